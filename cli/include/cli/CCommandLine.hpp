@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <cli/CResultPrinter.hpp>
+#include <search/CSearchQuery.hpp>
+#include <search/CSearchSettings.hpp>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Parses the arguments of the command-line program and turns
+ * them into a search query.
+ *
+ * All filters given on the command line must match (they are combined
+ * with AND). The case and whole match options apply to every filter.
+ */
+class CCommandLine {
+public:
+    explicit CCommandLine();
+
+    /**
+     * @brief Parse the program arguments.
+     *
+     * @return true on success, false if the arguments are invalid, in
+     *         which case getError() describes the problem
+     */
+    bool parse(int const argc, char const *const argv[]);
+
+    /**
+     * @brief Create a search query with the filters and options from the
+     * command line. The caller takes ownership of the query, and the query
+     * owns its filters. Directories and observers are not set.
+     *
+     * @throws std::regex_error if a regex filter has an invalid pattern
+     * @throws std::invalid_argument if a term query is malformed
+     */
+    CSearchQuery *createQuery() const;
+
+    std::vector<std::filesystem::path> const &getRoots() const { return m_roots; }
+
+    /**
+     * @brief Get the file listing the files to search instead of the
+     * directories ("-" for standard input), or an empty path to search
+     * the directories.
+     */
+    std::filesystem::path const &getFilesFromPath() const { return m_filesFromPath; }
+    CResultPrinter::Format getFormat() const { return m_format; }
+    bool isNullSeparated() const { return m_isNullSeparated; }
+    bool isSorted() const { return m_isSorted; }
+    bool isQuiet() const { return m_isQuiet; }
+    bool isExplainRequested() const { return m_isExplainRequested; }
+    bool isStatsRequested() const { return m_isStatsRequested; }
+    std::filesystem::path const &getCachePath() const { return m_cachePath; }
+    std::filesystem::path const &getVerdictCachePath() const { return m_verdictCachePath; }
+    std::filesystem::path const &getTracePath() const { return m_tracePath; }
+    CSearchSettings const &getSettings() const { return m_settings; }
+    bool isHelpRequested() const { return m_isHelpRequested; }
+    std::string const &getError() const { return m_error; }
+
+    /**
+     * @brief Get the help text listing all options.
+     */
+    static std::string getUsage();
+
+private:
+    enum class FilterKind { Name, FuzzyName, Contents, ApproxContents, Terms };
+
+    struct CFilterSpec {
+        FilterKind kind;
+        std::wstring matchText;
+        bool isRegex;
+    };
+
+    bool parseOption(std::string const &name, std::string const *value);
+
+    std::vector<std::filesystem::path> m_roots;
+    std::vector<CFilterSpec> m_filterSpecs;
+    std::filesystem::path m_filesFromPath;
+    std::filesystem::path m_cachePath;
+    std::filesystem::path m_verdictCachePath;
+    std::filesystem::path m_tracePath;
+    CSearchSettings m_settings;
+    CRanking m_ranking;
+    CResultPrinter::Format m_format;
+    bool m_isCaseInsensitive;
+    bool m_isWholeMatch;
+    bool m_respectIgnoreFiles;
+    bool m_followSymlinks;
+    bool m_searchArchives;
+    bool m_isNullSeparated;
+    bool m_isSorted;
+    bool m_isQuiet;
+    bool m_isExplainRequested;
+    bool m_isStatsRequested;
+    bool m_isHelpRequested;
+    bool m_hasIoConcurrency;
+    size_t m_maxEdits;
+    std::string m_error;
+};
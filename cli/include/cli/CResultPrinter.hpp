@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <search/ISearchObserver.hpp>
+
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Search observer which prints matched files to an output stream,
+ * for example stdout.
+ *
+ * In unordered mode, every match is printed as soon as it is found, in
+ * whatever order the worker threads find them. In sorted mode, matches
+ * are collected and printed sorted by path when finish() is called.
+ * The final results of a ranked search are printed in rank order when
+ * finish() is called, regardless of the mode.
+ */
+class CResultPrinter : public ISearchObserver {
+public:
+    enum class Format { Plain, Csv, NdJson };
+
+    /**
+     * @brief Create the printer. The printer does NOT take ownership of
+     * the output stream.
+     *
+     * @param nullSeparated if true, plain paths are terminated by a NUL
+     *        character instead of a line feed, for use with xargs -0
+     */
+    CResultPrinter(std::FILE *output, Format const format,
+                   bool const nullSeparated, bool const sorted);
+
+    // Implementation of ISearchObserver::onFileMatched
+    virtual void onFileMatched(std::filesystem::path const &matchedFile) override;
+
+    // Implementation of ISearchObserver::onRankedResults
+    virtual void onRankedResults(std::vector<CRankedResult> const &results, bool const isFinal) override;
+
+    /**
+     * @brief Print any collected matches and flush the output. Must be
+     * called after the search has completed.
+     */
+    void finish();
+
+private:
+    void print(std::filesystem::path const &matchedFile);
+
+    std::FILE *m_output;
+    Format const m_format;
+    bool const m_isNullSeparated;
+    bool const m_isSorted;
+
+    std::mutex m_mutex;
+    std::string m_line;
+    std::vector<std::filesystem::path> m_results;
+    std::vector<CRankedResult> m_rankedResults;
+};
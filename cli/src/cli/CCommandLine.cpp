@@ -0,0 +1,420 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <cli/CCommandLine.hpp>
+
+#include <search/CFilterContents.hpp>
+#include <search/CFilterFuzzyName.hpp>
+#include <search/CFilterName.hpp>
+#include <search/CFilterTerms.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+
+// Edits a fuzzy name may differ by unless --max-edits says otherwise
+#define DEFAULT_MAX_EDITS 2
+
+struct COptionInfo {
+    char const *shortName;
+    char const *longName;
+    bool takesValue;
+};
+
+static COptionInfo const OPTIONS[] = {
+    { "-n",    "--name",           true },
+    { "-N",    "--name-regex",     true },
+    { "-F",    "--fuzzy-name",     true },
+    { nullptr, "--max-edits",      true },
+    { "-c",    "--content",        true },
+    { "-e",    "--regex",          true },
+    { "-a",    "--approx",         true },
+    { "-Q",    "--query",          true },
+    { "-i",    "--ignore-case",    false },
+    { "-w",    "--whole-match",    false },
+    { "-g",    "--respect-ignore", false },
+    { "-L",    "--follow",         false },
+    { nullptr, "--archives",       false },
+    { "-T",    "--files-from",     true },
+    { "-0",    "--null",           false },
+    { "-s",    "--sort",           false },
+    { "-f",    "--format",         true },
+    { "-q",    "--quiet",          false },
+    { nullptr, "--cache",          true },
+    { nullptr, "--verdict-cache",  true },
+    { nullptr, "--top",            true },
+    { nullptr, "--rank-by",        true },
+    { "-j",    "--threads",        true },
+    { nullptr, "--io-threads",     true },
+    { nullptr, "--memory",         true },
+    { nullptr, "--explain",        false },
+    { nullptr, "--stats",          false },
+    { nullptr, "--trace",          true },
+    { "-h",    "--help",           false },
+};
+
+static COptionInfo const *findOption(std::string const &name) {
+    for(COptionInfo const &option : OPTIONS) {
+        if((option.shortName && name == option.shortName) || name == option.longName) {
+            return &option;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Convert a command-line argument, which is in the encoding of the
+ * global locale, to a wide string. std::filesystem is no help here: with
+ * libstdc++, its conversions to wide strings fail outside ASCII.
+ */
+static std::wstring widen(std::string const &text) {
+    std::wstring wide(text.size(), L'\0');
+    size_t const size = std::mbstowcs(&wide[0], text.c_str(), wide.size());
+
+    // Not valid in the locale's encoding; keep the bytes as they are.
+    if(size == static_cast<size_t>(-1)) {
+        return std::wstring(text.begin(), text.end());
+    }
+
+    wide.resize(size);
+    return wide;
+}
+
+/**
+ * @brief Parse a positive decimal number.
+ *
+ * @return true on success, false if the text is not a positive number
+ */
+static bool parseCount(std::string const &text, std::uint64_t &count) {
+    if(text.empty() || text.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+
+    try {
+        count = std::stoull(text);
+    } catch(std::out_of_range const &) {
+        return false;
+    }
+
+    return count > 0;
+}
+
+CCommandLine::CCommandLine()
+    : m_format(CResultPrinter::Format::Plain),
+      m_isCaseInsensitive(false),
+      m_isWholeMatch(false),
+      m_respectIgnoreFiles(false),
+      m_followSymlinks(false),
+      m_searchArchives(false),
+      m_isNullSeparated(false),
+      m_isSorted(false),
+      m_isQuiet(false),
+      m_isExplainRequested(false),
+      m_isStatsRequested(false),
+      m_isHelpRequested(false),
+      m_hasIoConcurrency(false),
+      m_maxEdits(DEFAULT_MAX_EDITS)
+{
+    // nothing to do
+}
+
+bool CCommandLine::parse(int const argc, char const *const argv[]) {
+    bool isEndOfOptions = false;
+
+    for(int i = 1; i < argc; ++i) {
+        std::string const arg = argv[i];
+
+        if(isEndOfOptions || arg.size() < 2 || arg[0] != '-') {
+            m_roots.push_back(std::filesystem::u8path(arg));
+            continue;
+        }
+
+        if(arg == "--") {
+            isEndOfOptions = true;
+            continue;
+        }
+
+        // Long options may be given as --name=value, short ones taking a
+        // value as -nvalue.
+        std::string name = arg;
+        std::string inlineValue;
+        bool hasInlineValue = false;
+
+        size_t const equalsPos = arg.find('=');
+        if(arg.compare(0, 2, "--") == 0) {
+            if(equalsPos != std::string::npos) {
+                name = arg.substr(0, equalsPos);
+                inlineValue = arg.substr(equalsPos + 1);
+                hasInlineValue = true;
+            }
+        } else if(arg.size() > 2) {
+            COptionInfo const *const shortOption = findOption(arg.substr(0, 2));
+
+            if(shortOption && shortOption->takesValue) {
+                name = arg.substr(0, 2);
+                inlineValue = arg.substr(2);
+                hasInlineValue = true;
+            }
+        }
+
+        COptionInfo const *option = findOption(name);
+
+        if(!option) {
+            m_error = "unknown option " + name;
+            return false;
+        }
+
+        std::string const *value = nullptr;
+
+        if(option->takesValue) {
+            if(hasInlineValue) {
+                value = &inlineValue;
+            } else if(i + 1 < argc) {
+                inlineValue = argv[++i];
+                value = &inlineValue;
+            } else {
+                m_error = "option " + name + " requires a value";
+                return false;
+            }
+        } else if(hasInlineValue) {
+            m_error = "option " + name + " does not take a value";
+            return false;
+        }
+
+        if(!parseOption(option->longName, value)) {
+            return false;
+        }
+    }
+
+    if(!m_filesFromPath.empty()) {
+        if(!m_roots.empty()) {
+            m_error = "directories cannot be searched together with --files-from";
+            return false;
+        }
+    } else if(m_roots.empty()) {
+        m_roots.push_back(".");
+    }
+
+    // Unless limited explicitly, every worker may read at the same time.
+    if(!m_hasIoConcurrency) {
+        m_settings.setIoConcurrency(m_settings.getWorkerThreads());
+    }
+
+    // --top alone ranks by modification time, newest first.
+    if(m_ranking.count > 0 && m_ranking.key == CRanking::Key::None) {
+        m_ranking.key = CRanking::Key::ModifiedTime;
+        m_ranking.isDescending = true;
+    }
+
+    // Nobody looks at the statistics unless they are printed.
+    m_settings.setCollectStats(m_isStatsRequested);
+
+    return true;
+}
+
+bool CCommandLine::parseOption(std::string const &name, std::string const *value) {
+    if(name == "--name") {
+        m_filterSpecs.push_back({ FilterKind::Name, widen(*value), false });
+    } else if(name == "--name-regex") {
+        m_filterSpecs.push_back({ FilterKind::Name, widen(*value), true });
+    } else if(name == "--fuzzy-name") {
+        m_filterSpecs.push_back({ FilterKind::FuzzyName, widen(*value), false });
+    } else if(name == "--max-edits") {
+        std::uint64_t count = 0;
+
+        // Zero edits is a valid, if exact, fuzzy match.
+        if(*value != "0" && !parseCount(*value, count)) {
+            m_error = "option " + name + " requires a number";
+            return false;
+        }
+        m_maxEdits = static_cast<size_t>(count);
+    } else if(name == "--content") {
+        m_filterSpecs.push_back({ FilterKind::Contents, widen(*value), false });
+    } else if(name == "--query") {
+        m_filterSpecs.push_back({ FilterKind::Terms, widen(*value), false });
+    } else if(name == "--approx") {
+        m_filterSpecs.push_back({ FilterKind::ApproxContents, widen(*value), false });
+    } else if(name == "--regex") {
+        m_filterSpecs.push_back({ FilterKind::Contents, widen(*value), true });
+    } else if(name == "--ignore-case") {
+        m_isCaseInsensitive = true;
+    } else if(name == "--whole-match") {
+        m_isWholeMatch = true;
+    } else if(name == "--respect-ignore") {
+        m_respectIgnoreFiles = true;
+    } else if(name == "--follow") {
+        m_followSymlinks = true;
+    } else if(name == "--archives") {
+        m_searchArchives = true;
+    } else if(name == "--files-from") {
+        m_filesFromPath = std::filesystem::u8path(*value);
+    } else if(name == "--null") {
+        m_isNullSeparated = true;
+    } else if(name == "--sort") {
+        m_isSorted = true;
+    } else if(name == "--format") {
+        if(*value == "plain") {
+            m_format = CResultPrinter::Format::Plain;
+        } else if(*value == "csv") {
+            m_format = CResultPrinter::Format::Csv;
+        } else if(*value == "ndjson") {
+            m_format = CResultPrinter::Format::NdJson;
+        } else {
+            m_error = "unknown format " + *value + " (expected plain, csv or ndjson)";
+            return false;
+        }
+    } else if(name == "--quiet") {
+        m_isQuiet = true;
+    } else if(name == "--cache") {
+        m_cachePath = std::filesystem::u8path(*value);
+    } else if(name == "--verdict-cache") {
+        m_verdictCachePath = std::filesystem::u8path(*value);
+    } else if(name == "--rank-by") {
+        if(*value == "mtime") {
+            m_ranking.key = CRanking::Key::ModifiedTime;
+        } else if(*value == "size") {
+            m_ranking.key = CRanking::Key::Size;
+        } else if(*value == "path") {
+            m_ranking.key = CRanking::Key::Path;
+        } else if(*value == "matches") {
+            m_ranking.key = CRanking::Key::MatchCount;
+        } else if(*value == "similarity") {
+            m_ranking.key = CRanking::Key::NameSimilarity;
+        } else {
+            m_error = "unknown ranking " + *value + " (expected mtime, size, path, matches or similarity)";
+            return false;
+        }
+        m_ranking.isDescending = CRanking::isDescendingByDefault(m_ranking.key);
+    } else if(name == "--threads" || name == "--io-threads" || name == "--memory" || name == "--top") {
+        std::uint64_t count = 0;
+
+        if(!parseCount(*value, count)) {
+            m_error = "option " + name + " requires a positive number";
+            return false;
+        }
+
+        if(name == "--threads") {
+            m_settings.setWorkerThreads(static_cast<size_t>(count));
+        } else if(name == "--top") {
+            m_ranking.count = static_cast<size_t>(count);
+        } else if(name == "--io-threads") {
+            m_settings.setIoConcurrency(static_cast<size_t>(count));
+            m_hasIoConcurrency = true;
+        } else {
+            m_settings.setMemoryBudget(count * 1024 * 1024);
+        }
+    } else if(name == "--explain") {
+        m_isExplainRequested = true;
+    } else if(name == "--stats") {
+        m_isStatsRequested = true;
+    } else if(name == "--trace") {
+        m_tracePath = std::filesystem::u8path(*value);
+    } else if(name == "--help") {
+        m_isHelpRequested = true;
+    }
+
+    return true;
+}
+
+CSearchQuery *CCommandLine::createQuery() const {
+    std::vector<IFilter *> filters;
+
+    // An invalid regex or term query makes the filter constructor throw. Don't leak
+    // the filters that were already created in that case.
+    try {
+        for(CFilterSpec const &spec : m_filterSpecs) {
+            if(spec.kind == FilterKind::Name) {
+                filters.push_back(new CFilterName(spec.matchText, m_isCaseInsensitive, m_isWholeMatch, spec.isRegex));
+            } else if(spec.kind == FilterKind::FuzzyName) {
+                filters.push_back(new CFilterFuzzyName(spec.matchText, m_maxEdits, m_isCaseInsensitive, m_isWholeMatch));
+            } else if(spec.kind == FilterKind::Terms) {
+                filters.push_back(new CFilterTerms(spec.matchText, m_isCaseInsensitive));
+            } else if(spec.kind == FilterKind::ApproxContents) {
+                filters.push_back(new CFilterContents(spec.matchText, m_isCaseInsensitive, m_isWholeMatch, false, m_maxEdits));
+            } else {
+                filters.push_back(new CFilterContents(spec.matchText, m_isCaseInsensitive, m_isWholeMatch, spec.isRegex));
+            }
+        }
+    } catch(...) {
+        for(IFilter *filter : filters) {
+            delete filter;
+        }
+        throw;
+    }
+
+    CSearchQuery *searchQuery = new CSearchQuery;
+    searchQuery->setFilters(filters);
+    searchQuery->setRespectIgnoreFiles(m_respectIgnoreFiles);
+    searchQuery->setFollowSymlinks(m_followSymlinks);
+    searchQuery->setSearchArchives(m_searchArchives);
+    searchQuery->setRanking(m_ranking);
+    return searchQuery;
+}
+
+std::string CCommandLine::getUsage() {
+    return
+        "Usage: LightningSearchCli [OPTION]... [DIRECTORY]...\n"
+        "  or:  LightningSearchCli [OPTION]... --files-from FILE\n"
+        "Search the given directories (the current directory by default) for files\n"
+        "matching all of the given filters.\n"
+        "\n"
+        "Filters:\n"
+        "  -n, --name TEXT         file name contains TEXT\n"
+        "  -N, --name-regex REGEX  file name matches REGEX\n"
+        "  -F, --fuzzy-name TEXT   file name contains TEXT, give or take a few typos\n"
+        "  -c, --content TEXT      file contents contain TEXT\n"
+        "  -e, --regex REGEX       file contents match REGEX\n"
+        "  -a, --approx TEXT       file contents contain TEXT, give or take a few typos\n"
+        "  -Q, --query QUERY       file contents contain all terms of QUERY, read in\n"
+        "                          one pass. Terms are separated by spaces or AND;\n"
+        "                          NOT A excludes files containing A, and\n"
+        "                          A NEAR/N B requires at most N characters\n"
+        "                          between A and B. Quote terms with spaces in\n"
+        "                          double quotes.\n"
+        "      --max-edits N       let fuzzy names and approximate contents differ\n"
+        "                          from TEXT by at most N inserted, deleted or\n"
+        "                          replaced characters (default: 2)\n"
+        "  -i, --ignore-case       match all filters case-insensitively\n"
+        "  -w, --whole-match       filters must match the whole name or contents\n"
+        "  -g, --respect-ignore    skip files excluded by .gitignore and .ignore\n"
+        "  -L, --follow            follow symbolic links to directories\n"
+        "      --archives          also search the members of zip and tar archives,\n"
+        "                          reported as ARCHIVE!/MEMBER\n"
+        "  -T, --files-from FILE   search only the files listed in FILE (- for\n"
+        "                          standard input), one per line or NUL-separated\n"
+        "                          with -0, instead of the directories. Refines the\n"
+        "                          output of an earlier search without walking the\n"
+        "                          tree again\n"
+        "      --cache FILE        reuse results of earlier runs stored in FILE, and\n"
+        "                          store the results of this run there\n"
+        "      --verdict-cache FILE\n"
+        "                          remember per file whether each content filter\n"
+        "                          matched, across queries and runs, in FILE\n"
+        "\n"
+        "Ranking:\n"
+        "      --top K             print only the K best matches, once the search is\n"
+        "                          done\n"
+        "      --rank-by KEY       rank by mtime (newest first, the default), size\n"
+        "                          (largest first), path (A to Z), matches (most\n"
+        "                          content matches first) or similarity (names\n"
+        "                          closest to the fuzzy name first)\n"
+        "\n"
+        "Resources:\n"
+        "  -j, --threads N         search with N worker threads (default: the number\n"
+        "                          of CPUs available, including container limits)\n"
+        "      --io-threads N      read at most N files at the same time\n"
+        "      --memory MIB        use at most MIB mebibytes for file buffers\n"
+        "\n"
+        "Output:\n"
+        "  -0, --null              terminate paths with NUL instead of a line feed\n"
+        "  -s, --sort              print matches sorted by path once the search is done\n"
+        "  -f, --format FORMAT     plain (default), csv or ndjson\n"
+        "  -q, --quiet             do not print statistics to stderr\n"
+        "      --explain           print the search plan to stderr\n"
+        "      --stats             print the time spent in each stage of the search\n"
+        "                          to stderr\n"
+        "      --trace FILE        write a timeline of the search to FILE in Chrome\n"
+        "                          trace format, for Perfetto or chrome://tracing\n"
+        "  -h, --help              show this help and exit\n"
+        "\n"
+        "Exit status is 0 if a file matched, 1 if none matched, and 2 if an error\n"
+        "occurred.\n";
+}
@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <cli/CResultPrinter.hpp>
+
+#include <search/CResultExporter.hpp>
+
+#include <algorithm>
+
+CResultPrinter::CResultPrinter(std::FILE *output, Format const format,
+                               bool const nullSeparated, bool const sorted)
+    : m_output(output),
+      m_format(format),
+      m_isNullSeparated(nullSeparated),
+      m_isSorted(sorted)
+{
+    if(m_format == Format::Csv) {
+        std::fputs("path\n", m_output);
+    }
+}
+
+void CResultPrinter::onFileMatched(std::filesystem::path const &matchedFile) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if(m_isSorted) {
+        m_results.push_back(matchedFile);
+    } else {
+        print(matchedFile);
+    }
+}
+
+void CResultPrinter::onRankedResults(std::vector<CRankedResult> const &results, bool const isFinal) {
+    // Interim snapshots are of no use for a printed list.
+    if(!isFinal) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_rankedResults = results;
+}
+
+void CResultPrinter::print(std::filesystem::path const &matchedFile) {
+    m_line.clear();
+
+    switch(m_format) {
+        case Format::Plain:
+            m_line = matchedFile.u8string();
+            m_line += m_isNullSeparated ? '\0' : '\n';
+            break;
+
+        case Format::Csv:
+            CResultExporter::formatRow(CResultExporter::Format::Csv, matchedFile, m_line);
+            break;
+
+        case Format::NdJson:
+            CResultExporter::formatRow(CResultExporter::Format::NdJson, matchedFile, m_line);
+            break;
+    }
+
+    std::fwrite(m_line.data(), 1, m_line.size(), m_output);
+}
+
+void CResultPrinter::finish() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if(m_isSorted) {
+        std::sort(m_results.begin(), m_results.end());
+
+        for(std::filesystem::path const &matchedFile : m_results) {
+            print(matchedFile);
+        }
+
+        m_results.clear();
+    }
+
+    for(CRankedResult const &result : m_rankedResults) {
+        print(result.path);
+    }
+
+    m_rankedResults.clear();
+
+    std::fflush(m_output);
+}
@@ -0,0 +1,238 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <cli/CCommandLine.hpp>
+#include <cli/CResultPrinter.hpp>
+#include <CTraceRecorder.hpp>
+#include <search/CResultCache.hpp>
+#include <search/CVerdictCache.hpp>
+#include <search/CSearchEngine.hpp>
+
+#include <chrono>
+#include <climits>
+#include <cwchar>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <locale>
+#include <regex>
+#include <stdexcept>
+
+// Exit codes follow the convention of grep.
+#define EXIT_MATCH 0
+#define EXIT_NO_MATCH 1
+#define EXIT_ERROR 2
+
+/**
+ * @brief Convert a wide string to the encoding of the global locale, for
+ * printing. Characters the encoding lacks are replaced by '?'.
+ */
+static std::string narrow(std::wstring const &text) {
+    std::string narrowText;
+    char buffer[MB_LEN_MAX];
+    std::mbstate_t state{};
+
+    for(wchar_t const c : text) {
+        size_t const size = std::wcrtomb(buffer, c, &state);
+
+        if(size == static_cast<size_t>(-1)) {
+            narrowText += '?';
+            state = std::mbstate_t{};
+        } else {
+            narrowText.append(buffer, size);
+        }
+    }
+
+    return narrowText;
+}
+
+/**
+ * @brief Read the list of files to search, one UTF-8 path per line or
+ * terminated by NUL characters, as printed by an earlier search.
+ *
+ * @return false if the list cannot be read
+ */
+static bool readFileList(std::filesystem::path const &listPath,
+                         bool const isNullSeparated,
+                         std::vector<CSearchFile> &searchFiles) {
+    std::ifstream listFile;
+    std::istream *in = &std::cin;
+
+    if(listPath != "-") {
+        listFile.open(listPath, std::ios::binary);
+        if(!listFile) {
+            return false;
+        }
+        in = &listFile;
+    }
+
+    std::string line;
+    while(std::getline(*in, line, isNullSeparated ? '\0' : '\n')) {
+        if(!isNullSeparated && !line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+
+        if(!line.empty()) {
+            CSearchFile searchFile;
+            searchFile.path = std::filesystem::u8path(line);
+            searchFiles.push_back(std::move(searchFile));
+        }
+    }
+
+    return !in->bad();
+}
+
+int main(int argc, char *argv[]) {
+    auto const startTime = std::chrono::steady_clock::now();
+
+    // File contents are decoded with the global locale, which should be
+    // the user's, as for grep. Under the classic "C" locale, UTF-8 text
+    // stops decoding at its first character outside ASCII.
+    try {
+        std::locale::global(std::locale(""));
+    } catch(std::runtime_error const &) {
+        std::cerr << "LightningSearchCli: warning: cannot use the locale of the environment\n";
+    }
+
+    CCommandLine commandLine;
+
+    if(!commandLine.parse(argc, argv)) {
+        std::cerr << "LightningSearchCli: " << commandLine.getError() << "\n"
+                  << "Try 'LightningSearchCli --help' for more information.\n";
+        return EXIT_ERROR;
+    }
+
+    if(commandLine.isHelpRequested()) {
+        std::cout << CCommandLine::getUsage();
+        return EXIT_MATCH;
+    }
+
+    bool hasError = false;
+    std::vector<std::filesystem::path> roots;
+
+    for(std::filesystem::path const &root : commandLine.getRoots()) {
+        std::error_code ec;
+
+        if(!std::filesystem::is_directory(root, ec)) {
+            std::cerr << "LightningSearchCli: " << root.u8string() << ": not a directory\n";
+            hasError = true;
+            continue;
+        }
+
+        roots.push_back(root);
+    }
+
+    std::vector<CSearchFile> searchFiles;
+    bool const hasFileList = !commandLine.getFilesFromPath().empty();
+
+    if(hasFileList && !readFileList(commandLine.getFilesFromPath(), commandLine.isNullSeparated(), searchFiles)) {
+        std::cerr << "LightningSearchCli: cannot read file list " << commandLine.getFilesFromPath().u8string() << "\n";
+        return EXIT_ERROR;
+    }
+
+    if(roots.empty() && !hasFileList) {
+        std::cerr << "LightningSearchCli: no directory to search\n";
+        return EXIT_ERROR;
+    }
+
+    CResultPrinter printer(stdout, commandLine.getFormat(),
+                           commandLine.isNullSeparated(), commandLine.isSorted());
+
+    CSearchQuery *searchQuery = nullptr;
+
+    try {
+        searchQuery = commandLine.createQuery();
+    } catch(std::regex_error const &e) {
+        std::cerr << "LightningSearchCli: invalid regular expression: " << e.what() << "\n";
+        return EXIT_ERROR;
+    } catch(std::invalid_argument const &e) {
+        std::cerr << "LightningSearchCli: invalid query: " << e.what() << "\n";
+        return EXIT_ERROR;
+    }
+
+    searchQuery->setDirectories(roots);
+
+    if(hasFileList) {
+        searchQuery->setSearchFiles(std::move(searchFiles));
+    }
+    searchQuery->addResultObserver(&printer);
+
+    // A missing or unreadable cache file just means starting with an
+    // empty cache.
+    CResultCache resultCache;
+    bool const useCache = !commandLine.getCachePath().empty();
+
+    if(useCache) {
+        resultCache.load(commandLine.getCachePath());
+    }
+
+    CVerdictCache verdictCache;
+    bool const useVerdictCache = !commandLine.getVerdictCachePath().empty();
+
+    if(useVerdictCache) {
+        verdictCache.load(commandLine.getVerdictCachePath());
+    }
+
+    // Declared before the engine, so that it outlives the engine's
+    // threads, which record into it until they end.
+    CTraceRecorder traceRecorder;
+    bool const useTrace = !commandLine.getTracePath().empty();
+
+    // The engine takes ownership of the query.
+    CSearchEngine searchEngine(searchQuery, commandLine.getSettings());
+
+    if(useCache) {
+        searchEngine.setResultCache(&resultCache);
+    }
+
+    if(useVerdictCache) {
+        searchEngine.setVerdictCache(&verdictCache);
+    }
+
+    if(useTrace) {
+        searchEngine.setTraceRecorder(&traceRecorder);
+    }
+
+    if(commandLine.isExplainRequested()) {
+        std::cerr << narrow(searchEngine.getSearchPlan().getText());
+    }
+
+    searchEngine.performSearch();
+    searchEngine.waitForCompletion();
+
+    printer.finish();
+
+    if(useCache && !resultCache.save(commandLine.getCachePath())) {
+        std::cerr << "LightningSearchCli: cannot write cache file " << commandLine.getCachePath().u8string() << "\n";
+        hasError = true;
+    }
+
+    if(useVerdictCache && !verdictCache.save(commandLine.getVerdictCachePath())) {
+        std::cerr << "LightningSearchCli: cannot write verdict cache file " << commandLine.getVerdictCachePath().u8string() << "\n";
+        hasError = true;
+    }
+
+    if(useTrace && !traceRecorder.writeJson(commandLine.getTracePath())) {
+        std::cerr << "LightningSearchCli: cannot write trace file " << commandLine.getTracePath().u8string() << "\n";
+        hasError = true;
+    }
+
+    int const totalMatches = searchEngine.getTotalMatches();
+
+    if(!commandLine.isQuiet()) {
+        std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - startTime;
+
+        std::cerr << "Searched " << searchEngine.getTotalFilesSearched() << " files, "
+                  << totalMatches << " matches in "
+                  << std::fixed << std::setprecision(3) << elapsed.count() << " s\n";
+    }
+
+    if(commandLine.isStatsRequested()) {
+        std::cerr << narrow(searchEngine.getStats()->getText());
+    }
+
+    if(hasError) {
+        return EXIT_ERROR;
+    }
+
+    return totalMatches > 0 ? EXIT_MATCH : EXIT_NO_MATCH;
+}
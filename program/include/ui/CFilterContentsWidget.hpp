@@ -7,6 +7,7 @@
 #include <QLineEdit>
 #include <QCheckBox>
 #include <QHBoxLayout>
+#include <QSpinBox>
 
 class CFilterContentsWidget : public IFilterWidget
 {
@@ -26,4 +27,6 @@ private:
     QCheckBox *m_caseSensitiveCheck;
     QCheckBox *m_wholeMatchCheck;
     QCheckBox *m_regexModeCheck;
+    QCheckBox *m_termQueryCheck;
+    QSpinBox *m_maxEditsSpin;
 };
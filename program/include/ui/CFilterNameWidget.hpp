@@ -7,6 +7,7 @@
 #include <QLineEdit>
 #include <QCheckBox>
 #include <QHBoxLayout>
+#include <QSpinBox>
 
 class CFilterNameWidget : public IFilterWidget
 {
@@ -26,4 +27,5 @@ private:
     QCheckBox *m_caseSensitiveCheck;
     QCheckBox *m_wholeMatchCheck;
     QCheckBox *m_regexModeCheck;
+    QSpinBox *m_maxEditsSpin;
 };
@@ -1,10 +1,14 @@
 // SPDX-License-Identifier: GPL-2.0
 #pragma once
 
+#include <search/CResultCache.hpp>
+#include <search/CResultExporter.hpp>
 #include <search/CSearchEngine.hpp>
+#include <search/CVerdictCache.hpp>
 #include <ui/CSearchResultModel.hpp>
 #include <ui/CFilterListWidget.hpp>
 #include <ui/CFolderListWidget.hpp>
+#include <ui/CStartSearchDialog.hpp>
 
 #include <QAction>
 #include <QMainWindow>
@@ -26,6 +30,9 @@ public:
 
 private slots:
     void onSearchClicked();
+    void onRefineClicked();
+    void onStatisticsClicked();
+    void onFilterTextChanged(QString const &text);
     void updateTick();
 
 private:
@@ -34,15 +41,42 @@ private:
     void createActions();
     void createMenus();
 
+    void stopSearch();
+
+    /**
+     * @brief Start a search with the options of a dialog the user has
+     * accepted, over the given files if it refines the current results.
+     */
+    void startSearch(CStartSearchDialog &dialog, std::vector<CSearchFile> *searchFiles);
+
+    static std::filesystem::path getVerdictCachePath();
+
     CSearchEngine *m_searchEngine;
+    CResultExporter *m_resultExporter; // Owned, may be null
+
+    // Results of earlier searches in this session. Repeating a search
+    // only rescans the directories and files that have changed.
+    CResultCache m_resultCache;
+
+    // Content filter verdicts per file, shared by all searches and kept
+    // on disk between sessions.
+    CVerdictCache m_verdictCache;
 
     QTimer *m_updateTimer;
     QPushButton *m_searchBtn;
+    QPushButton *m_refineBtn;
+    QLineEdit *m_filterEdit;
     QTableView *m_tableView;
 
     CSearchResultModel *m_resultModel; // Owned by the Qt parent system
 
+    // Whether the last search looked inside archives. Searches refining
+    // its results treat archive members the same way.
+    bool m_isSearchingArchives;
+
     QAction *m_newAct;
+    QAction *m_refineAct;
+    QAction *m_statsAct;
     QAction *m_exitAct;
 
     QMenu *m_fileMenu;
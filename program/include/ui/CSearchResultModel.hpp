@@ -1,19 +1,50 @@
 // SPDX-License-Identifier: GPL-2.0
 #pragma once
 
+#include <search/CResultTable.hpp>
+#include <search/CSearchQuery.hpp>
 #include <search/ISearchObserver.hpp>
 
 #include <QAbstractTableModel>
 #include <QString>
 
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
 #include <vector>
-#include <filesystem>
 
+/**
+ * @brief Table model of the files matched by a search, with columns for
+ * the name, folder, size and modification time of each file.
+ *
+ * Results are kept in a CResultTable, and display strings are only built
+ * for the cells the view asks for, once per distinct name and folder.
+ * Matches arrive from the search threads and are added to the table in
+ * batches on the GUI thread.
+ *
+ * Sorting (see sort) and filtering (see setFilterText) compute a view of
+ * the table on a background thread, so the GUI stays responsive with
+ * millions of rows. Once ready, the view replaces the current one in a
+ * single model reset. While a search adds rows to a sorted or filtered
+ * view, the view is recomputed every VIEW_REFRESH_MS.
+ */
 class CSearchResultModel : public QAbstractTableModel, public ISearchObserver {
     Q_OBJECT
-    
+
 public:
+    enum ColumnIndex {
+        NAME_COLUMN,
+        FOLDER_COLUMN,
+        SIZE_COLUMN,
+        MODIFIED_COLUMN,
+        COLUMN_COUNT
+    };
+
     CSearchResultModel(QObject *parent = nullptr);
     virtual ~CSearchResultModel();
 
@@ -26,17 +57,127 @@ public:
     // Implementation of QAbstractTableModel::headerData
     Q_INVOKABLE virtual QVariant headerData(int section, Qt::Orientation orientation,
                                 int role = Qt::DisplayRole) const;
-                                
+
     // Implementation of QAbstractTableModel::data
     Q_INVOKABLE virtual QVariant data(QModelIndex const &index, int role) const;
 
+    /**
+     * @brief Sort the rows by a column, in the background. A negative
+     * column shows the rows in the order they were found.
+     */
+    virtual void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
+
     // Implementation of ISearchObserver::on_file_matched
     virtual void onFileMatched(std::filesystem::path const &matchedFile);
 
+    /**
+     * @brief Show only the rows whose name or folder contains the text,
+     * ignoring case. The view is filtered in the background.
+     */
+    void setFilterText(QString const &filterText);
+
     void clear();
 
+    /**
+     * @brief Get the files shown, with their size and modification time,
+     * and clear the results for a search within them. While that search
+     * runs, matches take their size and time from here rather than being
+     * looked at again.
+     *
+     * Must not be called while a search reports matches to the model.
+     */
+    std::vector<CSearchFile> startRefine();
+
 private:
-    void fileResultAvailable(std::filesystem::path const matchedFile);
+    // A match waiting to be added to the table
+    struct CPendingRow {
+        std::filesystem::path path;
+        std::uint64_t size;
+        std::int64_t modifiedTime;
+    };
+
+    // Sorted or filtered rows of the table
+    using View = std::vector<CResultTable::Row>;
+
+    bool isViewActive() const { return m_sortColumn >= 0 || !m_filterText.isEmpty(); }
+
+    CResultTable::Row getTableRow(int row) const;
+
+    /**
+     * @brief Fill in the size and modification time of a match from the
+     * file system.
+     */
+    static void lookAtFile(CPendingRow &pendingRow);
+
+    QString const &getName(CResultTable::StringId const id) const;
+    QString const &getFolder(CResultTable::StringId const id) const;
+
+    /**
+     * @brief Add the pending rows to the table. Called on the GUI thread.
+     */
+    void addPendingRows();
+
+    /**
+     * @brief Show the rows in the order they were found, or start
+     * computing a view for the current sorting and filter.
+     */
+    void updateView();
+
+    /**
+     * @brief Start computing a view on the background thread. Only one
+     * view is computed at a time.
+     */
+    void startSelect();
+
+    /**
+     * @brief Schedule a refresh of the current view, which lacks rows
+     * added since it was computed.
+     */
+    void scheduleRefresh();
+
+    /**
+     * @brief Called on the GUI thread with a view computed by the
+     * background thread.
+     */
+    void viewSelected(std::uint64_t const generation,
+                      std::shared_ptr<View const> const &view,
+                      size_t const viewRowCount);
+
+    // Shared with the background thread, which may still read the
+    // table of an earlier search
+    std::shared_ptr<CResultTable> m_table;
+
+    // Rows shown, or null to show all rows of the table in the order
+    // they were found
+    std::shared_ptr<View const> m_view;
+
+    // Number of table rows the view was computed from
+    size_t m_viewRowCount;
+
+    int m_sortColumn;
+    Qt::SortOrder m_sortOrder;
+    QString m_filterText;
+
+    // Incremented whenever a computed view would no longer be current
+    std::uint64_t m_generation;
+
+    std::thread m_selectThread;
+    bool m_isSelecting;
+    bool m_isRefreshScheduled;
+    size_t m_threadCount;
+
+    // Display strings per string id of the table, built on demand
+    mutable std::vector<QString> m_names;
+    mutable std::vector<QString> m_folders;
+
+    // Size and modification time of the files a refined search searches,
+    // by path, or null. Only changed while no search is running.
+    std::shared_ptr<std::unordered_map<std::filesystem::path::string_type,
+                                       std::pair<std::uint64_t, std::int64_t>> const> m_knownFiles;
 
-    std::vector<std::filesystem::path> m_results;
+    // Matches reported by the search threads, and whether adding them
+    // has been posted to the GUI thread
+    std::mutex m_pendingMutex;
+    std::vector<CPendingRow> m_pendingRows;
+    bool m_isAddPosted;
 };
@@ -1,23 +1,58 @@
 // SPDX-License-Identifier: GPL-2.0
 #pragma once
 
+#include <search/CSearchSettings.hpp>
 #include <ui/CFilterListWidget.hpp>
 #include <ui/CFolderListWidget.hpp>
 
+#include <QCheckBox>
 #include <QDialog>
+#include <QLineEdit>
+#include <QSpinBox>
 
 class CStartSearchDialog : public QDialog
 {
     Q_OBJECT
 
 public:
-    explicit CStartSearchDialog(QWidget *parent = nullptr);
+    /**
+     * @brief Create the dialog. A refining dialog asks for the filters of
+     * a search within the current results, so it has no directories to
+     * choose.
+     */
+    explicit CStartSearchDialog(QWidget *parent = nullptr, bool const isRefining = false);
     virtual ~CStartSearchDialog();
 
     std::vector<std::filesystem::path> getDirectories();
     std::vector<IFilter *> getFilters();
+    bool isRespectIgnoreFiles() const;
+    bool isFollowSymlinks() const;
+    bool isSearchArchives() const;
+
+    /**
+     * @brief Get the file that results should be exported to while
+     * searching, or an empty path if results should not be exported.
+     */
+    std::filesystem::path getExportPath() const;
+
+    /**
+     * @brief Get the resources the search may use, as entered on the
+     * Settings tab.
+     */
+    CSearchSettings getSearchSettings() const;
+
+private slots:
+    void onBrowseExportClicked();
 
 private:
     CFolderListWidget *m_folderListWidget;
     CFilterListWidget *m_filterListWidget;
+    QCheckBox *m_respectIgnoreFilesCheck;
+    QCheckBox *m_followSymlinksCheck;
+    QCheckBox *m_searchArchivesCheck;
+    QCheckBox *m_exportCheck;
+    QLineEdit *m_exportPathEdit;
+    QSpinBox *m_workerThreadsSpin;
+    QSpinBox *m_ioConcurrencySpin;
+    QSpinBox *m_memoryBudgetSpin;
 };
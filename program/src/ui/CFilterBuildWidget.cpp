@@ -5,6 +5,10 @@
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QLabel>
+#include <QMessageBox>
+
+#include <regex>
+#include <stdexcept>
 
 // Qt MOC source file
 #include "ui/moc_CFilterBuildWidget.cpp"
@@ -76,8 +80,19 @@ void CFilterBuildWidget::onAddFilterClicked()
     // However, we only want to create the filter and emit the signal if the cast
     // actually succeeded.
     if(filterWidget) {
-        // Create the filter.
-        IFilter *filter = filterWidget->createFilter();
+        // Create the filter. Malformed regexes and term queries make
+        // the filter constructors throw.
+        IFilter *filter = nullptr;
+
+        try {
+            filter = filterWidget->createFilter();
+        } catch(std::regex_error const &e) {
+            QMessageBox::warning(this, tr("Add Filter"), tr("Invalid regular expression: %1").arg(e.what()));
+            return;
+        } catch(std::invalid_argument const &e) {
+            QMessageBox::warning(this, tr("Add Filter"), tr("Invalid query: %1").arg(e.what()));
+            return;
+        }
 
         // Emit the signal. Whoever is connected receives the new filter.
         emit filterCreated(filter);
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0
 #include <ui/CFilterContentsWidget.hpp>
 #include <search/CFilterContents.hpp>
+#include <search/CFilterTerms.hpp>
 
 // Qt MOC source file
 #include "ui/moc_CFilterContentsWidget.cpp"
@@ -23,12 +24,30 @@ CFilterContentsWidget::CFilterContentsWidget(QWidget* parent)
     m_regexModeCheck = new QCheckBox(tr("Regex mode"), this);
     m_regexModeCheck->setChecked(false);
 
+    m_termQueryCheck = new QCheckBox(tr("Term query"), this);
+    m_termQueryCheck->setChecked(false);
+    m_termQueryCheck->setToolTip(tr("Terms separated by spaces must all occur. "
+                                    "NOT term excludes a term, A NEAR/200 B puts at most "
+                                    "200 characters between A and B."));
+
+    // Zero edits is an exact match; anything more tolerates typos.
+    m_maxEditsSpin = new QSpinBox(this);
+    m_maxEditsSpin->setRange(0, 9);
+    m_maxEditsSpin->setValue(0);
+    m_maxEditsSpin->setPrefix(tr("Typos: "));
+    m_maxEditsSpin->setToolTip(tr("Number of inserted, deleted or replaced characters a match may differ by"));
+
+    // Regexes are never matched approximately.
+    connect(m_regexModeCheck, &QCheckBox::toggled, m_maxEditsSpin, &QSpinBox::setDisabled);
+
     // Add them to the layout
     layout->addWidget(label);
     layout->addWidget(m_lineEdit);
     layout->addWidget(m_caseSensitiveCheck);
     layout->addWidget(m_wholeMatchCheck);
     layout->addWidget(m_regexModeCheck);
+    layout->addWidget(m_termQueryCheck);
+    layout->addWidget(m_maxEditsSpin);
 
     setLayout(layout);
 }
@@ -39,6 +58,12 @@ IFilter *CFilterContentsWidget::createFilter()
     bool caseSensitive = m_caseSensitiveCheck->isChecked();
     bool wholeMatch = m_wholeMatchCheck->isChecked();
     bool regexMode = m_regexModeCheck->isChecked();
+    int maxEdits = m_maxEditsSpin->value();
+
+    // Throws std::invalid_argument if the query is malformed.
+    if(m_termQueryCheck->isChecked()) {
+        return new CFilterTerms(text, !caseSensitive);
+    }
 
-    return new CFilterContents(text, !caseSensitive, wholeMatch, regexMode);
+    return new CFilterContents(text, !caseSensitive, wholeMatch, regexMode, static_cast<size_t>(maxEdits));
 }
\ No newline at end of file
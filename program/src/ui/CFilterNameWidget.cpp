@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0
 #include <ui/CFilterNameWidget.hpp>
 
+#include <search/CFilterFuzzyName.hpp>
 #include <search/CFilterName.hpp>
 
 // Qt MOC source file
@@ -24,12 +25,23 @@ CFilterNameWidget::CFilterNameWidget(QWidget *parent)
     m_regexModeCheck = new QCheckBox(tr("Regex mode"), this);
     m_regexModeCheck->setChecked(false);
 
+    // Zero edits is an exact match; anything more tolerates typos.
+    m_maxEditsSpin = new QSpinBox(this);
+    m_maxEditsSpin->setRange(0, 9);
+    m_maxEditsSpin->setValue(0);
+    m_maxEditsSpin->setPrefix(tr("Typos: "));
+    m_maxEditsSpin->setToolTip(tr("Number of inserted, deleted or replaced characters a name may differ by"));
+
+    // Regexes are never matched approximately.
+    connect(m_regexModeCheck, &QCheckBox::toggled, m_maxEditsSpin, &QSpinBox::setDisabled);
+
     // Add them to the layout
     layout->addWidget(label);
     layout->addWidget(m_lineEdit);
     layout->addWidget(m_caseSensitiveCheck);
     layout->addWidget(m_wholeMatchCheck);
     layout->addWidget(m_regexModeCheck);
+    layout->addWidget(m_maxEditsSpin);
 
     setLayout(layout);
 }
@@ -40,6 +52,11 @@ IFilter *CFilterNameWidget::createFilter()
     bool caseSensitive = m_caseSensitiveCheck->isChecked();
     bool wholeMatch = m_wholeMatchCheck->isChecked();
     bool regexMode = m_regexModeCheck->isChecked();
+    int maxEdits = m_maxEditsSpin->value();
+
+    if(!regexMode && maxEdits > 0) {
+        return new CFilterFuzzyName(text, static_cast<size_t>(maxEdits), !caseSensitive, wholeMatch);
+    }
 
     return new CFilterName(text, !caseSensitive, wholeMatch, regexMode);
 }
\ No newline at end of file
@@ -5,10 +5,17 @@
 #include <ui/CStartSearchDialog.hpp>
 
 #include <QCoreApplication>
+#include <QDir>
+#include <QFontDatabase>
+#include <QHeaderView>
+#include <QMessageBox>
 #include <QMenuBar>
+#include <QStandardPaths>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 
+#include <stdexcept>
+
 // Qt MOC source file
 #include "ui/moc_CMainWindow.cpp"
 
@@ -24,16 +31,48 @@ CMainWindow::CMainWindow(QWidget *parent)
     // Set model to the QTableView
     m_tableView->setModel(m_resultModel);
 
+    // Show the results in the order they are found until a column header
+    // is clicked. The model sorts in the background.
+    m_tableView->horizontalHeader()->setSortIndicator(-1, Qt::AscendingOrder);
+    m_tableView->setSortingEnabled(true);
+
     m_searchEngine = nullptr;
+    m_resultExporter = nullptr;
+    m_isSearchingArchives = false;
 
     m_updateTimer = new QTimer(this);
     connect(m_updateTimer, SIGNAL(timeout()), this, SLOT(updateTick()));
     m_updateTimer->start(500);
+
+    // A missing cache file is not an error; it is written on exit.
+    m_verdictCache.load(getVerdictCachePath());
 }
 
 CMainWindow::~CMainWindow() {
+    stopSearch();
+
+    std::filesystem::path const verdictCachePath = getVerdictCachePath();
+    std::error_code ec;
+    std::filesystem::create_directories(verdictCachePath.parent_path(), ec);
+    m_verdictCache.save(verdictCachePath);
+}
+
+std::filesystem::path CMainWindow::getVerdictCachePath() {
+    QString const dataPath = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    return std::filesystem::path(QDir(dataPath).filePath("verdicts.cache").toStdWString());
+}
+
+void CMainWindow::stopSearch() {
     if(m_searchEngine) {
         delete m_searchEngine;
+        m_searchEngine = nullptr;
+    }
+
+    // The exporter is an observer of the search, so it can only be
+    // destroyed (which flushes the file) once the engine is gone.
+    if(m_resultExporter) {
+        delete m_resultExporter;
+        m_resultExporter = nullptr;
     }
 }
 
@@ -44,23 +83,99 @@ void CMainWindow::onSearchClicked() {
         return;
     }
 
+    // The old search must be gone before its results are cleared, since
+    // it reports to the result model until then.
+    stopSearch();
+
     // Clear previous results
     m_resultModel->clear();
 
-    if(m_searchEngine != nullptr) {
-        delete m_searchEngine;
+    m_isSearchingArchives = dialog.isSearchArchives();
+    startSearch(dialog, nullptr);
+}
+
+void CMainWindow::onRefineClicked() {
+    if(m_resultModel->rowCount() == 0) {
+        QMessageBox::information(this, tr("Refine Search"), tr("There are no results to search within."));
+        return;
+    }
+
+    CStartSearchDialog dialog(this, true);
+
+    if(dialog.exec() == QDialog::Rejected) {
+        return;
+    }
+
+    stopSearch();
+
+    // The files shown go straight to the new search, with the metadata
+    // already collected for them, so refining costs time in proportion
+    // to the results rather than to the directories they came from.
+    std::vector<CSearchFile> searchFiles = m_resultModel->startRefine();
+    startSearch(dialog, &searchFiles);
+}
+
+void CMainWindow::startSearch(CStartSearchDialog &dialog, std::vector<CSearchFile> *searchFiles) {
+    std::filesystem::path const exportPath = dialog.getExportPath();
+
+    if(!exportPath.empty()) {
+        // NDJSON for .ndjson/.jsonl/.json files, CSV otherwise.
+        std::filesystem::path const extension = exportPath.extension();
+        bool const isJson = extension == ".ndjson" || extension == ".jsonl" || extension == ".json";
+
+        try {
+            m_resultExporter = new CResultExporter(exportPath,
+                                                   isJson ? CResultExporter::Format::NdJson
+                                                          : CResultExporter::Format::Csv);
+        } catch(std::runtime_error const &) {
+            QMessageBox::warning(this, tr("Export Results"),
+                                 tr("Cannot write to the export file. Results will not be exported."));
+        }
     }
 
     CSearchQuery *searchQuery = new CSearchQuery;
-    searchQuery->setDirectories(dialog.getDirectories());
     searchQuery->setFilters(dialog.getFilters());
+    searchQuery->setSearchArchives(m_isSearchingArchives);
+
+    if(searchFiles) {
+        searchQuery->setSearchFiles(std::move(*searchFiles));
+    } else {
+        searchQuery->setDirectories(dialog.getDirectories());
+        searchQuery->setRespectIgnoreFiles(dialog.isRespectIgnoreFiles());
+        searchQuery->setFollowSymlinks(dialog.isFollowSymlinks());
+    }
+
     searchQuery->addResultObserver(m_resultModel);
-    m_searchEngine = new CSearchEngine(searchQuery);
+    if(m_resultExporter) {
+        searchQuery->addResultObserver(m_resultExporter);
+    }
+    m_searchEngine = new CSearchEngine(searchQuery, dialog.getSearchSettings());
+    m_searchEngine->setResultCache(&m_resultCache);
+    m_searchEngine->setVerdictCache(&m_verdictCache);
 
     // start the search
     m_searchEngine->performSearch();
 }
 
+void CMainWindow::onStatisticsClicked() {
+    if(m_searchEngine == nullptr || m_searchEngine->getStats() == nullptr) {
+        QMessageBox::information(this, tr("Search Statistics"), tr("No search has been started yet."));
+        return;
+    }
+
+    // The statistics are read while the search may still be running, so
+    // they show where the time has gone so far.
+    QMessageBox box(QMessageBox::Information, tr("Search Statistics"),
+                    QString::fromStdWString(m_searchEngine->getStats()->getText()),
+                    QMessageBox::Ok, this);
+    box.setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    box.exec();
+}
+
+void CMainWindow::onFilterTextChanged(QString const &text) {
+    m_resultModel->setFilterText(text);
+}
+
 void CMainWindow::setupUI() {
     QWidget *centralWidget = new QWidget(this);
     setCentralWidget(centralWidget);
@@ -68,13 +183,30 @@ void CMainWindow::setupUI() {
     QVBoxLayout *mainLayout = new QVBoxLayout(centralWidget);
 
     m_searchBtn = new QPushButton("Search", centralWidget);
+    m_refineBtn = new QPushButton("Search Within Results", centralWidget);
     m_tableView = new QTableView(centralWidget);
 
+    // With millions of results, rows of a fixed height spare the view
+    // from measuring them.
+    m_tableView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    m_tableView->verticalHeader()->hide();
+    m_tableView->horizontalHeader()->setStretchLastSection(true);
+    m_tableView->setSelectionBehavior(QAbstractItemView::SelectRows);
+
+    m_filterEdit = new QLineEdit(centralWidget);
+    m_filterEdit->setPlaceholderText(tr("Filter results by name or folder"));
+    m_filterEdit->setClearButtonEnabled(true);
+
     QHBoxLayout *searchSettingsLayout = new QHBoxLayout;
+    searchSettingsLayout->addWidget(m_filterEdit);
 
     mainLayout->addLayout(searchSettingsLayout);
 
-    mainLayout->addWidget(m_searchBtn);
+    QHBoxLayout *searchButtonsLayout = new QHBoxLayout;
+    searchButtonsLayout->addWidget(m_searchBtn);
+    searchButtonsLayout->addWidget(m_refineBtn);
+
+    mainLayout->addLayout(searchButtonsLayout);
     mainLayout->addWidget(m_tableView);
 
     createActions();
@@ -86,6 +218,8 @@ void CMainWindow::setupUI() {
 
 void CMainWindow::setupConnections() {
     connect(m_searchBtn, &QPushButton::clicked, this, &CMainWindow::onSearchClicked);
+    connect(m_refineBtn, &QPushButton::clicked, this, &CMainWindow::onRefineClicked);
+    connect(m_filterEdit, &QLineEdit::textChanged, this, &CMainWindow::onFilterTextChanged);
 }
 
 void CMainWindow::updateTick() {
@@ -103,6 +237,12 @@ void CMainWindow::updateTick() {
         QString matchesText = QString("Matches: ") + QString::number(totalMatches);
 
         if(pendingOperations == 0) {
+            // Write out the rest of the export file as soon as the
+            // search is done, rather than when the next search starts.
+            if(m_resultExporter) {
+                m_resultExporter->finish();
+            }
+
             QString progressText = filesSearchedText + QString(" | ") +
                                     matchesText;
             statusBar()->showMessage(QString("Search completed! ") + progressText);
@@ -123,6 +263,18 @@ void CMainWindow::createActions() {
 
     connect(m_newAct, &QAction::triggered, this, &CMainWindow::onSearchClicked);
 
+    m_refineAct = new QAction(tr("Search &Within Results..."), this);
+
+    m_refineAct->setStatusTip(tr("Search only the files in the current results, with new filters"));
+
+    connect(m_refineAct, &QAction::triggered, this, &CMainWindow::onRefineClicked);
+
+    m_statsAct = new QAction(tr("&Statistics..."), this);
+
+    m_statsAct->setStatusTip(tr("Show the time spent in each stage of the current search"));
+
+    connect(m_statsAct, &QAction::triggered, this, &CMainWindow::onStatisticsClicked);
+
     m_exitAct = new QAction(tr("E&xit"), this);
 
     m_exitAct->setShortcuts(QKeySequence::Quit);
@@ -134,6 +286,8 @@ void CMainWindow::createActions() {
 void CMainWindow::createMenus() {
     m_fileMenu = menuBar()->addMenu(tr("&File"));
     m_fileMenu->addAction(m_newAct);
+    m_fileMenu->addAction(m_refineAct);
+    m_fileMenu->addAction(m_statsAct);
     m_fileMenu->addSeparator();
     m_fileMenu->addAction(m_exitAct);
 }
\ No newline at end of file
@@ -1,27 +1,88 @@
 // SPDX-License-Identifier: GPL-2.0
 #include <ui/CSearchResultModel.hpp>
 
+#include <search/CArchive.hpp>
+#include <SystemResources.hpp>
+
+#include <QDateTime>
+#include <QLocale>
+#include <QTimer>
+
+#include <chrono>
+
 // Qt MOC source file
 #include "ui/moc_CSearchResultModel.cpp"
 
+// How often a sorted or filtered view is recomputed while rows are added
+#define VIEW_REFRESH_MS 1000
+
+/**
+ * @brief Convert a modification time in nanoseconds since the file clock's
+ * epoch to a date and time.
+ */
+static QDateTime toDateTime(std::int64_t const modifiedTime) {
+    using FileTime = std::filesystem::file_time_type;
+
+    FileTime const fileTime(std::chrono::duration_cast<FileTime::duration>(std::chrono::nanoseconds(modifiedTime)));
+
+    // C++17 cannot convert between the clocks, so go through the time
+    // between now and then.
+    auto const systemTime = std::chrono::system_clock::now() +
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(fileTime - FileTime::clock::now());
+
+    return QDateTime::fromMSecsSinceEpoch(
+        std::chrono::duration_cast<std::chrono::milliseconds>(systemTime.time_since_epoch()).count());
+}
+
+static CResultTable::Column toTableColumn(int const column) {
+    switch(column) {
+    case CSearchResultModel::NAME_COLUMN:
+        return CResultTable::Column::Name;
+    case CSearchResultModel::FOLDER_COLUMN:
+        return CResultTable::Column::Directory;
+    case CSearchResultModel::SIZE_COLUMN:
+        return CResultTable::Column::Size;
+    case CSearchResultModel::MODIFIED_COLUMN:
+        return CResultTable::Column::ModifiedTime;
+    default:
+        return CResultTable::Column::None;
+    }
+}
+
 CSearchResultModel::CSearchResultModel(QObject *parent)
-    : QAbstractTableModel(parent)
+    : QAbstractTableModel(parent),
+      m_table(std::make_shared<CResultTable>()),
+      m_viewRowCount(0),
+      m_sortColumn(-1),
+      m_sortOrder(Qt::AscendingOrder),
+      m_generation(0),
+      m_isSelecting(false),
+      m_isRefreshScheduled(false),
+      m_threadCount(getSystemResources().cpuCount),
+      m_isAddPosted(false)
 {
     // nothing to do
 }
 
 CSearchResultModel::~CSearchResultModel() {
-    // nothing to do
+    // The background thread posts its view to this model when done.
+    if(m_selectThread.joinable()) {
+        m_selectThread.join();
+    }
 }
 
 int CSearchResultModel::rowCount(QModelIndex const &parent) const {
     Q_UNUSED(parent);
-    return static_cast<int>(m_results.size());
+
+    if(m_view) {
+        return static_cast<int>(m_view->size());
+    }
+    return static_cast<int>(m_table->getRowCount());
 }
 
 int CSearchResultModel::columnCount(QModelIndex const &parent) const {
     Q_UNUSED(parent);
-    return 2;
+    return COLUMN_COUNT;
 }
 
 QVariant CSearchResultModel::headerData(int section,
@@ -31,66 +92,316 @@ QVariant CSearchResultModel::headerData(int section,
     // We only want to customize the horizontal headers (the column headers)
     if (role == Qt::DisplayRole && orientation == Qt::Horizontal) {
         switch (section) {
-        case 0:
-            return QString("Filename");
-        case 1:
-            return QString("Path");
+        case NAME_COLUMN:
+            return QString("Name");
+        case FOLDER_COLUMN:
+            return QString("Folder");
+        case SIZE_COLUMN:
+            return QString("Size");
+        case MODIFIED_COLUMN:
+            return QString("Modified");
         }
     }
     return QAbstractTableModel::headerData(section, orientation, role);
 }
 
+CResultTable::Row CSearchResultModel::getTableRow(int row) const {
+    return m_view ? (*m_view)[row] : static_cast<CResultTable::Row>(row);
+}
+
+QString const &CSearchResultModel::getName(CResultTable::StringId const id) const {
+    if(id >= m_names.size()) {
+        m_names.resize(id + 1);
+    }
+
+    QString &name = m_names[id];
+    if(name.isNull()) {
+        std::wstring_view const text = m_table->getName(id);
+        name = QString::fromWCharArray(text.data(), static_cast<int>(text.size()));
+    }
+    return name;
+}
+
+QString const &CSearchResultModel::getFolder(CResultTable::StringId const id) const {
+    if(id >= m_folders.size()) {
+        m_folders.resize(id + 1);
+    }
+
+    QString &folder = m_folders[id];
+    if(folder.isNull()) {
+        std::wstring_view const text = m_table->getDirectory(id);
+        folder = QString::fromWCharArray(text.data(), static_cast<int>(text.size()));
+    }
+    return folder;
+}
 
 QVariant CSearchResultModel::data(QModelIndex const &index, int role) const {
-    if(!index.isValid() || role != Qt::DisplayRole) {
+    if(!index.isValid()) {
         return QVariant();
     }
 
     int row = index.row();
     int col = index.column();
-    
-    if(row < 0 || row >= static_cast<int>(m_results.size())) {
+
+    if(row < 0 || row >= rowCount()) {
         return QVariant();
     }
 
-    auto const &path = m_results[row];
+    if(role == Qt::TextAlignmentRole && col == SIZE_COLUMN) {
+        return QVariant(static_cast<int>(Qt::AlignRight | Qt::AlignVCenter));
+    }
+
+    if(role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    CResultTable::Row const tableRow = getTableRow(row);
+
     switch(col) {
-    case 0:
-        return QString::fromStdWString(path.filename().wstring());
-    case 1:
-        return QString::fromStdWString(path.wstring());
+    case NAME_COLUMN:
+        return getName(m_table->getNameId(tableRow));
+    case FOLDER_COLUMN:
+        return getFolder(m_table->getDirectoryId(tableRow));
+    case SIZE_COLUMN:
+        return QLocale().formattedDataSize(static_cast<qint64>(m_table->getSize(tableRow)));
+    case MODIFIED_COLUMN:
+        return QLocale().toString(toDateTime(m_table->getModifiedTime(tableRow)), QLocale::ShortFormat);
     default:
         return QVariant();
     }
 }
 
+void CSearchResultModel::sort(int column, Qt::SortOrder order) {
+    m_sortColumn = column;
+    m_sortOrder = order;
+    updateView();
+}
+
+void CSearchResultModel::setFilterText(QString const &filterText) {
+    if(filterText == m_filterText) {
+        return;
+    }
+
+    m_filterText = filterText;
+    updateView();
+}
+
 void CSearchResultModel::onFileMatched(std::filesystem::path const &matchedFile) {
     // Important: This function will potentially be called from
-    // other threads (the search worker threads).
-    // 
-    // Since the file path was passed as an lvalue reference,
-    // it would be unsafe to capture it in the lambda, because the
-    // file path may go out of scope before the lambda is invoked.
-    // Hence, we create a copy of the file path and capture the
-    // copy in the lambda.
-    std::filesystem::path filePathCopy(matchedFile);
-
-    // Use QMetaObject to invoke fileResultAvailable callback.
-    // This ensures that fileResultAvailable is called from the
-    // main thread.
-    QMetaObject::invokeMethod(this, [this, filePathCopy]() {
-        fileResultAvailable(filePathCopy);
-    }, Qt::QueuedConnection);
+    // other threads (the search worker threads), so the file is
+    // looked at here rather than on the GUI thread.
+    CPendingRow pendingRow{ matchedFile, 0, 0 };
+
+    // A refined search only finds files which were shown before.
+    if(m_knownFiles) {
+        auto const it = m_knownFiles->find(matchedFile.native());
+
+        if(it != m_knownFiles->end()) {
+            pendingRow.size = it->second.first;
+            pendingRow.modifiedTime = it->second.second;
+        }
+    } else {
+        lookAtFile(pendingRow);
+    }
+
+    std::lock_guard<std::mutex> const lock(m_pendingMutex);
+    m_pendingRows.push_back(std::move(pendingRow));
+
+    // Add all rows which arrive until the GUI thread gets to it at once,
+    // rather than posting an event per row.
+    if(!m_isAddPosted) {
+        m_isAddPosted = true;
+
+        QMetaObject::invokeMethod(this, [this]() {
+            addPendingRows();
+        }, Qt::QueuedConnection);
+    }
+}
+
+void CSearchResultModel::lookAtFile(CPendingRow &pendingRow) {
+    std::error_code ec;
+
+    // Archive members have the time and size of their archive.
+    std::filesystem::path statPath = pendingRow.path;
+    std::uintmax_t size = std::filesystem::file_size(statPath, ec);
+
+    std::filesystem::path archivePath;
+    std::string memberName;
+
+    if(ec && CArchive::splitMemberPath(pendingRow.path, archivePath, memberName)) {
+        statPath = archivePath;
+        size = std::filesystem::file_size(statPath, ec);
+    }
+
+    if(!ec) {
+        pendingRow.size = size;
+    }
+
+    std::filesystem::file_time_type const modifiedTime = std::filesystem::last_write_time(statPath, ec);
+    if(!ec) {
+        pendingRow.modifiedTime =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(modifiedTime.time_since_epoch()).count();
+    }
 }
 
 void CSearchResultModel::clear() {
+    // A view which is being computed belongs to the old table.
+    ++m_generation;
+
     beginResetModel();
-    m_results.clear();
+
+    m_table = std::make_shared<CResultTable>();
+    m_knownFiles.reset();
+    m_view = isViewActive() ? std::make_shared<View const>() : nullptr;
+    m_viewRowCount = 0;
+    m_names.clear();
+    m_folders.clear();
+
+    {
+        std::lock_guard<std::mutex> const lock(m_pendingMutex);
+        m_pendingRows.clear();
+    }
+
     endResetModel();
 }
 
-void CSearchResultModel::fileResultAvailable(std::filesystem::path const matchedFile) {
-    beginInsertRows(QModelIndex(), rowCount(), rowCount());
-    m_results.push_back(matchedFile);
-    endInsertRows();
-}
\ No newline at end of file
+std::vector<CSearchFile> CSearchResultModel::startRefine() {
+    auto knownFiles = std::make_shared<std::unordered_map<std::filesystem::path::string_type,
+                                                          std::pair<std::uint64_t, std::int64_t>>>();
+    std::vector<CSearchFile> searchFiles;
+
+    int const shownRows = rowCount();
+    searchFiles.reserve(static_cast<size_t>(shownRows));
+    knownFiles->reserve(static_cast<size_t>(shownRows));
+
+    for(int row = 0; row < shownRows; ++row) {
+        CResultTable::Row const tableRow = getTableRow(row);
+
+        CSearchFile searchFile;
+        searchFile.path = m_table->getPath(tableRow);
+        searchFile.hasMetadata = true;
+        searchFile.size = m_table->getSize(tableRow);
+        searchFile.modifiedTime = m_table->getModifiedTime(tableRow);
+
+        knownFiles->emplace(searchFile.path.native(), std::make_pair(searchFile.size, searchFile.modifiedTime));
+        searchFiles.push_back(std::move(searchFile));
+    }
+
+    clear();
+    m_knownFiles = std::move(knownFiles);
+
+    return searchFiles;
+}
+
+void CSearchResultModel::addPendingRows() {
+    std::vector<CPendingRow> pendingRows;
+
+    {
+        std::lock_guard<std::mutex> const lock(m_pendingMutex);
+        pendingRows.swap(m_pendingRows);
+        m_isAddPosted = false;
+    }
+
+    if(pendingRows.empty()) {
+        return;
+    }
+
+    size_t const firstRow = m_table->getRowCount();
+
+    // Without a view, the new rows are shown right away. Otherwise they
+    // show up when the view is refreshed.
+    if(!m_view) {
+        beginInsertRows(QModelIndex(), static_cast<int>(firstRow),
+                        static_cast<int>(firstRow + pendingRows.size() - 1));
+    }
+
+    for(CPendingRow const &pendingRow : pendingRows) {
+        m_table->addRow(pendingRow.path, pendingRow.size, pendingRow.modifiedTime);
+    }
+
+    if(!m_view) {
+        endInsertRows();
+    } else {
+        scheduleRefresh();
+    }
+}
+
+void CSearchResultModel::updateView() {
+    ++m_generation;
+
+    if(!isViewActive()) {
+        beginResetModel();
+        m_view.reset();
+        m_viewRowCount = 0;
+        endResetModel();
+        return;
+    }
+
+    // A view which is being computed is discarded when done, and a new
+    // one started then.
+    if(!m_isSelecting) {
+        startSelect();
+    }
+}
+
+void CSearchResultModel::startSelect() {
+    m_isSelecting = true;
+
+    std::shared_ptr<CResultTable const> const table = m_table;
+    size_t const rowCount = table->getRowCount();
+    std::uint64_t const generation = m_generation;
+    std::wstring const filterText = m_filterText.toStdWString();
+    CResultTable::Column const sortColumn = toTableColumn(m_sortColumn);
+    bool const isDescending = m_sortOrder == Qt::DescendingOrder;
+    size_t const threadCount = m_threadCount;
+
+    m_selectThread = std::thread([this, table, rowCount, generation, filterText, sortColumn, isDescending, threadCount]() {
+        std::shared_ptr<View const> const view = std::make_shared<View const>(
+            table->select(rowCount, filterText, sortColumn, isDescending, threadCount));
+
+        QMetaObject::invokeMethod(this, [this, generation, view, rowCount]() {
+            viewSelected(generation, view, rowCount);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void CSearchResultModel::scheduleRefresh() {
+    // A view which is being computed is refreshed when done.
+    if(m_isSelecting || m_isRefreshScheduled) {
+        return;
+    }
+
+    m_isRefreshScheduled = true;
+
+    QTimer::singleShot(VIEW_REFRESH_MS, this, [this]() {
+        m_isRefreshScheduled = false;
+
+        if(!m_isSelecting && isViewActive()) {
+            startSelect();
+        }
+    });
+}
+
+void CSearchResultModel::viewSelected(std::uint64_t const generation,
+                                      std::shared_ptr<View const> const &view,
+                                      size_t const viewRowCount) {
+    m_selectThread.join();
+    m_isSelecting = false;
+
+    if(generation != m_generation) {
+        // The sorting, the filter or the table has changed meanwhile.
+        if(isViewActive()) {
+            startSelect();
+        }
+        return;
+    }
+
+    beginResetModel();
+    m_view = view;
+    m_viewRowCount = viewRowCount;
+    endResetModel();
+
+    if(m_table->getRowCount() > m_viewRowCount) {
+        scheduleRefresh();
+    }
+}
@@ -1,19 +1,27 @@
 // SPDX-License-Identifier: GPL-2.0
 #include <ui/CStartSearchDialog.hpp>
 
+#include <QFileDialog>
+#include <QFormLayout>
+#include <QGroupBox>
 #include <QTabWidget>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QLabel>
 #include <QPushButton>
 
+#include <algorithm>
+
 // Qt MOC source file
 #include "ui/moc_CStartSearchDialog.cpp"
 
-CStartSearchDialog::CStartSearchDialog(QWidget *parent)
+#define MAX_WORKER_THREADS 256
+#define MEBIBYTE (1024 * 1024)
+
+CStartSearchDialog::CStartSearchDialog(QWidget *parent, bool const isRefining)
     : QDialog(parent)
 {
-    setWindowTitle(tr("Start Search"));
+    setWindowTitle(isRefining ? tr("Refine Search") : tr("Start Search"));
 
     // Create the QTabWidget
     QTabWidget *tabWidget = new QTabWidget(this);
@@ -25,18 +33,82 @@ CStartSearchDialog::CStartSearchDialog(QWidget *parent)
     QWidget *directoriesTab = new QWidget(this);
     QVBoxLayout *directoriesLayout = new QVBoxLayout(directoriesTab);
     directoriesLayout->addWidget(m_folderListWidget);
+
+    m_respectIgnoreFilesCheck = new QCheckBox(tr("Skip files excluded by .gitignore and .ignore"), this);
+    m_respectIgnoreFilesCheck->setChecked(false);
+    directoriesLayout->addWidget(m_respectIgnoreFilesCheck);
+
+    m_followSymlinksCheck = new QCheckBox(tr("Follow symbolic links"), this);
+    m_followSymlinksCheck->setChecked(false);
+    directoriesLayout->addWidget(m_followSymlinksCheck);
+
+    m_searchArchivesCheck = new QCheckBox(tr("Search inside zip and tar archives"), this);
+    m_searchArchivesCheck->setChecked(false);
+    directoriesLayout->addWidget(m_searchArchivesCheck);
     directoriesTab->setLayout(directoriesLayout);
 
     // Filters
     QWidget *filtersTab = new QWidget(this);
     QVBoxLayout *filtersLayout = new QVBoxLayout(filtersTab);
+
+    if(isRefining) {
+        filtersLayout->addWidget(new QLabel(tr("Only the files in the current results are searched."), this));
+    }
+
     filtersLayout->addWidget(m_filterListWidget);
     filtersTab->setLayout(filtersLayout);
 
     // Settings
     QWidget *settingsTab = new QWidget(this);
     QVBoxLayout *settingsLayout = new QVBoxLayout(settingsTab);
-    settingsLayout->addWidget(new QLabel(tr("Settings tab content goes here."), this));
+
+    m_exportCheck = new QCheckBox(tr("Export results to a CSV or NDJSON file while searching"), this);
+    m_exportCheck->setChecked(false);
+    m_exportPathEdit = new QLineEdit(this);
+    m_exportPathEdit->setEnabled(false);
+    QPushButton *browseExportButton = new QPushButton(tr("Browse..."), this);
+    browseExportButton->setEnabled(false);
+
+    connect(m_exportCheck, &QCheckBox::toggled, m_exportPathEdit, &QLineEdit::setEnabled);
+    connect(m_exportCheck, &QCheckBox::toggled, browseExportButton, &QPushButton::setEnabled);
+    connect(browseExportButton, &QPushButton::clicked, this, &CStartSearchDialog::onBrowseExportClicked);
+
+    QHBoxLayout *exportPathLayout = new QHBoxLayout;
+    exportPathLayout->addWidget(m_exportPathEdit);
+    exportPathLayout->addWidget(browseExportButton);
+
+    // Resources, with defaults derived from the CPUs and memory available
+    // to the process.
+    CSearchSettings const defaults;
+
+    QGroupBox *resourcesGroup = new QGroupBox(tr("Resources"), this);
+    QFormLayout *resourcesLayout = new QFormLayout(resourcesGroup);
+
+    m_workerThreadsSpin = new QSpinBox(this);
+    m_workerThreadsSpin->setRange(1, MAX_WORKER_THREADS);
+    m_workerThreadsSpin->setValue(static_cast<int>(std::min<size_t>(defaults.getWorkerThreads(), MAX_WORKER_THREADS)));
+    m_workerThreadsSpin->setToolTip(tr("Number of threads which enumerate and search files"));
+
+    m_ioConcurrencySpin = new QSpinBox(this);
+    m_ioConcurrencySpin->setRange(1, MAX_WORKER_THREADS);
+    m_ioConcurrencySpin->setValue(static_cast<int>(std::min<size_t>(defaults.getIoConcurrency(), MAX_WORKER_THREADS)));
+    m_ioConcurrencySpin->setToolTip(tr("Lower this for spinning disks and network shares"));
+
+    m_memoryBudgetSpin = new QSpinBox(this);
+    m_memoryBudgetSpin->setRange(static_cast<int>(CSearchSettings::MIN_MEMORY_BUDGET / MEBIBYTE), 64 * 1024);
+    m_memoryBudgetSpin->setValue(static_cast<int>(defaults.getMemoryBudget() / MEBIBYTE));
+    m_memoryBudgetSpin->setSuffix(tr(" MiB"));
+    m_memoryBudgetSpin->setToolTip(tr("Memory shared by all threads for file buffers"));
+
+    resourcesLayout->addRow(tr("Worker threads:"), m_workerThreadsSpin);
+    resourcesLayout->addRow(tr("Concurrent file reads:"), m_ioConcurrencySpin);
+    resourcesLayout->addRow(tr("Buffer memory:"), m_memoryBudgetSpin);
+    resourcesGroup->setLayout(resourcesLayout);
+
+    settingsLayout->addWidget(m_exportCheck);
+    settingsLayout->addLayout(exportPathLayout);
+    settingsLayout->addWidget(resourcesGroup);
+    settingsLayout->addStretch();
     settingsTab->setLayout(settingsLayout);
 
     // Add the tabs to the QTabWidget
@@ -44,6 +116,12 @@ CStartSearchDialog::CStartSearchDialog(QWidget *parent)
     tabWidget->addTab(filtersTab, tr("Filters"));
     tabWidget->addTab(settingsTab, tr("Settings"));
 
+    // A refined search takes its files from the current results.
+    if(isRefining) {
+        tabWidget->setTabEnabled(tabWidget->indexOf(directoriesTab), false);
+        tabWidget->setCurrentWidget(filtersTab);
+    }
+
     // Create the buttons
     QPushButton *searchButton = new QPushButton(tr("Search"), this);
     QPushButton *cancelButton = new QPushButton(tr("Cancel"), this);
@@ -77,4 +155,48 @@ std::vector<std::filesystem::path> CStartSearchDialog::getDirectories() {
 
 std::vector<IFilter *> CStartSearchDialog::getFilters() {
     return m_filterListWidget->extractFilters();
+}
+
+bool CStartSearchDialog::isRespectIgnoreFiles() const {
+    return m_respectIgnoreFilesCheck->isChecked();
+}
+
+bool CStartSearchDialog::isFollowSymlinks() const {
+    return m_followSymlinksCheck->isChecked();
+}
+
+bool CStartSearchDialog::isSearchArchives() const {
+    return m_searchArchivesCheck->isChecked();
+}
+
+std::filesystem::path CStartSearchDialog::getExportPath() const {
+    if(!m_exportCheck->isChecked()) {
+        return std::filesystem::path();
+    }
+
+    return std::filesystem::path(m_exportPathEdit->text().toStdWString());
+}
+
+CSearchSettings CStartSearchDialog::getSearchSettings() const {
+    CSearchSettings settings;
+    settings.setWorkerThreads(static_cast<size_t>(m_workerThreadsSpin->value()));
+    settings.setIoConcurrency(static_cast<size_t>(m_ioConcurrencySpin->value()));
+    settings.setMemoryBudget(static_cast<std::uint64_t>(m_memoryBudgetSpin->value()) * MEBIBYTE);
+
+    // Somebody is waiting for the results.
+    settings.setPriority(CExecutor::Priority::Interactive);
+    return settings;
+}
+
+void CStartSearchDialog::onBrowseExportClicked() {
+    QString const filePath = QFileDialog::getSaveFileName(
+        this,
+        tr("Export Results"),
+        m_exportPathEdit->text(),
+        tr("CSV files (*.csv);;NDJSON files (*.ndjson *.jsonl);;All files (*)")
+    );
+
+    if(!filePath.isEmpty()) {
+        m_exportPathEdit->setText(filePath);
+    }
 }
\ No newline at end of file
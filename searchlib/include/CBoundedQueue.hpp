@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+
+/**
+ * @brief Bounded lock-free queue for any number of producer and consumer
+ * threads.
+ *
+ * The queue is a ring of cells which each carry a sequence number telling
+ * producers and consumers whose turn it is (the algorithm by Dmitry
+ * Vyukov). Pushing and popping costs one compare-and-swap on a shared
+ * position plus uncontended accesses to one cell, and never allocates.
+ *
+ * The capacity is fixed at construction and rounded up to a power of two,
+ * at least 2: with a single cell, a full cell and an empty one would carry
+ * the same sequence number.
+ */
+template<typename T>
+class CBoundedQueue {
+public:
+    explicit CBoundedQueue(size_t const capacity)
+        : m_mask(roundUpToPowerOfTwo(capacity) - 1),
+          m_cells(new CCell[m_mask + 1]),
+          m_enqueuePos(0),
+          m_dequeuePos(0)
+    {
+        for(size_t i = 0; i <= m_mask; ++i) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~CBoundedQueue() {
+        delete[] m_cells;
+    }
+
+    CBoundedQueue(CBoundedQueue const &) = delete;
+    CBoundedQueue &operator=(CBoundedQueue const &) = delete;
+
+    /**
+     * @brief Add an item to the back of the queue.
+     *
+     * @return true on success, false if the queue is full, in which case
+     *         the item is left untouched
+     */
+    bool tryPush(T &item) {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        CCell *cell;
+
+        while(true) {
+            cell = &m_cells[pos & m_mask];
+            size_t const sequence = cell->sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t const diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+
+            if(diff == 0) {
+                // The cell is free for this position; claim it.
+                if(m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if(diff < 0) {
+                // The cell still holds the item from one lap ago.
+                return false;
+            } else {
+                // Another producer claimed the position first.
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->item = std::move(item);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Remove the item at the front of the queue.
+     *
+     * @return true on success, false if the queue is empty
+     */
+    bool tryPop(T &item) {
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        CCell *cell;
+
+        while(true) {
+            cell = &m_cells[pos & m_mask];
+            size_t const sequence = cell->sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t const diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos + 1);
+
+            if(diff == 0) {
+                if(m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if(diff < 0) {
+                // Nothing has been pushed to this position yet.
+                return false;
+            } else {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        item = std::move(cell->item);
+        cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Whether the queue appears empty. Items which are being pushed
+     * at the same time may or may not be counted.
+     */
+    bool isEmpty() const {
+        return m_enqueuePos.load(std::memory_order_seq_cst) == m_dequeuePos.load(std::memory_order_seq_cst);
+    }
+
+    size_t getCapacity() const { return m_mask + 1; }
+
+private:
+    struct CCell {
+        std::atomic<size_t> sequence;
+        T item;
+    };
+
+    static size_t roundUpToPowerOfTwo(size_t const value) {
+        if(value == 0) {
+            throw std::invalid_argument("The capacity of a bounded queue must not be 0");
+        }
+
+        size_t result = 2;
+        while(result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    size_t const m_mask;
+    CCell *const m_cells; // Owned
+
+    // On separate cache lines, so that producers and consumers do not
+    // invalidate each other's line on every operation.
+    alignas(64) std::atomic<size_t> m_enqueuePos;
+    alignas(64) std::atomic<size_t> m_dequeuePos;
+};
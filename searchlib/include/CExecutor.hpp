@@ -0,0 +1,332 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <CBoundedQueue.hpp>
+#include <CTask.hpp>
+#include <CTaskGroup.hpp>
+#include <CTraceRecorder.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Long-lived pool of worker threads shared by concurrent searches.
+ *
+ * Work is posted to queues (CQueue), typically one per search, rather than
+ * to the executor itself. Creating a queue creates no threads, so running
+ * several searches at once neither multiplies the threads competing for
+ * the CPUs nor pays for starting new ones. The process-wide executor is
+ * reached through getShared().
+ *
+ * Workers pick tasks as follows:
+ *  - queues of a higher priority go first; a Background queue only gets a
+ *    worker while no Normal or Interactive queue has a task waiting,
+ *  - among queues of the same priority, the one which has had the least
+ *    worker time for its weight goes next, so a queue of weight 2 gets
+ *    twice the time of a queue of weight 1 while both have tasks,
+ *  - within a queue, high priority tasks go first.
+ *
+ * Posting and taking a task takes no lock: each queue
+ * keeps its tasks in lock-free rings (CBoundedQueue), and the number of
+ * waiting tasks per queue and per priority is kept in atomic counters.
+ * The executor's mutex is only taken by workers going to sleep, by
+ * threads waking them, and when queues are created or destroyed.
+ *
+ * Tasks are not interrupted. A long task of a low priority queue lets
+ * waiting tasks of higher priority queues run by calling CQueue::yield
+ * every now and then, which runs them on its own thread.
+ */
+class CExecutor {
+public:
+    static constexpr size_t DEFAULT_QUEUE_CAPACITY = 1024;
+
+    // Most queues which may exist at once; creating another one waits
+    // until one of them is destroyed
+    static constexpr size_t MAX_QUEUES = 64;
+
+    // Priority of a queue relative to the other queues
+    enum class Priority { Background, Normal, Interactive };
+
+    // Priority of a task relative to the other tasks of its queue
+    enum class TaskPriority { Normal, High };
+
+    class CQueue;
+
+private:
+    /**
+     * @brief Scheduling state of a queue, which workers read without a
+     * lock. Slots belong to the executor and outlive the queues using
+     * them, so a worker may look at a slot whose queue is just being
+     * destroyed. It only touches the queue itself after counting itself
+     * as running in the slot and seeing the queue still attached.
+     */
+    struct alignas(64) CSlot {
+        CSlot();
+
+        std::atomic<CQueue *> queue; // null while the slot is free or its queue closes
+        std::atomic_int priority;
+        std::atomic_uint weight;
+        std::atomic<size_t> maxRunning;
+        std::atomic<std::uint64_t> sequence; // Order in which the queues were created
+
+        // Tasks pushed but not taken yet. May briefly be one less than the
+        // tasks in the queue's rings, or negative, while a task is being
+        // pushed or taken.
+        std::atomic_long waiting;
+        std::atomic<size_t> running;
+
+        // Worker time the queue has had, in nanoseconds divided by its
+        // weight
+        std::atomic<std::uint64_t> virtualTime;
+
+        std::atomic<CTraceRecorder *> traceRecorder;
+
+        bool isUsed; // Guarded by the executor's mutex
+    };
+
+public:
+    /**
+     * @brief A queue of tasks, e.g. those of one search, which gets a fair
+     * share of the executor's workers.
+     *
+     * Destroying the queue discards the tasks which have not started yet
+     * and waits for those which have. Meanwhile, only the queue's own
+     * tasks and the groups' completion handlers may still post to it.
+     */
+    class CQueue {
+    public:
+        /**
+         * @param weight share of the workers relative to other queues of
+         *        the same priority, at least 1
+         * @param maxRunning most tasks of the queue which may run at once
+         * @param queueCapacity room for waiting tasks of each task priority.
+         *        The rings are allocated and initialized up front, so this
+         *        should fit the tasks the queue is expected to hold.
+         *
+         * If MAX_QUEUES queues exist already, waits until one of them is
+         * destroyed.
+         */
+        explicit CQueue(CExecutor &executor,
+                        Priority const priority = Priority::Normal,
+                        unsigned const weight = 1,
+                        size_t const maxRunning = SIZE_MAX,
+                        size_t const queueCapacity = DEFAULT_QUEUE_CAPACITY);
+        ~CQueue();
+
+        CQueue(CQueue const &) = delete;
+        CQueue &operator=(CQueue const &) = delete;
+
+        /**
+         * @brief Set the recorder which waits for this queue are traced to,
+         * or null to not trace them: workers sleeping for lack of tasks and
+         * threads waiting for room in a full queue. The queue does NOT take
+         * ownership of the recorder, which must outlive the queue.
+         */
+        void setTraceRecorder(CTraceRecorder *traceRecorder);
+
+        /**
+         * @brief Submit a task without a way to wait for its result. If the
+         * task throws, the exception is discarded.
+         *
+         * If the queue is full, a task posted from one of the executor's
+         * workers runs right away on that worker, since the worker would
+         * otherwise wait for itself. Other threads wait until there is room.
+         */
+        void post(CTask task, TaskPriority const taskPriority = TaskPriority::Normal) {
+            push(std::move(task), nullptr, taskPriority);
+        }
+
+        /**
+         * @brief Submit a task which belongs to a group. The group learns
+         * about the task before this returns, and about its completion after
+         * the callable has returned or thrown, or the task was discarded.
+         */
+        template<typename F>
+        void post(CTaskGroup &group, F &&f, TaskPriority const taskPriority = TaskPriority::Normal) {
+            group.begin();
+
+            try {
+                push(CTask(std::forward<F>(f)), &group, taskPriority);
+            } catch(...) {
+                group.end();
+                throw;
+            }
+        }
+
+        /**
+         * @brief Check whether tasks of a queue of higher priority are
+         * waiting for a worker. Costs at most two atomic loads.
+         */
+        bool shouldYield() const {
+            return m_executor.hasWaitingTasksAbove(m_priority);
+        }
+
+        /**
+         * @brief Run the waiting tasks of queues of higher priority on the
+         * calling thread, if there are any. Meant to be called by long
+         * tasks of the queue at points where they hold no locks.
+         */
+        void yield() {
+            if(shouldYield()) {
+                m_executor.runPreempting(m_priority);
+            }
+        }
+
+        Priority getPriority() const { return m_priority; }
+        unsigned getWeight() const { return m_weight; }
+
+    private:
+        friend class CExecutor;
+
+        struct CEntry {
+            CTask task;
+            CTaskGroup *group = nullptr; // null if the task belongs to no group
+        };
+
+        void push(CTask task, CTaskGroup *group, TaskPriority const taskPriority);
+
+        /**
+         * @brief Take the next task of the queue, high priority tasks first.
+         * The caller must count as running in the queue's slot.
+         */
+        bool tryPop(CEntry &entry);
+
+        CExecutor &m_executor;
+        Priority const m_priority;
+        unsigned const m_weight;
+        CSlot *m_slot; // Not owned
+
+        CBoundedQueue<CEntry> m_tasks;
+        CBoundedQueue<CEntry> m_highPriorityTasks;
+
+        // Set once the queue is being destroyed, after which posted tasks
+        // are discarded
+        std::atomic_bool m_isClosed;
+    };
+
+    explicit CExecutor(size_t const numWorkers);
+
+    /**
+     * @brief Stop the workers once the tasks they are running are done.
+     * Every queue must have been destroyed before.
+     */
+    ~CExecutor();
+
+    CExecutor(CExecutor const &) = delete;
+    CExecutor &operator=(CExecutor const &) = delete;
+
+    /**
+     * @brief Get the executor shared by the whole process. It is created
+     * on first use with one worker per CPU the process may use (see
+     * getSystemResources).
+     */
+    static CExecutor &getShared();
+
+    /**
+     * @brief Add workers until there are at least numWorkers. Workers are
+     * never removed before the executor is destroyed.
+     */
+    void reserveWorkers(size_t const numWorkers);
+
+    size_t getWorkerCount() const;
+
+private:
+    static constexpr int PRIORITY_COUNT = 3;
+
+    bool hasWaitingTasksAbove(Priority const priority) const {
+        for(int level = static_cast<int>(priority) + 1; level < PRIORITY_COUNT; ++level) {
+            if(m_waitingTasks[level].load(std::memory_order_relaxed) > 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Count the calling thread as running in a slot, unless the
+     * slot's queue has gone or is at its limit of running tasks.
+     *
+     * @return the slot's queue, or null if the thread does not count
+     */
+    CQueue *enterSlot(CSlot &slot, bool const isLimited);
+
+    /**
+     * @brief Stop counting the calling thread as running in a slot. The
+     * slot's queue may be gone as soon as this returns.
+     */
+    void leaveSlot(CSlot &slot);
+
+    /**
+     * @brief Find the slot whose task should run next among the queues of
+     * a priority higher than minPriority which may run another task.
+     *
+     * @return the slot, or null if no task may run now
+     */
+    CSlot *findNextSlot(int const minPriority);
+
+    /**
+     * @brief Get the least virtual time of the queues with tasks waiting
+     * or running, or 0 if there are none. A queue which gets a task after
+     * being idle starts from there, so that it cannot make up for the
+     * time it did not need.
+     */
+    std::uint64_t getActiveVirtualTime() const;
+
+    /**
+     * @brief Take the next task to run from the queues of a priority
+     * higher than minPriority. The calling thread then counts as running
+     * in the task's slot until runTask is done.
+     *
+     * @return the slot of the task, or null if no task may run now
+     */
+    CSlot *takeTask(int const minPriority, CQueue::CEntry &entry);
+
+    /**
+     * @brief Run a taken task and account for its time.
+     */
+    void runTask(CSlot &slot, CQueue::CEntry &entry);
+
+    void runPreempting(Priority const priority);
+
+    void wakeWorker();
+
+    /**
+     * @brief Record a span of idle workers into the trace recorders of
+     * all queues which have one.
+     */
+    void recordIdle(CTraceRecorder::Clock::time_point const start);
+
+    void workerThreadFunc();
+
+    // How long a thread waits before retrying to post to a full queue.
+    static constexpr int FULL_QUEUE_WAIT_MICROSECONDS = 100;
+
+    // The executor whose worker is running on the current thread, if any.
+    static inline thread_local CExecutor *t_currentExecutor = nullptr;
+
+    CSlot m_slots[MAX_QUEUES];
+    std::atomic<size_t> m_slotCount; // Slots which have ever been used
+    std::uint64_t m_queueSequence; // Guarded by m_mutex
+
+    // Queues which exist. Tasks are only timed while there are several,
+    // as the time a queue has had only matters relative to other queues.
+    std::atomic<size_t> m_queueCount;
+
+    // Tasks waiting per queue priority, like CSlot::waiting
+    std::atomic_long m_waitingTasks[PRIORITY_COUNT];
+
+    // Queues with a trace recorder
+    std::atomic_int m_tracedQueues;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wakeCondition;
+    std::condition_variable m_idleCondition;
+    std::condition_variable m_slotCondition; // Signalled when a slot becomes free
+    std::vector<std::thread> m_workers;
+    std::atomic_int m_sleepingWorkers;
+    std::atomic_bool m_shouldTerminate;
+};
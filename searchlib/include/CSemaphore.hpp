@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+
+/**
+ * @brief Counting semaphore which limits how many threads may hold one of
+ * a fixed number of slots at a time.
+ *
+ * lock() and unlock() acquire and release one slot, so the semaphore can
+ * be used with std::lock_guard.
+ */
+class CSemaphore {
+public:
+    explicit CSemaphore(size_t const slots)
+        : m_freeSlots(slots)
+    {}
+
+    CSemaphore(CSemaphore const &) = delete;
+    CSemaphore &operator=(CSemaphore const &) = delete;
+
+    /**
+     * @brief Wait until a slot is free and take it.
+     */
+    void lock() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        m_condition.wait(lock, [this] {
+            return m_freeSlots > 0;
+        });
+
+        m_freeSlots--;
+    }
+
+    /**
+     * @brief Give back a slot taken with lock().
+     */
+    void unlock() {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_freeSlots++;
+        }
+
+        m_condition.notify_one();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    size_t m_freeSlots;
+};
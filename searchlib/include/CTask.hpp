@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief Move-only wrapper for a callable taking no arguments and
+ * returning nothing, like a move-only std::function<void()>.
+ *
+ * Callables of up to INLINE_SIZE bytes (for example a lambda capturing a
+ * pointer and a path or a vector) are stored inside the task itself, so
+ * creating, moving and running such a task does not allocate. Larger
+ * callables are moved to the heap.
+ */
+class CTask {
+public:
+    static constexpr size_t INLINE_SIZE = 64;
+
+    CTask() : m_ops(nullptr) {}
+
+    template<typename F,
+             typename = std::enable_if_t<!std::is_same<std::decay_t<F>, CTask>::value>>
+    CTask(F &&f) : m_ops(nullptr) {
+        using Callable = std::decay_t<F>;
+
+        if constexpr(isInline<Callable>()) {
+            new (&m_storage) Callable(std::forward<F>(f));
+            m_ops = &InlineOps<Callable>::OPS;
+        } else {
+            // Owned; deleted by HeapOps::destroy.
+            *reinterpret_cast<Callable **>(&m_storage) = new Callable(std::forward<F>(f));
+            m_ops = &HeapOps<Callable>::OPS;
+        }
+    }
+
+    CTask(CTask &&other) noexcept : m_ops(other.m_ops) {
+        if(m_ops) {
+            m_ops->move(&other.m_storage, &m_storage);
+            other.m_ops = nullptr;
+        }
+    }
+
+    CTask &operator=(CTask &&other) noexcept {
+        if(this != &other) {
+            reset();
+
+            if(other.m_ops) {
+                m_ops = other.m_ops;
+                m_ops->move(&other.m_storage, &m_storage);
+                other.m_ops = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    CTask(CTask const &) = delete;
+    CTask &operator=(CTask const &) = delete;
+
+    ~CTask() { reset(); }
+
+    /**
+     * @brief Run the callable. The task must not be empty.
+     */
+    void operator()() { m_ops->invoke(&m_storage); }
+
+    explicit operator bool() const { return m_ops != nullptr; }
+
+    /**
+     * @brief Destroy the callable, leaving the task empty.
+     */
+    void reset() {
+        if(m_ops) {
+            m_ops->destroy(&m_storage);
+            m_ops = nullptr;
+        }
+    }
+
+private:
+    using Storage = std::aligned_storage_t<INLINE_SIZE, alignof(std::max_align_t)>;
+
+    // Type-erased operations on the stored callable. One static table per
+    // callable type, instead of a virtual base class per task.
+    struct COps {
+        void (*invoke)(void *storage);
+        void (*move)(void *from, void *to);
+        void (*destroy)(void *storage);
+    };
+
+    template<typename Callable>
+    static constexpr bool isInline() {
+        return sizeof(Callable) <= INLINE_SIZE &&
+               alignof(Callable) <= alignof(Storage) &&
+               std::is_nothrow_move_constructible<Callable>::value;
+    }
+
+    template<typename Callable>
+    struct InlineOps {
+        static void invoke(void *storage) { (*static_cast<Callable *>(storage))(); }
+
+        static void move(void *from, void *to) {
+            Callable *source = static_cast<Callable *>(from);
+            new (to) Callable(std::move(*source));
+            source->~Callable();
+        }
+
+        static void destroy(void *storage) { static_cast<Callable *>(storage)->~Callable(); }
+
+        static constexpr COps OPS = { &invoke, &move, &destroy };
+    };
+
+    template<typename Callable>
+    struct HeapOps {
+        static Callable *&pointer(void *storage) { return *static_cast<Callable **>(storage); }
+
+        static void invoke(void *storage) { (*pointer(storage))(); }
+        static void move(void *from, void *to) { pointer(to) = pointer(from); }
+        static void destroy(void *storage) { delete pointer(storage); }
+
+        static constexpr COps OPS = { &invoke, &move, &destroy };
+    };
+
+    Storage m_storage;
+    COps const *m_ops;
+};
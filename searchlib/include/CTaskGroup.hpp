@@ -0,0 +1,125 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief Tracks completion of a group of tasks, in place of one future per
+ * task.
+ *
+ * Every task of the group is announced with begin() before it is
+ * submitted and reported with end() when it has finished; see
+ * CExecutor::CQueue::push. The group is complete whenever the number of
+ * unfinished tasks drops to zero. Tasks may add further tasks to the
+ * group while they run, as long as they do so before calling end().
+ */
+class CTaskGroup {
+public:
+    explicit CTaskGroup()
+        : m_pendingTasks(0),
+          m_isCompleting(false),
+          m_isCompletedAgain(false)
+    {}
+
+    CTaskGroup(CTaskGroup const &) = delete;
+    CTaskGroup &operator=(CTaskGroup const &) = delete;
+
+    /**
+     * @brief Set a function which is called each time the group completes,
+     * on the thread which finished the last task and before any waiting
+     * thread is woken up.
+     *
+     * The handler runs without any lock of the group held, so it may add
+     * tasks to the group or query it. Until it returns, the group counts
+     * one pending task more, and only wait() called by the handler itself
+     * returns.
+     */
+    void setCompletionHandler(std::function<void()> const &onComplete) {
+        m_onComplete = onComplete;
+    }
+
+    /**
+     * @brief Announce a task of the group.
+     */
+    void begin() {
+        m_pendingTasks++;
+    }
+
+    /**
+     * @brief Report that a task of the group has finished.
+     */
+    void end() {
+        // Take the lock so that a waiter cannot miss the notification
+        // between checking the count and going to sleep.
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        if(m_isCompleting || m_pendingTasks.load() > 1) {
+            // Tasks added by a running handler may complete the group
+            // again; the handler's thread then calls it once more.
+            if(--m_pendingTasks == 0) {
+                m_isCompletedAgain = true;
+            }
+            return;
+        }
+
+        // The group counts as busy before its last task is gone, so that
+        // getPendingTasks never sees it idle with the handler still to run.
+        m_isCompleting = true;
+        m_completingThread = std::this_thread::get_id();
+        m_pendingTasks--;
+
+        do {
+            m_isCompletedAgain = false;
+            std::function<void()> const onComplete = m_onComplete;
+
+            lock.unlock();
+            if(onComplete) {
+                onComplete();
+            }
+            lock.lock();
+        } while(m_isCompletedAgain);
+
+        m_isCompleting = false;
+
+        if(m_pendingTasks == 0) {
+            m_condition.notify_all();
+        }
+    }
+
+    /**
+     * @brief Block the calling thread until the group has no unfinished
+     * tasks and its completion handler has returned.
+     */
+    void wait() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        m_condition.wait(lock, [this] {
+            return m_pendingTasks.load() == 0 &&
+                   (!m_isCompleting || m_completingThread == std::this_thread::get_id());
+        });
+    }
+
+    /**
+     * @brief Get the number of unfinished tasks, counting a running
+     * completion handler as one.
+     */
+    int getPendingTasks() const {
+        return m_pendingTasks.load() + (m_isCompleting.load() ? 1 : 0);
+    }
+
+private:
+    std::atomic_int m_pendingTasks;
+    std::function<void()> m_onComplete;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+
+    // Whether the completion handler runs, on which thread, and whether
+    // the group completed again meanwhile. Written with the mutex held.
+    std::atomic_bool m_isCompleting;
+    bool m_isCompletedAgain;
+    std::thread::id m_completingThread;
+};
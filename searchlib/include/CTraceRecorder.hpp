@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Records spans of work on a timeline and writes them as a Chrome
+ * trace file, which can be opened in Perfetto (ui.perfetto.dev) or in
+ * chrome://tracing.
+ *
+ * Every thread records into its own ring buffer of a fixed number of
+ * events. When a thread's buffer is full, its oldest events are
+ * overwritten, so the trace always holds the most recent work of each
+ * thread.
+ *
+ * Like CSearchStats, code being traced does not get the recorder passed
+ * in: a thread installs a recorder with a CScope, and CTraceSpan records
+ * into whatever is installed. Without an installed recorder, a span costs
+ * one thread-local load and allocates nothing.
+ */
+class CTraceRecorder {
+public:
+    static constexpr size_t DEFAULT_EVENTS_PER_THREAD = 65536;
+
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Installs a recorder for the current thread for as long as
+     * the scope lives. Scopes may be nested; the previous recorder is
+     * restored when the scope ends.
+     */
+    class CScope {
+    public:
+        explicit CScope(CTraceRecorder *recorder);
+        ~CScope();
+
+        CScope(CScope const &) = delete;
+        CScope &operator=(CScope const &) = delete;
+
+    private:
+        CTraceRecorder *m_previous;
+    };
+
+    explicit CTraceRecorder(size_t const eventsPerThread = DEFAULT_EVENTS_PER_THREAD);
+    ~CTraceRecorder();
+
+    CTraceRecorder(CTraceRecorder const &) = delete;
+    CTraceRecorder &operator=(CTraceRecorder const &) = delete;
+
+    /**
+     * @brief Record a span on behalf of the calling thread.
+     *
+     * @param name name of the span; must be a string literal or otherwise
+     *        outlive the recorder, since only the pointer is kept
+     * @param detail optional text shown with the span, such as a path
+     * @param value optional number shown with the span, negative if none
+     */
+    void record(char const *name, Clock::time_point const start, Clock::time_point const end,
+                std::string const &detail = std::string(), std::int64_t const value = -1);
+
+    /**
+     * @brief Get the number of events currently held, over all threads.
+     */
+    size_t getEventCount() const;
+
+    /**
+     * @brief Write all recorded events as Chrome trace JSON. Threads may
+     * still be recording; their events from after the call may be missing.
+     *
+     * @return false if the file could not be written
+     */
+    bool writeJson(std::filesystem::path const &outputPath) const;
+    void writeJson(std::string &output) const;
+
+    /**
+     * @brief Get the recorder installed for the current thread, or null.
+     */
+    static CTraceRecorder *getCurrent() { return t_current; }
+
+private:
+    struct CEvent {
+        char const *name = nullptr;
+        std::uint64_t startNs = 0;
+        std::uint64_t durationNs = 0;
+        std::int64_t value = -1;
+        std::string detail;
+    };
+
+    struct CThreadBuffer {
+        int threadId;
+
+        // Taken by the owning thread for every event, and by writeJson.
+        // It is practically never contended.
+        std::mutex mutex;
+        std::vector<CEvent> events;
+        size_t nextEvent = 0;
+        bool isWrapped = false;
+    };
+
+    CThreadBuffer &getThreadBuffer();
+    std::uint64_t getOffsetNs(Clock::time_point const time) const;
+
+    static thread_local CTraceRecorder *t_current;
+
+    // Distinguishes instances for the per-thread lookup, even if a new
+    // instance is created at the address of a deleted one.
+    std::uint64_t const m_id;
+    size_t const m_eventsPerThread;
+    Clock::time_point const m_origin;
+
+    mutable std::mutex m_mutex;
+    std::vector<CThreadBuffer *> m_threadBuffers; // Owned
+};
+
+/**
+ * @brief Records the time from construction until stop() or destruction
+ * as a span into the recorder installed for the current thread (see
+ * CTraceRecorder::CScope).
+ */
+class CTraceSpan {
+public:
+    explicit CTraceSpan(char const *name)
+        : m_recorder(CTraceRecorder::getCurrent()),
+          m_name(name),
+          m_value(-1)
+    {
+        if(m_recorder) {
+            m_start = CTraceRecorder::Clock::now();
+        }
+    }
+
+    ~CTraceSpan() { stop(); }
+
+    CTraceSpan(CTraceSpan const &) = delete;
+    CTraceSpan &operator=(CTraceSpan const &) = delete;
+
+    /**
+     * @brief Whether the span is being recorded. Callers can skip
+     * preparing details nobody records.
+     */
+    bool isRecording() const { return m_recorder != nullptr; }
+
+    void setDetail(std::string const &detail) {
+        if(m_recorder) {
+            m_detail = detail;
+        }
+    }
+
+    void setValue(std::int64_t const value) { m_value = value; }
+
+    void stop() {
+        if(m_recorder) {
+            m_recorder->record(m_name, m_start, CTraceRecorder::Clock::now(), m_detail, m_value);
+            m_recorder = nullptr;
+        }
+    }
+
+private:
+    CTraceRecorder *m_recorder;
+    char const *const m_name;
+    std::int64_t m_value;
+    std::string m_detail;
+    CTraceRecorder::Clock::time_point m_start;
+};
@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+/**
+ * @brief Identity and version of a file on disk, as far as the file
+ * system can tell. Two paths with the same device and inode refer to the
+ * same file (for example through hard links). If size and modification
+ * time are unchanged as well, the file's contents are assumed unchanged.
+ */
+struct CFileIdentity {
+    std::uint64_t device = 0;
+    std::uint64_t inode = 0;
+    std::uint64_t size = 0;
+    std::int64_t modifiedTimeNs = 0;
+    std::uint64_t linkCount = 0;
+};
+
+/**
+ * @brief Get the identity of a file with a single stat call. Symbolic
+ * links are followed.
+ *
+ * @return true on success, false if the file cannot be stat'ed
+ */
+bool getFileIdentity(std::filesystem::path const &filePath, CFileIdentity &identity);
+
+/**
+ * @brief Whether the file was modified so recently that a further change
+ * within the same timestamp tick could go unnoticed. Results computed
+ * from such files should not be cached.
+ */
+bool isRecentlyModified(CFileIdentity const &identity);
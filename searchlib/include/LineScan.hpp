@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LINESCAN_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief Count the occurrences of a character in a buffer.
+ *
+ * On x86 the buffer is compared 16 bytes at a time with SSE2, which
+ * makes counting newlines (for line numbers) cheap even on large
+ * buffers. Works for 1, 2 and 4 byte character types.
+ */
+template<typename CharType>
+inline size_t countChar(CharType const *text, size_t const size, CharType const c) {
+    static_assert(sizeof(CharType) == 1 || sizeof(CharType) == 2 || sizeof(CharType) == 4,
+                  "unsupported character size");
+
+    size_t count = 0;
+    size_t i = 0;
+
+#ifdef LINESCAN_HAVE_SSE2
+    constexpr size_t charsPerBlock = 16 / sizeof(CharType);
+
+    __m128i needle;
+    if(sizeof(CharType) == 1) {
+        needle = _mm_set1_epi8(static_cast<char>(c));
+    } else if(sizeof(CharType) == 2) {
+        needle = _mm_set1_epi16(static_cast<short>(c));
+    } else {
+        needle = _mm_set1_epi32(static_cast<int>(c));
+    }
+
+    for(; i + charsPerBlock <= size; i += charsPerBlock) {
+        __m128i const block = _mm_loadu_si128(reinterpret_cast<__m128i const *>(text + i));
+        __m128i equal;
+
+        if(sizeof(CharType) == 1) {
+            equal = _mm_cmpeq_epi8(block, needle);
+        } else if(sizeof(CharType) == 2) {
+            equal = _mm_cmpeq_epi16(block, needle);
+        } else {
+            equal = _mm_cmpeq_epi32(block, needle);
+        }
+
+        // Every matching character sets sizeof(CharType) bits in the mask.
+        unsigned const mask = static_cast<unsigned>(_mm_movemask_epi8(equal));
+        count += std::bitset<16>(mask).count() / sizeof(CharType);
+    }
+#endif
+
+    for(; i < size; ++i) {
+        if(text[i] == c) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * @brief Count the line feeds in a buffer.
+ */
+template<typename CharType>
+inline size_t countNewlines(CharType const *text, size_t const size) {
+    return countChar(text, size, static_cast<CharType>('\n'));
+}
@@ -45,4 +45,35 @@ inline std::wstring wupper(std::wstring const &wText) {
     std::transform(wResult.begin(), wResult.end(), wResult.begin(),
                    [](wchar_t c) { return std::towupper(c); });
     return wResult;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Append a UTF-8 string to a buffer as a quoted JSON string.
+ */
+inline void appendJsonString(std::string const &text, std::string &buffer) {
+    static char const hexDigits[] = "0123456789abcdef";
+
+    buffer += '"';
+    for(char const c : text) {
+        switch(c) {
+            case '"':  buffer += "\\\""; break;
+            case '\\': buffer += "\\\\"; break;
+            case '\n': buffer += "\\n"; break;
+            case '\r': buffer += "\\r"; break;
+            case '\t': buffer += "\\t"; break;
+
+            default:
+                // Other control characters must be escaped. Bytes of
+                // UTF-8 sequences are passed through as they are.
+                if(static_cast<unsigned char>(c) < 0x20) {
+                    buffer += "\\u00";
+                    buffer += hexDigits[(c >> 4) & 0xf];
+                    buffer += hexDigits[c & 0xf];
+                } else {
+                    buffer += c;
+                }
+                break;
+        }
+    }
+    buffer += '"';
+}
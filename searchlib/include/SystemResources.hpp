@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+/**
+ * @brief CPU and memory available to the process.
+ *
+ * Inside a container, the limits of the container's control group are
+ * usually much lower than what the machine has, so they are taken into
+ * account where the platform supports them.
+ */
+struct CSystemResources {
+    // Number of CPUs the process can keep busy. At least 1.
+    size_t cpuCount = 1;
+
+    // Physical memory the process can use, in bytes. 0 if unknown.
+    std::uint64_t memoryBytes = 0;
+};
+
+/**
+ * @brief Detect the resources available to the process: the CPUs it may
+ * run on and the machine's physical memory, lowered to the limits of its
+ * cgroup v2 control group (cpu.max and memory.max) on Linux.
+ */
+CSystemResources getSystemResources();
+
+/**
+ * @brief Lower the given resources to the limits set in a cgroup v2
+ * control group and all of its ancestors.
+ *
+ * @param cgroupRoot mount point of the cgroup v2 hierarchy, normally
+ *        /sys/fs/cgroup
+ * @param cgroupPath path of the control group within the hierarchy, as
+ *        listed in /proc/self/cgroup (for example "/user.slice")
+ */
+void applyCgroupLimits(std::filesystem::path const &cgroupRoot,
+                       std::string const &cgroupPath,
+                       CSystemResources &resources);
+
+/**
+ * @brief Parse the contents of a cgroup v2 cpu.max file ("max 100000" or
+ * "<quota> <period>") into a number of CPUs, rounded up.
+ *
+ * @return true if the file sets a limit, false if it is unlimited or
+ *         cannot be parsed
+ */
+bool parseCgroupCpuMax(std::string const &text, size_t &cpuCount);
+
+/**
+ * @brief Parse the contents of a cgroup v2 memory.max file ("max" or a
+ * number of bytes).
+ *
+ * @return true if the file sets a limit, false if it is unlimited or
+ *         cannot be parsed
+ */
+bool parseCgroupMemoryMax(std::string const &text, std::uint64_t &memoryBytes);
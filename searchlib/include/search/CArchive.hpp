@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <filesystem>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+/**
+ * @brief An archive member opened for reading. Deleting it closes the
+ * member.
+ */
+class CArchiveMember {
+public:
+    virtual ~CArchiveMember() = default;
+
+    /**
+     * @brief Get the stream buffer which yields the member's contents.
+     */
+    virtual std::streambuf *getBuffer() = 0;
+};
+
+class CTarReader;
+
+/**
+ * @brief Where reading a tar archive stopped, to read on from there. Each
+ * thread has a cursor of its own; a search which reads one archive on
+ * several threads in turn keeps one to hand on (see CArchive::CCursorScope).
+ * Deleting it closes the archive.
+ */
+struct CTarCursor {
+    CTarCursor() = default;
+    ~CTarCursor();
+
+    CTarCursor(CTarCursor const &) = delete;
+    CTarCursor &operator=(CTarCursor const &) = delete;
+
+    CTarReader *reader = nullptr; // Owned
+};
+
+/**
+ * @brief Access to the members of zip and tar archives, which searches
+ * expose as virtual files named "archive.zip!/path/in/archive". Members
+ * are read straight out of the archive; nothing is extracted to disk.
+ *
+ * Zip archives have a central directory, so any member can be opened on
+ * its own. Tar archives, which may also be compressed as a whole (.tar.gz,
+ * .tgz, .tar.xz, .txz, .tar.zst, .tzst), can only be read front to back:
+ * every thread keeps its position in the tar archive it read last, so
+ * opening the members in archive order reads the archive once.
+ */
+class CArchive {
+public:
+    /**
+     * @brief Makes the calling thread read tar members through a given
+     * cursor instead of its own while the scope lasts. Batches of members
+     * searched one after the other on different threads pass a cursor on
+     * this way, so that the archive is still read once. A cursor must not
+     * be in scope on two threads at once.
+     */
+    class CCursorScope {
+    public:
+        explicit CCursorScope(CTarCursor &cursor);
+        ~CCursorScope();
+
+        CCursorScope(CCursorScope const &) = delete;
+        CCursorScope &operator=(CCursorScope const &) = delete;
+
+    private:
+        CTarCursor *m_previous; // Not owned
+    };
+
+    enum class Format {
+        None,
+        Zip,
+        Tar,
+    };
+
+    /**
+     * @brief Get the format of an archive, judging by its extension.
+     */
+    static Format getFormat(std::filesystem::path const &archivePath);
+
+    /**
+     * @brief Whether the members of an archive format can be opened
+     * independently of each other, and so searched in parallel.
+     */
+    static bool isRandomAccess(Format const format) { return format == Format::Zip; }
+
+    /**
+     * @brief Whether a path names a member of an archive whose members
+     * cannot be opened independently (see isRandomAccess). Opening such a
+     * member a second time, once a thread has read past it, reads the
+     * archive again from the start.
+     */
+    static bool isSequentialMember(std::filesystem::path const &path);
+
+    /**
+     * @brief List the names of the regular file members of an archive,
+     * in archive order. Members which cannot be read (encrypted ones, or
+     * ones compressed with methods other than deflate) are left out.
+     *
+     * @return false if the archive cannot be read
+     */
+    static bool listMembers(std::filesystem::path const &archivePath, std::vector<std::string> &names);
+
+    /**
+     * @brief Open a member for reading.
+     *
+     * @return the member, owned by the caller, or null if the archive has
+     *         no such member
+     */
+    static CArchiveMember *openMember(std::filesystem::path const &archivePath, std::string const &memberName);
+
+    /**
+     * @brief Get the virtual path of an archive member.
+     */
+    static std::filesystem::path makeMemberPath(std::filesystem::path const &archivePath, std::string const &memberName);
+
+    /**
+     * @brief Split the virtual path of an archive member into the path
+     * of the archive and the member's name.
+     *
+     * @return false if the path does not name an archive member
+     */
+    static bool splitMemberPath(std::filesystem::path const &memberPath,
+                                std::filesystem::path &archivePath,
+                                std::string &memberName);
+};
@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <istream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Literal search through a stream or a buffer of characters of type
+ * CharT: bytes (char), UTF-16 code units (char16_t) or wide characters
+ * (wchar_t). Supports options for case sensitivity and whole or partial
+ * matches.
+ *
+ * Case-insensitive searches fold every character on its own with
+ * std::towlower. Bytes outside ASCII and UTF-16 surrogates are only parts
+ * of characters and are never folded, so a narrow search folds the ASCII
+ * letters only.
+ *
+ * Instantiated for char, char16_t and wchar_t in CBasicStreamSearcher.cpp.
+ * CStreamSearcher puts the instances behind the IStreamSearcher interface.
+ */
+template<typename CharT>
+class CBasicStreamSearcher {
+public:
+    using String = std::basic_string<CharT>;
+    using Stream = std::basic_istream<CharT>;
+
+    /**
+     * @brief Create a stream searcher.
+     *
+     * @param matchText the match string
+     * @param caseInsensitive if true, the match is case insensitive, otherwise case sensitive
+     * @param wholeMatch if true, whole match, otherwise partial match
+     * @param maxBufferSize number of characters read from a stream at a time
+     */
+    CBasicStreamSearcher(String const &matchText,
+                         bool const caseInsensitive = false,
+                         bool const wholeMatch = false,
+                         size_t const maxBufferSize = 1000000);
+
+    /**
+     * @brief Get the match string, folded to lowercase if the search is
+     * case insensitive.
+     */
+    String const &getMatchText() const { return m_matchText; }
+    bool isCaseInsensitive() const { return m_isCaseInsensitive; }
+    bool isWholeMatch() const { return m_isWholeMatch; }
+
+    void setMaxBufferSize(size_t const maxBufferChars) { m_maxBufferSize = maxBufferChars; }
+    size_t getMaxBufferSize() const { return m_maxBufferSize; }
+
+    /**
+     * @brief Perform search on an input stream. The stream is read in
+     * windows of the maximum buffer size, and the end of each window is
+     * carried over into the next one, so the stream need not be seekable.
+     *
+     * @return true if full or partial match according to options; otherwise false
+     */
+    bool searchText(Stream &in) const;
+
+    /**
+     * @brief Perform search on text that is already loaded into memory.
+     *
+     * @return true if full or partial match according to options; otherwise false
+     */
+    bool searchBuffer(CharT const *text, size_t const size) const;
+
+    /**
+     * @brief Find all non-overlapping occurrences of the match text.
+     * For a whole match, the whole buffer is the only possible match.
+     *
+     * @param maxMatches stop after this many matches have been found
+     * @param matches receives one (offset, length) pair per match
+     */
+    void findMatches(CharT const *text,
+                     size_t const size,
+                     size_t const maxMatches,
+                     std::vector<std::pair<size_t, size_t>> &matches) const;
+
+private:
+    /**
+     * @brief Search one window of a stream for the match text.
+     */
+    bool bufferedSearch(CharT const *text, size_t const size) const;
+
+    /**
+     * @brief Compare a chunk from an input stream against a chunk
+     * in the match string.
+     * @param text pointer to start of the chunk from the stream
+     * @param size size of the chunk
+     * @param streamPos index of the start of the chunk within the stream
+     * @return true if the chunk matches, false otherwise
+     */
+    bool bufferedMatch(CharT const *text, size_t const size, size_t const streamPos) const;
+
+    String m_matchText;
+    bool m_isCaseInsensitive;
+    bool m_isWholeMatch;
+    size_t m_maxBufferSize;
+};
+
+extern template class CBasicStreamSearcher<char>;
+extern template class CBasicStreamSearcher<char16_t>;
+extern template class CBasicStreamSearcher<wchar_t>;
@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <search/StreamBuffers.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <istream>
+
+class CArchiveMember;
+
+/**
+ * @brief Wide character stream over the contents of a file, used by all
+ * content filters in place of std::wifstream.
+ *
+ * Files compressed with gzip (.gz), Zstandard (.zst) or xz (.xz) are
+ * decompressed on the fly, so that filters see the original text. The
+ * format is chosen by the file extension and confirmed by the format's
+ * magic number; other files, and compressed files whose decoder was not
+ * available at build time, are read as they are.
+ *
+ * Paths of archive members ("archive.zip!/path/in/archive", see CArchive)
+ * are read straight out of the archive, and decompressed as well if the
+ * member's name calls for it.
+ *
+ * Decompression happens in fixed-size chunks as the stream is read, so
+ * memory stays bounded however large the file is, and a filter which
+ * stops reading after the first match never decompresses the rest.
+ * Seeking is limited to moving back within the recently read characters,
+ * which is what the stream searchers need to overlap their windows.
+ */
+class CContentStream : public std::wistream {
+public:
+    using Compression = CDecompressingBuffer::Format;
+
+    explicit CContentStream(std::filesystem::path const &filePath);
+    ~CContentStream();
+
+    CContentStream(CContentStream const &) = delete;
+    CContentStream &operator=(CContentStream const &) = delete;
+
+    /**
+     * @brief Get the compression the stream decompresses.
+     */
+    Compression getCompression() const;
+
+    /**
+     * @brief Get the compression a file would be decompressed with,
+     * judging by its extension only. Returns None for formats this build
+     * cannot decompress.
+     */
+    static Compression getCompression(std::filesystem::path const &filePath);
+
+    /**
+     * @brief Whether this build can decompress a format.
+     */
+    static bool isSupported(Compression const compression);
+
+private:
+    // Plain files
+    std::wfilebuf m_fileBuffer;
+
+    // Compressed files and archive members, from the file up
+    std::filebuf m_byteBuffer;
+    CArchiveMember *m_member; // Owned, null if not reading an archive member
+    CDecompressingBuffer *m_decompressingBuffer; // Owned, null if not compressed
+    CWideningBuffer *m_wideningBuffer; // Owned, null for plain files
+};
+
+/**
+ * @brief Byte stream over the contents of a file, which decompresses files
+ * and reads archive members like CContentStream, but leaves the bytes
+ * undecoded. Used by searchers which can search raw bytes (see
+ * IStreamSearcher::searchBytes). Cannot seek.
+ */
+class CContentByteStream : public std::istream {
+public:
+    explicit CContentByteStream(std::filesystem::path const &filePath);
+    ~CContentByteStream();
+
+    CContentByteStream(CContentByteStream const &) = delete;
+    CContentByteStream &operator=(CContentByteStream const &) = delete;
+
+private:
+    std::filebuf m_byteBuffer;
+    CArchiveMember *m_member; // Owned, null if not reading an archive member
+    CDecompressingBuffer *m_decompressingBuffer; // Owned, null if not compressed
+};
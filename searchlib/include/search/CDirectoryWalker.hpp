@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <search/CIgnoreRules.hpp>
+#include <search/CSearchStats.hpp>
+#include <search/CVisitedInodes.hpp>
+#include <search/IDirectoryCache.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Depth-first walk over a directory tree which reports every
+ * regular file to a callback.
+ *
+ * Unlike std::filesystem::recursive_directory_iterator, the walker keeps
+ * an explicit stack of open directories, which lets it attach state to
+ * each directory level. When ignore files are respected, the rules from
+ * ".gitignore", ".ignore" and ".git/info/exclude" are compiled once per
+ * directory and kept on that stack, and ignored directories are pruned
+ * before they are opened.
+ *
+ * Symbolic links to directories are not followed unless enabled with
+ * setFollowSymlinks. When they are followed, every directory is
+ * identified by device and inode and entered at most once, so symbolic
+ * link cycles end the descent instead of recursing forever. Directories
+ * that cannot be opened (for example because of missing permissions) are
+ * skipped.
+ *
+ * With a directory cache, directories which have not changed since an
+ * earlier walk are replayed from the cache instead of being read again.
+ *
+ * If search statistics are installed on the calling thread, the time
+ * spent opening and listing each directory read from disk is recorded as
+ * one DirectoryRead operation (see CSearchStats).
+ */
+class CDirectoryWalker {
+public:
+    using FileCallback = std::function<void(std::filesystem::path const &)>;
+
+    /**
+     * @brief Create a walker for the tree below the given root directory.
+     */
+    explicit CDirectoryWalker(std::filesystem::path const &root);
+
+    /**
+     * @brief Enable or disable evaluation of ignore files.
+     */
+    void setRespectIgnoreFiles(bool const respectIgnoreFiles) { m_respectIgnoreFiles = respectIgnoreFiles; }
+    bool isRespectIgnoreFiles() const { return m_respectIgnoreFiles; }
+
+    /**
+     * @brief Set the cache used to skip reading unchanged directories,
+     * or null to always read them. The walker does NOT take ownership of
+     * the cache.
+     */
+    void setDirectoryCache(IDirectoryCache *directoryCache) { m_directoryCache = directoryCache; }
+
+    /**
+     * @brief Enable or disable descending into symbolic links to
+     * directories.
+     */
+    void setFollowSymlinks(bool const followSymlinks) { m_followSymlinks = followSymlinks; }
+    bool isFollowSymlinks() const { return m_followSymlinks; }
+
+    /**
+     * @brief Set the set of directories already entered, shared with
+     * other walkers of the same search, or null to use a set of this walk
+     * only. Only used when following symbolic links. The walker does NOT
+     * take ownership of the set.
+     */
+    void setVisitedDirectories(CVisitedInodes *visitedDirectories) { m_visitedDirectories = visitedDirectories; }
+
+    /**
+     * @brief Walk the tree and call onFile with the path of each regular
+     * file that is not ignored. The callback is invoked on the calling
+     * thread.
+     */
+    void walk(FileCallback const &onFile);
+
+    /**
+     * @brief Remove roots which lie within other roots, as well as
+     * duplicates, so that no directory is walked twice. Roots are compared
+     * by their canonical paths, with symbolic links resolved. The
+     * remaining roots keep their order and spelling.
+     */
+    static std::vector<std::filesystem::path> removeOverlappingRoots(std::vector<std::filesystem::path> const &roots);
+
+private:
+    struct CLevel {
+        CIgnoreRules rules;
+
+        // Length of the directory's generic path string including the
+        // trailing separator, used to derive paths relative to the level.
+        size_t baseLength;
+
+        // Prepended to the derived relative path. Only non-empty for
+        // levels above the search root.
+        std::string prefix;
+    };
+
+    struct CFrame {
+        std::filesystem::path directory;
+
+        // Used when the directory is read from disk.
+        std::filesystem::directory_iterator it;
+        bool isComplete = true;
+
+        // The cached listing being replayed, or the listing being recorded
+        // for the cache while the directory is read.
+        IDirectoryCache::CListing listing;
+        bool isCached = false;
+        size_t nextFile = 0;
+        size_t nextSubdirectory = 0;
+
+        // Time spent opening and listing the directory so far, and the
+        // number of entries listed; only tracked with statistics.
+        std::uint64_t readNs = 0;
+        std::uint64_t entryCount = 0;
+
+        bool hasLevel = false;
+    };
+
+    bool openFrame(std::filesystem::path const &directory, CFrame &frame);
+    void popFrame(std::vector<CFrame> &stack);
+    void pushLevel(std::filesystem::path const &directory, bool const isRepositoryRoot);
+    void pushRootLevels();
+    bool isIgnored(std::filesystem::path const &entryPath, bool const isDirectory) const;
+
+    std::filesystem::path m_root;
+    bool m_respectIgnoreFiles;
+    IDirectoryCache *m_directoryCache;
+    bool m_followSymlinks;
+    CVisitedInodes *m_visitedDirectories;
+
+    // The set used by the current walk, when following symbolic links
+    CVisitedInodes *m_activeVisitedDirectories;
+
+    std::vector<CLevel> m_levels;
+
+    // Statistics of the current walk, or null
+    CSearchStats *m_stats;
+};
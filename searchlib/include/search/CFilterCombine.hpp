@@ -8,11 +8,15 @@
 #include <memory>
 #include <sstream>
 
+/**
+ * @brief Class which combines several filters with a logical AND or OR.
+ * The combined filter takes ownership of the filters added to it.
+ */
 class CFilterCombine : public IFilter {
 public:
     enum class Mode { AND, OR };
 
-    CFilterCombine(Mode mode)
+    explicit CFilterCombine(Mode mode)
         : m_mode(mode)
     {}
 
@@ -28,7 +32,14 @@ public:
         m_filters.push_back(filter);
     }
 
-    virtual bool filterFile(std::filesystem::path const &filePath) {
+    Mode getMode() const { return m_mode; }
+
+    /**
+     * @brief Get the combined filters. Ownership stays with this object.
+     */
+    std::vector<IFilter *> const &getFilters() const { return m_filters; }
+
+    virtual bool filterFile(std::filesystem::path const &filePath) const {
         if(m_filters.empty()) {
             return true;
         }
@@ -57,12 +68,55 @@ public:
      * @brief Represent the filter and its options as a
      * text string.
      */
-    virtual std::wstring getText() {
+    virtual std::wstring getText() const {
         std::wstringstream wss;
         wss << L"Multiple filters";
         return wss.str();
     }
 
+    /**
+     * @brief The key lists the keys of all combined filters, in order.
+     * If any of them has no key, neither does the combination.
+     */
+    virtual std::wstring getKey() const {
+        std::wstring key = (m_mode == Mode::AND) ? L"and(" : L"or(";
+
+        for(auto &f : m_filters) {
+            std::wstring const filterKey = f->getKey();
+
+            if(filterKey.empty()) {
+                return std::wstring();
+            }
+
+            key += std::to_wstring(filterKey.size()) + L":" + filterKey;
+        }
+
+        key += L")";
+        return key;
+    }
+
+    virtual void setMaxBufferSize(size_t const maxBufferChars) {
+        for(auto &f : m_filters) {
+            f->setMaxBufferSize(maxBufferChars);
+        }
+    }
+
+    /**
+     * @brief The combined filter is as expensive as its most
+     * expensive member.
+     */
+    virtual Cost getCost() const {
+        Cost cost = Cost::Name;
+
+        for(auto &f : m_filters) {
+            if(f->getCost() > cost) {
+                cost = f->getCost();
+            }
+        }
+
+        return cost;
+    }
+
 private:
     std::vector<IFilter *> m_filters;
     Mode m_mode;
@@ -1,13 +1,17 @@
 // SPDX-License-Identifier: GPL-2.0
 #pragma once
 
+#include <search/CStreamFuzzySearcher.hpp>
 #include <search/IFilter.hpp>
 #include <search/IStreamSearcher.hpp>
 
+#include <cstdint>
 #include <filesystem>
 #include <sstream>
 #include <string>
 #include <regex>
+#include <utility>
+#include <vector>
 
 /**
  * @brief Class which filters files by file contents.
@@ -21,11 +25,14 @@ public:
      * @param caseInsensitive if true, the match is case insensitive, otherwise case sensitive
      * @param wholeMatch if true, whole match, otherwise partial match
      * @param isRegex if true, matchText is treated as a regex expression, and the caseInsensitive option is ignored
+     * @param maxEdits if not 0, matchText may occur with up to this many inserted, deleted or substituted
+     *                 characters. Ignored for regex searches.
      */
     CFilterContents(std::wstring const &matchText,
                 bool const caseInsensitive = false,
                 bool const wholeMatch = false,
-                bool const isRegex = false);
+                bool const isRegex = false,
+                size_t const maxEdits = 0);
 
     virtual ~CFilterContents();
 
@@ -37,9 +44,60 @@ public:
      */
     virtual std::wstring getText() const;
 
+    // Implementation of IFilter::getKey
+    virtual std::wstring getKey() const;
+
+    // Implementation of IFilter::setMaxBufferSize
+    virtual void setMaxBufferSize(size_t const maxBufferChars);
+
+    /**
+     * @brief Apply the filter to file contents that were already loaded
+     * into memory, for example when several content filters share one
+     * read of the file.
+     */
+    bool filterBuffer(wchar_t const *text, size_t const size) const;
+
+    /**
+     * @brief Find the individual matches of the filter in file contents
+     * that were already loaded into memory.
+     *
+     * @param maxMatches stop after this many matches have been found
+     * @param matches receives one (offset, length) pair per match
+     */
+    void findMatches(wchar_t const *text,
+                     size_t const size,
+                     size_t const maxMatches,
+                     std::vector<std::pair<size_t, size_t>> &matches) const;
+
+    /**
+     * @brief Find the smallest number of edits the match text occurs with
+     * in a file, or 0 if it occurs exactly. Only approximate searches
+     * (see getMaxEdits) can report anything but 0.
+     *
+     * @return the number of edits, or CFuzzyMatcher::NO_MATCH if the file
+     *         does not match
+     */
+    size_t findBestDistance(std::filesystem::path const &filePath) const;
+
+    /**
+     * @brief Get the fingerprint of the filter's key, which identifies
+     * its verdicts in a CVerdictCache.
+     */
+    std::uint64_t getFingerprint() const { return m_fingerprint; }
+
+    std::wstring getMatchText() const { return m_matchText; }
+    bool isCaseInsensitive() const { return m_isCaseInsensitive; }
+    bool isWholeMatch() const { return m_isWholeMatch; }
+    bool isRegex() const { return m_isRegex; }
+    size_t getMaxEdits() const { return m_maxEdits; }
+
 private:
     IStreamSearcher *m_streamSearcher;
+    CStreamFuzzySearcher *m_fuzzySearcher; // m_streamSearcher if the search is approximate, otherwise null
+    std::wstring m_matchText;
     bool m_isCaseInsensitive;
     bool m_isWholeMatch;
     bool m_isRegex;
+    size_t m_maxEdits;
+    std::uint64_t m_fingerprint;
 };
\ No newline at end of file
@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <search/CFuzzyMatcher.hpp>
+#include <search/IFilter.hpp>
+
+#include <filesystem>
+#include <string>
+
+/**
+ * @brief Class which filters files by filename, allowing for a number of
+ * typos: a name matches if at most maxEdits single-character insertions,
+ * deletions or substitutions turn the match text into the name (whole
+ * match) or into a part of it (partial match).
+ *
+ * How close a name comes to the match text is available as a similarity
+ * score, which a search can rank its matches by (see
+ * CRanking::Key::NameSimilarity).
+ */
+class CFilterFuzzyName : public IFilter {
+public:
+    /**
+     * @brief Create the CFilterFuzzyName instance.
+     *
+     * @param matchText the match string
+     * @param maxEdits the largest number of edits a matching name may need
+     * @param caseInsensitive if true, the match is case insensitive, otherwise case sensitive
+     * @param wholeMatch if true, whole match, otherwise partial match
+     */
+    CFilterFuzzyName(std::wstring const &matchText,
+                     size_t const maxEdits,
+                     bool const caseInsensitive = false,
+                     bool const wholeMatch = false);
+
+    virtual bool filterFile(std::filesystem::path const &filePath) const;
+
+    /**
+     * @brief Represent the filter and its options as a
+     * text string.
+     */
+    virtual std::wstring getText() const;
+
+    // Implementation of IFilter::getKey
+    virtual std::wstring getKey() const;
+
+    /**
+     * @brief Name filters only look at the path and never touch the disk.
+     */
+    virtual Cost getCost() const { return Cost::Name; }
+
+    /**
+     * @brief Get how similar a file's name is to the match text, from 0
+     * (not a match) to 1 (an exact match).
+     */
+    double getSimilarity(std::filesystem::path const &filePath) const;
+
+    std::wstring getMatchText() const { return m_matchText; }
+    size_t getMaxEdits() const { return m_maxEdits; }
+
+private:
+    CFuzzyMatcher m_matcher;
+    std::wstring m_matchText;
+    size_t m_maxEdits;
+    bool m_isCaseInsensitive;
+    bool m_isWholeMatch;
+};
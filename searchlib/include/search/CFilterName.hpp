@@ -37,8 +37,17 @@ public:
      */
     virtual std::wstring getText() const;
 
+    // Implementation of IFilter::getKey
+    virtual std::wstring getKey() const;
+
+    /**
+     * @brief Name filters only look at the path and never touch the disk.
+     */
+    virtual Cost getCost() const { return Cost::Name; }
+
 private:
     IStreamSearcher *m_streamSearcher;
+    std::wstring m_matchText;
     bool m_isCaseInsensitive;
     bool m_isWholeMatch;
     bool m_isRegex;
@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <search/CTermAutomaton.hpp>
+#include <search/IFilter.hpp>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Class which filters files by a compound content query of
+ * several terms, such as "contains timeout within 200 characters of
+ * retry" or "contains A and B but not C", evaluated in a single pass
+ * over the file.
+ *
+ * Queries are written as terms separated by spaces, which must all occur
+ * in the file. Terms are quoted with double quotes if they contain spaces
+ * or would otherwise read as an operator. The operators are:
+ *
+ *   A AND B      both terms occur (the same as "A B")
+ *   NOT A        the term does not occur
+ *   A NEAR/N B   the terms occur with at most N characters between them,
+ *                in either order. Chains such as "A NEAR/5 B NEAR/9 C"
+ *                put each term near the next.
+ *
+ * All terms are found with one Aho-Corasick automaton (CTermAutomaton)
+ * while the file is streamed in chunks. Reading stops as soon as the
+ * outcome is certain: when an excluded term occurs, or, if there are no
+ * excluded terms, when every required term and proximity has been seen.
+ * A query with excluded terms has to read matching files to the end.
+ */
+class CFilterTerms : public IFilter {
+public:
+    /**
+     * @brief Create the CFilterTerms instance.
+     *
+     * @param query the query, in the syntax described above
+     * @param caseInsensitive if true, terms are matched case insensitively
+     * @throws std::invalid_argument if the query is malformed
+     */
+    explicit CFilterTerms(std::wstring const &query, bool const caseInsensitive = false);
+
+    virtual ~CFilterTerms();
+
+    CFilterTerms(CFilterTerms const &) = delete;
+    CFilterTerms &operator=(CFilterTerms const &) = delete;
+
+    virtual bool filterFile(std::filesystem::path const &filePath) const;
+
+    /**
+     * @brief Apply the filter to file contents that were already loaded
+     * into memory.
+     */
+    bool filterBuffer(wchar_t const *text, size_t const size) const;
+
+    /**
+     * @brief Represent the filter and its options as a
+     * text string.
+     */
+    virtual std::wstring getText() const;
+
+    // Implementation of IFilter::getKey
+    virtual std::wstring getKey() const;
+
+    // Implementation of IFilter::setMaxBufferSize
+    virtual void setMaxBufferSize(size_t const maxBufferChars);
+
+    std::wstring getQuery() const { return m_query; }
+    bool isCaseInsensitive() const { return m_isCaseInsensitive; }
+
+    /**
+     * @brief Get the distinct terms of the query.
+     */
+    std::vector<std::wstring> const &getTerms() const { return m_terms; }
+
+private:
+    // Two terms which must occur with at most maxGap characters between them
+    struct CProximity {
+        std::uint32_t first;
+        std::uint32_t second;
+        size_t maxGap;
+    };
+
+    class CEvaluation;
+
+    void parse();
+    std::uint32_t addTerm(std::wstring const &term, bool const isExcluded);
+
+    std::wstring m_query;
+    bool m_isCaseInsensitive;
+    size_t m_maxBufferSize;
+
+    // A term may be both required and excluded, which no file satisfies.
+    std::vector<std::wstring> m_terms;
+    std::vector<bool> m_isRequired;
+    std::vector<bool> m_isExcluded;
+    size_t m_requiredCount;
+    bool m_hasExcluded;
+
+    std::vector<CProximity> m_proximities;
+
+    // Indices into m_proximities of the proximities each term is part of
+    std::vector<std::vector<std::uint32_t>> m_termProximities;
+
+    // Built from m_terms once parsing is done
+    CTermAutomaton *m_automaton; // Owned
+};
@@ -0,0 +1,172 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Approximate string matching by edit distance (Levenshtein
+ * distance: insertions, deletions and substitutions of single
+ * characters), using Myers' bit-parallel algorithm.
+ *
+ * The pattern is preprocessed once into one bit mask per distinct
+ * character. Matching a text then costs a handful of word operations per
+ * text character and 64 pattern characters, independently of the allowed
+ * distance, and allocates nothing for patterns of up to 64 characters.
+ * Longer patterns are split into 64-character blocks which pass their
+ * carries on to each other (Hyyrö's blocked variant).
+ *
+ * A whole match compares the pattern with the entire text. A partial
+ * match finds the substring of the text closest to the pattern, so that
+ * for example "repot" matches "quarterly_report.pdf" within one edit.
+ *
+ * Texts which arrive in pieces, such as file contents read in chunks, are
+ * matched with a CScan, which carries the state of the matrix from one
+ * piece to the next, so that no match is missed at a piece boundary and
+ * no text has to be read twice.
+ *
+ * Thread-safe once constructed. A CScan belongs to one thread.
+ */
+class CFuzzyMatcher {
+    using Word = std::uint64_t;
+
+public:
+    // Returned by getDistance if the text does not match within the
+    // maximum distance
+    static constexpr size_t NO_MATCH = static_cast<size_t>(-1);
+
+    /**
+     * @brief State of a match over a text which arrives in pieces. See
+     * beginScan.
+     */
+    class CScan {
+    public:
+        /**
+         * @brief Whether the outcome is certain, so that the rest of the
+         * text need not be scanned: a partial match has reached the stop
+         * distance, or a whole match has grown too long to stay within
+         * the maximum distance.
+         */
+        bool isDecided() const { return m_isDecided; }
+
+        /**
+         * @brief Get the number of characters scanned so far.
+         */
+        size_t getPosition() const { return m_position; }
+
+        /**
+         * @brief Get the smallest distance between the pattern and a
+         * substring (partial match) or the whole (whole match) of the
+         * text scanned so far, which ends at the current position.
+         */
+        size_t getDistance() const { return m_score; }
+
+        /**
+         * @brief Get the smallest distance between the pattern and a
+         * substring (partial match) or a prefix (whole match) of the text
+         * scanned so far, and where the first such substring or the
+         * longest such prefix ends.
+         */
+        size_t getBestDistance() const { return m_best; }
+        size_t getBestEnd() const { return m_bestEnd; }
+
+    private:
+        friend class CFuzzyMatcher;
+
+        std::vector<Word> m_pv;
+        std::vector<Word> m_mv;
+        size_t m_score = 0;
+        size_t m_best = 0;
+        size_t m_bestEnd = 0;
+        size_t m_position = 0;
+        size_t m_maxDistance = 0;
+        size_t m_stopDistance = 0;
+        bool m_isDecided = false;
+    };
+
+    /**
+     * @brief Create the matcher.
+     *
+     * @param pattern the text to look for
+     * @param caseInsensitive if true, characters are compared by their
+     *                        lowercase versions
+     * @param wholeMatch if true, the whole text is compared with the
+     *                   pattern, otherwise its closest substring
+     */
+    CFuzzyMatcher(std::wstring const &pattern, bool const caseInsensitive, bool const wholeMatch);
+
+    /**
+     * @brief Get the smallest number of edits which turn the pattern into
+     * the text (whole match) or into a substring of the text (partial
+     * match).
+     *
+     * @param maxDistance the largest distance of interest. Texts which
+     *                    cannot be within it are rejected early.
+     * @return the distance, or NO_MATCH if it is larger than maxDistance
+     */
+    size_t getDistance(wchar_t const *text, size_t const length, size_t const maxDistance) const;
+
+    size_t getDistance(std::wstring const &text, size_t const maxDistance) const {
+        return getDistance(text.data(), text.size(), maxDistance);
+    }
+
+    /**
+     * @brief Start matching a text which arrives in pieces.
+     *
+     * @param maxDistance the largest distance of interest
+     * @param stopDistance a partial match stops scanning once it has found
+     *                     a substring within this distance: maxDistance to
+     *                     only learn whether the text matches, 0 to learn
+     *                     the best distance, NO_MATCH to scan everything
+     */
+    void beginScan(CScan &scan, size_t const maxDistance, size_t const stopDistance) const;
+
+    /**
+     * @brief Scan the next piece of the text. Returns early once the scan
+     * is decided.
+     */
+    void continueScan(CScan &scan, wchar_t const *text, size_t const length) const;
+
+    /**
+     * @brief Get the distance of the text scanned, as getDistance would
+     * for the whole text.
+     *
+     * @return the distance, or NO_MATCH if it is larger than the scan's
+     *         maximum distance
+     */
+    size_t finishScan(CScan const &scan) const;
+
+    /**
+     * @brief Turn a distance into a similarity between 0 (nothing in
+     * common) and 1 (identical), relative to the length of the pattern,
+     * or for a whole match to the longer of pattern and text.
+     */
+    double getSimilarity(size_t const distance, size_t const textLength) const;
+
+    size_t getPatternLength() const { return m_pattern.size(); }
+
+private:
+    // Characters below this have their masks in a plain array
+    static constexpr size_t DIRECT_CHARS = 256;
+
+    Word const *getMasks(wchar_t const c) const;
+
+    size_t getDistanceSingleBlock(wchar_t const *text, size_t const length, size_t const maxDistance) const;
+
+    std::wstring m_pattern;
+    bool m_isCaseInsensitive;
+    bool m_isWholeMatch;
+    size_t m_blockCount;
+
+    // Match masks, m_blockCount words per character: bit i of a
+    // character's masks is set if the pattern has that character at
+    // position i. Rows 0 to DIRECT_CHARS - 1 belong to those characters,
+    // the row after them is all zeros for characters not in the pattern,
+    // and other characters of the pattern follow. Case-insensitive
+    // matchers give uppercase characters the rows of their lowercase
+    // versions.
+    std::vector<Word> m_masks;
+    std::unordered_map<wchar_t, size_t> m_otherRows;
+};
@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Compiled set of ignore rules belonging to a single directory.
+ *
+ * The rules follow gitignore semantics: blank lines and comments are
+ * skipped, a leading '!' negates a rule, a trailing '/' restricts a rule
+ * to directories, and a rule containing a '/' is anchored to the directory
+ * the rules were loaded from. Within one rule set, the last matching rule
+ * decides the outcome.
+ *
+ * Rules are classified when they are compiled so that the common cases
+ * (plain file names such as "node_modules", and extension rules such as
+ * "*.o") are answered by a hash lookup or a suffix compare, and only
+ * genuine glob patterns go through the wildcard matcher.
+ */
+class CIgnoreRules {
+public:
+    /**
+     * @brief Result of testing a path against a rule set.
+     */
+    enum class Verdict { None, Ignore, Include };
+
+    CIgnoreRules() = default;
+
+    /**
+     * @brief Parse and compile rules from the text of an ignore file.
+     * Rules added later take precedence over rules added earlier.
+     */
+    void addRules(std::string const &text);
+
+    /**
+     * @brief Read and compile an ignore file. Missing or unreadable
+     * files are silently skipped.
+     *
+     * @return true if the file was read, false otherwise
+     */
+    bool addRulesFromFile(std::filesystem::path const &filePath);
+
+    /**
+     * @brief Test a path against the rule set.
+     *
+     * @param relativePath path relative to the directory the rules belong
+     *        to, using '/' as separator
+     * @param name the last component of relativePath
+     * @param isDirectory whether the path refers to a directory
+     * @return Verdict::None if no rule matched, otherwise whether the last
+     *         matching rule ignores or re-includes the path
+     */
+    Verdict match(std::string const &relativePath,
+                  std::string const &name,
+                  bool const isDirectory) const;
+
+    /**
+     * @brief Whether any rules were compiled.
+     */
+    bool empty() const { return m_rules.empty(); }
+
+    /**
+     * @brief Whether any rule needs the full relative path rather than
+     * just the file name.
+     */
+    bool needsRelativePath() const { return m_hasAnchoredRules; }
+
+private:
+    enum class Kind { Literal, Suffix, Prefix, Glob };
+
+    struct CRule {
+        std::string pattern;
+        Kind kind;
+        bool isNegated;
+        bool isDirectoryOnly;
+        bool isAnchored;
+    };
+
+    void compileLine(std::string line);
+
+    std::vector<CRule> m_rules;
+
+    // Literal, unanchored rules indexed by file name. The value is the
+    // index of the last such rule, so that a single lookup tells us the
+    // highest-precedence literal rule for a name.
+    std::unordered_map<std::string, size_t> m_literalRules;
+    std::unordered_map<std::string, size_t> m_literalDirectoryRules;
+
+    // Indices of all rules that are not answered by the literal maps,
+    // in ascending order.
+    std::vector<size_t> m_patternRules;
+
+    bool m_hasAnchoredRules = false;
+};
+
+/**
+ * @brief Match a gitignore-style glob pattern against a string.
+ *
+ * '*' and '?' never match '/', "**" matches across directory separators
+ * when it forms a whole path component, and [...] denotes a character
+ * class (with '!' or '^' for negation).
+ */
+bool globMatch(std::string const &pattern, std::string const &text);
@@ -0,0 +1,29 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <string>
+
+/**
+ * @brief Location of a single content match within a file.
+ *
+ * Offsets and columns count characters as read from the file. For
+ * single-byte encodings such as ASCII, they are equal to byte offsets.
+ */
+struct CMatchLocation {
+    // Offset of the first matched character from the start of the file.
+    size_t offset = 0;
+
+    // Number of matched characters.
+    size_t length = 0;
+
+    // 1-based line and column of the first matched character.
+    size_t lineNumber = 0;
+    size_t column = 0;
+
+    // Text around the match, limited to the line(s) containing it and
+    // to a bounded number of characters on either side.
+    std::wstring snippet;
+
+    // Offset of the match within the snippet.
+    size_t snippetMatchOffset = 0;
+};
@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <search/CMatchLocation.hpp>
+
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Turns raw match ranges within a loaded buffer into match
+ * locations with line numbers and context snippets.
+ *
+ * Line numbers are computed incrementally between consecutive matches
+ * with a vectorized newline count, and snippets are sliced from the
+ * buffer, so the file is never read a second time.
+ */
+class CMatchLocator {
+public:
+    /**
+     * @param maxMatches maximum number of locations reported per buffer
+     * @param snippetContext maximum number of characters included on each
+     *        side of a match in its snippet
+     */
+    CMatchLocator(size_t const maxMatches, size_t const snippetContext);
+
+    size_t getMaxMatches() const { return m_maxMatches; }
+    size_t getSnippetContext() const { return m_snippetContext; }
+
+    /**
+     * @brief Build match locations for a set of ranges.
+     *
+     * @param text the buffer the ranges refer to
+     * @param size size of the buffer
+     * @param ranges (offset, length) pairs, in any order. Ranges are sorted
+     *        and duplicates are removed.
+     * @param locations receives at most getMaxMatches() locations, in
+     *        ascending order of offset
+     */
+    void locate(wchar_t const *text,
+                size_t const size,
+                std::vector<std::pair<size_t, size_t>> ranges,
+                std::vector<CMatchLocation> &locations) const;
+
+private:
+    size_t m_maxMatches;
+    size_t m_snippetContext;
+};
@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Static analysis of an ECMAScript regular expression.
+ *
+ * The analyzer parses a pattern into a small syntax tree and derives
+ * properties which hold for every possible match, so that files can be
+ * rejected before the regex engine runs. All derived properties are
+ * conservative: if the pattern cannot be parsed, the analyzer reports
+ * the weakest possible result (for example a minimum length of 0).
+ */
+class CRegexAnalyzer {
+public:
+    /**
+     * @brief Parse and analyze a regex pattern in ECMAScript syntax.
+     */
+    explicit CRegexAnalyzer(std::wstring const &pattern);
+
+    /**
+     * @brief Whether the pattern was understood by the analyzer.
+     */
+    bool isValid() const { return m_isValid; }
+
+    /**
+     * @brief Get the minimum number of characters of any match.
+     */
+    size_t getMinLength() const;
+
+    /**
+     * @brief Get literal strings which occur in every match, in the order
+     * of the pattern. A file without one of them cannot match. Empty if
+     * the pattern has no such literal, for example because every
+     * literal is part of an alternation.
+     */
+    std::vector<std::wstring> getRequiredLiterals() const;
+
+    /**
+     * @brief Get a literal string which every match starts with, or an
+     * empty string if matches may start differently.
+     */
+    std::wstring getRequiredPrefix() const;
+
+    /**
+     * @brief Whether every match lies within one line: nothing in the
+     * pattern can match a line feed, and no lookahead or backreference
+     * may look beyond one.
+     */
+    bool isLineBound() const;
+
+private:
+    enum class NodeType { Literal, Class, Assertion, Backreference, Group };
+
+    struct CNode {
+        NodeType type;
+        wchar_t literal = 0;
+
+        // For groups: each alternative is a sequence of nodes.
+        std::vector<std::vector<CNode>> alternatives;
+
+        size_t minRepeat = 1;
+        size_t maxRepeat = 1;
+
+        // For classes and assertions: whether a line feed may match
+        bool canMatchNewline = false;
+    };
+
+    static size_t const UNBOUNDED = static_cast<size_t>(-1);
+
+    std::vector<std::vector<CNode>> parseAlternatives();
+    std::vector<CNode> parseSequence();
+    CNode parseAtom();
+    CNode parseEscape();
+    bool parseClass();
+    void parseQuantifier(CNode &node);
+    size_t parseNumber();
+
+    static size_t minLength(CNode const &node);
+    static size_t minLength(std::vector<CNode> const &sequence);
+
+    static void collectLiterals(std::vector<CNode> const &sequence,
+                                std::wstring &run,
+                                std::vector<std::wstring> &literals);
+    static bool collectPrefix(std::vector<CNode> const &sequence, std::wstring &prefix);
+    static bool canMatchNewline(CNode const &node);
+
+    std::wstring m_pattern;
+    size_t m_pos;
+
+    CNode m_root;
+    bool m_isValid;
+};
@@ -0,0 +1,194 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <search/CSearchQuery.hpp>
+#include <search/IDirectoryCache.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Cache of search results, so that repeating a query over
+ * directories that have not changed is (nearly) free.
+ *
+ * Results are cached per query, identified by CSearchQuery::getKey. For
+ * each query the cache holds:
+ *  - the listing of every directory that was walked, validated by the
+ *    directory's modification time. A directory whose modification time
+ *    is unchanged has the same entries, so its listing is replayed
+ *    instead of reading the directory again.
+ *  - the verdict (match or no match) of every file which had to be
+ *    opened or stat'ed to evaluate the query, validated by the file's
+ *    size and modification time. A file whose size and modification time
+ *    are unchanged gets its cached verdict without being read.
+ *
+ * Note that changing a file's contents does not change the modification
+ * time of its directory, which is why verdicts carry their own stamps.
+ * Entries modified within the last few seconds are not cached at all,
+ * because a later change within the same timestamp tick would go
+ * unnoticed.
+ *
+ * The cache is bounded by an approximate size in bytes and by the age
+ * of its entries. When either bound is exceeded, the least recently used
+ * queries are evicted. The cache can be saved to and loaded from a file,
+ * to carry it over between runs of the program.
+ */
+class CResultCache {
+public:
+    /**
+     * @brief Size and modification time of a file when its verdict was
+     * computed.
+     */
+    struct CFileStamp {
+        std::uintmax_t size = 0;
+        std::int64_t modifiedTime = 0;
+        bool isValid = false;
+    };
+
+    /**
+     * @brief The cached results of one query. Obtained from acquire(),
+     * and safe to use from several threads at once.
+     */
+    class CQueryEntry : public IDirectoryCache {
+    public:
+        explicit CQueryEntry(std::wstring const &key);
+
+        // Implementation of IDirectoryCache
+        virtual bool findListing(std::filesystem::path const &directory, CListing &listing) override;
+        virtual void storeListing(std::filesystem::path const &directory, CListing const &listing) override;
+
+        /**
+         * @brief Look up the cached verdict of a file.
+         *
+         * @param stamp receives the current stamp of the file, which must
+         *        be passed to storeVerdict if there was no valid verdict
+         * @param isMatch receives the cached verdict
+         * @return true if there is a cached verdict and the file has not
+         *         changed since
+         */
+        bool findVerdict(std::filesystem::path const &filePath, CFileStamp &stamp, bool &isMatch);
+
+        /**
+         * @brief Store the verdict of a file. Does nothing if the stamp is
+         * not valid.
+         */
+        void storeVerdict(std::filesystem::path const &filePath, CFileStamp const &stamp, bool const isMatch);
+
+        /**
+         * @brief Get the approximate memory used by the entry, in bytes.
+         */
+        size_t getSize() const;
+
+    private:
+        friend class CResultCache;
+
+        struct CDirectoryRecord {
+            std::int64_t stamp;
+            std::vector<std::filesystem::path> files;
+            std::vector<std::filesystem::path> subdirectories;
+        };
+
+        struct CVerdictRecord {
+            std::uintmax_t size;
+            std::int64_t modifiedTime;
+            bool isMatch;
+        };
+
+        static size_t recordSize(std::filesystem::path::string_type const &key, CDirectoryRecord const &record);
+        static size_t recordSize(std::filesystem::path::string_type const &key);
+
+        std::wstring const m_key;
+
+        mutable std::mutex m_mutex;
+        std::unordered_map<std::filesystem::path::string_type, CDirectoryRecord> m_directories;
+        std::unordered_map<std::filesystem::path::string_type, CVerdictRecord> m_verdicts;
+        size_t m_size;
+
+        // Guarded by the mutex of the owning CResultCache.
+        std::int64_t m_lastUsed;
+        int m_useCount;
+    };
+
+    explicit CResultCache();
+    virtual ~CResultCache();
+
+    CResultCache(CResultCache const &) = delete;
+    CResultCache &operator=(CResultCache const &) = delete;
+
+    /**
+     * @brief Set the approximate maximum size of the cache in bytes.
+     */
+    void setMaxSize(size_t const maxSize);
+    size_t getMaxSize() const;
+
+    /**
+     * @brief Set how long a query stays cached after it was last used.
+     */
+    void setMaxAge(std::chrono::seconds const maxAge);
+    std::chrono::seconds getMaxAge() const;
+
+    /**
+     * @brief Get the cache entry for a query, creating an empty one if the
+     * query has not been cached before. The entry is not evicted until it
+     * is handed back with release().
+     *
+     * @return the entry, or null if the query cannot be cached because it
+     *         has no key. Ownership stays with the cache.
+     */
+    CQueryEntry *acquire(CSearchQuery const &searchQuery);
+
+    /**
+     * @brief Hand back an entry obtained from acquire(), after the search
+     * using it has completed. Evicts entries if the cache is over its
+     * bounds.
+     */
+    void release(CQueryEntry *entry);
+
+    /**
+     * @brief Get the number of cached queries.
+     */
+    size_t getEntryCount() const;
+
+    /**
+     * @brief Get the approximate memory used by the cache, in bytes.
+     */
+    size_t getSize() const;
+
+    /**
+     * @brief Remove all entries which are not currently acquired.
+     */
+    void clear();
+
+    /**
+     * @brief Write the cache to a file.
+     *
+     * @return true on success, false if the file could not be written
+     */
+    bool save(std::filesystem::path const &filePath) const;
+
+    /**
+     * @brief Replace the contents of the cache with those of a file
+     * written by save(). Must not be called while entries are acquired.
+     *
+     * @return true on success, false if the file does not exist or is
+     *         not a valid cache file, in which case the cache is empty
+     */
+    bool load(std::filesystem::path const &filePath);
+
+private:
+    void evict(std::int64_t const now);
+    void clearUnused();
+
+    mutable std::mutex m_mutex;
+
+    // Owned by the cache; deleted on eviction and in the destructor.
+    std::unordered_map<std::wstring, CQueryEntry *> m_entries;
+
+    size_t m_maxSize;
+    std::chrono::seconds m_maxAge;
+};
@@ -0,0 +1,119 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <search/ISearchObserver.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Search observer which streams matched files to a CSV or
+ * newline-delimited JSON (NDJSON) file while the search runs.
+ *
+ * In Background mode, the search threads only append the matched path to
+ * a bounded hand-off queue. A dedicated writer thread takes the whole
+ * queue at once, formats the rows into a large buffer and writes it out
+ * in big blocks, so formatting and disk I/O stay off the search threads.
+ * If the writer falls behind by more than the queue capacity, the search
+ * threads wait for it, which bounds the memory used by the exporter.
+ *
+ * In Direct mode there is no writer thread; rows are formatted and
+ * buffered by the search thread which found the match, under a mutex.
+ * This is useful when the output is fast (for example a pipe that is
+ * drained immediately) or when no extra thread is wanted.
+ *
+ * Paths are written as UTF-8. Call finish() (or destroy the exporter)
+ * after the search has completed to flush the remaining rows.
+ */
+class CResultExporter : public ISearchObserver {
+public:
+    enum class Format { Csv, NdJson };
+    enum class Mode { Background, Direct };
+
+    /**
+     * @brief Create an exporter writing to the given file, which is
+     * created or truncated.
+     *
+     * @throws std::runtime_error if the file cannot be opened
+     */
+    CResultExporter(std::filesystem::path const &outputPath, Format const format,
+                    Mode const mode = Mode::Background);
+
+    /**
+     * @brief Create an exporter writing to an existing stream. The
+     * exporter does NOT take ownership of the stream, which must outlive
+     * the exporter.
+     */
+    CResultExporter(std::ostream &output, Format const format,
+                    Mode const mode = Mode::Background);
+
+    virtual ~CResultExporter();
+
+    CResultExporter(CResultExporter const &) = delete;
+    CResultExporter &operator=(CResultExporter const &) = delete;
+
+    // Implementation of ISearchObserver::onFileMatched
+    virtual void onFileMatched(std::filesystem::path const &matchedFile) override;
+
+    /**
+     * @brief Set the maximum number of rows waiting for the writer thread
+     * before the search threads have to wait. Has no effect in Direct mode.
+     * Must be called before the search starts.
+     */
+    void setQueueCapacity(size_t const queueCapacity);
+
+    /**
+     * @brief Write all remaining rows, flush the output and stop the
+     * writer thread. No rows may be added afterwards. Calling finish()
+     * more than once has no effect.
+     */
+    void finish();
+
+    /**
+     * @brief Get the number of rows written (or buffered for writing).
+     */
+    size_t getRowsWritten() const;
+
+    /**
+     * @brief Whether writing to the output failed at some point.
+     */
+    bool hasError() const;
+
+    /**
+     * @brief Append a single formatted row, including the line break, to
+     * the given buffer.
+     */
+    static void formatRow(Format const format, std::filesystem::path const &filePath, std::string &buffer);
+
+private:
+    void start();
+    void writerThreadFunc();
+    void writeHeader();
+    void flushBuffer(std::string &buffer);
+
+    std::ofstream m_ownedOutput;
+    std::ostream &m_output;
+    Format const m_format;
+    Mode const m_mode;
+
+    // Guards the hand-off queue in Background mode, and the buffer in
+    // Direct mode.
+    mutable std::mutex m_mutex;
+    std::condition_variable m_queueNotEmpty;
+    std::condition_variable m_queueNotFull;
+    std::vector<std::filesystem::path> m_queue;
+    size_t m_queueCapacity;
+
+    std::string m_directBuffer;
+    std::thread m_writerThread;
+    size_t m_rowsWritten;
+    bool m_isFinished;
+    std::atomic_bool m_hasError;
+};
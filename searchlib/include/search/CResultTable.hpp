@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Column store for the results of a search, meant to hold millions
+ * of rows for a result view.
+ *
+ * A row holds a file's name and directory, as ids of strings interned in
+ * one pool per column, its size and its modification time. Interning
+ * keeps the directory shared by many results in memory once, and lets
+ * sorting compare strings by precomputed ranks.
+ *
+ * One thread (the writer) appends rows, while any number of other threads
+ * read the rows published so far, for example to sort or filter them in
+ * the background with select(). Columns are stored in blocks which never
+ * move once allocated, and getRowCount() only counts a row once all of its
+ * cells and strings are written. A table is never cleared; start a new
+ * one instead, once nobody reads the old one anymore.
+ */
+class CResultTable {
+public:
+    using Row = std::uint32_t;
+    using StringId = std::uint32_t;
+
+    enum class Column {
+        None,           // no sorting; rows keep the order they were added in
+        Name,           // file name; ties are ordered by directory
+        Directory,      // directory; ties are ordered by file name
+        Size,           // size in bytes
+        ModifiedTime,   // modification time
+    };
+
+    CResultTable();
+    ~CResultTable();
+
+    CResultTable(CResultTable const &) = delete;
+    CResultTable &operator=(CResultTable const &) = delete;
+
+    /**
+     * @brief Append a row. Writer only.
+     *
+     * @param modifiedTime modification time in nanoseconds since the file
+     *        clock's epoch, as in CRankedResult
+     * @throws std::length_error if the table is full
+     */
+    Row addRow(std::filesystem::path const &path, std::uint64_t const size, std::int64_t const modifiedTime);
+
+    /**
+     * @brief Get the number of rows published so far. Any thread may read
+     * the rows below it.
+     */
+    size_t getRowCount() const { return m_rowCount.load(std::memory_order_acquire); }
+
+    StringId getNameId(Row const row) const { return m_nameIds[row]; }
+    StringId getDirectoryId(Row const row) const { return m_directoryIds[row]; }
+    std::uint64_t getSize(Row const row) const { return m_sizes[row]; }
+    std::int64_t getModifiedTime(Row const row) const { return m_modifiedTimes[row]; }
+
+    std::wstring_view getName(StringId const id) const { return m_names.strings[id]; }
+    std::wstring_view getDirectory(StringId const id) const { return m_directories.strings[id]; }
+
+    std::filesystem::path getPath(Row const row) const;
+
+    /**
+     * @brief Compute a view of the first rowCount rows: those whose name or
+     * directory contains the filter text, ignoring case, ordered by a
+     * column. Rows that tie keep the order they were added in. Runs on
+     * the calling thread and up to threadCount - 1 more, and may run
+     * while the writer appends further rows.
+     *
+     * @param filterText empty to keep all rows
+     * @param isDescending whether the largest values (Z for names) come first
+     * @return the rows of the view, in order
+     */
+    std::vector<Row> select(size_t const rowCount,
+                            std::wstring const &filterText,
+                            Column const sortColumn,
+                            bool const isDescending,
+                            size_t const threadCount) const;
+
+private:
+    // Cells are stored in blocks of BLOCK_SIZE, reached through a fixed
+    // array of block pointers, so a cell never moves and readers need no
+    // lock while the writer adds blocks.
+    static constexpr size_t BLOCK_BITS = 16;
+    static constexpr size_t BLOCK_SIZE = size_t(1) << BLOCK_BITS;
+    static constexpr size_t MAX_BLOCKS = 4096;
+
+    template<typename T>
+    class CColumn {
+    public:
+        CColumn() : m_blocks{} {}
+        ~CColumn() {
+            for(T *block : m_blocks) {
+                delete[] block;
+            }
+        }
+
+        CColumn(CColumn const &) = delete;
+        CColumn &operator=(CColumn const &) = delete;
+
+        T const &operator[](size_t const index) const {
+            return m_blocks[index >> BLOCK_BITS][index & (BLOCK_SIZE - 1)];
+        }
+
+        void set(size_t const index, T const &value) {
+            T *&block = m_blocks[index >> BLOCK_BITS];
+            if(!block) {
+                block = new T[BLOCK_SIZE];
+            }
+            block[index & (BLOCK_SIZE - 1)] = value;
+        }
+
+    private:
+        std::array<T *, MAX_BLOCKS> m_blocks; // Owned
+    };
+
+    // Interned strings of one column. The characters are kept in chunks
+    // which are never freed or moved while the table lives.
+    struct CStringPool {
+        CStringPool() : count(0), chunkUsed(0) {}
+        ~CStringPool();
+
+        CColumn<std::wstring_view> strings;
+        std::atomic<size_t> count;
+
+        // Writer only
+        std::unordered_map<std::wstring_view, StringId> ids;
+        std::vector<wchar_t *> chunks; // Owned
+        size_t chunkUsed;
+    };
+
+    static StringId intern(CStringPool &pool, std::wstring const &text);
+
+    /**
+     * @brief Rank the first count strings of a pool in ascending order,
+     * ignoring case first.
+     */
+    static std::vector<std::uint32_t> rankStrings(CStringPool const &pool, size_t const count, size_t const threadCount);
+
+    /**
+     * @brief Mark the first count strings of a pool which contain the
+     * filter text, ignoring case.
+     */
+    static std::vector<char> findStrings(CStringPool const &pool, size_t const count,
+                                         std::wstring const &filterText, size_t const threadCount);
+
+    CColumn<StringId> m_nameIds;
+    CColumn<StringId> m_directoryIds;
+    CColumn<std::uint64_t> m_sizes;
+    CColumn<std::int64_t> m_modifiedTimes;
+
+    CStringPool m_names;
+    CStringPool m_directories;
+
+    std::atomic<size_t> m_rowCount;
+};
@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <cstddef>
+
+/**
+ * @brief Character buffer for reading files, meant to be kept per thread
+ * and reused for every file the thread scans.
+ *
+ * Unlike a std::vector or std::wstring, the buffer never initializes its
+ * characters. Memory pages are only touched once data is read into them,
+ * so a large buffer costs a small file no more than the file's size, and
+ * reusing the buffer avoids allocating and faulting in fresh memory for
+ * every file.
+ *
+ * Declare instances as static thread_local at the place they are used,
+ * so that callers on the same thread cannot overwrite each other's data.
+ *
+ * Instantiated for char, char16_t and wchar_t in CScanBuffer.cpp.
+ */
+template<typename CharT>
+class CBasicScanBuffer {
+public:
+    explicit CBasicScanBuffer();
+    ~CBasicScanBuffer();
+
+    CBasicScanBuffer(CBasicScanBuffer const &) = delete;
+    CBasicScanBuffer &operator=(CBasicScanBuffer const &) = delete;
+
+    /**
+     * @brief Make room for at least the given number of characters.
+     *
+     * @param chars the number of characters needed
+     * @param keepChars the number of characters at the start of the
+     *        buffer to preserve if the buffer has to grow
+     * @return the start of the buffer. Characters beyond keepChars have
+     *         unspecified values.
+     */
+    CharT *reserve(size_t const chars, size_t const keepChars = 0);
+
+    /**
+     * @brief Free the buffer's memory if it holds more than the given
+     * number of characters, so that one very large file does not pin
+     * memory for the lifetime of the thread.
+     */
+    void trim(size_t const maxChars);
+
+    CharT *data() { return m_data; }
+    size_t getCapacity() const { return m_capacity; }
+
+private:
+    CharT *m_data; // Owned
+    size_t m_capacity;
+};
+
+extern template class CBasicScanBuffer<char>;
+extern template class CBasicScanBuffer<char16_t>;
+extern template class CBasicScanBuffer<wchar_t>;
+
+using CScanBuffer = CBasicScanBuffer<wchar_t>;
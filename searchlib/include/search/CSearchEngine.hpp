@@ -1,21 +1,66 @@
 // SPDX-License-Identifier: GPL-2.0
 #pragma once
 
-#include <CThreadPool.hpp>
+#include <CExecutor.hpp>
+#include <CSemaphore.hpp>
+#include <CTaskGroup.hpp>
+#include <CTraceRecorder.hpp>
+#include <search/CArchive.hpp>
+#include <search/CResultCache.hpp>
+#include <search/CSearchPlan.hpp>
 #include <search/CSearchQuery.hpp>
+#include <search/CSearchSettings.hpp>
+#include <search/CSearchStats.hpp>
+#include <search/CTopResults.hpp>
+#include <search/CVisitedInodes.hpp>
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <filesystem>
 #include <vector>
 #include <memory>
 #include <mutex>
 #include <set>
+#include <string>
+#include <unordered_map>
+
+class CFilterFuzzyName;
 
 class CSearchEngine {
 public:
-    explicit CSearchEngine(CSearchQuery *searchQuery);
+    /**
+     * @brief Create an engine for the given query, which it takes
+     * ownership of. The settings limit the threads and memory the search
+     * uses; they are fixed when the engine is created.
+     */
+    explicit CSearchEngine(CSearchQuery *searchQuery,
+                           CSearchSettings const &settings = CSearchSettings());
     virtual ~CSearchEngine();
 
+    /**
+     * @brief Set the cache used to replay results of earlier searches for
+     * the same query, or null to not use a cache. Must be called before
+     * performSearch(). The engine does NOT take ownership of the cache,
+     * which must outlive the engine.
+     */
+    void setResultCache(CResultCache *resultCache);
+
+    /**
+     * @brief Set the cache of content filter verdicts per file, or null to
+     * not use one. Must be called before performSearch(). The engine does
+     * NOT take ownership of the cache, which must outlive the engine.
+     */
+    void setVerdictCache(CVerdictCache *verdictCache);
+
+    /**
+     * @brief Set the recorder which the search is traced to, or null to
+     * not trace it. Must be called before performSearch(). The engine
+     * does NOT take ownership of the recorder, which must outlive the
+     * engine.
+     */
+    void setTraceRecorder(CTraceRecorder *traceRecorder);
+
     /**
      * @brief Initiate a search according to the specifications
      * of the given search query.
@@ -28,6 +73,13 @@ public:
      */
     virtual int getPendingOperations();
 
+    /**
+     * @brief Block the calling thread until the search started by
+     * performSearch() has completed, i.e. until there are no pending
+     * operations left. Returns immediately if no search is running.
+     */
+    void waitForCompletion();
+
     /**
      * @brief Get the number of files that have been enumerated
      * in the search directories so far.
@@ -46,17 +98,124 @@ public:
      */
     virtual int getTotalMatches();
 
+    /**
+     * @brief Get the execution plan compiled from the search query's
+     * filters. The plan is fixed when the engine is created.
+     */
+    CSearchPlan const &getSearchPlan() const { return m_searchPlan; }
+
+    /**
+     * @brief Get the settings the engine was created with.
+     */
+    CSearchSettings const &getSettings() const { return m_settings; }
+
+    /**
+     * @brief Get the best matches so far of a ranked search, best first,
+     * or nothing if the query has no ranking (see CSearchQuery::setRanking).
+     */
+    std::vector<CRankedResult> getRankedResults() const;
+
+    /**
+     * @brief Get the time spent in each stage of the search so far, or
+     * null if the settings disabled collecting statistics. The statistics
+     * may be read while the search is running.
+     */
+    CSearchStats const *getStats() const { return m_stats; }
+
 private:
-    void spawnEnumerateWorker(std::filesystem::path const enumPath);
+    void spawnEnumerateWorker(std::filesystem::path const &enumPath);
+    void spawnListWorker();
     void spawnSearchWorker(std::vector<std::filesystem::path> searchPath);
+    void addToBatch(std::filesystem::path filePath, std::vector<std::filesystem::path> &paths);
+    void enumerateArchive(std::filesystem::path const &archivePath,
+                          std::vector<std::filesystem::path> &paths);
 
-    bool matchesAllFilters(std::filesystem::path const &filePath);
-    void notifyAllObservers(std::filesystem::path const &matchedFile);
+    /**
+     * @brief Members of a tar archive, searched one batch after the other.
+     */
+    struct CArchiveMembers {
+        std::filesystem::path archivePath;
+        std::vector<std::string> names;
+        size_t next = 0; // First member of the next batch
+        CTarCursor cursor;
+    };
+
+    /**
+     * @brief Search the remaining members of an archive, a batch at a
+     * time: the next batch is queued, or searched right away if searching
+     * has fallen behind.
+     */
+    void searchArchiveMembers(std::shared_ptr<CArchiveMembers> members);
+
+    /**
+     * @brief Post a task to search the next batch of an archive's members,
+     * which goes on with the rest of them in turn.
+     */
+    void spawnArchiveWorker(std::shared_ptr<CArchiveMembers> members);
+    void searchArchiveBatch(CArchiveMembers &members);
+    void searchBatch(std::vector<std::filesystem::path> const &fileList);
+    void rankMatch(std::filesystem::path const &filePath,
+                   std::vector<CMatchLocation> const &locations,
+                   CTopResults &batchTop);
+    void publishRankedResults(bool const isFinal);
+    CSearchFile const *findKnownFile(std::filesystem::path const &filePath) const;
+
+    bool matchesAllFilters(std::filesystem::path const &filePath,
+                           std::vector<CMatchLocation> *locations,
+                           CSearchPlan::ContentVerdict const *contentVerdict = nullptr);
+    bool evaluateFile(std::filesystem::path const &filePath,
+                      std::vector<CMatchLocation> *locations,
+                      CSearchPlan::ContentVerdict const *contentVerdict = nullptr);
+    bool evaluateDistinctFile(std::filesystem::path const &filePath,
+                              std::vector<CMatchLocation> *locations);
+    void notifyAllObservers(std::filesystem::path const &matchedFile,
+                            std::vector<CMatchLocation> const &locations);
 
     CSearchQuery *m_searchQuery;
-    CThreadPool *m_threadPool;
-    std::atomic_int m_pendingOperations;
+    CSearchSettings m_settings;
+    CSearchPlan m_searchPlan;
+    bool m_wantsMatchLocations;
+    CResultCache *m_resultCache;
+    CResultCache::CQueryEntry *m_queryCache;
+    bool m_useCachedVerdicts;
+    CExecutor::CQueue *m_taskQueue; // Owned
+    CSemaphore *m_ioSlots; // Owned, null if reads are not limited
+    CTaskGroup m_searchTasks;
+    CSearchStats *m_stats; // Owned, null if not collected
+    CTraceRecorder *m_traceRecorder;
     std::atomic_int m_totalFilesToSearch;
     std::atomic_int m_totalFilesSearched;
     std::atomic_int m_totalMatches;
+
+    // Whether archive members are searched as virtual files
+    bool const m_searchArchives;
+
+    // Files reached through several paths (hard links, followed symbolic
+    // links) have their contents read once; later paths reuse the
+    // verdict. Directories are entered once when following symbolic
+    // links.
+    bool const m_followSymlinks;
+    CVisitedInodes *m_visitedFiles; // Owned, null if files are not read
+    CVisitedInodes *m_visitedDirectories; // Owned, null if links are not followed
+
+    // Batches posted to the queue which no worker has started yet
+    std::atomic_int m_queuedBatches;
+    int m_maxQueuedBatches;
+
+    // Ranked searches keep only the best matches. Batches rank their
+    // matches locally and merge them into m_topResults.
+    CRanking const m_ranking;
+    CTopResults *m_topResults; // Owned, null if the search is not ranked
+    CFilterFuzzyName const *m_similarityFilter; // Filter ranking by name similarity uses, or null
+    mutable std::mutex m_topMutex;
+    bool m_isTopChanged;
+
+    // Listed files (see CSearchQuery::setSearchFiles) with known metadata,
+    // by path. Ranking by size or time takes them from here instead of
+    // looking at the file again. Filled before the first batch is posted.
+    std::unordered_map<std::filesystem::path::string_type, CSearchFile const *> m_knownFiles;
+
+    // Serializes calls to onRankedResults
+    std::mutex m_publishMutex;
+    std::chrono::steady_clock::time_point m_lastPublishTime;
 };
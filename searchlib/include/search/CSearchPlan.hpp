@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <search/CFilterContents.hpp>
+#include <search/CMatchLocation.hpp>
+#include <search/CMatchLocator.hpp>
+#include <search/CVerdictCache.hpp>
+#include <search/IFilter.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Execution plan compiled from the filter list of a search query.
+ *
+ * The search query holds a flat list of filters which must all match.
+ * Instead of evaluating that list as-is for every file, the plan:
+ *  - flattens nested AND combinations into the top-level list,
+ *  - orders the filters by cost class, so name filters run before
+ *    metadata filters, which run before content filters,
+ *  - merges all plain content filters into one content scan, so a file
+ *    is read at most once no matter how many content filters there are,
+ *  - derives file size bounds from the content filters (for example,
+ *    a whole-match literal of N characters requires a file of exactly N
+ *    bytes), so files can be rejected with a stat instead of a read.
+ *
+ * The plan does not take ownership of any filters. They must outlive it.
+ */
+class CSearchPlan {
+public:
+    enum class StepType { Filter, SizeCheck, ContentScan };
+
+    struct CStep {
+        StepType type;
+
+        // For StepType::Filter: the filter to evaluate.
+        IFilter const *filter = nullptr;
+
+        // For StepType::ContentScan: the content filters sharing one read.
+        std::vector<CFilterContents const *> contentFilters;
+    };
+
+    /**
+     * @brief Decides the outcome of the steps which only depend on the
+     * size and contents of a file (the size check and the content scan),
+     * given a function which evaluates them. This lets a caller reuse the
+     * outcome for every path of a file reached under several paths, while
+     * filters which look at the path still see each of them.
+     */
+    using ContentVerdict = std::function<bool(std::function<bool()> const &evaluate)>;
+
+    /**
+     * @brief Compile a plan for the given list of filters, which must all
+     * match for a file to be included.
+     */
+    explicit CSearchPlan(std::vector<IFilter *> const &filters);
+
+    /**
+     * @brief Evaluate the plan for a single file.
+     *
+     * @param filePath the file to evaluate
+     * @param locations if not null, receives the locations of the content
+     *        matches in a matching file. Collecting locations requires the
+     *        file to be loaded into memory in one piece, so no locations
+     *        are reported for very large files.
+     * @param contentVerdict if not null, decides the outcome of the size
+     *        check and the content scan in place of evaluating them
+     * @return true if the file matches all filters, false otherwise
+     */
+    bool matches(std::filesystem::path const &filePath,
+                 std::vector<CMatchLocation> *locations = nullptr,
+                 ContentVerdict const *contentVerdict = nullptr) const;
+
+    /**
+     * @brief Set how many match locations are reported per file, and how
+     * much context is included in their snippets.
+     */
+    void setLocationOptions(size_t const maxMatchesPerFile, size_t const snippetContext);
+
+    /**
+     * @brief Set the size of the largest file (in characters) which is
+     * loaded into memory once and shared by all content filters of a
+     * scan. Larger files are streamed through each filter instead.
+     */
+    void setMaxBufferSize(size_t const maxBufferChars);
+
+    /**
+     * @brief Set the cache consulted by the content scan before reading a
+     * file, or null to always read files. Verdicts of the plain content
+     * filters are looked up per file and filter, and the verdicts computed
+     * during the scan are stored back. The plan does NOT take ownership of
+     * the cache.
+     */
+    void setVerdictCache(CVerdictCache *verdictCache) { m_verdictCache = verdictCache; }
+
+    /**
+     * @brief Get the ordered list of steps in the plan.
+     */
+    std::vector<CStep> const &getSteps() const { return m_steps; }
+
+    /**
+     * @brief Get the smallest file size (in bytes) that can match.
+     */
+    std::uintmax_t getMinFileSize() const { return m_minFileSize; }
+
+    /**
+     * @brief Whether the plan requires one exact file size.
+     */
+    bool hasExactFileSize() const { return m_hasExactFileSize; }
+    std::uintmax_t getExactFileSize() const { return m_exactFileSize; }
+
+    /**
+     * @brief Whether any file can match at all. This is false if the
+     * derived constraints contradict each other.
+     */
+    bool isSatisfiable() const { return m_isSatisfiable; }
+
+    /**
+     * @brief Whether evaluating the plan touches the file itself (its
+     * metadata or contents), rather than only its path.
+     */
+    bool needsFileAccess() const;
+
+    /**
+     * @brief Represent the plan as a human-readable, multi-line text.
+     */
+    std::wstring getText() const;
+
+private:
+    void addFilter(IFilter const *filter, std::vector<IFilter const *> &flattened);
+    void deriveSizeBounds(CFilterContents const *filter);
+    bool matchesStep(CStep const &step,
+                     std::filesystem::path const &filePath,
+                     std::vector<CMatchLocation> *locations) const;
+    bool checkSize(std::filesystem::path const &filePath) const;
+    bool scanContents(std::filesystem::path const &filePath,
+                      std::vector<CFilterContents const *> const &contentFilters,
+                      std::vector<CMatchLocation> *locations) const;
+
+    std::vector<CStep> m_steps;
+    CMatchLocator m_matchLocator;
+    CVerdictCache *m_verdictCache;
+    size_t m_maxSharedScanChars;
+
+    std::uintmax_t m_minFileSize;
+    std::uintmax_t m_exactFileSize;
+    bool m_hasExactFileSize;
+    bool m_isSatisfiable;
+};
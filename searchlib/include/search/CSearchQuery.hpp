@@ -2,11 +2,33 @@
 #pragma once
 
 #include <search/IFilter.hpp>
+#include <search/CTopResults.hpp>
 #include <search/ISearchObserver.hpp>
 
+#include <cstdint>
 #include <filesystem>
+#include <string>
 #include <vector>
 
+/**
+ * @brief A file which a query searches in place of enumerating its
+ * directories, together with metadata an earlier search has already
+ * collected for it. See CSearchQuery::setSearchFiles.
+ */
+struct CSearchFile {
+    std::filesystem::path path;
+
+    // Whether size and modifiedTime are known
+    bool hasMetadata = false;
+
+    // Size in bytes
+    std::uint64_t size = 0;
+
+    // Modification time in nanoseconds since the file clock's epoch, as
+    // in CRankedResult
+    std::int64_t modifiedTime = 0;
+};
+
 class CSearchQuery {
 public:
     explicit CSearchQuery();
@@ -22,6 +44,28 @@ public:
      */
     virtual std::vector<std::filesystem::path> getDirectories() const;
 
+    /**
+     * @brief Search the given files instead of enumerating the directories,
+     * for example to refine the results of an earlier search with further
+     * filters. The files go straight into search batches, so the search
+     * costs time in proportion to their number rather than to the size of
+     * the tree they came from. Nothing is enumerated: ignore files are not
+     * evaluated and archives are not listed, though archive members in the
+     * list are searched.
+     */
+    virtual void setSearchFiles(std::vector<CSearchFile> searchFiles);
+
+    /**
+     * @brief Get the files to search instead of the directories.
+     */
+    virtual std::vector<CSearchFile> const &getSearchFiles() const;
+
+    /**
+     * @brief Whether the query searches a list of files (see
+     * setSearchFiles) rather than its directories.
+     */
+    virtual bool hasSearchFiles() const;
+
     /**
      * @brief Set the list of filters to be used when searching.
      */
@@ -32,6 +76,70 @@ public:
      */
     virtual std::vector<IFilter *> getFilters() const;
 
+    /**
+     * @brief Set whether ignore files (.gitignore, .ignore and
+     * .git/info/exclude) are evaluated while enumerating the search
+     * directories. Ignored files and directories are not searched.
+     */
+    virtual void setRespectIgnoreFiles(bool const respectIgnoreFiles);
+
+    /**
+     * @brief Get whether ignore files are evaluated while enumerating.
+     */
+    virtual bool isRespectIgnoreFiles() const;
+
+    /**
+     * @brief Set whether symbolic links to directories are followed while
+     * enumerating. Every directory and every file is still searched only
+     * once, however many links lead to it.
+     */
+    virtual void setFollowSymlinks(bool const followSymlinks);
+    virtual bool isFollowSymlinks() const;
+
+    /**
+     * @brief Set whether the members of zip and tar archives are searched
+     * as well, as virtual files named "archive.zip!/path/in/archive" (see
+     * CArchive). The archives themselves are searched either way.
+     */
+    virtual void setSearchArchives(bool const searchArchives);
+    virtual bool isSearchArchives() const;
+
+    /**
+     * @brief Set the maximum number of match locations reported per file
+     * to observers which want match locations.
+     */
+    virtual void setMaxMatchesPerFile(size_t const maxMatchesPerFile);
+    virtual size_t getMaxMatchesPerFile() const;
+
+    /**
+     * @brief Set the maximum number of characters of context shown on
+     * each side of a match in its snippet.
+     */
+    virtual void setSnippetContext(size_t const snippetContext);
+    virtual size_t getSnippetContext() const;
+
+    /**
+     * @brief Set a ranking to only report the best matches, for example
+     * the 100 most recently modified ones. Observers then receive the
+     * ranked matches through onRankedResults instead of each match
+     * through onFileMatched. Ranking by match count counts at most
+     * getMaxMatchesPerFile() matches per file.
+     */
+    virtual void setRanking(CRanking const &ranking);
+    virtual CRanking getRanking() const;
+
+    /**
+     * @brief Get a canonical key identifying which files the query
+     * matches: its search directories, filters and enumeration options.
+     * Queries with equal keys produce the same results. The order of the
+     * directories and of the (AND-combined) filters does not matter.
+     *
+     * @return the key, or an empty string if some filter cannot be
+     *         identified by a key (see IFilter::getKey) or if the query
+     *         searches a list of files
+     */
+    virtual std::wstring getKey() const;
+
     /**
      * @brief Adds an observer to the result observer list.
      * The search query does NOT take ownership of
@@ -49,6 +157,14 @@ public:
 
 private:
     std::vector<std::filesystem::path> m_searchPaths;
+    std::vector<CSearchFile> m_searchFiles;
+    bool m_hasSearchFiles;
     std::vector<IFilter *> m_filters;
     std::vector<ISearchObserver *> m_observers;
+    bool m_respectIgnoreFiles;
+    bool m_followSymlinks;
+    bool m_searchArchives;
+    size_t m_maxMatchesPerFile;
+    size_t m_snippetContext;
+    CRanking m_ranking;
 };
\ No newline at end of file
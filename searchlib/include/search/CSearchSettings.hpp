@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <CExecutor.hpp>
+#include <SystemResources.hpp>
+
+#include <cstdint>
+
+/**
+ * @brief Resources a search may use: worker threads, concurrent file
+ * reads and memory for file buffers, and its share of the workers when
+ * other searches run at the same time.
+ *
+ * A default-constructed object holds defaults derived from the resources
+ * available to the process (see getSystemResources), so that a search in
+ * a container with a CPU quota of 2 runs 2 workers rather than one per
+ * CPU of the machine.
+ */
+class CSearchSettings {
+public:
+    /**
+     * @brief Create settings with defaults for the resources available
+     * to the process. The resources are detected once per process.
+     */
+    explicit CSearchSettings();
+
+    /**
+     * @brief Create settings with defaults for the given resources.
+     */
+    explicit CSearchSettings(CSystemResources const &resources);
+
+    /**
+     * @brief Set the number of worker threads which enumerate and search
+     * files at once. At least 1. Workers come from the executor shared by
+     * all searches (see CExecutor::getShared), which grows to this many
+     * workers if it has fewer.
+     */
+    void setWorkerThreads(size_t const workerThreads);
+    size_t getWorkerThreads() const { return m_workerThreads; }
+
+    /**
+     * @brief Set how many files may be read at the same time. Values
+     * below the number of workers make the other workers wait, which
+     * helps on spinning disks and network shares. At least 1.
+     */
+    void setIoConcurrency(size_t const ioConcurrency);
+    size_t getIoConcurrency() const { return m_ioConcurrency; }
+
+    /**
+     * @brief Set the memory all workers together may use for file
+     * buffers, in bytes. Files which do not fit into a worker's share are
+     * streamed in smaller pieces.
+     */
+    void setMemoryBudget(std::uint64_t const memoryBudget);
+    std::uint64_t getMemoryBudget() const { return m_memoryBudget; }
+
+    /**
+     * @brief Get the number of characters each worker may keep in its
+     * file buffer, i.e. the worker's share of the memory budget.
+     */
+    size_t getBufferCharsPerWorker() const;
+
+    /**
+     * @brief Set how many batches of enumerated files may wait to be
+     * searched. When that many are waiting, enumeration searches its next
+     * batch itself instead of queueing it, so the memory held by waiting
+     * paths stays bounded however many files a tree contains. 0 (the
+     * default) allows a few batches per worker thread.
+     */
+    void setMaxQueuedBatches(size_t const maxQueuedBatches) { m_maxQueuedBatches = maxQueuedBatches; }
+
+    /**
+     * @brief Get the effective limit of waiting batches, at least 1.
+     */
+    size_t getMaxQueuedBatches() const;
+
+    /**
+     * @brief Enable or disable timing of the search's stages (see
+     * CSearchStats). Enabled by default; disabling it saves reading the
+     * clock around every file operation.
+     */
+    void setCollectStats(bool const collectStats) { m_collectStats = collectStats; }
+    bool isCollectStats() const { return m_collectStats; }
+
+    /**
+     * @brief Set the priority of the search relative to other searches
+     * running at the same time. Interactive searches overtake the others,
+     * and Background searches only run while no other search is waiting
+     * for a worker. Normal by default.
+     */
+    void setPriority(CExecutor::Priority const priority) { m_priority = priority; }
+    CExecutor::Priority getPriority() const { return m_priority; }
+
+    /**
+     * @brief Set the share of the workers the search gets relative to
+     * other searches of the same priority. A search of weight 2 gets
+     * twice the worker time of one of weight 1. At least 1, the default.
+     */
+    void setWeight(unsigned const weight);
+    unsigned getWeight() const { return m_weight; }
+
+    static constexpr std::uint64_t MIN_MEMORY_BUDGET = 16ULL * 1024 * 1024;
+    static constexpr std::uint64_t MAX_DEFAULT_MEMORY_BUDGET = 1024ULL * 1024 * 1024;
+
+private:
+    size_t m_workerThreads;
+    size_t m_ioConcurrency;
+    std::uint64_t m_memoryBudget;
+    size_t m_maxQueuedBatches;
+    bool m_collectStats;
+    CExecutor::Priority m_priority;
+    unsigned m_weight;
+};
@@ -0,0 +1,203 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <CTraceRecorder.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Time spent in each stage of a search, for finding out where a
+ * slow search spends its time.
+ *
+ * Every thread records into its own set of counters, so recording never
+ * takes a lock or contends with other threads. The counters are atomics
+ * written by one thread only, so they can be read while the search is
+ * still running. For each stage the statistics hold the number of
+ * operations, their total duration, an amount processed (see
+ * getAmountUnit) and a histogram of the operations' durations with one
+ * bucket per power of two nanoseconds.
+ *
+ * Code inside the search does not get a CSearchStats passed in. Instead,
+ * the thread running a search task installs the search's statistics with
+ * a CScope, and CStageTimer records into whatever is installed. With no
+ * statistics installed, a timer costs one thread-local load.
+ */
+class CSearchStats {
+public:
+    enum class Stage {
+        DirectoryRead,  // opening and listing directories
+        Stat,           // reading file metadata
+        Open,           // opening files
+        Read,           // reading and decoding file contents
+        Match,          // evaluating filters on names and contents
+        Notify,         // reporting matches to observers
+    };
+
+    static constexpr size_t STAGE_COUNT = 6;
+    static constexpr size_t HISTOGRAM_BUCKETS = 32;
+
+    /**
+     * @brief Statistics of one stage, summed over all threads.
+     */
+    struct CStageSummary {
+        std::uint64_t count = 0;
+        std::uint64_t totalNs = 0;
+        std::uint64_t amount = 0;
+
+        // Bucket i counts operations which took [2^i, 2^(i+1)) ns; the
+        // last bucket also counts all longer ones.
+        std::uint64_t histogram[HISTOGRAM_BUCKETS] = {};
+
+        /**
+         * @brief Estimate the duration below which the given fraction
+         * (0 to 1) of operations completed, from the histogram. Returns
+         * the upper bound of the bucket the percentile falls into.
+         */
+        std::uint64_t getPercentileNs(double const fraction) const;
+    };
+
+    /**
+     * @brief Installs statistics for the current thread for as long as
+     * the scope lives. Scopes may be nested; the previous statistics are
+     * restored when the scope ends.
+     */
+    class CScope {
+    public:
+        explicit CScope(CSearchStats *stats);
+        ~CScope();
+
+        CScope(CScope const &) = delete;
+        CScope &operator=(CScope const &) = delete;
+
+    private:
+        CSearchStats *m_previous;
+    };
+
+    explicit CSearchStats();
+    ~CSearchStats();
+
+    CSearchStats(CSearchStats const &) = delete;
+    CSearchStats &operator=(CSearchStats const &) = delete;
+
+    /**
+     * @brief Record one operation of a stage, on behalf of the calling
+     * thread.
+     */
+    void record(Stage const stage, std::uint64_t const durationNs, std::uint64_t const amount);
+
+    /**
+     * @brief Get the statistics of one stage so far.
+     */
+    CStageSummary getSummary(Stage const stage) const;
+
+    /**
+     * @brief Represent the statistics of all stages as a human-readable,
+     * multi-line table.
+     */
+    std::wstring getText() const;
+
+    static std::wstring getStageName(Stage const stage);
+
+    /**
+     * @brief Get the name of a stage's spans in a trace (see
+     * CTraceRecorder).
+     */
+    static char const *getTraceName(Stage const stage);
+
+    /**
+     * @brief Get the unit of a stage's amount: directory entries for
+     * DirectoryRead, characters for Read, matched files for Notify.
+     * Empty for stages without an amount.
+     */
+    static std::wstring getAmountUnit(Stage const stage);
+
+    /**
+     * @brief Get the statistics installed for the current thread, or null.
+     */
+    static CSearchStats *getCurrent() { return t_current; }
+
+private:
+    struct alignas(64) CThreadCounters {
+        std::atomic<std::uint64_t> count[STAGE_COUNT];
+        std::atomic<std::uint64_t> totalNs[STAGE_COUNT];
+        std::atomic<std::uint64_t> amount[STAGE_COUNT];
+        std::atomic<std::uint64_t> histogram[STAGE_COUNT][HISTOGRAM_BUCKETS];
+    };
+
+    CThreadCounters &getThreadCounters();
+
+    static thread_local CSearchStats *t_current;
+
+    // Distinguishes instances for the per-thread lookup, even if a new
+    // instance is created at the address of a deleted one.
+    std::uint64_t const m_id;
+
+    mutable std::mutex m_mutex;
+    std::vector<CThreadCounters *> m_threadCounters; // Owned
+};
+
+/**
+ * @brief Measures one operation of a stage, from construction until
+ * stop() or destruction, and records it into the statistics installed
+ * for the current thread (see CSearchStats::CScope). If a trace recorder
+ * is installed as well, the operation also becomes a span of the trace.
+ */
+class CStageTimer {
+public:
+    explicit CStageTimer(CSearchStats::Stage const stage)
+        : m_stats(CSearchStats::getCurrent()),
+          m_recorder(CTraceRecorder::getCurrent()),
+          m_stage(stage),
+          m_amount(0)
+    {
+        if(m_stats || m_recorder) {
+            m_start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~CStageTimer() { stop(); }
+
+    CStageTimer(CStageTimer const &) = delete;
+    CStageTimer &operator=(CStageTimer const &) = delete;
+
+    /**
+     * @brief Add to the amount processed by the operation.
+     */
+    void addAmount(std::uint64_t const amount) { m_amount += amount; }
+
+    /**
+     * @brief End the operation before the timer goes out of scope.
+     */
+    void stop() {
+        if(!m_stats && !m_recorder) {
+            return;
+        }
+
+        auto const end = std::chrono::steady_clock::now();
+
+        if(m_stats) {
+            m_stats->record(m_stage,
+                            static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - m_start).count()),
+                            m_amount);
+            m_stats = nullptr;
+        }
+
+        if(m_recorder) {
+            m_recorder->record(CSearchStats::getTraceName(m_stage), m_start, end, std::string(),
+                               m_amount > 0 ? static_cast<std::int64_t>(m_amount) : -1);
+            m_recorder = nullptr;
+        }
+    }
+
+private:
+    CSearchStats *m_stats;
+    CTraceRecorder *m_recorder;
+    CSearchStats::Stage const m_stage;
+    std::uint64_t m_amount;
+    std::chrono::steady_clock::time_point m_start;
+};
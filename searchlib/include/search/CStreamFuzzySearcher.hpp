@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <search/CFuzzyMatcher.hpp>
+#include <search/IStreamSearcher.hpp>
+
+/**
+ * @brief Approximate search through a stream: the match text may occur
+ * with up to a given number of inserted, deleted or substituted
+ * characters, as in OCR output or logs with typos.
+ *
+ * The stream is read in chunks and matched with CFuzzyMatcher, whose
+ * state carries over from one chunk to the next, so matches across chunk
+ * boundaries are found without reading any text twice.
+ */
+class CStreamFuzzySearcher : public IStreamSearcher {
+public:
+    /**
+     * @brief Create a fuzzy stream searcher.
+     *
+     * @param matchText the match string
+     * @param maxEdits the largest number of edits a match may need
+     * @param caseInsensitive if true, the match is case insensitive, otherwise case sensitive
+     * @param wholeMatch if true, the whole stream must match, otherwise a part of it
+     * @param maxBufferSize number of characters read from a stream at a time
+     */
+    CStreamFuzzySearcher(std::wstring const &matchText,
+                         size_t const maxEdits,
+                         bool const caseInsensitive = false,
+                         bool const wholeMatch = false,
+                         size_t const maxBufferSize = 1000000);
+
+    size_t getMaxEdits() const { return m_maxEdits; }
+
+    virtual void setMaxBufferSize(size_t const maxBufferChars);
+
+    /**
+     * @brief Perform search on an input stream. Stops reading as soon as
+     * the outcome is certain.
+     *
+     * @return true if the stream matches within the maximum number of edits
+     */
+    virtual bool searchText(std::wistream &in) const;
+
+    virtual bool searchBuffer(wchar_t const *text, size_t const size) const;
+
+    /**
+     * @brief Find the places where the match text occurs within the
+     * maximum number of edits. Each is reported once, at its closest
+     * match, and matches do not overlap.
+     */
+    virtual void findMatches(wchar_t const *text,
+                             size_t const size,
+                             size_t const maxMatches,
+                             std::vector<std::pair<size_t, size_t>> &matches) const;
+
+    /**
+     * @brief Find the smallest number of edits the match text occurs with
+     * in a stream. Reads on until an exact match is found.
+     *
+     * @return the number of edits, or CFuzzyMatcher::NO_MATCH if the
+     *         stream does not match within the maximum number of edits
+     */
+    size_t findBestDistance(std::wistream &in) const;
+    size_t findBestDistance(wchar_t const *text, size_t const size) const;
+
+private:
+    size_t scanStream(std::wistream &in, size_t const stopDistance) const;
+
+    /**
+     * @brief Find where the closest match ending at the given offset
+     * starts, but not before floor.
+     */
+    size_t findMatchStart(wchar_t const *text, size_t const end, size_t const floor) const;
+
+private:
+    CFuzzyMatcher m_matcher;
+
+    // Matches the reversed match text against the text before the end
+    // of a match, to find where the match starts
+    CFuzzyMatcher m_reverseMatcher;
+
+    size_t m_matchLength;
+    size_t m_maxEdits;
+    bool m_isWholeMatch;
+    size_t m_maxBufferSize;
+};
@@ -4,7 +4,25 @@
 #include <search/IStreamSearcher.hpp>
 
 #include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
 
+class CRegexAnalyzer;
+
+/**
+ * @brief Stream searcher which searches by regular expression.
+ *
+ * Literal strings which every match contains (see
+ * CRegexAnalyzer::getRequiredLiterals) are looked for before the regex
+ * runs: a text which lacks one of them is rejected without the regex.
+ * The regex then only runs where a match can be: from the occurrences of
+ * a literal every match starts with, or else, if every match lies within
+ * one line, on the lines containing the longest literal.
+ *
+ * Patterns written in ASCII are also compiled for bytes, so that ASCII
+ * files can be searched without decoding them (see searchBytes).
+ */
 class CStreamRegexSearcher : public IStreamSearcher {
 public:
     /**
@@ -17,6 +35,11 @@ public:
                          bool caseInsensitive = false,
                          bool wholeMatch = false);
 
+    virtual ~CStreamRegexSearcher();
+
+    CStreamRegexSearcher(CStreamRegexSearcher const &) = delete;
+    CStreamRegexSearcher &operator=(CStreamRegexSearcher const &) = delete;
+
     std::wstring getPattern() const { return m_pattern; }
     bool isCaseInsensitive() const { return m_isCaseInsensitive; }
     bool isWholeMatch() const { return m_isWholeMatch; }
@@ -27,9 +50,80 @@ public:
      */
     virtual bool searchText(std::wistream &in) const;
 
+    // Implementation of IStreamSearcher::canSearchBytes
+    virtual bool canSearchBytes() const { return m_byteProgram != nullptr; }
+
+    /**
+     * @brief Search an entire byte stream, which is loaded into memory like
+     * in searchText. Decides only if all of the bytes are ASCII, since a
+     * match in a part of the text need not be one in the whole text.
+     */
+    virtual ByteResult searchBytes(std::istream &in) const;
+
+    /**
+     * @brief Apply the regex to text that is already loaded into memory,
+     * after checking for its required literals.
+     */
+    virtual bool searchBuffer(wchar_t const *text, size_t const size) const;
+
+    /**
+     * @brief Find successive regex matches. For a whole match, the whole
+     * buffer is the only possible match.
+     */
+    virtual void findMatches(wchar_t const *text,
+                             size_t const size,
+                             size_t const maxMatches,
+                             std::vector<std::pair<size_t, size_t>> &matches) const;
+
+    /**
+     * @brief Get the literals a text must contain to match, folded to
+     * lowercase if the search is case insensitive. The first one is the
+     * longest.
+     */
+    std::vector<std::wstring> const &getRequiredLiterals() const { return m_program.requiredLiterals; }
+
+    /**
+     * @brief Get the literal every match starts with, folded like the
+     * required literals, or an empty string.
+     */
+    std::wstring const &getRequiredPrefix() const { return m_program.requiredPrefix; }
+
 private:
-    std::wregex m_regex;
+    /**
+     * @brief The compiled regex and its required literals, for one
+     * character type.
+     */
+    template<typename CharT>
+    struct CProgram {
+        std::basic_regex<CharT> regex;
+        std::vector<std::basic_string<CharT>> requiredLiterals;
+        std::basic_string<CharT> requiredPrefix;
+    };
+
+    template<typename CharT>
+    void compile(CProgram<CharT> &program,
+                 std::basic_string<CharT> const &pattern,
+                 CRegexAnalyzer const &analyzer) const;
+
+    template<typename CharT>
+    bool search(CProgram<CharT> const &program, CharT const *text, size_t const size) const;
+
+    /**
+     * @brief Run the regex from the occurrences of the required prefix,
+     * or on the lines containing the longest required literal.
+     * @param foldedText the text, or its folded version if the search is
+     *        case insensitive
+     */
+    template<typename CharT>
+    bool searchNearLiterals(CProgram<CharT> const &program,
+                            CharT const *text,
+                            std::basic_string_view<CharT> const foldedText,
+                            size_t const size) const;
+
+    CProgram<wchar_t> m_program;
+    CProgram<char> *m_byteProgram; // Owned, null if the pattern is not ASCII
     std::wstring m_pattern;
     bool m_isCaseInsensitive;
     bool m_isWholeMatch;
-};
\ No newline at end of file
+    bool m_isLineBound;
+};
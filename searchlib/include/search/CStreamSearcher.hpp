@@ -1,58 +1,74 @@
 // SPDX-License-Identifier: GPL-2.0
 #pragma once
 
+#include <search/CBasicStreamSearcher.hpp>
 #include <search/IStreamSearcher.hpp>
 
 /**
  * @brief Class representing a search through some form of stream.
  * Supports options for case sensitivity and whole or partial matches.
- * Optionally, regex mode may be specified, in which case the match string is
- * treated as a regex expression.
+ *
+ * Wraps the wide character CBasicStreamSearcher behind IStreamSearcher,
+ * together with a byte searcher for searchBytes if the match text is
+ * ASCII, so that ASCII files are searched without decoding them.
  */
 class CStreamSearcher : public IStreamSearcher {
 public:
     /**
      * @brief Create a stream searcher.
-     * 
+     *
      * @param matchText the match string
-     * @param caseInsensitive if true, the match is case insensitive, otherwise case sensitive. Ignored for regex searches.
+     * @param caseInsensitive if true, the match is case insensitive, otherwise case sensitive
      * @param wholeMatch if true, whole match, otherwise partial match
+     * @param maxBufferSize number of characters read from a stream at a time
      */
     CStreamSearcher(std::wstring const &matchText,
                     bool const caseInsensitive = false,
                     bool const wholeMatch = false,
                     size_t const maxBufferSize = 1000000);
 
-    std::wstring getMatchText() const { return m_matchText; }
-    bool isCaseInsensitive() const { return m_isCaseInsensitive; }
-    bool isWholeMatch() const { return m_isWholeMatch; }
+    virtual ~CStreamSearcher();
+
+    CStreamSearcher(CStreamSearcher const &) = delete;
+    CStreamSearcher &operator=(CStreamSearcher const &) = delete;
+
+    std::wstring getMatchText() const { return m_searcher.getMatchText(); }
+    bool isCaseInsensitive() const { return m_searcher.isCaseInsensitive(); }
+    bool isWholeMatch() const { return m_searcher.isWholeMatch(); }
+
+    virtual void setMaxBufferSize(size_t const maxBufferChars);
+    size_t getMaxBufferSize() const { return m_searcher.getMaxBufferSize(); }
 
     /**
      * @brief Perform search on an input stream.
-     * 
+     *
      * @return true if full or partial match according to options; otherwise false
      */
     virtual bool searchText(std::wistream &in) const;
 
-private:
+    // Implementation of IStreamSearcher::canSearchBytes
+    virtual bool canSearchBytes() const { return m_byteSearcher != nullptr; }
+
+    // Implementation of IStreamSearcher::searchBytes
+    virtual ByteResult searchBytes(std::istream &in) const;
+
     /**
-     * @brief Private implementation method. Performs buffered non-regex search.
+     * @brief Perform search on text that is already loaded into memory.
+     *
+     * @return true if full or partial match according to options; otherwise false
      */
-    bool bufferedSearch(wchar_t const *text, size_t const size) const;
+    virtual bool searchBuffer(wchar_t const *text, size_t const size) const;
 
     /**
-     * @brief Compare a chunk from an input stream against a chunk
-     * in the match string.
-     * @param bufferPos index of the start of the chunk within the stream
-     * @param text pointer to start of the chunk from the stream
-     * @param size size of the chunk
-     * @return true if the chunk matches, false otherwise
+     * @brief Find all non-overlapping occurrences of the match text.
+     * For a whole match, the whole buffer is the only possible match.
      */
-    bool bufferedMatch(wchar_t const *text, size_t const size, size_t const streamPos) const;
+    virtual void findMatches(wchar_t const *text,
+                             size_t const size,
+                             size_t const maxMatches,
+                             std::vector<std::pair<size_t, size_t>> &matches) const;
 
 private:
-    std::wstring m_matchText;
-    bool m_isCaseInsensitive;
-    bool m_isWholeMatch;
-    size_t m_maxBufferSize;
-};
\ No newline at end of file
+    CBasicStreamSearcher<wchar_t> m_searcher;
+    CBasicStreamSearcher<char> *m_byteSearcher; // Owned, null if the match text is not ASCII
+};
@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Aho-Corasick automaton which finds any number of terms in a
+ * text in a single pass, at a cost per character that does not depend on
+ * the number of terms.
+ *
+ * The automaton only keeps a state number between characters, so a text
+ * read in chunks is searched by carrying the state from one chunk to the
+ * next, and occurrences across chunk boundaries are found without reading
+ * any text twice.
+ *
+ * ASCII characters, which make up most text, follow a precomputed table
+ * in one step. Other characters follow the terms' sparse transitions and
+ * the failure links.
+ *
+ * Thread-safe once constructed.
+ */
+class CTermAutomaton {
+public:
+    using State = std::uint32_t;
+
+    // State before the first character
+    static constexpr State START = 0;
+
+    /**
+     * @brief Build the automaton.
+     *
+     * @param terms the terms to find. Empty terms are never found.
+     * @param caseInsensitive if true, characters are compared by their
+     *                        lowercase versions
+     */
+    CTermAutomaton(std::vector<std::wstring> const &terms, bool const caseInsensitive);
+
+    /**
+     * @brief Get the state after reading a character in another state.
+     */
+    State next(State const state, wchar_t const c) const {
+        if(static_cast<std::uint32_t>(c) < DIRECT_CHARS) {
+            return m_directTable[state * DIRECT_CHARS + static_cast<std::uint32_t>(c)];
+        }
+        return nextSlow(state, c);
+    }
+
+    /**
+     * @brief Whether any term ends in a state.
+     */
+    bool hasOutputs(State const state) const { return m_outputBegin[state] != m_outputBegin[state + 1]; }
+
+    /**
+     * @brief Get the indices of the terms which end in a state, as a
+     * range [begin, end).
+     */
+    std::uint32_t const *outputsBegin(State const state) const { return m_outputs.data() + m_outputBegin[state]; }
+    std::uint32_t const *outputsEnd(State const state) const { return m_outputs.data() + m_outputBegin[state + 1]; }
+
+    size_t getStateCount() const { return m_outputBegin.size() - 1; }
+
+private:
+    // Characters below this follow the direct table
+    static constexpr std::uint32_t DIRECT_CHARS = 128;
+
+    struct CEdge {
+        wchar_t c;
+        State target;
+    };
+
+    State nextSlow(State state, wchar_t const c) const;
+    State findEdge(State const state, wchar_t const c) const;
+
+    bool m_isCaseInsensitive;
+
+    // Transitions of the trie for characters outside the direct table,
+    // sorted by character within each state
+    std::vector<std::vector<CEdge>> m_edges;
+    std::vector<State> m_failure;
+
+    // Complete transitions for characters in the direct table,
+    // DIRECT_CHARS per state
+    std::vector<State> m_directTable;
+
+    // Terms ending in each state, including through failure links:
+    // state s has m_outputs[m_outputBegin[s]] up to
+    // m_outputs[m_outputBegin[s + 1]]
+    std::vector<std::uint32_t> m_outputs;
+    std::vector<std::uint32_t> m_outputBegin;
+};
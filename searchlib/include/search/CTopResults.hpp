@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+/**
+ * @brief How a ranked search orders its matches, and how many of them it
+ * keeps. See CSearchQuery::setRanking.
+ */
+struct CRanking {
+    enum class Key {
+        None,           // no ranking; every match is reported
+        ModifiedTime,   // last modification time
+        Size,           // file size in bytes
+        Path,           // path, compared by its generic form
+        MatchCount,     // number of content matches in the file
+        NameSimilarity, // similarity of the name to a fuzzy name filter
+    };
+
+    Key key = Key::None;
+
+    // Number of best matches to keep
+    size_t count = 0;
+
+    // Whether larger values rank first. For the path, descending means
+    // Z to A.
+    bool isDescending = true;
+
+    bool isEnabled() const { return key != Key::None && count > 0; }
+
+    /**
+     * @brief Get the natural direction of a key: newest, largest and most
+     * matches first, paths from A to Z.
+     */
+    static bool isDescendingByDefault(Key const key) { return key != Key::Path; }
+};
+
+/**
+ * @brief A match of a ranked search together with the value it is ranked
+ * by. The value is unused when ranking by path.
+ */
+struct CRankedResult {
+    std::filesystem::path path;
+
+    // Modification time in nanoseconds since the file clock's epoch, size
+    // in bytes, number of matches or name similarity in millionths,
+    // depending on the ranking key
+    std::int64_t value = 0;
+};
+
+/**
+ * @brief Keeps the best results according to a ranking, out of any
+ * number of results offered to it.
+ *
+ * The results are kept in a heap with the worst kept result on top, so
+ * offering a result costs O(log K) and memory stays O(K) for K kept
+ * results. Ties are broken by path, so the kept results do not depend on
+ * the order in which they were offered.
+ *
+ * Not thread-safe. Threads collect into their own instances, which are
+ * merged afterwards.
+ */
+class CTopResults {
+public:
+    explicit CTopResults(CRanking const &ranking);
+
+    /**
+     * @brief Offer a result. It is kept if fewer than K results are kept
+     * or if it ranks before the worst kept result.
+     */
+    void add(CRankedResult result);
+
+    /**
+     * @brief Offer all results kept by another instance with the same
+     * ranking, leaving it empty.
+     */
+    void merge(CTopResults &other);
+
+    /**
+     * @brief Whether a result with the given value and path would be
+     * kept if it was offered now. Lets callers skip building results
+     * which cannot make it.
+     */
+    bool wouldKeep(std::int64_t const value, std::filesystem::path const &path) const;
+
+    /**
+     * @brief Get the kept results, best first.
+     */
+    std::vector<CRankedResult> getSorted() const;
+
+    size_t size() const { return m_heap.size(); }
+    bool empty() const { return m_heap.empty(); }
+    void clear() { m_heap.clear(); }
+
+    CRanking const &getRanking() const { return m_ranking; }
+
+    /**
+     * @brief Whether a ranks before b.
+     */
+    bool ranksBefore(CRankedResult const &a, CRankedResult const &b) const;
+
+private:
+    bool ranksBefore(std::int64_t const valueA, std::filesystem::path const &pathA,
+                     std::int64_t const valueB, std::filesystem::path const &pathB) const;
+
+    CRanking m_ranking;
+
+    // Heap ordered so that the worst kept result is at the front
+    std::vector<CRankedResult> m_heap;
+};
@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <FileIdentity.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Persistent cache of content filter verdicts per file.
+ *
+ * Every entry records whether one content filter matched one version of
+ * one file. Files are identified by device, inode, size and modification
+ * time (see CFileIdentity), so an entry stays valid when a file is
+ * renamed or reached through a hard link, and is ignored as soon as the
+ * file is modified. Filters are identified by a 64-bit fingerprint of
+ * their key (see IFilter::getKey), so different queries which share a
+ * content filter share its verdicts.
+ *
+ * Entries are kept in fixed-size 40 byte records in open-addressing hash
+ * tables, split into shards which each have their own reader/writer
+ * lock, so lookups from all worker threads rarely contend. When a shard
+ * is full, it is cleared and starts over.
+ */
+class CVerdictCache {
+public:
+    /**
+     * @brief Create an empty cache which holds at most (roughly) the given
+     * number of verdicts.
+     */
+    explicit CVerdictCache(size_t const maxEntries = DEFAULT_MAX_ENTRIES);
+
+    CVerdictCache(CVerdictCache const &) = delete;
+    CVerdictCache &operator=(CVerdictCache const &) = delete;
+
+    /**
+     * @brief Compute the fingerprint of a filter key. Never returns 0.
+     */
+    static std::uint64_t fingerprint(std::wstring const &filterKey);
+
+    /**
+     * @brief Look up the verdict of a filter for a file.
+     *
+     * @return true if a verdict is cached, in which case isMatch receives it
+     */
+    bool find(CFileIdentity const &identity, std::uint64_t const filterFingerprint, bool &isMatch) const;
+
+    /**
+     * @brief Store the verdict of a filter for a file. Files which were
+     * modified very recently are not stored (see isRecentlyModified).
+     */
+    void store(CFileIdentity const &identity, std::uint64_t const filterFingerprint, bool const isMatch);
+
+    /**
+     * @brief Get the number of cached verdicts.
+     */
+    size_t getEntryCount() const;
+
+    /**
+     * @brief Remove all verdicts.
+     */
+    void clear();
+
+    /**
+     * @brief Write the cache to a file.
+     *
+     * @return true on success, false if the file could not be written
+     */
+    bool save(std::filesystem::path const &filePath) const;
+
+    /**
+     * @brief Add the verdicts stored in a file written by save().
+     *
+     * @return true on success, false if the file does not exist or is not
+     *         a valid cache file
+     */
+    bool load(std::filesystem::path const &filePath);
+
+    static constexpr size_t DEFAULT_MAX_ENTRIES = 1 << 20;
+
+private:
+    // One verdict. A fingerprint of 0 marks an empty slot; the verdict is
+    // kept in the lowest bit of the stored fingerprint.
+    struct CRecord {
+        std::uint64_t device;
+        std::uint64_t inode;
+        std::uint64_t size;
+        std::int64_t modifiedTimeNs;
+        std::uint64_t fingerprintAndVerdict;
+    };
+
+    struct CShard {
+        mutable std::shared_mutex mutex;
+        std::vector<CRecord> slots;
+        size_t count = 0;
+    };
+
+    static std::uint64_t hash(CFileIdentity const &identity, std::uint64_t const filterFingerprint);
+    static bool matches(CRecord const &record, CFileIdentity const &identity, std::uint64_t const filterFingerprint);
+
+    CShard &shardFor(std::uint64_t const hashValue) const;
+    void insert(CShard &shard, CRecord const &record, std::uint64_t const hashValue);
+
+    size_t const m_maxEntriesPerShard;
+
+    // The shards themselves are never resized, only their slot vectors.
+    mutable std::vector<CShard> m_shards;
+};
@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+/**
+ * @brief Set of files and directories, identified by device and inode,
+ * which a search has already visited, shared by all threads of the
+ * search.
+ *
+ * Each entry carries a state, so that a file reached through several
+ * paths (hard links, overlapping roots or followed symbolic links) has
+ * its contents read only once: the first visitor evaluates the file and
+ * records the verdict, later visitors reuse it.
+ *
+ * The set is split into shards with a mutex each, so threads visiting
+ * different files rarely wait for each other.
+ */
+class CVisitedInodes {
+public:
+    enum class State {
+        New,        // not visited before
+        Pending,    // visited, but no verdict recorded yet
+        Match,
+        NoMatch,
+    };
+
+    explicit CVisitedInodes();
+
+    CVisitedInodes(CVisitedInodes const &) = delete;
+    CVisitedInodes &operator=(CVisitedInodes const &) = delete;
+
+    /**
+     * @brief Mark a file as visited.
+     *
+     * @return the state before the call: New for the first visitor, which
+     *         should then record a verdict with setVerdict
+     */
+    State visit(std::uint64_t const device, std::uint64_t const inode);
+
+    /**
+     * @brief Record whether a visited file matched.
+     */
+    void setVerdict(std::uint64_t const device, std::uint64_t const inode, bool const isMatch);
+
+    /**
+     * @brief Get the number of visited files.
+     */
+    size_t size() const;
+
+    void clear();
+
+private:
+    static constexpr size_t SHARD_COUNT = 64;
+
+    struct CKey {
+        std::uint64_t device;
+        std::uint64_t inode;
+
+        bool operator==(CKey const &other) const {
+            return device == other.device && inode == other.inode;
+        }
+    };
+
+    struct CKeyHash {
+        size_t operator()(CKey const &key) const;
+    };
+
+    struct alignas(64) CShard {
+        mutable std::mutex mutex;
+        std::unordered_map<CKey, State, CKeyHash> states;
+    };
+
+    CShard &getShard(CKey const &key);
+
+    CShard m_shards[SHARD_COUNT];
+};
@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+/**
+ * @brief Interface through which CDirectoryWalker can skip reading
+ * directories that have not changed since an earlier walk.
+ *
+ * IMPORTANT: Several walkers may use the same cache at the same time,
+ * from different threads.
+ */
+class IDirectoryCache {
+public:
+    /**
+     * @brief The entries of one directory, as seen by the walker. Only
+     * names are stored, relative to the directory.
+     */
+    struct CListing {
+        // Opaque value identifying the state of the directory, for example
+        // its modification time. Set by findListing.
+        std::int64_t stamp = 0;
+
+        // Whether the stamp is good enough to store the listing under.
+        bool isStampValid = false;
+
+        std::vector<std::filesystem::path> files;
+        std::vector<std::filesystem::path> subdirectories;
+    };
+
+    virtual ~IDirectoryCache() = default;
+
+    /**
+     * @brief Look up the listing of a directory.
+     *
+     * @param listing receives the cached listing if the directory is
+     *        unchanged. Its stamp is set in either case, and must be
+     *        passed back to storeListing after reading the directory.
+     * @return true if the cached listing is still valid
+     */
+    virtual bool findListing(std::filesystem::path const &directory, CListing &listing) = 0;
+
+    /**
+     * @brief Store the listing of a directory after it has been read
+     * completely. Not called if reading the directory failed halfway.
+     */
+    virtual void storeListing(std::filesystem::path const &directory, CListing const &listing) = 0;
+};
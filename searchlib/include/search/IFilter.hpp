@@ -6,6 +6,12 @@
 
 class IFilter {
 public:
+    /**
+     * @brief Rough cost class of evaluating a filter, from cheapest to
+     * most expensive. The search planner evaluates cheaper filters first.
+     */
+    enum class Cost { Name, Metadata, Content };
+
     virtual ~IFilter() = default;
 
     /**
@@ -17,4 +23,36 @@ public:
      * @brief Represent the filter and its options as a text string.
      */
     virtual std::wstring getText() const = 0;
-};
\ No newline at end of file
+
+    /**
+     * @brief Get the cost class of the filter. Filters which do not
+     * override this are assumed to read file contents.
+     */
+    virtual Cost getCost() const { return Cost::Content; }
+
+    /**
+     * @brief Get a canonical key which identifies the filter and all of
+     * its options, for example to recognize a query that was run before.
+     * Unlike getText, the key is not meant for display, and two filters
+     * with equal keys must match exactly the same files. An empty key
+     * means that the filter cannot be identified this way.
+     */
+    virtual std::wstring getKey() const { return std::wstring(); }
+
+    /**
+     * @brief Set how many characters the filter may buffer at a time when
+     * it reads a file. Filters which do not read files ignore this.
+     */
+    virtual void setMaxBufferSize(size_t const maxBufferChars) { (void)maxBufferChars; }
+
+protected:
+    /**
+     * @brief Build a key from a filter type, its option flags and its
+     * match text. The text is length-prefixed so that keys stay
+     * unambiguous no matter which characters the text contains.
+     */
+    static std::wstring makeKey(std::wstring const &type, std::wstring const &flags,
+                                std::wstring const &matchText) {
+        return type + L":" + flags + L":" + std::to_wstring(matchText.size()) + L":" + matchText;
+    }
+};
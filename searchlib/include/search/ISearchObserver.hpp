@@ -1,7 +1,11 @@
 // SPDX-License-Identifier: GPL-2.0
 #pragma once
 
+#include <search/CMatchLocation.hpp>
+#include <search/CTopResults.hpp>
+
 #include <filesystem>
+#include <vector>
 
 class ISearchObserver {
 public:
@@ -12,4 +16,35 @@ public:
      * criteria.
      */
     virtual void onFileMatched(std::filesystem::path const &matchedFile) = 0;
+
+    /**
+     * @brief Whether the observer wants to receive match locations
+     * through onMatchLocations. Collecting locations costs extra work,
+     * so it is only done if at least one observer asks for it.
+     */
+    virtual bool wantsMatchLocations() const { return false; }
+
+    /**
+     * @brief Observer function called after onFileMatched with the
+     * locations of the content matches in the file, in ascending order
+     * of offset. Not called if there are no locations to report, for
+     * example if the query has no content filters.
+     */
+    virtual void onMatchLocations(std::filesystem::path const &matchedFile,
+                                  std::vector<CMatchLocation> const &locations) {
+        (void)matchedFile;
+        (void)locations;
+    }
+
+    /**
+     * @brief Observer function called with the best matches so far of a
+     * ranked search (see CSearchQuery::setRanking), best first. Ranked
+     * searches call this instead of onFileMatched: with interim snapshots
+     * while the search runs, and once more with isFinal set when it has
+     * completed. Calls are never concurrent.
+     */
+    virtual void onRankedResults(std::vector<CRankedResult> const &results, bool const isFinal) {
+        (void)results;
+        (void)isFinal;
+    }
 };
\ No newline at end of file
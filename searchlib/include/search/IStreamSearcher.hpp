@@ -2,8 +2,79 @@
 #pragma once
 
 #include <istream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
 
 class IStreamSearcher {
 public:
+    // Outcome of searchBytes
+    enum class ByteResult {
+        Match,
+        NoMatch,
+        NeedsDecoding,  // the bytes are not all ASCII; search the text with searchText
+    };
+
+    virtual ~IStreamSearcher() = default;
+
     virtual bool searchText(std::wistream &in) const = 0;
-};
\ No newline at end of file
+
+    /**
+     * @brief Whether the searcher can search raw bytes with searchBytes.
+     */
+    virtual bool canSearchBytes() const { return false; }
+
+    /**
+     * @brief Search the raw bytes of a text without decoding them into
+     * characters, which is exact as long as the bytes are ASCII: every
+     * encoding the text may be decoded with maps them to the same
+     * characters.
+     *
+     * @return NeedsDecoding if the searcher cannot tell the result from
+     *         the bytes before the first one outside ASCII. The stream
+     *         has then been read partly, and searchText must be given a
+     *         fresh stream over the decoded text.
+     */
+    virtual ByteResult searchBytes(std::istream &in) const {
+        (void)in;
+        return ByteResult::NeedsDecoding;
+    }
+
+    /**
+     * @brief Set how many characters searchText may buffer at a time.
+     * Searchers which need the whole stream at once ignore this.
+     */
+    virtual void setMaxBufferSize(size_t const maxBufferChars) { (void)maxBufferChars; }
+
+    /**
+     * @brief Search text which is already loaded into memory.
+     *
+     * The default implementation wraps the text in a stream and calls
+     * searchText. Implementations should override it when they can search
+     * the buffer directly.
+     */
+    virtual bool searchBuffer(wchar_t const *text, size_t const size) const {
+        std::wstringstream wss(std::wstring(text, size));
+        return searchText(wss);
+    }
+
+    /**
+     * @brief Find the individual matches in text that is already loaded
+     * into memory.
+     *
+     * The default implementation reports no matches.
+     *
+     * @param maxMatches stop after this many matches have been found
+     * @param matches receives one (offset, length) pair per match
+     */
+    virtual void findMatches(wchar_t const *text,
+                             size_t const size,
+                             size_t const maxMatches,
+                             std::vector<std::pair<size_t, size_t>> &matches) const {
+        (void)text;
+        (void)size;
+        (void)maxMatches;
+        (void)matches;
+    }
+};
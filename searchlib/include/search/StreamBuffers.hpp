@@ -0,0 +1,161 @@
+// SPDX-License-Identifier: GPL-2.0
+#pragma once
+
+#include <cstdint>
+#include <cwchar>
+#include <locale>
+#include <streambuf>
+#include <vector>
+
+class IDecoder;
+
+// Stream buffers which CContentStream stacks on top of each other to read
+// compressed files and archive members. Each one reads from a source
+// stream buffer, which it does NOT own, in fixed-size chunks, so memory
+// stays bounded however much data passes through.
+
+/**
+ * @brief Byte stream buffer which decompresses its source.
+ *
+ * If the source does not start with the format's magic number, the
+ * buffer passes the source through unchanged, so a misnamed file is read
+ * as it is.
+ */
+class CDecompressingBuffer : public std::streambuf {
+public:
+    enum class Format {
+        None,       // passed through unchanged
+        Gzip,
+        Zstd,
+        Xz,
+        Deflate,    // raw deflate data, as in zip members; has no magic
+    };
+
+    /**
+     * @brief Create the buffer. Reads the first chunk of the source to
+     * check its magic number.
+     */
+    explicit CDecompressingBuffer(std::streambuf *source, Format const format);
+    ~CDecompressingBuffer();
+
+    CDecompressingBuffer(CDecompressingBuffer const &) = delete;
+    CDecompressingBuffer &operator=(CDecompressingBuffer const &) = delete;
+
+    /**
+     * @brief Get the format the buffer decompresses, None if it passes
+     * the source through.
+     */
+    Format getFormat() const { return m_format; }
+
+    /**
+     * @brief Whether this build can decompress a format.
+     */
+    static bool isSupported(Format const format);
+
+protected:
+    int_type underflow() override;
+
+private:
+    bool fillInput();
+
+    std::streambuf *m_source;
+    IDecoder *m_decoder; // Owned, null when passing through
+    Format m_format;
+
+    std::vector<char> m_input;
+    size_t m_inputPos;
+    size_t m_inputSize;
+    bool m_isInputEnd;
+    bool m_isDataEnd;
+
+    std::vector<char> m_output;
+};
+
+/**
+ * @brief Byte stream buffer which reads a given number of bytes from the
+ * current position of its source, for example one archive member.
+ */
+class CWindowBuffer : public std::streambuf {
+public:
+    /**
+     * @param consumed if not null, increased by every byte taken from the
+     *        source
+     */
+    explicit CWindowBuffer(std::streambuf *source, std::uint64_t const length, std::uint64_t *consumed = nullptr);
+
+    CWindowBuffer(CWindowBuffer const &) = delete;
+    CWindowBuffer &operator=(CWindowBuffer const &) = delete;
+
+protected:
+    int_type underflow() override;
+
+private:
+    std::streambuf *m_source;
+    std::uint64_t m_remaining;
+    std::uint64_t *m_consumed;
+    std::vector<char> m_buffer;
+};
+
+/**
+ * @brief Byte stream buffer which passes its source through up to the
+ * first byte outside ASCII, where it ends, so that the bytes read are
+ * text in every ASCII-based encoding.
+ */
+class CAsciiBuffer : public std::streambuf {
+public:
+    explicit CAsciiBuffer(std::streambuf *source);
+
+    CAsciiBuffer(CAsciiBuffer const &) = delete;
+    CAsciiBuffer &operator=(CAsciiBuffer const &) = delete;
+
+    /**
+     * @brief Whether a byte outside ASCII ended the stream before the end
+     * of the source.
+     */
+    bool isTruncated() const { return m_isTruncated; }
+
+protected:
+    int_type underflow() override;
+
+private:
+    std::streambuf *m_source;
+    std::vector<char> m_buffer;
+    bool m_isTruncated;
+};
+
+/**
+ * @brief Wide stream buffer which decodes the bytes of its source into
+ * characters like std::wfilebuf does, with the global locale's
+ * conversion. Text ends at the first byte sequence that cannot be
+ * decoded.
+ *
+ * Seeking is limited to moving back within the recently read characters,
+ * which is what the stream searchers need to overlap their windows.
+ */
+class CWideningBuffer : public std::wstreambuf {
+public:
+    explicit CWideningBuffer(std::streambuf *source);
+
+    CWideningBuffer(CWideningBuffer const &) = delete;
+    CWideningBuffer &operator=(CWideningBuffer const &) = delete;
+
+protected:
+    int_type underflow() override;
+    pos_type seekoff(off_type const off, std::ios_base::seekdir const dir,
+                     std::ios_base::openmode const which) override;
+
+private:
+    std::streambuf *m_source;
+    std::codecvt<wchar_t, char, std::mbstate_t> const *m_codecvt;
+    std::mbstate_t m_state;
+
+    // Bytes read from the source but not yet decoded
+    std::vector<char> m_bytes;
+    size_t m_byteCount;
+    bool m_isSourceEnd;
+
+    std::vector<wchar_t> m_chars;
+
+    // Stream position of the first character in m_chars
+    std::uint64_t m_basePosition;
+};
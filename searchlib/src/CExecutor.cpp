@@ -0,0 +1,448 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <CExecutor.hpp>
+
+#include <SystemResources.hpp>
+
+#include <algorithm>
+#include <chrono>
+
+/**
+ * @brief Raise an atomic value to at least the given one.
+ */
+static void raiseTo(std::atomic<std::uint64_t> &value, std::uint64_t const minimum) {
+    std::uint64_t current = value.load(std::memory_order_relaxed);
+    while(current < minimum && !value.compare_exchange_weak(current, minimum, std::memory_order_relaxed)) {
+    }
+}
+
+CExecutor::CSlot::CSlot()
+    : queue(nullptr),
+      priority(0),
+      weight(1),
+      maxRunning(SIZE_MAX),
+      sequence(0),
+      waiting(0),
+      running(0),
+      virtualTime(0),
+      traceRecorder(nullptr),
+      isUsed(false)
+{
+}
+
+CExecutor::CQueue::CQueue(CExecutor &executor,
+                          Priority const priority,
+                          unsigned const weight,
+                          size_t const maxRunning,
+                          size_t const queueCapacity)
+    : m_executor(executor),
+      m_priority(priority),
+      m_weight(std::max(weight, 1u)),
+      m_slot(nullptr),
+      m_tasks(queueCapacity),
+      m_highPriorityTasks(queueCapacity),
+      m_isClosed(false)
+{
+    std::unique_lock<std::mutex> lock(m_executor.m_mutex);
+
+    CSlot *const slotsEnd = m_executor.m_slots + MAX_QUEUES;
+    CSlot *slot = slotsEnd;
+
+    m_executor.m_slotCondition.wait(lock, [&] {
+        slot = std::find_if(m_executor.m_slots, slotsEnd, [](CSlot const &candidate) {
+            return !candidate.isUsed;
+        });
+        return slot != slotsEnd;
+    });
+
+    slot->isUsed = true;
+    slot->priority.store(static_cast<int>(priority), std::memory_order_relaxed);
+    slot->weight.store(m_weight, std::memory_order_relaxed);
+    slot->maxRunning.store(std::max<size_t>(maxRunning, 1), std::memory_order_relaxed);
+    slot->sequence.store(m_executor.m_queueSequence++, std::memory_order_relaxed);
+    slot->virtualTime.store(m_executor.getActiveVirtualTime(), std::memory_order_relaxed);
+    m_slot = slot;
+    m_executor.m_queueCount.fetch_add(1, std::memory_order_relaxed);
+
+    // Workers read the slot's settings after seeing the queue in it.
+    slot->queue.store(this, std::memory_order_release);
+
+    size_t const usedSlots = static_cast<size_t>(slot - m_executor.m_slots) + 1;
+    if(m_executor.m_slotCount.load(std::memory_order_relaxed) < usedSlots) {
+        m_executor.m_slotCount.store(usedSlots, std::memory_order_release);
+    }
+}
+
+CExecutor::CQueue::~CQueue() {
+    // Posts from now on discard their task. Running tasks which post
+    // before seeing this are done pushing by the time they stop running,
+    // so their tasks are discarded below.
+    m_isClosed.store(true);
+
+    // Workers take no further tasks of the queue; wait for those running.
+    m_slot->queue.store(nullptr);
+
+    {
+        std::unique_lock<std::mutex> lock(m_executor.m_mutex);
+
+        m_executor.m_idleCondition.wait(lock, [this] {
+            return m_slot->running.load() == 0;
+        });
+    }
+
+    // Groups learn about discarded tasks as if they had run, outside the
+    // lock, since a group's completion handler may post further tasks.
+    CEntry entry;
+    while(tryPop(entry)) {
+        entry.task.reset();
+        if(entry.group) {
+            entry.group->end();
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(m_executor.m_mutex);
+
+    if(m_slot->traceRecorder.exchange(nullptr, std::memory_order_relaxed)) {
+        m_executor.m_tracedQueues.fetch_sub(1, std::memory_order_relaxed);
+    }
+    m_slot->isUsed = false;
+    m_executor.m_queueCount.fetch_sub(1, std::memory_order_relaxed);
+    m_executor.m_slotCondition.notify_one();
+}
+
+void CExecutor::CQueue::setTraceRecorder(CTraceRecorder *traceRecorder) {
+    std::unique_lock<std::mutex> lock(m_executor.m_mutex);
+
+    CTraceRecorder *const previous = m_slot->traceRecorder.exchange(traceRecorder, std::memory_order_relaxed);
+    m_executor.m_tracedQueues.fetch_add((traceRecorder ? 1 : 0) - (previous ? 1 : 0), std::memory_order_relaxed);
+}
+
+void CExecutor::CQueue::push(CTask task, CTaskGroup *group, TaskPriority const taskPriority) {
+    CExecutor &executor = m_executor;
+    CSlot &slot = *m_slot;
+
+    CEntry entry{ std::move(task), group };
+    CBoundedQueue<CEntry> &tasks = taskPriority == TaskPriority::High ? m_highPriorityTasks : m_tasks;
+
+    bool isPushed = false;
+    bool isRunInline = false;
+    CTraceRecorder *traceRecorder = nullptr;
+    CTraceRecorder::Clock::time_point waitStart;
+
+    // A queue which was idle starts at the current virtual time rather
+    // than with credit for the time it did not use.
+    if(slot.waiting.load(std::memory_order_relaxed) <= 0 && slot.running.load(std::memory_order_relaxed) == 0) {
+        raiseTo(slot.virtualTime, executor.getActiveVirtualTime());
+    }
+
+    while(!m_isClosed.load(std::memory_order_relaxed)) {
+        if(tasks.tryPush(entry)) {
+            isPushed = true;
+            break;
+        }
+
+        if(t_currentExecutor == &executor) {
+            // Counting as running keeps the queue from being destroyed
+            // under the task.
+            isRunInline = executor.enterSlot(slot, false) != nullptr;
+            break;
+        }
+
+        if(!traceRecorder) {
+            traceRecorder = slot.traceRecorder.load(std::memory_order_relaxed);
+            waitStart = CTraceRecorder::Clock::now();
+        }
+
+        std::this_thread::sleep_for(std::chrono::microseconds(FULL_QUEUE_WAIT_MICROSECONDS));
+    }
+
+    if(isPushed) {
+        slot.waiting.fetch_add(1, std::memory_order_relaxed);
+        executor.m_waitingTasks[static_cast<int>(m_priority)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if(traceRecorder) {
+        traceRecorder->record("Wait for queue", waitStart, CTraceRecorder::Clock::now());
+    }
+
+    if(isPushed) {
+        executor.wakeWorker();
+    } else if(isRunInline) {
+        executor.runTask(slot, entry);
+    } else {
+        // The queue is being destroyed; its tasks are discarded.
+        entry.task.reset();
+        if(entry.group) {
+            entry.group->end();
+        }
+    }
+}
+
+bool CExecutor::CQueue::tryPop(CEntry &entry) {
+    if(!m_highPriorityTasks.tryPop(entry) && !m_tasks.tryPop(entry)) {
+        return false;
+    }
+
+    m_slot->waiting.fetch_sub(1, std::memory_order_relaxed);
+    m_executor.m_waitingTasks[static_cast<int>(m_priority)].fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+CExecutor::CExecutor(size_t const numWorkers)
+    : m_slotCount(0),
+      m_queueSequence(0),
+      m_queueCount(0),
+      m_tracedQueues(0),
+      m_sleepingWorkers(0),
+      m_shouldTerminate(false)
+{
+    for(std::atomic_long &waitingTasks : m_waitingTasks) {
+        waitingTasks.store(0, std::memory_order_relaxed);
+    }
+
+    reserveWorkers(numWorkers);
+}
+
+CExecutor::~CExecutor() {
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_shouldTerminate = true;
+    }
+
+    m_wakeCondition.notify_all();
+
+    for(std::thread &worker : m_workers) {
+        worker.join();
+    }
+}
+
+CExecutor &CExecutor::getShared() {
+    static CExecutor executor(getSystemResources().cpuCount);
+    return executor;
+}
+
+void CExecutor::reserveWorkers(size_t const numWorkers) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while(m_workers.size() < numWorkers) {
+        m_workers.emplace_back(&CExecutor::workerThreadFunc, this);
+    }
+}
+
+size_t CExecutor::getWorkerCount() const {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_workers.size();
+}
+
+CExecutor::CQueue *CExecutor::enterSlot(CSlot &slot, bool const isLimited) {
+    // Pairs with the destructor of the queue: either we see the queue
+    // detached, or it sees us running and waits.
+    size_t const running = slot.running.fetch_add(1);
+    CQueue *const queue = slot.queue.load();
+
+    if(!queue || (isLimited && running >= slot.maxRunning.load(std::memory_order_relaxed))) {
+        leaveSlot(slot);
+        return nullptr;
+    }
+
+    return queue;
+}
+
+void CExecutor::leaveSlot(CSlot &slot) {
+    slot.running.fetch_sub(1);
+
+    // A queue being destroyed waits for the threads running in its slot.
+    if(!slot.queue.load()) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idleCondition.notify_all();
+    }
+}
+
+CExecutor::CSlot *CExecutor::findNextSlot(int const minPriority) {
+    CSlot *next = nullptr;
+    int nextPriority = 0;
+    std::uint64_t nextVirtualTime = 0;
+    std::uint64_t nextSequence = 0;
+
+    size_t const slotCount = m_slotCount.load(std::memory_order_acquire);
+
+    for(size_t i = 0; i < slotCount; ++i) {
+        CSlot &slot = m_slots[i];
+
+        if(!slot.queue.load(std::memory_order_acquire) || slot.waiting.load(std::memory_order_relaxed) <= 0) {
+            continue;
+        }
+
+        int const priority = slot.priority.load(std::memory_order_relaxed);
+        if(priority <= minPriority ||
+           slot.running.load(std::memory_order_relaxed) >= slot.maxRunning.load(std::memory_order_relaxed)) {
+            continue;
+        }
+
+        std::uint64_t const virtualTime = slot.virtualTime.load(std::memory_order_relaxed);
+        std::uint64_t const sequence = slot.sequence.load(std::memory_order_relaxed);
+
+        // Ties go to the queue created first.
+        if(!next || priority > nextPriority ||
+           (priority == nextPriority &&
+            (virtualTime < nextVirtualTime || (virtualTime == nextVirtualTime && sequence < nextSequence)))) {
+            next = &slot;
+            nextPriority = priority;
+            nextVirtualTime = virtualTime;
+            nextSequence = sequence;
+        }
+    }
+
+    return next;
+}
+
+std::uint64_t CExecutor::getActiveVirtualTime() const {
+    std::uint64_t virtualTime = UINT64_MAX;
+    size_t const slotCount = m_slotCount.load(std::memory_order_acquire);
+
+    for(size_t i = 0; i < slotCount; ++i) {
+        CSlot const &slot = m_slots[i];
+
+        if(slot.queue.load(std::memory_order_acquire) &&
+           (slot.waiting.load(std::memory_order_relaxed) > 0 || slot.running.load(std::memory_order_relaxed) > 0)) {
+            virtualTime = std::min(virtualTime, slot.virtualTime.load(std::memory_order_relaxed));
+        }
+    }
+
+    return virtualTime == UINT64_MAX ? 0 : virtualTime;
+}
+
+CExecutor::CSlot *CExecutor::takeTask(int const minPriority, CQueue::CEntry &entry) {
+    while(CSlot *const slot = findNextSlot(minPriority)) {
+        CQueue *const queue = enterSlot(*slot, true);
+        if(!queue) {
+            continue;
+        }
+
+        if(queue->tryPop(entry)) {
+            return slot;
+        }
+
+        // Another thread took the task first, and has yet to count it.
+        leaveSlot(*slot);
+        std::this_thread::yield();
+    }
+
+    return nullptr;
+}
+
+void CExecutor::runTask(CSlot &slot, CQueue::CEntry &entry) {
+    bool const isTimed = m_queueCount.load(std::memory_order_relaxed) > 1;
+    std::chrono::steady_clock::time_point const start =
+        isTimed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+
+    // Nobody is waiting for the result of a posted task, so there is
+    // nowhere to report its exceptions to. Don't let them end the worker.
+    try {
+        entry.task();
+    } catch(...) {
+    }
+
+    entry.task.reset();
+
+    // The group ends while the task still counts as running, so that
+    // the queue cannot be destroyed under a completion handler.
+    if(entry.group) {
+        entry.group->end();
+        entry.group = nullptr;
+    }
+
+    if(isTimed) {
+        std::uint64_t const nanoseconds = static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+
+        slot.virtualTime.fetch_add(nanoseconds / slot.weight.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    // A queue at its limit of running tasks may have a task for another
+    // worker once this one is done.
+    bool const isLimited = slot.running.load(std::memory_order_relaxed) >= slot.maxRunning.load(std::memory_order_relaxed) &&
+                           slot.waiting.load(std::memory_order_relaxed) > 0;
+
+    leaveSlot(slot);
+
+    if(isLimited) {
+        wakeWorker();
+    }
+}
+
+void CExecutor::runPreempting(Priority const priority) {
+    CQueue::CEntry entry;
+
+    while(CSlot *const slot = takeTask(static_cast<int>(priority), entry)) {
+        runTask(*slot, entry);
+    }
+}
+
+void CExecutor::wakeWorker() {
+    // Pairs with the fence in workerThreadFunc: either the worker sees
+    // the new task before going to sleep, or we see it sleeping.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if(m_sleepingWorkers.load(std::memory_order_relaxed) > 0) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wakeCondition.notify_one();
+    }
+}
+
+void CExecutor::recordIdle(CTraceRecorder::Clock::time_point const start) {
+    CTraceRecorder::Clock::time_point const end = CTraceRecorder::Clock::now();
+    size_t const slotCount = m_slotCount.load(std::memory_order_acquire);
+
+    for(size_t i = 0; i < slotCount; ++i) {
+        CSlot &slot = m_slots[i];
+
+        // Counting as running keeps the queue, and so its recorder, alive.
+        if(!slot.traceRecorder.load(std::memory_order_relaxed) || !enterSlot(slot, false)) {
+            continue;
+        }
+
+        if(CTraceRecorder *const traceRecorder = slot.traceRecorder.load(std::memory_order_relaxed)) {
+            traceRecorder->record("Idle", start, end);
+        }
+
+        leaveSlot(slot);
+    }
+}
+
+void CExecutor::workerThreadFunc() {
+    t_currentExecutor = this;
+
+    CQueue::CEntry entry;
+
+    while(true) {
+        if(CSlot *const slot = takeTask(-1, entry)) {
+            runTask(*slot, entry);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        m_sleepingWorkers.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        bool const isTraced = m_tracedQueues.load(std::memory_order_relaxed) > 0;
+        CTraceRecorder::Clock::time_point const idleStart =
+            isTraced ? CTraceRecorder::Clock::now() : CTraceRecorder::Clock::time_point();
+
+        m_wakeCondition.wait(lock, [this] {
+            return m_shouldTerminate || findNextSlot(-1);
+        });
+
+        m_sleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
+
+        if(m_shouldTerminate) {
+            return;
+        }
+
+        lock.unlock();
+
+        if(isTraced) {
+            recordIdle(idleStart);
+        }
+    }
+}
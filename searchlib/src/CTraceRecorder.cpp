@@ -0,0 +1,198 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <CTraceRecorder.hpp>
+
+#include <StringUtil.hpp>
+
+#include <algorithm>
+#include <fstream>
+
+// Number of per-thread lookup entries each thread remembers.
+#define THREAD_CACHE_ENTRIES 4
+
+// The trace format's process id. All threads belong to one process.
+#define TRACE_PROCESS_ID 1
+
+thread_local CTraceRecorder *CTraceRecorder::t_current = nullptr;
+
+namespace {
+    struct CThreadCacheEntry {
+        std::uint64_t id = 0;
+        void *buffer = nullptr;
+    };
+
+    thread_local CThreadCacheEntry t_threadCache[THREAD_CACHE_ENTRIES];
+    thread_local size_t t_nextCacheEntry = 0;
+
+    std::atomic<std::uint64_t> s_nextId(1);
+}
+
+/**
+ * @brief Append a time in nanoseconds as the microseconds the trace
+ * format expects, keeping the fraction.
+ */
+static void appendMicroseconds(std::uint64_t const ns, std::string &output) {
+    std::string fraction = std::to_string(ns % 1000);
+    fraction.insert(0, 3 - fraction.size(), '0');
+
+    output += std::to_string(ns / 1000);
+    output += '.';
+    output += fraction;
+}
+
+CTraceRecorder::CScope::CScope(CTraceRecorder *recorder)
+    : m_previous(t_current)
+{
+    t_current = recorder;
+}
+
+CTraceRecorder::CScope::~CScope() {
+    t_current = m_previous;
+}
+
+CTraceRecorder::CTraceRecorder(size_t const eventsPerThread)
+    : m_id(s_nextId++),
+      m_eventsPerThread(std::max<size_t>(eventsPerThread, 1)),
+      m_origin(Clock::now())
+{
+    // nothing to do
+}
+
+CTraceRecorder::~CTraceRecorder() {
+    for(CThreadBuffer *buffer : m_threadBuffers) {
+        delete buffer;
+    }
+}
+
+CTraceRecorder::CThreadBuffer &CTraceRecorder::getThreadBuffer() {
+    for(CThreadCacheEntry const &entry : t_threadCache) {
+        if(entry.id == m_id) {
+            return *static_cast<CThreadBuffer *>(entry.buffer);
+        }
+    }
+
+    CThreadBuffer *buffer = new CThreadBuffer();
+    buffer->events.resize(m_eventsPerThread);
+
+    {
+        std::lock_guard<std::mutex> const lock(m_mutex);
+        buffer->threadId = static_cast<int>(m_threadBuffers.size()) + 1;
+        m_threadBuffers.push_back(buffer);
+    }
+
+    CThreadCacheEntry &entry = t_threadCache[t_nextCacheEntry];
+    t_nextCacheEntry = (t_nextCacheEntry + 1) % THREAD_CACHE_ENTRIES;
+    entry.id = m_id;
+    entry.buffer = buffer;
+
+    return *buffer;
+}
+
+std::uint64_t CTraceRecorder::getOffsetNs(Clock::time_point const time) const {
+    if(time <= m_origin) {
+        return 0;
+    }
+
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time - m_origin).count());
+}
+
+void CTraceRecorder::record(char const *name, Clock::time_point const start, Clock::time_point const end,
+                            std::string const &detail, std::int64_t const value) {
+    CThreadBuffer &buffer = getThreadBuffer();
+    std::uint64_t const startNs = getOffsetNs(start);
+    std::uint64_t const endNs = getOffsetNs(end);
+
+    std::lock_guard<std::mutex> const lock(buffer.mutex);
+
+    // Overwrites the oldest event once the ring is full. Assigning the
+    // detail reuses the string's storage from the previous lap.
+    CEvent &event = buffer.events[buffer.nextEvent];
+    event.name = name;
+    event.startNs = startNs;
+    event.durationNs = endNs > startNs ? endNs - startNs : 0;
+    event.value = value;
+    event.detail = detail;
+
+    if(++buffer.nextEvent == buffer.events.size()) {
+        buffer.nextEvent = 0;
+        buffer.isWrapped = true;
+    }
+}
+
+size_t CTraceRecorder::getEventCount() const {
+    std::lock_guard<std::mutex> const lock(m_mutex);
+    size_t count = 0;
+
+    for(CThreadBuffer *buffer : m_threadBuffers) {
+        std::lock_guard<std::mutex> const bufferLock(buffer->mutex);
+        count += buffer->isWrapped ? buffer->events.size() : buffer->nextEvent;
+    }
+
+    return count;
+}
+
+void CTraceRecorder::writeJson(std::string &output) const {
+    std::lock_guard<std::mutex> const lock(m_mutex);
+    bool isFirst = true;
+
+    auto const beginEvent = [&output, &isFirst]() {
+        output += isFirst ? "\n" : ",\n";
+        isFirst = false;
+    };
+
+    output += "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+    for(CThreadBuffer *buffer : m_threadBuffers) {
+        std::lock_guard<std::mutex> const bufferLock(buffer->mutex);
+        std::string const threadId = std::to_string(buffer->threadId);
+
+        // Name the thread's track in the viewer.
+        beginEvent();
+        output += "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" + std::to_string(TRACE_PROCESS_ID);
+        output += ",\"tid\":" + threadId + ",\"args\":{\"name\":\"Thread " + threadId + "\"}}";
+
+        // Oldest event first.
+        size_t const count = buffer->isWrapped ? buffer->events.size() : buffer->nextEvent;
+        size_t const first = buffer->isWrapped ? buffer->nextEvent : 0;
+
+        for(size_t i = 0; i < count; ++i) {
+            CEvent const &event = buffer->events[(first + i) % buffer->events.size()];
+
+            beginEvent();
+            output += "{\"ph\":\"X\",\"name\":";
+            appendJsonString(event.name, output);
+            output += ",\"pid\":" + std::to_string(TRACE_PROCESS_ID) + ",\"tid\":" + threadId;
+            output += ",\"ts\":";
+            appendMicroseconds(event.startNs, output);
+            output += ",\"dur\":";
+            appendMicroseconds(event.durationNs, output);
+
+            if(!event.detail.empty() || event.value >= 0) {
+                output += ",\"args\":{";
+                if(!event.detail.empty()) {
+                    output += "\"detail\":";
+                    appendJsonString(event.detail, output);
+                }
+                if(event.value >= 0) {
+                    output += event.detail.empty() ? "\"value\":" : ",\"value\":";
+                    output += std::to_string(event.value);
+                }
+                output += "}";
+            }
+
+            output += "}";
+        }
+    }
+
+    output += "\n]}\n";
+}
+
+bool CTraceRecorder::writeJson(std::filesystem::path const &outputPath) const {
+    std::string output;
+    writeJson(output);
+
+    std::ofstream out(outputPath, std::ios::binary | std::ios::trunc);
+    out.write(output.data(), static_cast<std::streamsize>(output.size()));
+    out.close();
+
+    return !out.fail();
+}
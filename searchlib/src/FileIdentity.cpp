@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <FileIdentity.hpp>
+
+#include <chrono>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// See isRecentlyModified.
+#define RACY_INTERVAL_SECONDS 2
+
+#ifdef _WIN32
+
+// Difference between the FILETIME epoch (1601) and the Unix epoch (1970)
+// in 100 ns units.
+#define FILETIME_UNIX_EPOCH_OFFSET 116444736000000000LL
+
+bool getFileIdentity(std::filesystem::path const &filePath, CFileIdentity &identity) {
+    HANDLE const file = CreateFileW(filePath.c_str(), 0,
+                                    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                    nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+
+    if(file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    BY_HANDLE_FILE_INFORMATION info;
+    bool const isOk = GetFileInformationByHandle(file, &info) != 0;
+    CloseHandle(file);
+
+    if(!isOk) {
+        return false;
+    }
+
+    std::int64_t const lastWrite = (static_cast<std::int64_t>(info.ftLastWriteTime.dwHighDateTime) << 32) |
+                                   info.ftLastWriteTime.dwLowDateTime;
+
+    identity.device = info.dwVolumeSerialNumber;
+    identity.inode = (static_cast<std::uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+    identity.size = (static_cast<std::uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+    identity.modifiedTimeNs = (lastWrite - FILETIME_UNIX_EPOCH_OFFSET) * 100;
+    identity.linkCount = info.nNumberOfLinks;
+    return true;
+}
+
+#else
+
+bool getFileIdentity(std::filesystem::path const &filePath, CFileIdentity &identity) {
+    struct stat info;
+
+    if(stat(filePath.c_str(), &info) != 0) {
+        return false;
+    }
+
+#ifdef __APPLE__
+    std::int64_t const seconds = info.st_mtimespec.tv_sec;
+    std::int64_t const nanoseconds = info.st_mtimespec.tv_nsec;
+#else
+    std::int64_t const seconds = info.st_mtim.tv_sec;
+    std::int64_t const nanoseconds = info.st_mtim.tv_nsec;
+#endif
+
+    identity.device = static_cast<std::uint64_t>(info.st_dev);
+    identity.inode = static_cast<std::uint64_t>(info.st_ino);
+    identity.size = static_cast<std::uint64_t>(info.st_size);
+    identity.modifiedTimeNs = seconds * 1000000000LL + nanoseconds;
+    identity.linkCount = static_cast<std::uint64_t>(info.st_nlink);
+    return true;
+}
+
+#endif
+
+bool isRecentlyModified(CFileIdentity const &identity) {
+    std::int64_t const nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    return nowNs - identity.modifiedTimeNs < RACY_INTERVAL_SECONDS * 1000000000LL;
+}
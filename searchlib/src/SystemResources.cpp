@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <SystemResources.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#define CGROUP_ROOT "/sys/fs/cgroup"
+#define PROCESS_CGROUP_FILE "/proc/self/cgroup"
+
+static std::string readFirstLine(std::filesystem::path const &filePath) {
+    std::ifstream in(filePath);
+    std::string line;
+    std::getline(in, line);
+    return line;
+}
+
+bool parseCgroupCpuMax(std::string const &text, size_t &cpuCount) {
+    std::istringstream iss(text);
+    std::string quota;
+    std::uint64_t period = 0;
+
+    if(!(iss >> quota >> period) || quota == "max" || period == 0) {
+        return false;
+    }
+
+    std::uint64_t quotaValue = 0;
+
+    try {
+        quotaValue = std::stoull(quota);
+    } catch(std::exception const &) {
+        return false;
+    }
+
+    // A quota of 1.5 CPUs keeps two threads partly busy, so round up.
+    cpuCount = static_cast<size_t>(std::max<std::uint64_t>((quotaValue + period - 1) / period, 1));
+    return true;
+}
+
+bool parseCgroupMemoryMax(std::string const &text, std::uint64_t &memoryBytes) {
+    std::istringstream iss(text);
+    std::string limit;
+
+    if(!(iss >> limit) || limit == "max") {
+        return false;
+    }
+
+    try {
+        memoryBytes = std::stoull(limit);
+    } catch(std::exception const &) {
+        return false;
+    }
+
+    return true;
+}
+
+void applyCgroupLimits(std::filesystem::path const &cgroupRoot,
+                       std::string const &cgroupPath,
+                       CSystemResources &resources) {
+    // Limits are inherited: a group can use no more than any of its
+    // ancestors allow, so the lowest limit on the way up applies.
+    std::filesystem::path relativePath = std::filesystem::path(cgroupPath).relative_path();
+
+    while(true) {
+        std::filesystem::path const directory = cgroupRoot / relativePath;
+
+        size_t cpuCount = 0;
+        if(parseCgroupCpuMax(readFirstLine(directory / "cpu.max"), cpuCount)) {
+            resources.cpuCount = std::min(resources.cpuCount, cpuCount);
+        }
+
+        std::uint64_t memoryBytes = 0;
+        if(parseCgroupMemoryMax(readFirstLine(directory / "memory.max"), memoryBytes)) {
+            resources.memoryBytes = resources.memoryBytes == 0 ? memoryBytes
+                                                               : std::min(resources.memoryBytes, memoryBytes);
+        }
+
+        if(relativePath.empty()) {
+            break;
+        }
+
+        relativePath = relativePath.parent_path();
+    }
+}
+
+CSystemResources getSystemResources() {
+    CSystemResources resources;
+    resources.cpuCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+#ifdef _WIN32
+    MEMORYSTATUSEX memoryStatus;
+    memoryStatus.dwLength = sizeof(memoryStatus);
+
+    if(GlobalMemoryStatusEx(&memoryStatus)) {
+        resources.memoryBytes = memoryStatus.ullTotalPhys;
+    }
+#else
+    long const pageCount = sysconf(_SC_PHYS_PAGES);
+    long const pageSize = sysconf(_SC_PAGE_SIZE);
+
+    if(pageCount > 0 && pageSize > 0) {
+        resources.memoryBytes = static_cast<std::uint64_t>(pageCount) * static_cast<std::uint64_t>(pageSize);
+    }
+#endif
+
+#ifdef __linux__
+    // hardware_concurrency counts all CPUs of the machine, including
+    // those the process is not allowed to run on.
+    cpu_set_t cpuSet;
+
+    if(sched_getaffinity(0, sizeof(cpuSet), &cpuSet) == 0) {
+        resources.cpuCount = std::min(resources.cpuCount, std::max<size_t>(CPU_COUNT(&cpuSet), 1));
+    }
+
+    // On a cgroup v2 system, the process's group is listed on a line of
+    // the form "0::<path>".
+    std::ifstream in(PROCESS_CGROUP_FILE);
+    std::string line;
+
+    while(std::getline(in, line)) {
+        if(line.compare(0, 3, "0::") == 0) {
+            applyCgroupLimits(CGROUP_ROOT, line.substr(3), resources);
+            break;
+        }
+    }
+#endif
+
+    return resources;
+}
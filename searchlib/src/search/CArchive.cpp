@@ -0,0 +1,864 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CArchive.hpp>
+
+#include <CTraceRecorder.hpp>
+#include <FileIdentity.hpp>
+#include <search/StreamBuffers.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#define TAR_BLOCK_BYTES 512
+
+// Longest GNU long name or pax extended header accepted
+#define MAX_TAR_HEADER_DATA (1024 * 1024)
+
+#define SKIP_CHUNK_BYTES (64 * 1024)
+
+#define ZIP_EOCD_BYTES 22
+#define ZIP_MAX_COMMENT_BYTES 65535
+#define ZIP_EOCD_SIGNATURE 0x06054b50u
+#define ZIP64_LOCATOR_BYTES 20
+#define ZIP64_LOCATOR_SIGNATURE 0x07064b50u
+#define ZIP64_EOCD_BYTES 56
+#define ZIP64_EOCD_SIGNATURE 0x06064b50u
+#define ZIP_ENTRY_BYTES 46
+#define ZIP_ENTRY_SIGNATURE 0x02014b50u
+#define ZIP_LOCAL_HEADER_BYTES 30
+#define ZIP_LOCAL_HEADER_SIGNATURE 0x04034b50u
+#define ZIP64_EXTRA_ID 0x0001
+
+#define ZIP_METHOD_STORED 0
+#define ZIP_METHOD_DEFLATED 8
+
+using Format = CArchive::Format;
+using Compression = CDecompressingBuffer::Format;
+
+static std::uint16_t readU16(unsigned char const *data) {
+    return static_cast<std::uint16_t>(data[0] | (data[1] << 8));
+}
+
+static std::uint32_t readU32(unsigned char const *data) {
+    return static_cast<std::uint32_t>(readU16(data)) | (static_cast<std::uint32_t>(readU16(data + 2)) << 16);
+}
+
+static std::uint64_t readU64(unsigned char const *data) {
+    return static_cast<std::uint64_t>(readU32(data)) | (static_cast<std::uint64_t>(readU32(data + 4)) << 32);
+}
+
+static bool readAt(std::filebuf &file, std::uint64_t const offset, char *data, size_t const size) {
+    if(file.pubseekpos(static_cast<std::streamoff>(offset), std::ios::in) == std::streampos(std::streamoff(-1))) {
+        return false;
+    }
+
+    return file.sgetn(data, static_cast<std::streamsize>(size)) == static_cast<std::streamsize>(size);
+}
+
+static bool endsWith(std::string const &text, char const *suffix) {
+    size_t const suffixSize = std::strlen(suffix);
+    return text.size() >= suffixSize && text.compare(text.size() - suffixSize, suffixSize, suffix) == 0;
+}
+
+/**
+ * @brief Get the compression of a tar archive as a whole, judging by its
+ * file name.
+ */
+static Compression getTarCompression(std::string const &lowerName) {
+    if(endsWith(lowerName, ".tar.gz") || endsWith(lowerName, ".tgz")) {
+        return Compression::Gzip;
+    }
+
+    if(endsWith(lowerName, ".tar.xz") || endsWith(lowerName, ".txz")) {
+        return Compression::Xz;
+    }
+
+    if(endsWith(lowerName, ".tar.zst") || endsWith(lowerName, ".tzst")) {
+        return Compression::Zstd;
+    }
+
+    return Compression::None;
+}
+
+static std::string getLowerFileName(std::filesystem::path const &path) {
+    std::string name = path.filename().string();
+
+    std::transform(name.begin(), name.end(), name.begin(), [](char c) {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    });
+
+    return name;
+}
+
+static bool isSameFile(CFileIdentity const &a, CFileIdentity const &b) {
+    return a.device == b.device && a.inode == b.inode &&
+           a.size == b.size && a.modifiedTimeNs == b.modifiedTimeNs;
+}
+
+/* ---------------------------------------------------------------------
+ * Zip
+ * ------------------------------------------------------------------ */
+
+struct CZipEntry {
+    std::string name;
+    std::uint16_t method;
+    std::uint64_t compressedSize;
+    std::uint64_t localHeaderOffset;
+};
+
+/**
+ * @brief The readable members of a zip archive, from its central
+ * directory.
+ */
+struct CZipIndex {
+    std::filesystem::path archivePath;
+    CFileIdentity identity;
+    std::vector<CZipEntry> entries;
+    std::unordered_map<std::string, size_t> entryByName;
+};
+
+/**
+ * @brief Find the central directory from the end of central directory
+ * record, or its zip64 variant.
+ */
+static bool findCentralDirectory(std::filebuf &file, std::uint64_t const fileSize,
+                                 std::uint64_t &offset, std::uint64_t &size) {
+    std::uint64_t const tailSize = std::min<std::uint64_t>(fileSize, ZIP_EOCD_BYTES + ZIP_MAX_COMMENT_BYTES);
+    std::uint64_t const tailOffset = fileSize - tailSize;
+    std::vector<char> tail(static_cast<size_t>(tailSize));
+
+    if(tailSize < ZIP_EOCD_BYTES || !readAt(file, tailOffset, tail.data(), tail.size())) {
+        return false;
+    }
+
+    auto const *data = reinterpret_cast<unsigned char const *>(tail.data());
+    size_t eocdPos = tail.size() - ZIP_EOCD_BYTES + 1;
+
+    // The record is followed by a comment of unknown length, so search
+    // backwards for its signature.
+    do {
+        --eocdPos;
+        if(readU32(data + eocdPos) == ZIP_EOCD_SIGNATURE) {
+            break;
+        }
+    } while(eocdPos > 0);
+
+    if(readU32(data + eocdPos) != ZIP_EOCD_SIGNATURE) {
+        return false;
+    }
+
+    std::uint16_t const entryCount = readU16(data + eocdPos + 10);
+    size = readU32(data + eocdPos + 12);
+    offset = readU32(data + eocdPos + 16);
+
+    if(entryCount == 0xFFFF || size == 0xFFFFFFFFu || offset == 0xFFFFFFFFu) {
+        std::uint64_t const eocdOffset = tailOffset + eocdPos;
+        unsigned char locator[ZIP64_LOCATOR_BYTES];
+        unsigned char record[ZIP64_EOCD_BYTES];
+
+        if(eocdOffset < ZIP64_LOCATOR_BYTES ||
+           !readAt(file, eocdOffset - ZIP64_LOCATOR_BYTES, reinterpret_cast<char *>(locator), sizeof(locator)) ||
+           readU32(locator) != ZIP64_LOCATOR_SIGNATURE ||
+           !readAt(file, readU64(locator + 8), reinterpret_cast<char *>(record), sizeof(record)) ||
+           readU32(record) != ZIP64_EOCD_SIGNATURE) {
+            return false;
+        }
+
+        size = readU64(record + 40);
+        offset = readU64(record + 48);
+    }
+
+    return offset <= fileSize && size <= fileSize - offset;
+}
+
+static bool readZipIndex(std::filesystem::path const &archivePath, CFileIdentity const &identity, CZipIndex &index) {
+    index.archivePath.clear();
+    index.entries.clear();
+    index.entryByName.clear();
+
+    std::filebuf file;
+    std::uint64_t directoryOffset = 0;
+    std::uint64_t directorySize = 0;
+
+    if(!file.open(archivePath, std::ios::in | std::ios::binary) ||
+       !findCentralDirectory(file, identity.size, directoryOffset, directorySize)) {
+        return false;
+    }
+
+    std::vector<char> directory(static_cast<size_t>(directorySize));
+
+    if(!readAt(file, directoryOffset, directory.data(), directory.size())) {
+        return false;
+    }
+
+    auto const *data = reinterpret_cast<unsigned char const *>(directory.data());
+    size_t pos = 0;
+
+    while(pos + ZIP_ENTRY_BYTES <= directory.size() && readU32(data + pos) == ZIP_ENTRY_SIGNATURE) {
+        unsigned char const *entry = data + pos;
+        std::uint16_t const flags = readU16(entry + 8);
+        std::uint16_t const method = readU16(entry + 10);
+        std::uint64_t compressedSize = readU32(entry + 20);
+        std::uint64_t size = readU32(entry + 24);
+        size_t const nameSize = readU16(entry + 28);
+        size_t const extraSize = readU16(entry + 30);
+        size_t const commentSize = readU16(entry + 32);
+        std::uint64_t localHeaderOffset = readU32(entry + 42);
+        size_t const entrySize = ZIP_ENTRY_BYTES + nameSize + extraSize + commentSize;
+
+        if(pos + entrySize > directory.size()) {
+            break;
+        }
+
+        // Sizes and offsets which do not fit into 32 bits are in the
+        // zip64 extra field, in this order, if they are present.
+        unsigned char const *extra = entry + ZIP_ENTRY_BYTES + nameSize;
+        size_t extraPos = 0;
+
+        while(extraPos + 4 <= extraSize) {
+            std::uint16_t const fieldId = readU16(extra + extraPos);
+            size_t const fieldSize = readU16(extra + extraPos + 2);
+            unsigned char const *field = extra + extraPos + 4;
+            unsigned char const *const fieldEnd = field + std::min(fieldSize, extraSize - extraPos - 4);
+
+            if(fieldId == ZIP64_EXTRA_ID) {
+                for(std::uint64_t *value : { &size, &compressedSize, &localHeaderOffset }) {
+                    if(*value == 0xFFFFFFFFu && field + 8 <= fieldEnd) {
+                        *value = readU64(field);
+                        field += 8;
+                    }
+                }
+            }
+
+            extraPos += 4 + fieldSize;
+        }
+
+        std::string name(reinterpret_cast<char const *>(entry + ZIP_ENTRY_BYTES), nameSize);
+
+        bool const isDirectory = !name.empty() && name.back() == '/';
+        bool const isEncrypted = (flags & 1) != 0;
+        bool const isReadable = method == ZIP_METHOD_STORED ||
+            (method == ZIP_METHOD_DEFLATED && CDecompressingBuffer::isSupported(Compression::Deflate));
+
+        if(!name.empty() && !isDirectory && !isEncrypted && isReadable) {
+            index.entryByName.emplace(name, index.entries.size());
+            index.entries.push_back({ std::move(name), method, compressedSize, localHeaderOffset });
+        }
+
+        pos += entrySize;
+    }
+
+    index.archivePath = archivePath;
+    index.identity = identity;
+    return true;
+}
+
+/**
+ * @brief Get the index of a zip archive. Every thread keeps the index of
+ * the zip archive it used last, since the members of one archive are
+ * searched in batches.
+ */
+static CZipIndex const *getZipIndex(std::filesystem::path const &archivePath) {
+    static thread_local CZipIndex t_index;
+
+    CFileIdentity identity;
+
+    if(!getFileIdentity(archivePath, identity)) {
+        return nullptr;
+    }
+
+    if(t_index.archivePath == archivePath && isSameFile(t_index.identity, identity)) {
+        return &t_index;
+    }
+
+    return readZipIndex(archivePath, identity, t_index) ? &t_index : nullptr;
+}
+
+class CZipMember : public CArchiveMember {
+public:
+    CZipMember()
+        : m_window(nullptr),
+          m_inflating(nullptr)
+    {
+        // nothing to do
+    }
+
+    ~CZipMember() override {
+        delete m_inflating;
+        delete m_window;
+    }
+
+    bool open(std::filesystem::path const &archivePath, CZipEntry const &entry) {
+        unsigned char header[ZIP_LOCAL_HEADER_BYTES];
+
+        if(!m_file.open(archivePath, std::ios::in | std::ios::binary) ||
+           !readAt(m_file, entry.localHeaderOffset, reinterpret_cast<char *>(header), sizeof(header)) ||
+           readU32(header) != ZIP_LOCAL_HEADER_SIGNATURE) {
+            return false;
+        }
+
+        // The local header's name and extra field may differ in length
+        // from the central directory's.
+        std::uint64_t const dataOffset = entry.localHeaderOffset + ZIP_LOCAL_HEADER_BYTES +
+                                         readU16(header + 26) + readU16(header + 28);
+
+        if(m_file.pubseekpos(static_cast<std::streamoff>(dataOffset), std::ios::in) == std::streampos(std::streamoff(-1))) {
+            return false;
+        }
+
+        m_window = new CWindowBuffer(&m_file, entry.compressedSize);
+
+        if(entry.method == ZIP_METHOD_DEFLATED) {
+            m_inflating = new CDecompressingBuffer(m_window, Compression::Deflate);
+        }
+
+        return true;
+    }
+
+    std::streambuf *getBuffer() override {
+        if(m_inflating) {
+            return m_inflating;
+        }
+        return m_window;
+    }
+
+private:
+    std::filebuf m_file;
+    CWindowBuffer *m_window; // Owned
+    CDecompressingBuffer *m_inflating; // Owned, null for stored members
+};
+
+/* ---------------------------------------------------------------------
+ * Tar
+ * ------------------------------------------------------------------ */
+
+/**
+ * @brief Parse a numeric tar header field: octal text, or a big-endian
+ * binary number if the first byte has its high bit set.
+ */
+static bool parseTarNumber(char const *field, size_t const size, std::uint64_t &value) {
+    auto const *bytes = reinterpret_cast<unsigned char const *>(field);
+    value = 0;
+
+    if(bytes[0] & 0x80) {
+        value = bytes[0] & 0x7F;
+        for(size_t i = 1; i < size; ++i) {
+            value = (value << 8) | bytes[i];
+        }
+        return true;
+    }
+
+    size_t i = 0;
+
+    while(i < size && field[i] == ' ') {
+        ++i;
+    }
+
+    for(; i < size && field[i] >= '0' && field[i] <= '7'; ++i) {
+        value = value * 8 + static_cast<std::uint64_t>(field[i] - '0');
+    }
+
+    return i == size || field[i] == ' ' || field[i] == '\0';
+}
+
+/**
+ * @brief Read the records of a pax extended header which matter here.
+ */
+static void parsePaxHeader(std::string const &data, std::string &path, std::uint64_t &size, bool &hasSize) {
+    size_t pos = 0;
+
+    // Records are "<length> <key>=<value>\n", the length counting the
+    // whole record.
+    while(pos < data.size()) {
+        size_t const space = data.find(' ', pos);
+
+        if(space == std::string::npos) {
+            return;
+        }
+
+        std::uint64_t length = 0;
+        for(size_t i = pos; i < space && data[i] >= '0' && data[i] <= '9'; ++i) {
+            length = length * 10 + static_cast<std::uint64_t>(data[i] - '0');
+        }
+
+        if(length <= space - pos || pos + length > data.size()) {
+            return;
+        }
+
+        size_t const valueEnd = pos + static_cast<size_t>(length) - 1;
+        size_t const equals = data.find('=', space);
+
+        if(equals != std::string::npos && equals < valueEnd) {
+            std::string const key = data.substr(space + 1, equals - space - 1);
+
+            if(key == "path") {
+                path = data.substr(equals + 1, valueEnd - equals - 1);
+            } else if(key == "size") {
+                size = std::strtoull(data.c_str() + equals + 1, nullptr, 10);
+                hasSize = true;
+            }
+        }
+
+        pos += static_cast<size_t>(length);
+    }
+}
+
+/**
+ * @brief Reads the members of a tar archive front to back.
+ */
+class CTarReader {
+public:
+    explicit CTarReader(std::filesystem::path const &archivePath, CFileIdentity const &identity)
+        : m_archivePath(archivePath),
+          m_identity(identity),
+          m_decompressing(nullptr),
+          m_source(&m_file),
+          m_paddedSize(0),
+          m_consumed(0),
+          m_memberCount(0),
+          m_isInUse(false)
+    {
+        m_isOpen = m_file.open(archivePath, std::ios::in | std::ios::binary) != nullptr;
+
+        Compression const compression = getTarCompression(getLowerFileName(archivePath));
+
+        if(m_isOpen && compression != Compression::None) {
+            m_decompressing = new CDecompressingBuffer(&m_file, compression);
+            m_source = m_decompressing;
+        }
+    }
+
+    ~CTarReader() {
+        delete m_decompressing;
+    }
+
+    CTarReader(CTarReader const &) = delete;
+    CTarReader &operator=(CTarReader const &) = delete;
+
+    bool isOpen() const { return m_isOpen; }
+
+    bool isFor(std::filesystem::path const &archivePath, CFileIdentity const &identity) const {
+        return m_archivePath == archivePath && isSameFile(m_identity, identity);
+    }
+
+    /**
+     * @brief Whether members were passed which cannot be returned to.
+     */
+    bool hasPassedMembers() const { return m_memberCount > 0; }
+
+    bool isInUse() const { return m_isInUse; }
+    void setInUse(bool const isInUse) { m_isInUse = isInUse; }
+
+    /**
+     * @brief Move to the next regular file member. Its data can then be
+     * read from getSource, counting the bytes read in getConsumed.
+     *
+     * @return false at the end of the archive, or if it is corrupt
+     */
+    bool next(std::string &name, std::uint64_t &size) {
+        if(!m_isOpen) {
+            return false;
+        }
+
+        // Skip whatever the previous member's reader left, and the
+        // padding to the next block.
+        if(m_paddedSize > m_consumed && !skip(m_paddedSize - m_consumed)) {
+            m_isOpen = false;
+            return false;
+        }
+
+        m_paddedSize = 0;
+        m_consumed = 0;
+
+        std::string longName;
+        std::uint64_t paxSize = 0;
+        bool hasPaxSize = false;
+        char block[TAR_BLOCK_BYTES];
+
+        while(m_source->sgetn(block, TAR_BLOCK_BYTES) == TAR_BLOCK_BYTES) {
+            if(std::all_of(block, block + TAR_BLOCK_BYTES, [](char c) { return c == '\0'; })) {
+                break;
+            }
+
+            std::uint64_t dataSize = 0;
+
+            if(!parseTarNumber(block + 124, 12, dataSize)) {
+                break;
+            }
+
+            char const type = block[156];
+
+            if(type == 'L' || type == 'x') {
+                std::string data;
+
+                if(dataSize > MAX_TAR_HEADER_DATA || !readData(dataSize, data)) {
+                    break;
+                }
+
+                if(type == 'L') {
+                    longName = data.c_str();
+                } else {
+                    parsePaxHeader(data, longName, paxSize, hasPaxSize);
+                }
+                continue;
+            }
+
+            if(hasPaxSize) {
+                dataSize = paxSize;
+            }
+
+            std::uint64_t const paddedSize = (dataSize + TAR_BLOCK_BYTES - 1) / TAR_BLOCK_BYTES * TAR_BLOCK_BYTES;
+
+            if(type == '0' || type == '\0' || type == '7') {
+                name = longName.empty() ? getHeaderName(block) : longName;
+                size = dataSize;
+                m_paddedSize = paddedSize;
+                m_memberCount++;
+                return true;
+            }
+
+            // Directories, links and other entries
+            longName.clear();
+            hasPaxSize = false;
+
+            if(!skip(paddedSize)) {
+                break;
+            }
+        }
+
+        m_isOpen = false;
+        return false;
+    }
+
+    std::streambuf *getSource() { return m_source; }
+    std::uint64_t *getConsumed() { return &m_consumed; }
+
+private:
+    static std::string getHeaderName(char const *block) {
+        std::string name(block, strnlen(block, 100));
+
+        // The ustar format splits long names into a prefix and a name.
+        if(std::memcmp(block + 257, "ustar", 5) == 0 && block[345] != '\0') {
+            name = std::string(block + 345, strnlen(block + 345, 155)) + "/" + name;
+        }
+
+        return name;
+    }
+
+    bool readData(std::uint64_t const size, std::string &data) {
+        std::uint64_t const paddedSize = (size + TAR_BLOCK_BYTES - 1) / TAR_BLOCK_BYTES * TAR_BLOCK_BYTES;
+        data.resize(static_cast<size_t>(paddedSize));
+
+        if(m_source->sgetn(&data[0], static_cast<std::streamsize>(paddedSize)) != static_cast<std::streamsize>(paddedSize)) {
+            return false;
+        }
+
+        data.resize(static_cast<size_t>(size));
+        return true;
+    }
+
+    bool skip(std::uint64_t bytes) {
+        // An uncompressed archive can seek over member data.
+        if(!m_decompressing &&
+           m_file.pubseekoff(static_cast<std::streamoff>(bytes), std::ios::cur, std::ios::in) != std::streampos(std::streamoff(-1))) {
+            return true;
+        }
+
+        std::vector<char> discard(static_cast<size_t>(std::min<std::uint64_t>(bytes, SKIP_CHUNK_BYTES)));
+
+        while(bytes > 0) {
+            std::streamsize const chunk = static_cast<std::streamsize>(std::min<std::uint64_t>(bytes, discard.size()));
+
+            if(m_source->sgetn(discard.data(), chunk) != chunk) {
+                return false;
+            }
+
+            bytes -= static_cast<std::uint64_t>(chunk);
+        }
+
+        return true;
+    }
+
+    std::filesystem::path m_archivePath;
+    CFileIdentity m_identity;
+    std::filebuf m_file;
+    CDecompressingBuffer *m_decompressing; // Owned, null for uncompressed archives
+    std::streambuf *m_source;
+    bool m_isOpen;
+
+    // Data size of the current member, padded to whole blocks, and how
+    // much of it was read
+    std::uint64_t m_paddedSize;
+    std::uint64_t m_consumed;
+
+    size_t m_memberCount;
+    bool m_isInUse;
+};
+
+CTarCursor::~CTarCursor() {
+    delete reader;
+}
+
+// The tar reader a thread used last, kept to continue reading where it
+// stopped, and the cursor the thread reads through, which is its own one
+// unless a CArchive::CCursorScope lends it another.
+static thread_local CTarCursor t_ownTarCursor;
+static thread_local CTarCursor *t_tarCursor = &t_ownTarCursor;
+
+class CTarMember : public CArchiveMember {
+public:
+    CTarMember(CTarReader *reader, bool const isReaderOwned, std::uint64_t const size)
+        : m_reader(reader),
+          m_isReaderOwned(isReaderOwned),
+          m_window(reader->getSource(), size, reader->getConsumed())
+    {
+        m_reader->setInUse(true);
+    }
+
+    ~CTarMember() override {
+        m_reader->setInUse(false);
+
+        if(m_isReaderOwned) {
+            delete m_reader;
+        }
+    }
+
+    std::streambuf *getBuffer() override { return &m_window; }
+
+private:
+    CTarReader *m_reader;
+    bool m_isReaderOwned;
+    CWindowBuffer m_window;
+};
+
+static bool findTarMember(CTarReader &reader, std::string const &memberName, std::uint64_t &size) {
+    std::string name;
+
+    while(reader.next(name, size)) {
+        if(name == memberName) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Start reading a tar archive from the front. Traced, since
+ * doing that more often than once per archive and thread is costly.
+ */
+static CTarReader *startTarReader(std::filesystem::path const &archivePath, CFileIdentity const &identity) {
+    CTraceSpan span("Open archive");
+    if(span.isRecording()) {
+        span.setDetail(archivePath.u8string());
+    }
+
+    return new CTarReader(archivePath, identity);
+}
+
+static CArchiveMember *openTarMember(std::filesystem::path const &archivePath, std::string const &memberName) {
+    CFileIdentity identity;
+
+    if(!getFileIdentity(archivePath, identity)) {
+        return nullptr;
+    }
+
+    CTarCursor &cursor = *t_tarCursor;
+
+    // While a member read through the thread's cursor is open, for
+    // example when several filters stream the same member, other members
+    // get a reader of their own.
+    bool const isCursorFree = !cursor.reader || !cursor.reader->isInUse();
+    CTarReader *reader = isCursorFree ? cursor.reader : nullptr;
+
+    if(reader && !reader->isFor(archivePath, identity)) {
+        delete reader;
+        reader = cursor.reader = nullptr;
+    }
+
+    if(!reader) {
+        reader = startTarReader(archivePath, identity);
+
+        if(isCursorFree) {
+            cursor.reader = reader;
+        }
+    }
+
+    std::uint64_t size = 0;
+    bool isFound = findTarMember(*reader, memberName, size);
+
+    // The member may lie before the reader's position.
+    if(!isFound && reader->hasPassedMembers()) {
+        CTarReader *const restarted = startTarReader(archivePath, identity);
+
+        if(isCursorFree) {
+            cursor.reader = restarted;
+        }
+
+        delete reader;
+        reader = restarted;
+        isFound = findTarMember(*reader, memberName, size);
+    }
+
+    if(!isFound) {
+        if(!isCursorFree) {
+            delete reader;
+        }
+        return nullptr;
+    }
+
+    return new CTarMember(reader, !isCursorFree, size);
+}
+
+/* ---------------------------------------------------------------------
+ * CArchive
+ * ------------------------------------------------------------------ */
+
+CArchive::CCursorScope::CCursorScope(CTarCursor &cursor)
+    : m_previous(t_tarCursor)
+{
+    t_tarCursor = &cursor;
+}
+
+CArchive::CCursorScope::~CCursorScope() {
+    t_tarCursor = m_previous;
+}
+
+Format CArchive::getFormat(std::filesystem::path const &archivePath) {
+    std::string const name = getLowerFileName(archivePath);
+
+    if(endsWith(name, ".zip")) {
+        return Format::Zip;
+    }
+
+    if(endsWith(name, ".tar")) {
+        return Format::Tar;
+    }
+
+    Compression const compression = getTarCompression(name);
+
+    if(compression != Compression::None && CDecompressingBuffer::isSupported(compression)) {
+        return Format::Tar;
+    }
+
+    return Format::None;
+}
+
+bool CArchive::listMembers(std::filesystem::path const &archivePath, std::vector<std::string> &names) {
+    switch(getFormat(archivePath)) {
+        case Format::Zip: {
+            CZipIndex const *index = getZipIndex(archivePath);
+
+            if(!index) {
+                return false;
+            }
+
+            for(CZipEntry const &entry : index->entries) {
+                names.push_back(entry.name);
+            }
+            return true;
+        }
+
+        case Format::Tar: {
+            CFileIdentity identity;
+
+            if(!getFileIdentity(archivePath, identity)) {
+                return false;
+            }
+
+            CTarReader reader(archivePath, identity);
+            std::string name;
+            std::uint64_t size = 0;
+
+            if(!reader.isOpen()) {
+                return false;
+            }
+
+            while(reader.next(name, size)) {
+                names.push_back(name);
+            }
+            return true;
+        }
+
+        case Format::None:
+            break;
+    }
+
+    return false;
+}
+
+CArchiveMember *CArchive::openMember(std::filesystem::path const &archivePath, std::string const &memberName) {
+    switch(getFormat(archivePath)) {
+        case Format::Zip: {
+            CZipIndex const *index = getZipIndex(archivePath);
+
+            if(!index) {
+                return nullptr;
+            }
+
+            auto const it = index->entryByName.find(memberName);
+
+            if(it == index->entryByName.end()) {
+                return nullptr;
+            }
+
+            CZipMember *member = new CZipMember();
+
+            if(!member->open(archivePath, index->entries[it->second])) {
+                delete member;
+                return nullptr;
+            }
+            return member;
+        }
+
+        case Format::Tar:
+            return openTarMember(archivePath, memberName);
+
+        case Format::None:
+            break;
+    }
+
+    return nullptr;
+}
+
+bool CArchive::isSequentialMember(std::filesystem::path const &path) {
+    std::filesystem::path archivePath;
+    std::string memberName;
+
+    return splitMemberPath(path, archivePath, memberName) && !isRandomAccess(getFormat(archivePath));
+}
+
+std::filesystem::path CArchive::makeMemberPath(std::filesystem::path const &archivePath, std::string const &memberName) {
+    // Joined as strings: appending a path with several components to a
+    // path does not always keep the components intact in libstdc++.
+    return std::filesystem::path(archivePath.native() + std::filesystem::path("!/").native() +
+                                 std::filesystem::u8path(memberName).native());
+}
+
+bool CArchive::splitMemberPath(std::filesystem::path const &memberPath,
+                               std::filesystem::path &archivePath,
+                               std::string &memberName) {
+    static std::filesystem::path::string_type const SEPARATOR = std::filesystem::path("!/").native();
+
+    std::filesystem::path::string_type const &text = memberPath.native();
+    size_t pos = text.find(SEPARATOR);
+
+    // A directory may have a "!" at the end of its name, so the part
+    // before the separator has to name an archive.
+    while(pos != std::filesystem::path::string_type::npos) {
+        std::filesystem::path candidate(text.substr(0, pos));
+
+        if(getFormat(candidate) != Format::None) {
+            archivePath = std::move(candidate);
+            memberName = std::filesystem::path(text.substr(pos + SEPARATOR.size())).u8string();
+            return true;
+        }
+
+        pos = text.find(SEPARATOR, pos + 1);
+    }
+
+    return false;
+}
@@ -0,0 +1,221 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CBasicStreamSearcher.hpp>
+
+#include <search/CScanBuffer.hpp>
+#include <search/CSearchStats.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <cwctype>
+#include <string_view>
+
+static char foldCase(char const c) {
+    // Bytes outside ASCII belong to multibyte characters.
+    if(static_cast<unsigned char>(c) >= 0x80) {
+        return c;
+    }
+
+    wint_t const lower = std::towlower(static_cast<wint_t>(c));
+    return lower < 0x80 ? static_cast<char>(lower) : c;
+}
+
+static char16_t foldCase(char16_t const c) {
+    // Surrogates are halves of characters beyond the 16-bit range.
+    if(c >= 0xD800 && c <= 0xDFFF) {
+        return c;
+    }
+
+    wint_t const lower = std::towlower(static_cast<wint_t>(c));
+    return lower <= 0xFFFF ? static_cast<char16_t>(lower) : c;
+}
+
+static wchar_t foldCase(wchar_t const c) {
+    return static_cast<wchar_t>(std::towlower(static_cast<wint_t>(c)));
+}
+
+/**
+ * @brief Fold every character of a text. Each character folds to exactly
+ * one character, so offsets in the folded text are offsets in the
+ * original.
+ */
+template<typename CharT>
+static std::basic_string<CharT> foldCase(CharT const *text, size_t const size) {
+    std::basic_string<CharT> folded(text, size);
+    std::transform(folded.begin(), folded.end(), folded.begin(),
+                   [](CharT const c) { return foldCase(c); });
+    return folded;
+}
+
+template<>
+std::string foldCase(char const *text, size_t const size) {
+    // A byte folds by table lookup, which is much cheaper than
+    // std::towlower. The table is built per call, since the locale may
+    // change between searches.
+    char table[256];
+    for(size_t c = 0; c < 256; ++c) {
+        table[c] = foldCase(static_cast<char>(c));
+    }
+
+    std::string folded(text, size);
+    for(char &c : folded) {
+        c = table[static_cast<unsigned char>(c)];
+    }
+    return folded;
+}
+
+template<typename CharT>
+CBasicStreamSearcher<CharT>::CBasicStreamSearcher(String const &matchText,
+                                                  bool const caseInsensitive,
+                                                  bool const wholeMatch,
+                                                  size_t const maxBufferSize)
+    : m_isCaseInsensitive(caseInsensitive),
+      m_isWholeMatch(wholeMatch),
+      m_maxBufferSize(maxBufferSize)
+{
+    // Fold the match text once here rather than on every search.
+    m_matchText = caseInsensitive ? foldCase(matchText.data(), matchText.size()) : matchText;
+}
+
+template<typename CharT>
+bool CBasicStreamSearcher<CharT>::searchText(Stream &in) const {
+    if(!in.good()) {
+        return false;
+    }
+
+    // Every window after the first starts with the overlap carried over,
+    // so the buffer must be longer than the match text.
+    size_t const bufferLen = std::max(m_maxBufferSize, 2 * m_matchText.size());
+
+    // The buffer is reused for every file the thread searches, and is
+    // not cleared, so a small file only touches as much of it as it fills.
+    // Every character type has a buffer of its own.
+    static thread_local CBasicScanBuffer<CharT> scanBuffer;
+    CharT *const buffer = scanBuffer.reserve(bufferLen);
+
+    // A search keeps the last characters of a window in front of the next
+    // one, so that matches which straddle two windows are found. A whole
+    // match compares the windows with consecutive pieces of the match
+    // text instead.
+    size_t const overlapChars = m_isWholeMatch ? 0 : m_matchText.size();
+    size_t carriedChars = 0;
+    size_t bufferPos = 0;
+
+    do {
+        CStageTimer readTimer(CSearchStats::Stage::Read);
+        in.read(buffer + carriedChars, static_cast<std::streamsize>(bufferLen - carriedChars));
+        size_t const charsRead = static_cast<size_t>(in.gcount());
+        readTimer.addAmount(charsRead);
+        readTimer.stop();
+
+        if(charsRead == 0) {
+            break;
+        }
+
+        size_t const size = carriedChars + charsRead;
+        CStageTimer matchTimer(CSearchStats::Stage::Match);
+
+        if(m_isWholeMatch) {
+            // Every window must match its piece of the match text.
+            if(!bufferedMatch(buffer, size, bufferPos)) {
+                return false;
+            }
+        } else if(bufferedSearch(buffer, size)) {
+            // One window containing the match text is enough.
+            return true;
+        }
+
+        matchTimer.stop();
+        bufferPos += charsRead;
+
+        carriedChars = std::min(overlapChars, size);
+        std::memmove(buffer, buffer + size - carriedChars, carriedChars * sizeof(CharT));
+    } while(in.good());
+
+    // A whole match succeeds if no window had a mismatch and the stream
+    // had exactly the length of the match text (otherwise it was only a
+    // prefix of it). A search found the match text in no window.
+    return m_isWholeMatch && bufferPos == m_matchText.size();
+}
+
+template<typename CharT>
+bool CBasicStreamSearcher<CharT>::searchBuffer(CharT const *text, size_t const size) const {
+    if(m_isWholeMatch) {
+        return size == m_matchText.size() && bufferedMatch(text, size, 0);
+    }
+
+    return bufferedSearch(text, size);
+}
+
+template<typename CharT>
+void CBasicStreamSearcher<CharT>::findMatches(CharT const *text,
+                                              size_t const size,
+                                              size_t const maxMatches,
+                                              std::vector<std::pair<size_t, size_t>> &matches) const {
+    if(m_isWholeMatch) {
+        if(maxMatches > 0 && searchBuffer(text, size)) {
+            matches.emplace_back(0, size);
+        }
+        return;
+    }
+
+    if(m_matchText.empty()) {
+        return;
+    }
+
+    String foldedText;
+    std::basic_string_view<CharT> haystack(text, size);
+
+    if(m_isCaseInsensitive) {
+        foldedText = foldCase(text, size);
+        haystack = foldedText;
+    }
+
+    size_t pos = haystack.find(m_matchText);
+
+    while(pos != std::basic_string_view<CharT>::npos && matches.size() < maxMatches) {
+        matches.emplace_back(pos, m_matchText.size());
+        pos = haystack.find(m_matchText, pos + m_matchText.size());
+    }
+}
+
+template<typename CharT>
+bool CBasicStreamSearcher<CharT>::bufferedSearch(CharT const *text, size_t const size) const {
+    if(m_isCaseInsensitive) {
+        return foldCase(text, size).find(m_matchText) != String::npos;
+    }
+
+    // Otherwise, search the raw text in place without copying it.
+    return std::basic_string_view<CharT>(text, size).find(m_matchText) != std::basic_string_view<CharT>::npos;
+}
+
+template<typename CharT>
+bool CBasicStreamSearcher<CharT>::bufferedMatch(CharT const *text, size_t const size, size_t const streamPos) const {
+    // Example:
+    // * if match string is "ABCDEFGHIJKL"
+    // * stream pos is 4
+    // * size is 2, then this method should check:
+    // "ABCDEFGHIJKL"
+    //      ^^
+    // and compare against the text buffer,
+    // which is "EF". So in this example,
+    // the function should return true.
+
+    // impossible for this to be a match if
+    // the buffer window runs outside the
+    // match text
+    if(streamPos + size > m_matchText.size()) {
+        return false;
+    }
+
+    std::basic_string_view<CharT> const matchChunk(m_matchText.data() + streamPos, size);
+
+    if(m_isCaseInsensitive) {
+        return foldCase(text, size) == matchChunk;
+    }
+
+    return std::basic_string_view<CharT>(text, size) == matchChunk;
+}
+
+template class CBasicStreamSearcher<char>;
+template class CBasicStreamSearcher<char16_t>;
+template class CBasicStreamSearcher<wchar_t>;
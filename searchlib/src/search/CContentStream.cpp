@@ -0,0 +1,133 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CContentStream.hpp>
+
+#include <search/CArchive.hpp>
+
+#include <string>
+
+/**
+ * @brief Open the undecoded bytes of an archive member or a file, for
+ * CContentStream and CContentByteStream, and decompress them if the
+ * compression calls for it. Files are opened in fileBuffer.
+ *
+ * @return the stream buffer to read the bytes from, or null if the file
+ *         cannot be opened
+ */
+static std::streambuf *openBytes(std::filesystem::path const &filePath,
+                                 CContentStream::Compression const compression,
+                                 std::filebuf &fileBuffer,
+                                 CArchiveMember *&member,
+                                 CDecompressingBuffer *&decompressingBuffer) {
+    std::streambuf *source = nullptr;
+
+    std::filesystem::path archivePath;
+    std::string memberName;
+
+    if(CArchive::splitMemberPath(filePath, archivePath, memberName)) {
+        member = CArchive::openMember(archivePath, memberName);
+
+        if(!member) {
+            return nullptr;
+        }
+
+        source = member->getBuffer();
+    } else {
+        if(!fileBuffer.open(filePath, std::ios::in | std::ios::binary)) {
+            return nullptr;
+        }
+
+        source = &fileBuffer;
+    }
+
+    if(compression != CContentStream::Compression::None) {
+        decompressingBuffer = new CDecompressingBuffer(source, compression);
+        source = decompressingBuffer;
+    }
+
+    return source;
+}
+
+CContentStream::CContentStream(std::filesystem::path const &filePath)
+    : std::wistream(nullptr),
+      m_member(nullptr),
+      m_decompressingBuffer(nullptr),
+      m_wideningBuffer(nullptr)
+{
+    Compression const compression = getCompression(filePath);
+
+    std::filesystem::path archivePath;
+    std::string memberName;
+
+    // Plain files are decoded by the file buffer itself.
+    if(compression == Compression::None && !CArchive::splitMemberPath(filePath, archivePath, memberName)) {
+        init(&m_fileBuffer);
+
+        if(!m_fileBuffer.open(filePath, std::ios::in)) {
+            setstate(std::ios::failbit);
+        }
+        return;
+    }
+
+    std::streambuf *const source = openBytes(filePath, compression, m_byteBuffer, m_member, m_decompressingBuffer);
+
+    if(!source) {
+        init(&m_fileBuffer);
+        setstate(std::ios::failbit);
+        return;
+    }
+
+    m_wideningBuffer = new CWideningBuffer(source);
+    init(m_wideningBuffer);
+}
+
+CContentStream::~CContentStream() {
+    // From the top down, since every buffer reads from the one below.
+    delete m_wideningBuffer;
+    delete m_decompressingBuffer;
+    delete m_member;
+}
+
+CContentByteStream::CContentByteStream(std::filesystem::path const &filePath)
+    : std::istream(nullptr),
+      m_member(nullptr),
+      m_decompressingBuffer(nullptr)
+{
+    std::streambuf *const source = openBytes(filePath, CContentStream::getCompression(filePath),
+                                             m_byteBuffer, m_member, m_decompressingBuffer);
+
+    if(!source) {
+        init(&m_byteBuffer);
+        setstate(std::ios::failbit);
+        return;
+    }
+
+    init(source);
+}
+
+CContentByteStream::~CContentByteStream() {
+    delete m_decompressingBuffer;
+    delete m_member;
+}
+
+CContentStream::Compression CContentStream::getCompression() const {
+    return m_decompressingBuffer ? m_decompressingBuffer->getFormat() : Compression::None;
+}
+
+CContentStream::Compression CContentStream::getCompression(std::filesystem::path const &filePath) {
+    std::filesystem::path const extension = filePath.extension();
+    Compression compression = Compression::None;
+
+    if(extension == ".gz") {
+        compression = Compression::Gzip;
+    } else if(extension == ".zst") {
+        compression = Compression::Zstd;
+    } else if(extension == ".xz") {
+        compression = Compression::Xz;
+    }
+
+    return isSupported(compression) ? compression : Compression::None;
+}
+
+bool CContentStream::isSupported(Compression const compression) {
+    return CDecompressingBuffer::isSupported(compression);
+}
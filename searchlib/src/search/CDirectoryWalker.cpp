@@ -0,0 +1,382 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CDirectoryWalker.hpp>
+
+#include <FileIdentity.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+
+/**
+ * @brief Whether a path equals another path or lies below it, comparing
+ * whole components.
+ */
+static bool isWithin(std::filesystem::path const &inner, std::filesystem::path const &outer) {
+    auto innerIt = inner.begin();
+
+    for(auto outerIt = outer.begin(); outerIt != outer.end(); ++outerIt, ++innerIt) {
+        if(innerIt == inner.end() || *innerIt != *outerIt) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static std::uint64_t getElapsedNs(std::chrono::steady_clock::time_point const start) {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+CDirectoryWalker::CDirectoryWalker(std::filesystem::path const &root)
+    : m_root(root),
+      m_respectIgnoreFiles(false),
+      m_directoryCache(nullptr),
+      m_followSymlinks(false),
+      m_visitedDirectories(nullptr),
+      m_activeVisitedDirectories(nullptr),
+      m_stats(nullptr)
+{
+    // nothing to do
+}
+
+void CDirectoryWalker::walk(FileCallback const &onFile) {
+    std::vector<CFrame> stack;
+
+    m_levels.clear();
+    m_stats = CSearchStats::getCurrent();
+
+    std::unique_ptr<CVisitedInodes> ownVisitedDirectories;
+    m_activeVisitedDirectories = m_visitedDirectories;
+
+    if(m_followSymlinks && !m_activeVisitedDirectories) {
+        ownVisitedDirectories.reset(new CVisitedInodes());
+        m_activeVisitedDirectories = ownVisitedDirectories.get();
+    }
+
+    CFrame rootFrame;
+
+    if(!openFrame(m_root, rootFrame)) {
+        m_activeVisitedDirectories = nullptr;
+        return;
+    }
+
+    if(m_respectIgnoreFiles) {
+        pushRootLevels();
+    }
+
+    stack.push_back(std::move(rootFrame));
+
+    std::filesystem::directory_iterator const endIterator;
+
+    while(!stack.empty()) {
+        CFrame &frame = stack.back();
+        std::filesystem::path descendPath;
+
+        if(frame.isCached) {
+            // Replay the listing recorded by an earlier walk. Ignore rules
+            // are still evaluated, since ignore files may have changed
+            // without changing the directories they apply to.
+            if(frame.nextFile < frame.listing.files.size()) {
+                std::filesystem::path const filePath = frame.directory / frame.listing.files[frame.nextFile++];
+
+                if(!m_respectIgnoreFiles || !isIgnored(filePath, false)) {
+                    onFile(filePath);
+                }
+                continue;
+            }
+
+            if(frame.nextSubdirectory >= frame.listing.subdirectories.size()) {
+                popFrame(stack);
+                continue;
+            }
+
+            std::filesystem::path const &name = frame.listing.subdirectories[frame.nextSubdirectory++];
+            std::filesystem::path const subdirectoryPath = frame.directory / name;
+
+            if(!m_respectIgnoreFiles || (name != ".git" && !isIgnored(subdirectoryPath, true))) {
+                descendPath = subdirectoryPath;
+            }
+        } else {
+            if(frame.it == endIterator) {
+                if(m_directoryCache && frame.isComplete && frame.listing.isStampValid) {
+                    m_directoryCache->storeListing(frame.directory, frame.listing);
+                }
+
+                popFrame(stack);
+                continue;
+            }
+
+            std::filesystem::directory_entry const &dirEntry = *frame.it;
+
+            // The entry type is usually known from the directory listing
+            // itself, so these checks do not need a stat call. Symbolic
+            // links to directories are not followed by default, which
+            // matches the behavior of recursive_directory_iterator with
+            // default options.
+            std::error_code typeEc;
+            bool const isSymlink = dirEntry.is_symlink(typeEc);
+
+            if((!isSymlink || m_followSymlinks) && dirEntry.is_directory(typeEc)) {
+                if(m_directoryCache) {
+                    frame.listing.subdirectories.push_back(dirEntry.path().filename());
+                }
+
+                if(!m_respectIgnoreFiles ||
+                   (dirEntry.path().filename() != ".git" && !isIgnored(dirEntry.path(), true))) {
+                    descendPath = dirEntry.path();
+                }
+            } else if(dirEntry.is_regular_file(typeEc)) {
+                if(m_directoryCache) {
+                    frame.listing.files.push_back(dirEntry.path().filename());
+                }
+
+                if(!m_respectIgnoreFiles || !isIgnored(dirEntry.path(), false)) {
+                    onFile(dirEntry.path());
+                }
+            }
+
+            std::error_code ec;
+
+            if(m_stats) {
+                auto const start = std::chrono::steady_clock::now();
+                frame.it.increment(ec);
+                frame.readNs += getElapsedNs(start);
+                frame.entryCount++;
+            } else {
+                frame.it.increment(ec);
+            }
+
+            if(ec) {
+                std::cout << "warning: error code " << ec.value() << " while enumerating directory\n";
+                frame.it = endIterator;
+                frame.isComplete = false;
+            }
+        }
+
+        if(descendPath.empty()) {
+            continue;
+        }
+
+        CFrame childFrame;
+
+        if(!openFrame(descendPath, childFrame)) {
+            continue;
+        }
+
+        if(m_respectIgnoreFiles) {
+            size_t const levelCount = m_levels.size();
+            pushLevel(descendPath, false);
+            childFrame.hasLevel = m_levels.size() != levelCount;
+        }
+
+        stack.push_back(std::move(childFrame));
+    }
+
+    m_levels.clear();
+    m_activeVisitedDirectories = nullptr;
+}
+
+std::vector<std::filesystem::path> CDirectoryWalker::removeOverlappingRoots(std::vector<std::filesystem::path> const &roots) {
+    std::vector<std::filesystem::path> resolved;
+
+    for(std::filesystem::path const &root : roots) {
+        std::error_code ec;
+        std::filesystem::path resolvedRoot = std::filesystem::weakly_canonical(root, ec);
+
+        if(ec) {
+            resolvedRoot = std::filesystem::absolute(root, ec).lexically_normal();
+        }
+
+        // "dir/" and "dir" are the same root.
+        if(!resolvedRoot.has_filename() && resolvedRoot.has_relative_path()) {
+            resolvedRoot = resolvedRoot.parent_path();
+        }
+
+        resolved.push_back(resolvedRoot);
+    }
+
+    std::vector<std::filesystem::path> result;
+
+    for(size_t i = 0; i < roots.size(); ++i) {
+        bool isCovered = false;
+
+        // Of equal roots, the first one is kept.
+        for(size_t j = 0; j < roots.size() && !isCovered; ++j) {
+            if(j != i && isWithin(resolved[i], resolved[j])) {
+                isCovered = resolved[i] != resolved[j] || j < i;
+            }
+        }
+
+        if(!isCovered) {
+            result.push_back(roots[i]);
+        }
+    }
+
+    return result;
+}
+
+bool CDirectoryWalker::openFrame(std::filesystem::path const &directory, CFrame &frame) {
+    frame.directory = directory;
+
+    // Entering a directory a second time, for example through a symbolic
+    // link to one of its ancestors, would repeat its contents or never end.
+    // Cached listings contain followed links too, so this check comes
+    // first.
+    if(m_activeVisitedDirectories) {
+        CFileIdentity identity;
+
+        if(getFileIdentity(directory, identity) &&
+           m_activeVisitedDirectories->visit(identity.device, identity.inode) != CVisitedInodes::State::New) {
+            return false;
+        }
+    }
+
+    if(m_directoryCache && m_directoryCache->findListing(directory, frame.listing)) {
+        frame.isCached = true;
+        return true;
+    }
+
+    frame.listing.files.clear();
+    frame.listing.subdirectories.clear();
+
+    auto const start = m_stats ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+
+    std::error_code ec;
+    frame.it = std::filesystem::directory_iterator(
+        directory,
+        std::filesystem::directory_options::skip_permission_denied,
+        ec);
+
+    if(m_stats) {
+        frame.readNs = getElapsedNs(start);
+
+        if(ec) {
+            m_stats->record(CSearchStats::Stage::DirectoryRead, frame.readNs, 0);
+        }
+    }
+
+    return !ec;
+}
+
+void CDirectoryWalker::popFrame(std::vector<CFrame> &stack) {
+    if(m_stats && !stack.back().isCached) {
+        m_stats->record(CSearchStats::Stage::DirectoryRead, stack.back().readNs, stack.back().entryCount);
+    }
+
+    if(stack.back().hasLevel) {
+        m_levels.pop_back();
+    }
+
+    stack.pop_back();
+}
+
+void CDirectoryWalker::pushLevel(std::filesystem::path const &directory, bool const isRepositoryRoot) {
+    CLevel level;
+
+    // Precedence within one directory, from lowest to highest:
+    // .git/info/exclude, .gitignore, .ignore
+    if(isRepositoryRoot) {
+        level.rules.addRulesFromFile(directory / ".git" / "info" / "exclude");
+    }
+    level.rules.addRulesFromFile(directory / ".gitignore");
+    level.rules.addRulesFromFile(directory / ".ignore");
+
+    if(level.rules.empty()) {
+        return;
+    }
+
+    std::string const base = directory.generic_u8string();
+    level.baseLength = base.size() + ((base.empty() || base.back() == '/') ? 0 : 1);
+
+    m_levels.push_back(std::move(level));
+}
+
+void CDirectoryWalker::pushRootLevels() {
+    std::error_code ec;
+
+    // If the root lies inside a repository, the ignore files of the
+    // directories between the repository root and the search root apply
+    // as well. Those directories do not appear in the paths we enumerate,
+    // so their rules are evaluated against a path prefixed with the
+    // root's location relative to them.
+    std::filesystem::path const absoluteRoot = std::filesystem::absolute(m_root, ec).lexically_normal();
+    std::vector<std::filesystem::path> ancestors;
+    bool foundRepository = false;
+
+    if(!ec) {
+        std::filesystem::path dir = absoluteRoot;
+
+        while(true) {
+            if(std::filesystem::exists(dir / ".git", ec)) {
+                foundRepository = true;
+                break;
+            }
+
+            std::filesystem::path const parent = dir.parent_path();
+
+            if(parent.empty() || parent == dir) {
+                break;
+            }
+
+            dir = parent;
+            ancestors.push_back(dir);
+        }
+    }
+
+    if(foundRepository) {
+        // Outermost ancestor first, so that deeper levels are pushed later
+        // and therefore take precedence.
+        for(auto it = ancestors.rbegin(); it != ancestors.rend(); ++it) {
+            size_t const levelCount = m_levels.size();
+            pushLevel(*it, it == ancestors.rbegin());
+
+            if(m_levels.size() != levelCount) {
+                std::string const base = m_root.generic_u8string();
+                std::string prefix = absoluteRoot.lexically_relative(*it).generic_u8string();
+
+                if(!prefix.empty() && prefix.back() != '/') {
+                    prefix.push_back('/');
+                }
+
+                m_levels.back().prefix = std::move(prefix);
+                m_levels.back().baseLength = base.size() + ((base.empty() || base.back() == '/') ? 0 : 1);
+            }
+        }
+    }
+
+    pushLevel(m_root, ancestors.empty() && foundRepository);
+}
+
+bool CDirectoryWalker::isIgnored(std::filesystem::path const &entryPath, bool const isDirectory) const {
+    if(m_levels.empty()) {
+        return false;
+    }
+
+    std::string const name = entryPath.filename().u8string();
+    std::string fullPath;
+    std::string relativePath;
+
+    // Deepest level first: rules closer to the entry take precedence.
+    for(auto it = m_levels.rbegin(); it != m_levels.rend(); ++it) {
+        if(it->rules.needsRelativePath()) {
+            if(fullPath.empty()) {
+                fullPath = entryPath.generic_u8string();
+            }
+
+            relativePath = it->prefix;
+            relativePath.append(fullPath, std::min(it->baseLength, fullPath.size()), std::string::npos);
+        } else {
+            relativePath.clear();
+        }
+
+        CIgnoreRules::Verdict const verdict = it->rules.match(relativePath, name, isDirectory);
+
+        if(verdict != CIgnoreRules::Verdict::None) {
+            return verdict == CIgnoreRules::Verdict::Ignore;
+        }
+    }
+
+    return false;
+}
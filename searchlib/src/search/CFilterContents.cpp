@@ -1,27 +1,39 @@
 // SPDX-License-Identifier: GPL-2.0
 #include <search/CFilterContents.hpp>
 
+#include <search/CArchive.hpp>
+#include <search/CContentStream.hpp>
+#include <search/CSearchStats.hpp>
 #include <search/CStreamSearcher.hpp>
 #include <search/CStreamRegexSearcher.hpp>
+#include <search/CVerdictCache.hpp>
 
 #include <codecvt>
-#include <fstream>
 #include <locale>
 #include <stdexcept>
 
 CFilterContents::CFilterContents(std::wstring const &matchText,
                 bool const caseInsensitive,
                 bool const wholeMatch,
-                bool const isRegex)
-    : m_isCaseInsensitive(caseInsensitive),
+                bool const isRegex,
+                size_t const maxEdits)
+    : m_fuzzySearcher(nullptr),
+    m_matchText(matchText),
+    m_isCaseInsensitive(caseInsensitive),
     m_isWholeMatch(wholeMatch),
-    m_isRegex(isRegex)
+    m_isRegex(isRegex),
+    m_maxEdits(isRegex ? 0 : maxEdits)
 {
     if(m_isRegex) {
         m_streamSearcher = new CStreamRegexSearcher(matchText, caseInsensitive, wholeMatch);
+    } else if(m_maxEdits > 0) {
+        m_fuzzySearcher = new CStreamFuzzySearcher(matchText, m_maxEdits, caseInsensitive, wholeMatch);
+        m_streamSearcher = m_fuzzySearcher;
     } else {
         m_streamSearcher = new CStreamSearcher(matchText, caseInsensitive, wholeMatch);
     }
+
+    m_fingerprint = CVerdictCache::fingerprint(getKey());
 }
 
 CFilterContents::~CFilterContents() {
@@ -29,11 +41,55 @@ CFilterContents::~CFilterContents() {
 }
 
 bool CFilterContents::filterFile(std::filesystem::path const &filePath) const {
-    std::wifstream fileStream(filePath);
+    // ASCII files are searched without decoding them into wide
+    // characters, which saves the conversion and most of the memory.
+    // Members of tar archives are not: if a member turned out to need
+    // decoding, opening it again would read the archive from the start.
+    if(m_streamSearcher->canSearchBytes() && !CArchive::isSequentialMember(filePath)) {
+        CStageTimer openTimer(CSearchStats::Stage::Open);
+        CContentByteStream byteStream(filePath);
+        openTimer.stop();
+
+        IStreamSearcher::ByteResult const result = m_streamSearcher->searchBytes(byteStream);
+
+        if(result != IStreamSearcher::ByteResult::NeedsDecoding) {
+            return result == IStreamSearcher::ByteResult::Match;
+        }
+    }
+
+    CStageTimer openTimer(CSearchStats::Stage::Open);
+    CContentStream fileStream(filePath);
+    openTimer.stop();
 
     return m_streamSearcher->searchText(fileStream);
 }
 
+size_t CFilterContents::findBestDistance(std::filesystem::path const &filePath) const {
+    CStageTimer openTimer(CSearchStats::Stage::Open);
+    CContentStream fileStream(filePath);
+    openTimer.stop();
+
+    if(m_fuzzySearcher) {
+        return m_fuzzySearcher->findBestDistance(fileStream);
+    }
+    return m_streamSearcher->searchText(fileStream) ? 0 : CFuzzyMatcher::NO_MATCH;
+}
+
+bool CFilterContents::filterBuffer(wchar_t const *text, size_t const size) const {
+    return m_streamSearcher->searchBuffer(text, size);
+}
+
+void CFilterContents::findMatches(wchar_t const *text,
+                                  size_t const size,
+                                  size_t const maxMatches,
+                                  std::vector<std::pair<size_t, size_t>> &matches) const {
+    m_streamSearcher->findMatches(text, size, maxMatches, matches);
+}
+
+void CFilterContents::setMaxBufferSize(size_t const maxBufferChars) {
+    m_streamSearcher->setMaxBufferSize(maxBufferChars);
+}
+
 std::wstring CFilterContents::getText() const {
     std::wstringstream wss;
 
@@ -46,6 +102,8 @@ std::wstring CFilterContents::getText() const {
     static std::wstring const TXTCONST_CASE_INSENSITIVE = L"case insensitive";
     static std::wstring const TXTCONST_REGEX_MODE = L"use regex";
     static std::wstring const TXTCONST_CHARACTERS = L"characters";
+    static std::wstring const TXTCONST_EDIT = L"edit";
+    static std::wstring const TXTCONST_EDITS = L"edits";
 
     // Now we build a string using the text constants.
     // Example: L"Name matches <quoted match string> (regex mode)"
@@ -58,6 +116,24 @@ std::wstring CFilterContents::getText() const {
     } else {
         wss << (m_isCaseInsensitive ? TXTCONST_CASE_INSENSITIVE : TXTCONST_CASE_SENSITIVE);
     }
+    if(m_maxEdits > 0) {
+        wss << L", " << m_maxEdits << L" " << (m_maxEdits == 1 ? TXTCONST_EDIT : TXTCONST_EDITS);
+    }
     wss << L")";
     return wss.str();
-}
\ No newline at end of file
+}
+
+std::wstring CFilterContents::getKey() const {
+    std::wstring flags;
+    flags += m_isRegex ? L'r' : L'l';
+    flags += m_isCaseInsensitive ? L'i' : L'c';
+    flags += m_isWholeMatch ? L'w' : L'p';
+
+    // Exact searches keep the keys they had before approximate ones
+    // existed, so that cached verdicts stay valid.
+    if(m_maxEdits > 0) {
+        flags += std::to_wstring(m_maxEdits);
+    }
+
+    return makeKey(L"content", flags, m_matchText);
+}
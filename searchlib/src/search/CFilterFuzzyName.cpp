@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CFilterFuzzyName.hpp>
+
+#include <sstream>
+
+CFilterFuzzyName::CFilterFuzzyName(std::wstring const &matchText,
+                                   size_t const maxEdits,
+                                   bool const caseInsensitive,
+                                   bool const wholeMatch)
+    : m_matcher(matchText, caseInsensitive, wholeMatch),
+      m_matchText(matchText),
+      m_maxEdits(maxEdits),
+      m_isCaseInsensitive(caseInsensitive),
+      m_isWholeMatch(wholeMatch)
+{
+    // nothing to do
+}
+
+bool CFilterFuzzyName::filterFile(std::filesystem::path const &filePath) const {
+    std::wstring const name = filePath.filename().wstring();
+    return m_matcher.getDistance(name, m_maxEdits) != CFuzzyMatcher::NO_MATCH;
+}
+
+double CFilterFuzzyName::getSimilarity(std::filesystem::path const &filePath) const {
+    std::wstring const name = filePath.filename().wstring();
+    size_t const distance = m_matcher.getDistance(name, m_maxEdits);
+
+    if(distance == CFuzzyMatcher::NO_MATCH) {
+        return 0.0;
+    }
+    return m_matcher.getSimilarity(distance, name.size());
+}
+
+std::wstring CFilterFuzzyName::getText() const {
+    std::wstringstream wss;
+
+    // TODO: Add localization support.
+    static std::wstring const TXTCONST_NAME_RESEMBLES = L"Name resembles";
+    static std::wstring const TXTCONST_NAME_CONTAINS = L"Name contains about";
+    static std::wstring const TXTCONST_CASE_SENSITIVE = L"case sensitive";
+    static std::wstring const TXTCONST_CASE_INSENSITIVE = L"case insensitive";
+
+    // Example: L"Name resembles (at most 2 edits, case insensitive)"
+    wss << (m_isWholeMatch ? TXTCONST_NAME_RESEMBLES : TXTCONST_NAME_CONTAINS);
+    wss << L" (at most " << m_maxEdits << (m_maxEdits == 1 ? L" edit, " : L" edits, ");
+    wss << (m_isCaseInsensitive ? TXTCONST_CASE_INSENSITIVE : TXTCONST_CASE_SENSITIVE);
+    wss << L")";
+    return wss.str();
+}
+
+std::wstring CFilterFuzzyName::getKey() const {
+    std::wstring flags;
+    flags += m_isCaseInsensitive ? L'i' : L'c';
+    flags += m_isWholeMatch ? L'w' : L'p';
+    flags += std::to_wstring(m_maxEdits);
+
+    return makeKey(L"fuzzyname", flags, m_matchText);
+}
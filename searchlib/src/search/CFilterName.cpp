@@ -10,7 +10,8 @@ CFilterName::CFilterName(std::wstring const &matchText,
                 bool const caseInsensitive,
                 bool const wholeMatch,
                 bool const isRegex)
-    : m_isCaseInsensitive(caseInsensitive),
+    : m_matchText(matchText),
+    m_isCaseInsensitive(caseInsensitive),
     m_isWholeMatch(wholeMatch),
     m_isRegex(isRegex)
 {
@@ -45,13 +46,22 @@ std::wstring CFilterName::getText() const {
     // Now we build a string using the text constants.
     // Example: L"Name matches (regex mode)"
     //       or L"Name contains (case insensitive)"
-    wss << m_isWholeMatch ? TXTCONST_NAME_MATCHES : TXTCONST_NAME_CONTAINS;
+    wss << (m_isWholeMatch ? TXTCONST_NAME_MATCHES : TXTCONST_NAME_CONTAINS);
     wss << L" (";
     if(m_isRegex) {
         wss << TXTCONST_REGEX_MODE;
     } else {
-        wss << m_isCaseInsensitive ? TXTCONST_CASE_INSENSITIVE : TXTCONST_CASE_SENSITIVE;
+        wss << (m_isCaseInsensitive ? TXTCONST_CASE_INSENSITIVE : TXTCONST_CASE_SENSITIVE);
     }
     wss << L")";
     return wss.str();
-}
\ No newline at end of file
+}
+
+std::wstring CFilterName::getKey() const {
+    std::wstring flags;
+    flags += m_isRegex ? L'r' : L'l';
+    flags += m_isCaseInsensitive ? L'i' : L'c';
+    flags += m_isWholeMatch ? L'w' : L'p';
+
+    return makeKey(L"name", flags, m_matchText);
+}
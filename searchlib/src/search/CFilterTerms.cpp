@@ -0,0 +1,383 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CFilterTerms.hpp>
+
+#include <StringUtil.hpp>
+#include <search/CContentStream.hpp>
+#include <search/CScanBuffer.hpp>
+#include <search/CSearchStats.hpp>
+
+#include <algorithm>
+#include <cwctype>
+#include <sstream>
+#include <stdexcept>
+
+#define DEFAULT_MAX_BUFFER_CHARS 1000000
+
+// Marks a term which has not occurred yet
+#define NO_POSITION static_cast<size_t>(-1)
+
+struct CQueryToken {
+    std::wstring text;
+    bool isQuoted;
+};
+
+static std::vector<CQueryToken> tokenize(std::wstring const &query) {
+    std::vector<CQueryToken> tokens;
+    size_t pos = 0;
+
+    while(pos < query.size()) {
+        if(std::iswspace(query[pos])) {
+            ++pos;
+            continue;
+        }
+
+        if(query[pos] == L'"') {
+            size_t const close = query.find(L'"', pos + 1);
+
+            if(close == std::wstring::npos) {
+                throw std::invalid_argument("unterminated quote in term query");
+            }
+            if(close == pos + 1) {
+                throw std::invalid_argument("empty term in term query");
+            }
+
+            tokens.push_back({ query.substr(pos + 1, close - pos - 1), true });
+            pos = close + 1;
+            continue;
+        }
+
+        size_t end = pos;
+        while(end < query.size() && !std::iswspace(query[end])) {
+            ++end;
+        }
+
+        tokens.push_back({ query.substr(pos, end - pos), false });
+        pos = end;
+    }
+
+    return tokens;
+}
+
+static bool isOperator(CQueryToken const &token, wchar_t const *name) {
+    return !token.isQuoted && token.text == name;
+}
+
+/**
+ * @brief Parse a NEAR/N operator.
+ *
+ * @return true if the token is one, with N in maxGap
+ */
+static bool parseNear(CQueryToken const &token, size_t &maxGap) {
+    static std::wstring const PREFIX = L"NEAR/";
+
+    if(token.isQuoted || token.text.compare(0, PREFIX.size(), PREFIX) != 0) {
+        return false;
+    }
+
+    std::wstring const digits = token.text.substr(PREFIX.size());
+
+    if(digits.empty() || digits.find_first_not_of(L"0123456789") != std::wstring::npos) {
+        throw std::invalid_argument("NEAR needs a number of characters, as in NEAR/200");
+    }
+
+    try {
+        maxGap = static_cast<size_t>(std::stoull(digits));
+    } catch(std::out_of_range const &) {
+        throw std::invalid_argument("NEAR distance out of range");
+    }
+    return true;
+}
+
+static bool isAnyOperator(CQueryToken const &token) {
+    size_t maxGap = 0;
+    return isOperator(token, L"AND") || isOperator(token, L"NOT") || parseNear(token, maxGap);
+}
+
+/**
+ * @brief State of evaluating the query over one file.
+ */
+class CFilterTerms::CEvaluation {
+public:
+    explicit CEvaluation(CFilterTerms const &filter)
+        : m_filter(filter),
+          m_state(CTermAutomaton::START),
+          m_position(0),
+          m_isSeen(filter.m_terms.size(), false),
+          m_lastEnd(filter.m_terms.size(), NO_POSITION),
+          m_isNear(filter.m_proximities.size(), false),
+          m_requiredSeen(0),
+          m_proximitiesSeen(0),
+          m_isDecided(false),
+          m_result(false)
+    {
+        checkDecided();
+    }
+
+    /**
+     * @brief Feed the next chunk of the file.
+     *
+     * @return true once the outcome is certain
+     */
+    bool feed(wchar_t const *text, size_t const size) {
+        CTermAutomaton const &automaton = *m_filter.m_automaton;
+        CTermAutomaton::State state = m_state;
+
+        for(size_t i = 0; i < size && !m_isDecided; ++i) {
+            state = automaton.next(state, text[i]);
+
+            if(automaton.hasOutputs(state)) {
+                for(std::uint32_t const *term = automaton.outputsBegin(state); term != automaton.outputsEnd(state); ++term) {
+                    onTerm(*term, m_position + i + 1);
+                }
+                checkDecided();
+            }
+        }
+
+        m_state = state;
+        m_position += size;
+        return m_isDecided;
+    }
+
+    /**
+     * @brief Get the outcome once the whole file was fed, or once it was
+     * decided earlier.
+     */
+    bool getResult() const {
+        if(m_isDecided) {
+            return m_result;
+        }
+
+        // No excluded term occurred, or the outcome would be decided.
+        return m_requiredSeen == m_filter.m_requiredCount
+            && m_proximitiesSeen == m_filter.m_proximities.size();
+    }
+
+private:
+    void onTerm(std::uint32_t const term, size_t const end) {
+        if(m_filter.m_isExcluded[term]) {
+            m_isDecided = true;
+            m_result = false;
+            return;
+        }
+
+        if(!m_isSeen[term]) {
+            m_isSeen[term] = true;
+            if(m_filter.m_isRequired[term]) {
+                ++m_requiredSeen;
+            }
+        }
+
+        // The latest occurrence of the other term is the closest one
+        // before this occurrence, which ends last.
+        size_t const start = end - m_filter.m_terms[term].size();
+
+        for(std::uint32_t const index : m_filter.m_termProximities[term]) {
+            CProximity const &proximity = m_filter.m_proximities[index];
+            std::uint32_t const other = proximity.first == term ? proximity.second : proximity.first;
+            size_t const otherEnd = m_lastEnd[other];
+
+            if(m_isNear[index] || otherEnd == NO_POSITION) {
+                continue;
+            }
+
+            size_t const gap = start > otherEnd ? start - otherEnd : 0;
+
+            if(gap <= proximity.maxGap) {
+                m_isNear[index] = true;
+                ++m_proximitiesSeen;
+            }
+        }
+
+        m_lastEnd[term] = end;
+    }
+
+    void checkDecided() {
+        // With excluded terms, only the end of the file proves a match.
+        if(!m_isDecided && !m_filter.m_hasExcluded
+           && m_requiredSeen == m_filter.m_requiredCount
+           && m_proximitiesSeen == m_filter.m_proximities.size()) {
+            m_isDecided = true;
+            m_result = true;
+        }
+    }
+
+    CFilterTerms const &m_filter;
+    CTermAutomaton::State m_state;
+    size_t m_position;
+    std::vector<bool> m_isSeen;
+    std::vector<size_t> m_lastEnd;
+    std::vector<bool> m_isNear;
+    size_t m_requiredSeen;
+    size_t m_proximitiesSeen;
+    bool m_isDecided;
+    bool m_result;
+};
+
+CFilterTerms::CFilterTerms(std::wstring const &query, bool const caseInsensitive)
+    : m_query(query),
+      m_isCaseInsensitive(caseInsensitive),
+      m_maxBufferSize(DEFAULT_MAX_BUFFER_CHARS),
+      m_requiredCount(0),
+      m_hasExcluded(false),
+      m_automaton(nullptr)
+{
+    parse();
+    m_automaton = new CTermAutomaton(m_terms, m_isCaseInsensitive);
+}
+
+CFilterTerms::~CFilterTerms() {
+    delete m_automaton;
+}
+
+void CFilterTerms::parse() {
+    std::vector<CQueryToken> const tokens = tokenize(m_query);
+
+    if(tokens.empty()) {
+        throw std::invalid_argument("empty term query");
+    }
+
+    auto const isTerm = [&](size_t const i) { return i < tokens.size() && !isAnyOperator(tokens[i]); };
+
+    // Whether the previous token completed a clause, so that AND may follow
+    bool hasClause = false;
+    size_t i = 0;
+
+    while(i < tokens.size()) {
+        size_t maxGap = 0;
+
+        if(isOperator(tokens[i], L"AND")) {
+            bool const hasNext = isTerm(i + 1) || (i + 1 < tokens.size() && isOperator(tokens[i + 1], L"NOT"));
+
+            if(!hasClause || !hasNext) {
+                throw std::invalid_argument("AND needs a term on both sides");
+            }
+            hasClause = false;
+            ++i;
+        } else if(isOperator(tokens[i], L"NOT")) {
+            if(!isTerm(i + 1)) {
+                throw std::invalid_argument("NOT needs a term after it");
+            }
+            addTerm(tokens[i + 1].text, true);
+            hasClause = true;
+            i += 2;
+        } else if(parseNear(tokens[i], maxGap)) {
+            throw std::invalid_argument("NEAR needs a term on both sides");
+        } else {
+            std::uint32_t term = addTerm(tokens[i].text, false);
+            ++i;
+
+            while(i < tokens.size() && parseNear(tokens[i], maxGap)) {
+                if(!isTerm(i + 1)) {
+                    throw std::invalid_argument("NEAR needs a term on both sides");
+                }
+
+                std::uint32_t const next = addTerm(tokens[i + 1].text, false);
+                auto const index = static_cast<std::uint32_t>(m_proximities.size());
+
+                m_proximities.push_back({ term, next, maxGap });
+                m_termProximities[term].push_back(index);
+                if(next != term) {
+                    m_termProximities[next].push_back(index);
+                }
+
+                term = next;
+                i += 2;
+            }
+
+            hasClause = true;
+        }
+    }
+}
+
+std::uint32_t CFilterTerms::addTerm(std::wstring const &term, bool const isExcluded) {
+    // Terms are told apart the way the automaton compares them.
+    std::wstring const key = m_isCaseInsensitive ? wlower(term) : term;
+
+    std::uint32_t index = 0;
+    while(index < m_terms.size() && m_terms[index] != key) {
+        ++index;
+    }
+
+    if(index == m_terms.size()) {
+        m_terms.push_back(key);
+        m_isRequired.push_back(false);
+        m_isExcluded.push_back(false);
+        m_termProximities.emplace_back();
+    }
+
+    if(isExcluded) {
+        m_isExcluded[index] = true;
+        m_hasExcluded = true;
+    } else if(!m_isRequired[index]) {
+        m_isRequired[index] = true;
+        ++m_requiredCount;
+    }
+
+    return index;
+}
+
+bool CFilterTerms::filterFile(std::filesystem::path const &filePath) const {
+    CStageTimer openTimer(CSearchStats::Stage::Open);
+    CContentStream fileStream(filePath);
+    openTimer.stop();
+
+    if(!fileStream.good()) {
+        return false;
+    }
+
+    // The automaton carries its state from one chunk to the next, so
+    // chunks need not overlap.
+    static thread_local CScanBuffer scanBuffer;
+    size_t const bufferLen = std::max<size_t>(m_maxBufferSize, 1);
+    wchar_t *const buffer = scanBuffer.reserve(bufferLen);
+
+    CEvaluation evaluation(*this);
+    bool isDecided = false;
+
+    while(!isDecided && fileStream.good()) {
+        CStageTimer readTimer(CSearchStats::Stage::Read);
+        fileStream.read(buffer, bufferLen);
+        size_t const charsRead = fileStream.gcount();
+        readTimer.addAmount(charsRead);
+        readTimer.stop();
+
+        if(charsRead == 0) {
+            break;
+        }
+
+        CStageTimer const matchTimer(CSearchStats::Stage::Match);
+        isDecided = evaluation.feed(buffer, charsRead);
+    }
+
+    return evaluation.getResult();
+}
+
+bool CFilterTerms::filterBuffer(wchar_t const *text, size_t const size) const {
+    CEvaluation evaluation(*this);
+    evaluation.feed(text, size);
+    return evaluation.getResult();
+}
+
+void CFilterTerms::setMaxBufferSize(size_t const maxBufferChars) {
+    m_maxBufferSize = maxBufferChars;
+}
+
+std::wstring CFilterTerms::getText() const {
+    std::wstringstream wss;
+
+    // TODO: Add localization support.
+    static std::wstring const TXTCONST_MATCHES_QUERY = L"File contents match term query";
+    static std::wstring const TXTCONST_CASE_SENSITIVE = L"case sensitive";
+    static std::wstring const TXTCONST_CASE_INSENSITIVE = L"case insensitive";
+    static std::wstring const TXTCONST_TERMS = L"terms";
+
+    // Example: L"File contents match term query (3 terms, case insensitive)"
+    wss << TXTCONST_MATCHES_QUERY << L" (" << m_terms.size() << L" " << TXTCONST_TERMS << L", ";
+    wss << (m_isCaseInsensitive ? TXTCONST_CASE_INSENSITIVE : TXTCONST_CASE_SENSITIVE);
+    wss << L")";
+    return wss.str();
+}
+
+std::wstring CFilterTerms::getKey() const {
+    return makeKey(L"terms", m_isCaseInsensitive ? L"i" : L"c", m_query);
+}
@@ -0,0 +1,257 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CFuzzyMatcher.hpp>
+
+#include <StringUtil.hpp>
+
+#include <algorithm>
+#include <cwctype>
+#include <type_traits>
+
+#define WORD_BITS 64
+
+/**
+ * @brief Advance one 64-row block of the edit distance matrix by one text
+ * character, in the bit-vector form of Myers' algorithm.
+ *
+ * pv and mv hold the block's vertical deltas (+1 and -1) of the current
+ * column, eq the positions where the pattern has the text character. hin
+ * is the horizontal delta entering the block at its top, -1, 0 or +1.
+ *
+ * @return the horizontal delta leaving the block at the row of lastBit
+ */
+static inline int advanceBlock(std::uint64_t &pv, std::uint64_t &mv, std::uint64_t eq,
+                               int const hin, std::uint64_t const lastBit) {
+    std::uint64_t const hinIsNegative = static_cast<std::uint64_t>(hin < 0);
+    std::uint64_t const xv = eq | mv;
+    eq |= hinIsNegative;
+    std::uint64_t const xh = (((eq & pv) + pv) ^ pv) | eq;
+    std::uint64_t ph = mv | ~(xh | pv);
+    std::uint64_t mh = pv & xh;
+
+    // Without branches, which random text would keep mispredicting
+    int const hout = static_cast<int>((ph & lastBit) != 0) - static_cast<int>((mh & lastBit) != 0);
+
+    ph = (ph << 1) | static_cast<std::uint64_t>(hin > 0);
+    mh = (mh << 1) | hinIsNegative;
+    pv = mh | ~(xv | ph);
+    mv = ph & xv;
+    return hout;
+}
+
+static size_t absoluteDifference(size_t const a, size_t const b) {
+    return a > b ? a - b : b - a;
+}
+
+CFuzzyMatcher::CFuzzyMatcher(std::wstring const &pattern, bool const caseInsensitive, bool const wholeMatch)
+    : m_isCaseInsensitive(caseInsensitive),
+      m_isWholeMatch(wholeMatch)
+{
+    m_pattern = m_isCaseInsensitive ? wlower(pattern) : pattern;
+    m_blockCount = std::max<size_t>(1, (m_pattern.size() + WORD_BITS - 1) / WORD_BITS);
+
+    // The direct rows and the zero row.
+    m_masks.assign((DIRECT_CHARS + 1) * m_blockCount, 0);
+
+    for(size_t i = 0; i < m_pattern.size(); ++i) {
+        wchar_t const c = m_pattern[i];
+        size_t row = static_cast<size_t>(c);
+
+        if(static_cast<std::make_unsigned_t<wchar_t>>(c) >= DIRECT_CHARS) {
+            auto const it = m_otherRows.find(c);
+
+            if(it != m_otherRows.end()) {
+                row = it->second;
+            } else {
+                row = m_masks.size() / m_blockCount;
+                m_masks.resize(m_masks.size() + m_blockCount, 0);
+                m_otherRows.emplace(c, row);
+            }
+        }
+
+        m_masks[row * m_blockCount + i / WORD_BITS] |= Word(1) << (i % WORD_BITS);
+    }
+
+    // Uppercase characters of the direct range share the masks of their
+    // lowercase versions, which spares matching the case folding of most
+    // characters.
+    if(m_isCaseInsensitive) {
+        for(size_t c = 0; c < DIRECT_CHARS; ++c) {
+            size_t const lower = static_cast<size_t>(std::towlower(static_cast<wint_t>(c)));
+
+            if(lower != c && lower < DIRECT_CHARS) {
+                std::copy_n(&m_masks[lower * m_blockCount], m_blockCount, &m_masks[c * m_blockCount]);
+            }
+        }
+    }
+}
+
+CFuzzyMatcher::Word const *CFuzzyMatcher::getMasks(wchar_t const c) const {
+    if(static_cast<std::make_unsigned_t<wchar_t>>(c) < DIRECT_CHARS) {
+        return &m_masks[static_cast<size_t>(c) * m_blockCount];
+    }
+
+    wchar_t const folded = m_isCaseInsensitive ? static_cast<wchar_t>(std::towlower(c)) : c;
+    auto const it = m_otherRows.find(folded);
+    size_t const row = it != m_otherRows.end() ? it->second : DIRECT_CHARS;
+    return &m_masks[row * m_blockCount];
+}
+
+size_t CFuzzyMatcher::getDistance(wchar_t const *text, size_t const length, size_t const maxDistance) const {
+    size_t const patternLength = m_pattern.size();
+
+    // Every edit changes the length by at most one, and a substring
+    // shorter than the pattern needs an insertion per missing character.
+    if(m_isWholeMatch ? absoluteDifference(length, patternLength) > maxDistance
+                      : length < patternLength && patternLength - length > maxDistance) {
+        return NO_MATCH;
+    }
+
+    if(patternLength == 0) {
+        return m_isWholeMatch ? length : 0;
+    }
+
+    if(m_blockCount == 1) {
+        return getDistanceSingleBlock(text, length, maxDistance);
+    }
+
+    CScan scan;
+    beginScan(scan, maxDistance, 0);
+    continueScan(scan, text, length);
+    return finishScan(scan);
+}
+
+size_t CFuzzyMatcher::getDistanceSingleBlock(wchar_t const *text, size_t const length, size_t const maxDistance) const {
+    Word const lastBit = Word(1) << (m_pattern.size() - 1);
+
+    // A whole match starts from the distances of the empty text (0, 1, 2,
+    // ... down the column) and pays for every text character skipped
+    // before the pattern; a partial match may start anywhere for free.
+    int const hin = m_isWholeMatch ? 1 : 0;
+
+    Word pv = ~Word(0);
+    Word mv = 0;
+    size_t score = m_pattern.size();
+    size_t best = score;
+
+    for(size_t j = 0; j < length; ++j) {
+        int const hout = advanceBlock(pv, mv, getMasks(text[j])[0], hin, lastBit);
+        score += hout;
+
+        if(m_isWholeMatch) {
+            // The distance drops by at most one per remaining character.
+            size_t const remaining = length - j - 1;
+            if(score > remaining && score - remaining > maxDistance) {
+                return NO_MATCH;
+            }
+        } else if(score < best) {
+            best = score;
+            if(best == 0) {
+                break;
+            }
+        }
+    }
+
+    size_t const distance = m_isWholeMatch ? score : best;
+    return distance <= maxDistance ? distance : NO_MATCH;
+}
+
+void CFuzzyMatcher::beginScan(CScan &scan, size_t const maxDistance, size_t const stopDistance) const {
+    scan.m_pv.assign(m_blockCount, ~Word(0));
+    scan.m_mv.assign(m_blockCount, 0);
+    scan.m_score = m_pattern.size();
+    scan.m_best = scan.m_score;
+    scan.m_bestEnd = 0;
+    scan.m_position = 0;
+    scan.m_maxDistance = maxDistance;
+    scan.m_stopDistance = stopDistance;
+
+    // Deleting the whole pattern may already be good enough.
+    scan.m_isDecided = !m_isWholeMatch && stopDistance != NO_MATCH && scan.m_best <= stopDistance;
+}
+
+void CFuzzyMatcher::continueScan(CScan &scan, wchar_t const *text, size_t const length) const {
+    if(scan.m_isDecided) {
+        return;
+    }
+
+    size_t const patternLength = m_pattern.size();
+
+    if(patternLength == 0) {
+        // Only a whole match gets here; every character is an insertion.
+        scan.m_position += length;
+        scan.m_score = scan.m_position;
+        scan.m_isDecided = scan.m_position > scan.m_maxDistance;
+        return;
+    }
+
+    Word const lastBit = Word(1) << ((patternLength - 1) % WORD_BITS);
+    Word const highBit = Word(1) << (WORD_BITS - 1);
+    int const hin = m_isWholeMatch ? 1 : 0;
+    size_t const lastBlock = m_blockCount - 1;
+
+    // A partial match is decided once its best distance falls below
+    // stopBelow. A whole match cannot come back once the text is longer
+    // than the pattern by more than the maximum distance.
+    size_t const stopBelow = scan.m_stopDistance == NO_MATCH ? 0 : scan.m_stopDistance + 1;
+    size_t const stopAfter = scan.m_maxDistance > NO_MATCH - patternLength ? NO_MATCH
+                                                                           : patternLength + scan.m_maxDistance;
+
+    // The state lives in locals while scanning, and the single block of
+    // short patterns in registers.
+    Word *const pv = scan.m_pv.data();
+    Word *const mv = scan.m_mv.data();
+    Word pvLast = pv[lastBlock];
+    Word mvLast = mv[lastBlock];
+    size_t score = scan.m_score;
+    size_t best = scan.m_best;
+    size_t bestEnd = scan.m_bestEnd;
+    size_t position = scan.m_position;
+    bool isDecided = false;
+
+    for(size_t j = 0; j < length; ++j) {
+        Word const *masks = getMasks(text[j]);
+        int carry = hin;
+
+        for(size_t b = 0; b < lastBlock; ++b) {
+            carry = advanceBlock(pv[b], mv[b], masks[b], carry, highBit);
+        }
+        carry = advanceBlock(pvLast, mvLast, masks[lastBlock], carry, lastBit);
+
+        score += carry;
+        ++position;
+
+        // Partial matches remember the first substring with the best
+        // distance, whole matches the longest prefix.
+        if(score < best || (m_isWholeMatch && score == best)) {
+            best = score;
+            bestEnd = position;
+        }
+
+        if(m_isWholeMatch ? position > stopAfter : best < stopBelow) {
+            isDecided = true;
+            break;
+        }
+    }
+
+    pv[lastBlock] = pvLast;
+    mv[lastBlock] = mvLast;
+    scan.m_score = score;
+    scan.m_best = best;
+    scan.m_bestEnd = bestEnd;
+    scan.m_position = position;
+    scan.m_isDecided = isDecided;
+}
+
+size_t CFuzzyMatcher::finishScan(CScan const &scan) const {
+    size_t const distance = m_isWholeMatch ? scan.m_score : scan.m_best;
+    return distance <= scan.m_maxDistance ? distance : NO_MATCH;
+}
+
+double CFuzzyMatcher::getSimilarity(size_t const distance, size_t const textLength) const {
+    size_t const length = m_isWholeMatch ? std::max(m_pattern.size(), textLength) : m_pattern.size();
+
+    if(length == 0 || distance >= length) {
+        return length == 0 ? 1.0 : 0.0;
+    }
+    return 1.0 - static_cast<double>(distance) / static_cast<double>(length);
+}
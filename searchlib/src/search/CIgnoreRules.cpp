@@ -0,0 +1,350 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CIgnoreRules.hpp>
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+/**
+ * @brief Match a bracket expression such as "[a-z]" or "[!0-9]".
+ *
+ * @param p points at the opening '['; on success it is advanced past
+ *        the closing ']'
+ * @return 1 if c is in the class, 0 if it is not, -1 if the bracket
+ *         expression is not terminated (and '[' should be taken literally)
+ */
+static int matchCharClass(char const *&p, char const *pEnd, char const c) {
+    char const *q = p + 1;
+    bool negate = false;
+
+    if(q < pEnd && (*q == '!' || *q == '^')) {
+        negate = true;
+        q++;
+    }
+
+    bool matched = false;
+    bool first = true;
+
+    while(q < pEnd && (first || *q != ']')) {
+        first = false;
+        char lo = *q;
+
+        if(lo == '\\' && q + 1 < pEnd) {
+            lo = *++q;
+        }
+
+        char hi = lo;
+
+        if(q + 2 < pEnd && q[1] == '-' && q[2] != ']') {
+            hi = q[2];
+            q += 2;
+        }
+
+        if(c >= lo && c <= hi) {
+            matched = true;
+        }
+
+        q++;
+    }
+
+    if(q >= pEnd) {
+        return -1;
+    }
+
+    p = q + 1;
+    return matched != negate ? 1 : 0;
+}
+
+static bool globMatchImpl(char const *pBegin, char const *p, char const *pEnd,
+                          char const *t, char const *tEnd) {
+    while(p < pEnd) {
+        char const pc = *p;
+
+        if(pc == '*') {
+            char const *q = p;
+            while(q < pEnd && *q == '*') {
+                q++;
+            }
+
+            bool const isDoubleStar = (q - p) >= 2;
+            bool const atComponentStart = (p == pBegin || p[-1] == '/');
+            bool const atComponentEnd = (q == pEnd || *q == '/');
+
+            if(isDoubleStar && atComponentStart && atComponentEnd) {
+                // "**" as a whole component matches any number of
+                // directories, including none.
+                if(q == pEnd) {
+                    return true;
+                }
+
+                q++;
+                char const *s = t;
+                while(true) {
+                    if(globMatchImpl(pBegin, q, pEnd, s, tEnd)) {
+                        return true;
+                    }
+
+                    while(s < tEnd && *s != '/') {
+                        s++;
+                    }
+
+                    if(s == tEnd) {
+                        return false;
+                    }
+
+                    s++;
+                }
+            }
+
+            // A plain '*' matches any run of characters within one
+            // path component.
+            for(char const *s = t; ; ++s) {
+                if(globMatchImpl(pBegin, q, pEnd, s, tEnd)) {
+                    return true;
+                }
+
+                if(s == tEnd || *s == '/') {
+                    return false;
+                }
+            }
+        }
+
+        if(t == tEnd) {
+            return false;
+        }
+
+        if(pc == '?') {
+            if(*t == '/') {
+                return false;
+            }
+            p++;
+            t++;
+            continue;
+        }
+
+        if(pc == '[') {
+            if(*t == '/') {
+                return false;
+            }
+
+            int const classResult = matchCharClass(p, pEnd, *t);
+
+            if(classResult == 0) {
+                return false;
+            }
+
+            if(classResult == 1) {
+                t++;
+                continue;
+            }
+
+            // Unterminated class: fall through and treat '[' literally.
+        }
+
+        char literal = pc;
+
+        if(pc == '\\' && p + 1 < pEnd) {
+            literal = *++p;
+        }
+
+        if(literal != *t) {
+            return false;
+        }
+
+        p++;
+        t++;
+    }
+
+    return t == tEnd;
+}
+
+bool globMatch(std::string const &pattern, std::string const &text) {
+    char const *p = pattern.data();
+    char const *t = text.data();
+    return globMatchImpl(p, p, p + pattern.size(), t, t + text.size());
+}
+
+static bool hasGlobChars(std::string const &text, size_t const begin, size_t const end) {
+    for(size_t i = begin; i < end; ++i) {
+        char const c = text[i];
+        if(c == '*' || c == '?' || c == '[' || c == '\\') {
+            return true;
+        }
+    }
+    return false;
+}
+
+void CIgnoreRules::addRules(std::string const &text) {
+    std::istringstream iss(text);
+    std::string line;
+
+    while(std::getline(iss, line)) {
+        compileLine(std::move(line));
+    }
+}
+
+bool CIgnoreRules::addRulesFromFile(std::filesystem::path const &filePath) {
+    std::ifstream file(filePath, std::ios::binary);
+
+    if(!file.good()) {
+        return false;
+    }
+
+    std::string text{ std::istreambuf_iterator<char>(file),
+                      std::istreambuf_iterator<char>() };
+    addRules(text);
+    return true;
+}
+
+void CIgnoreRules::compileLine(std::string line) {
+    if(!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+
+    if(line.empty() || line[0] == '#') {
+        return;
+    }
+
+    // Trailing spaces are ignored unless they are escaped with a backslash.
+    while(!line.empty() && line.back() == ' ') {
+        if(line.size() >= 2 && line[line.size() - 2] == '\\') {
+            line.erase(line.size() - 2, 1);
+            break;
+        }
+        line.pop_back();
+    }
+
+    CRule rule;
+    rule.isNegated = false;
+    rule.isDirectoryOnly = false;
+    rule.isAnchored = false;
+
+    if(!line.empty() && line[0] == '!') {
+        rule.isNegated = true;
+        line.erase(0, 1);
+    } else if(line.size() >= 2 && line[0] == '\\' && (line[1] == '!' || line[1] == '#')) {
+        line.erase(0, 1);
+    }
+
+    while(!line.empty() && line.back() == '/') {
+        rule.isDirectoryOnly = true;
+        line.pop_back();
+    }
+
+    if(line.empty()) {
+        return;
+    }
+
+    if(line.find('/') != std::string::npos) {
+        rule.isAnchored = true;
+
+        if(line[0] == '/') {
+            line.erase(0, 1);
+        }
+    }
+
+    // Classify the rule so that match() can take a fast path for the
+    // most common rule shapes.
+    if(!hasGlobChars(line, 0, line.size())) {
+        rule.kind = Kind::Literal;
+    } else if(!rule.isAnchored && line[0] == '*' && !hasGlobChars(line, 1, line.size())) {
+        rule.kind = Kind::Suffix;
+        line.erase(0, 1);
+    } else if(!rule.isAnchored && line.back() == '*' && !hasGlobChars(line, 0, line.size() - 1)) {
+        rule.kind = Kind::Prefix;
+        line.pop_back();
+    } else {
+        rule.kind = Kind::Glob;
+    }
+
+    rule.pattern = std::move(line);
+
+    size_t const index = m_rules.size();
+
+    if(rule.kind == Kind::Literal && !rule.isAnchored) {
+        if(rule.isDirectoryOnly) {
+            m_literalDirectoryRules[rule.pattern] = index;
+        } else {
+            m_literalRules[rule.pattern] = index;
+        }
+    } else {
+        m_patternRules.push_back(index);
+    }
+
+    if(rule.isAnchored) {
+        m_hasAnchoredRules = true;
+    }
+
+    m_rules.push_back(std::move(rule));
+}
+
+CIgnoreRules::Verdict CIgnoreRules::match(std::string const &relativePath,
+                                          std::string const &name,
+                                          bool const isDirectory) const {
+    // Find the highest-precedence literal rule for this name, if any.
+    size_t literalIndex = m_rules.size();
+    bool hasLiteral = false;
+
+    auto const it = m_literalRules.find(name);
+    if(it != m_literalRules.end()) {
+        literalIndex = it->second;
+        hasLiteral = true;
+    }
+
+    if(isDirectory) {
+        auto const dirIt = m_literalDirectoryRules.find(name);
+        if(dirIt != m_literalDirectoryRules.end() && (!hasLiteral || dirIt->second > literalIndex)) {
+            literalIndex = dirIt->second;
+            hasLiteral = true;
+        }
+    }
+
+    // Only pattern rules that come after the literal rule can override it,
+    // so walk them backwards and stop as soon as we pass it.
+    for(auto ruleIt = m_patternRules.rbegin(); ruleIt != m_patternRules.rend(); ++ruleIt) {
+        size_t const index = *ruleIt;
+
+        if(hasLiteral && index < literalIndex) {
+            break;
+        }
+
+        CRule const &rule = m_rules[index];
+
+        if(rule.isDirectoryOnly && !isDirectory) {
+            continue;
+        }
+
+        std::string const &subject = rule.isAnchored ? relativePath : name;
+        bool isMatch = false;
+
+        switch(rule.kind) {
+            case Kind::Literal:
+                isMatch = subject == rule.pattern;
+                break;
+
+            case Kind::Suffix:
+                isMatch = subject.size() >= rule.pattern.size() &&
+                          subject.compare(subject.size() - rule.pattern.size(),
+                                          rule.pattern.size(), rule.pattern) == 0;
+                break;
+
+            case Kind::Prefix:
+                isMatch = subject.compare(0, rule.pattern.size(), rule.pattern) == 0;
+                break;
+
+            case Kind::Glob:
+                isMatch = globMatch(rule.pattern, subject);
+                break;
+        }
+
+        if(isMatch) {
+            return rule.isNegated ? Verdict::Include : Verdict::Ignore;
+        }
+    }
+
+    if(hasLiteral) {
+        return m_rules[literalIndex].isNegated ? Verdict::Include : Verdict::Ignore;
+    }
+
+    return Verdict::None;
+}
@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CMatchLocator.hpp>
+
+#include <LineScan.hpp>
+
+#include <algorithm>
+
+CMatchLocator::CMatchLocator(size_t const maxMatches, size_t const snippetContext)
+    : m_maxMatches(maxMatches),
+      m_snippetContext(snippetContext)
+{
+    // nothing to do
+}
+
+void CMatchLocator::locate(wchar_t const *text,
+                           size_t const size,
+                           std::vector<std::pair<size_t, size_t>> ranges,
+                           std::vector<CMatchLocation> &locations) const {
+    std::sort(ranges.begin(), ranges.end());
+    ranges.erase(std::unique(ranges.begin(), ranges.end()), ranges.end());
+
+    if(ranges.size() > m_maxMatches) {
+        ranges.resize(m_maxMatches);
+    }
+
+    // Line numbers are tracked incrementally: we only count the newlines
+    // between the previous match and the current one. The start of the
+    // current line is tracked the same way, so no scan ever goes back
+    // further than the previous match.
+    size_t lineNumber = 1;
+    size_t lineStart = 0;
+    size_t countedUpTo = 0;
+
+    for(auto const &range : ranges) {
+        size_t const offset = std::min(range.first, size);
+        size_t const end = std::min(offset + range.second, size);
+
+        size_t const newlines = countNewlines(text + countedUpTo, offset - countedUpTo);
+
+        if(newlines > 0) {
+            lineNumber += newlines;
+
+            lineStart = offset;
+            while(text[lineStart - 1] != L'\n') {
+                lineStart--;
+            }
+        }
+
+        countedUpTo = offset;
+
+        size_t const snippetStart = std::max(lineStart, offset > m_snippetContext ? offset - m_snippetContext : 0);
+
+        size_t const searchEnd = std::min(size, end + m_snippetContext);
+        size_t lineEnd = end;
+        while(lineEnd < searchEnd && text[lineEnd] != L'\n') {
+            lineEnd++;
+        }
+
+        // Drop the carriage return of a CRLF line ending.
+        if(lineEnd > end && text[lineEnd - 1] == L'\r') {
+            lineEnd--;
+        }
+
+        CMatchLocation location;
+        location.offset = offset;
+        location.length = end - offset;
+        location.lineNumber = lineNumber;
+        location.column = offset - lineStart + 1;
+        location.snippet.assign(text + snippetStart, lineEnd - snippetStart);
+        location.snippetMatchOffset = offset - snippetStart;
+        locations.push_back(std::move(location));
+    }
+}
@@ -0,0 +1,519 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CRegexAnalyzer.hpp>
+
+#include <algorithm>
+#include <cwctype>
+#include <stdexcept>
+
+/**
+ * @brief Multiply two lengths, saturating at the largest size_t instead
+ * of overflowing.
+ */
+static size_t saturatingMultiply(size_t const a, size_t const b) {
+    if(a != 0 && b > static_cast<size_t>(-1) / a) {
+        return static_cast<size_t>(-1);
+    }
+    return a * b;
+}
+
+static size_t saturatingAdd(size_t const a, size_t const b) {
+    if(a > static_cast<size_t>(-1) - b) {
+        return static_cast<size_t>(-1);
+    }
+    return a + b;
+}
+
+// Repetitions of a literal character beyond this are left out of the
+// required literals, which only need to be long enough to be rare.
+#define MAX_LITERAL_REPEAT 64
+
+static void endRun(std::wstring &run, std::vector<std::wstring> &literals) {
+    if(!run.empty()) {
+        literals.push_back(run);
+        run.clear();
+    }
+}
+
+CRegexAnalyzer::CRegexAnalyzer(std::wstring const &pattern)
+    : m_pattern(pattern),
+      m_pos(0),
+      m_isValid(false)
+{
+    m_root.type = NodeType::Group;
+
+    // Any construct the parser does not understand makes it throw, in
+    // which case we fall back to the conservative defaults.
+    try {
+        m_root.alternatives = parseAlternatives();
+
+        if(m_pos != m_pattern.size()) {
+            throw std::runtime_error("unbalanced parenthesis");
+        }
+
+        m_isValid = true;
+    } catch(std::runtime_error const &) {
+        m_root.alternatives.clear();
+        m_isValid = false;
+    }
+}
+
+size_t CRegexAnalyzer::getMinLength() const {
+    if(!m_isValid) {
+        return 0;
+    }
+
+    return minLength(m_root);
+}
+
+std::vector<std::wstring> CRegexAnalyzer::getRequiredLiterals() const {
+    std::vector<std::wstring> literals;
+
+    // Of alternatives, none is required.
+    if(!m_isValid || m_root.alternatives.size() != 1) {
+        return literals;
+    }
+
+    std::wstring run;
+    collectLiterals(m_root.alternatives.front(), run, literals);
+    endRun(run, literals);
+    return literals;
+}
+
+std::wstring CRegexAnalyzer::getRequiredPrefix() const {
+    std::wstring prefix;
+
+    if(m_isValid && m_root.alternatives.size() == 1) {
+        collectPrefix(m_root.alternatives.front(), prefix);
+    }
+
+    return prefix;
+}
+
+bool CRegexAnalyzer::isLineBound() const {
+    return m_isValid && !canMatchNewline(m_root);
+}
+
+std::vector<std::vector<CRegexAnalyzer::CNode>> CRegexAnalyzer::parseAlternatives() {
+    std::vector<std::vector<CNode>> alternatives;
+    alternatives.push_back(parseSequence());
+
+    while(m_pos < m_pattern.size() && m_pattern[m_pos] == L'|') {
+        m_pos++;
+        alternatives.push_back(parseSequence());
+    }
+
+    return alternatives;
+}
+
+std::vector<CRegexAnalyzer::CNode> CRegexAnalyzer::parseSequence() {
+    std::vector<CNode> sequence;
+
+    while(m_pos < m_pattern.size() && m_pattern[m_pos] != L'|' && m_pattern[m_pos] != L')') {
+        CNode node = parseAtom();
+        parseQuantifier(node);
+        sequence.push_back(std::move(node));
+    }
+
+    return sequence;
+}
+
+CRegexAnalyzer::CNode CRegexAnalyzer::parseAtom() {
+    CNode node;
+    wchar_t const c = m_pattern[m_pos++];
+
+    switch(c) {
+        case L'(': {
+            node.type = NodeType::Group;
+            bool isLookahead = false;
+
+            if(m_pos + 1 < m_pattern.size() && m_pattern[m_pos] == L'?') {
+                wchar_t const kind = m_pattern[m_pos + 1];
+
+                if(kind == L'=' || kind == L'!') {
+                    isLookahead = true;
+                } else if(kind != L':') {
+                    throw std::runtime_error("unsupported group");
+                }
+
+                m_pos += 2;
+            }
+
+            node.alternatives = parseAlternatives();
+
+            if(m_pos >= m_pattern.size() || m_pattern[m_pos] != L')') {
+                throw std::runtime_error("missing closing parenthesis");
+            }
+
+            m_pos++;
+
+            // Lookaheads do not consume any characters, but may look
+            // beyond the end of a line.
+            if(isLookahead) {
+                node.type = NodeType::Assertion;
+                node.alternatives.clear();
+                node.canMatchNewline = true;
+            }
+            break;
+        }
+
+        case L'[':
+            node.canMatchNewline = parseClass();
+            node.type = NodeType::Class;
+            break;
+
+        case L'\\':
+            node = parseEscape();
+            break;
+
+        case L'.':
+            node.type = NodeType::Class;
+            break;
+
+        case L'^':
+        case L'$':
+            node.type = NodeType::Assertion;
+            break;
+
+        case L'*':
+        case L'+':
+        case L'?':
+        case L'{':
+            throw std::runtime_error("quantifier without operand");
+
+        default:
+            node.type = NodeType::Literal;
+            node.literal = c;
+            break;
+    }
+
+    return node;
+}
+
+CRegexAnalyzer::CNode CRegexAnalyzer::parseEscape() {
+    if(m_pos >= m_pattern.size()) {
+        throw std::runtime_error("trailing backslash");
+    }
+
+    CNode node;
+    wchar_t const c = m_pattern[m_pos++];
+
+    switch(c) {
+        case L'd':
+        case L'w':
+            node.type = NodeType::Class;
+            break;
+
+        case L'D': case L'W':
+        case L's': case L'S':
+            node.type = NodeType::Class;
+            node.canMatchNewline = true;
+            break;
+
+        case L'b': case L'B':
+            node.type = NodeType::Assertion;
+            break;
+
+        case L'n': node.type = NodeType::Literal; node.literal = L'\n'; break;
+        case L'r': node.type = NodeType::Literal; node.literal = L'\r'; break;
+        case L't': node.type = NodeType::Literal; node.literal = L'\t'; break;
+        case L'f': node.type = NodeType::Literal; node.literal = L'\f'; break;
+        case L'v': node.type = NodeType::Literal; node.literal = L'\v'; break;
+        case L'0': node.type = NodeType::Literal; node.literal = L'\0'; break;
+
+        case L'x':
+        case L'u':
+        case L'c': {
+            // Hex, unicode and control escapes denote a single character.
+            // We do not need its value, so treat it like a class.
+            size_t const digits = (c == L'x') ? 2 : (c == L'u') ? 4 : 1;
+            if(m_pos + digits > m_pattern.size()) {
+                throw std::runtime_error("truncated escape");
+            }
+            m_pos += digits;
+            node.type = NodeType::Class;
+            node.canMatchNewline = true;
+            break;
+        }
+
+        default:
+            if(c >= L'1' && c <= L'9') {
+                // A backreference may refer to an empty capture.
+                while(m_pos < m_pattern.size() && std::iswdigit(m_pattern[m_pos])) {
+                    m_pos++;
+                }
+                node.type = NodeType::Backreference;
+                node.canMatchNewline = true;
+            } else {
+                node.type = NodeType::Literal;
+                node.literal = c;
+            }
+            break;
+    }
+
+    return node;
+}
+
+bool CRegexAnalyzer::parseClass() {
+    // m_pos is just past the opening '['. In ECMAScript a ']' directly
+    // after '[' or "[^" closes the class, so no special case is needed.
+    // A negated class matches a line feed unless it lists one, which we
+    // do not bother to find out.
+    bool canMatchNewline = false;
+
+    if(m_pos < m_pattern.size() && m_pattern[m_pos] == L'^') {
+        canMatchNewline = true;
+        m_pos++;
+    }
+
+    // The last plain character, which may start a range
+    wchar_t rangeStart = 0;
+    bool hasRangeStart = false;
+
+    while(m_pos < m_pattern.size() && m_pattern[m_pos] != L']') {
+        wchar_t const c = m_pattern[m_pos];
+
+        if(c == L'\\') {
+            // Escapes may be \s, \n or the code of any character.
+            canMatchNewline = true;
+            hasRangeStart = false;
+            m_pos += 2;
+        } else if(c == L'-' && hasRangeStart && m_pos + 1 < m_pattern.size() && m_pattern[m_pos + 1] != L']') {
+            wchar_t const rangeEnd = m_pattern[m_pos + 1];
+
+            if(rangeEnd == L'\\') {
+                canMatchNewline = true;
+                m_pos++;
+            } else if(rangeStart <= L'\n' && rangeEnd >= L'\n') {
+                canMatchNewline = true;
+            }
+
+            hasRangeStart = false;
+            m_pos += 2;
+        } else {
+            canMatchNewline = canMatchNewline || c == L'\n';
+            rangeStart = c;
+            hasRangeStart = true;
+            m_pos++;
+        }
+    }
+
+    if(m_pos >= m_pattern.size()) {
+        throw std::runtime_error("unterminated character class");
+    }
+
+    m_pos++;
+    return canMatchNewline;
+}
+
+void CRegexAnalyzer::parseQuantifier(CNode &node) {
+    if(m_pos >= m_pattern.size()) {
+        return;
+    }
+
+    wchar_t const c = m_pattern[m_pos];
+
+    switch(c) {
+        case L'*': node.minRepeat = 0; node.maxRepeat = UNBOUNDED; m_pos++; break;
+        case L'+': node.minRepeat = 1; node.maxRepeat = UNBOUNDED; m_pos++; break;
+        case L'?': node.minRepeat = 0; node.maxRepeat = 1; m_pos++; break;
+
+        case L'{': {
+            m_pos++;
+            node.minRepeat = parseNumber();
+            node.maxRepeat = node.minRepeat;
+
+            if(m_pos < m_pattern.size() && m_pattern[m_pos] == L',') {
+                m_pos++;
+                if(m_pos < m_pattern.size() && m_pattern[m_pos] == L'}') {
+                    node.maxRepeat = UNBOUNDED;
+                } else {
+                    node.maxRepeat = parseNumber();
+                }
+            }
+
+            if(m_pos >= m_pattern.size() || m_pattern[m_pos] != L'}') {
+                throw std::runtime_error("malformed repetition");
+            }
+            m_pos++;
+            break;
+        }
+
+        default:
+            return;
+    }
+
+    // Skip the lazy modifier, it does not change what can match.
+    if(m_pos < m_pattern.size() && m_pattern[m_pos] == L'?') {
+        m_pos++;
+    }
+}
+
+size_t CRegexAnalyzer::parseNumber() {
+    size_t const start = m_pos;
+    size_t value = 0;
+
+    while(m_pos < m_pattern.size() && std::iswdigit(m_pattern[m_pos])) {
+        value = saturatingAdd(saturatingMultiply(value, 10), static_cast<size_t>(m_pattern[m_pos] - L'0'));
+        m_pos++;
+    }
+
+    if(m_pos == start) {
+        throw std::runtime_error("expected a number");
+    }
+
+    return value;
+}
+
+size_t CRegexAnalyzer::minLength(CNode const &node) {
+    size_t single = 0;
+
+    switch(node.type) {
+        case NodeType::Literal:
+        case NodeType::Class:
+            single = 1;
+            break;
+
+        case NodeType::Assertion:
+        case NodeType::Backreference:
+            single = 0;
+            break;
+
+        case NodeType::Group: {
+            single = static_cast<size_t>(-1);
+            for(auto const &alternative : node.alternatives) {
+                single = std::min(single, minLength(alternative));
+            }
+            if(node.alternatives.empty()) {
+                single = 0;
+            }
+            break;
+        }
+    }
+
+    return saturatingMultiply(single, node.minRepeat);
+}
+
+size_t CRegexAnalyzer::minLength(std::vector<CNode> const &sequence) {
+    size_t total = 0;
+
+    for(auto const &node : sequence) {
+        total = saturatingAdd(total, minLength(node));
+    }
+
+    return total;
+}
+
+void CRegexAnalyzer::collectLiterals(std::vector<CNode> const &sequence,
+                                     std::wstring &run,
+                                     std::vector<std::wstring> &literals) {
+    // run holds the literal characters which directly precede the current
+    // node in every match.
+    for(CNode const &node : sequence) {
+        switch(node.type) {
+            case NodeType::Assertion:
+                // Zero width: the characters around it stay adjacent.
+                break;
+
+            case NodeType::Literal: {
+                if(node.minRepeat == 0) {
+                    endRun(run, literals);
+                    break;
+                }
+
+                run.append(std::min<size_t>(node.minRepeat, MAX_LITERAL_REPEAT), node.literal);
+
+                // After a varying number of repetitions, only the last
+                // one is known to precede what follows.
+                if(node.maxRepeat != node.minRepeat || node.minRepeat > MAX_LITERAL_REPEAT) {
+                    endRun(run, literals);
+                    run.assign(1, node.literal);
+                }
+                break;
+            }
+
+            case NodeType::Group:
+                if(node.minRepeat == 0 || node.alternatives.size() != 1) {
+                    endRun(run, literals);
+                } else if(node.minRepeat == 1 && node.maxRepeat == 1) {
+                    collectLiterals(node.alternatives.front(), run, literals);
+                } else {
+                    // A repeated group contains its literals, but not
+                    // next to what surrounds it.
+                    endRun(run, literals);
+                    collectLiterals(node.alternatives.front(), run, literals);
+                    endRun(run, literals);
+                }
+                break;
+
+            case NodeType::Class:
+            case NodeType::Backreference:
+                endRun(run, literals);
+                break;
+        }
+    }
+}
+
+/**
+ * @brief Append the literal characters every match of a sequence starts
+ * with to prefix.
+ *
+ * @return true if the sequence consists of these characters only, so that
+ *         the prefix goes on with what follows the sequence
+ */
+bool CRegexAnalyzer::collectPrefix(std::vector<CNode> const &sequence, std::wstring &prefix) {
+    for(CNode const &node : sequence) {
+        switch(node.type) {
+            case NodeType::Assertion:
+                break;
+
+            case NodeType::Literal:
+                if(node.minRepeat == 0) {
+                    return false;
+                }
+
+                prefix.append(std::min<size_t>(node.minRepeat, MAX_LITERAL_REPEAT), node.literal);
+
+                if(node.maxRepeat != node.minRepeat || node.minRepeat > MAX_LITERAL_REPEAT) {
+                    return false;
+                }
+                break;
+
+            case NodeType::Group:
+                if(node.minRepeat == 0 || node.alternatives.size() != 1) {
+                    return false;
+                }
+
+                // A repeated group starts with its first repetition.
+                if(!collectPrefix(node.alternatives.front(), prefix) || node.minRepeat != 1 || node.maxRepeat != 1) {
+                    return false;
+                }
+                break;
+
+            case NodeType::Class:
+            case NodeType::Backreference:
+                return false;
+        }
+    }
+
+    return true;
+}
+
+bool CRegexAnalyzer::canMatchNewline(CNode const &node) {
+    switch(node.type) {
+        case NodeType::Literal:
+            return node.literal == L'\n';
+
+        case NodeType::Group:
+            for(auto const &alternative : node.alternatives) {
+                for(CNode const &child : alternative) {
+                    if(canMatchNewline(child)) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+
+        default:
+            return node.canMatchNewline;
+    }
+}
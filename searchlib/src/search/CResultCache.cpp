@@ -0,0 +1,549 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CResultCache.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <unordered_set>
+
+// Entries modified less than this many seconds ago are not cached. A
+// second change within the same timestamp tick would not change the
+// stamp, so the cached entry could silently go stale.
+#define RACY_INTERVAL_SECONDS 2
+
+#define DEFAULT_MAX_SIZE (256 * 1024 * 1024)
+#define DEFAULT_MAX_AGE_SECONDS (7 * 24 * 60 * 60)
+
+// Rough per-record overhead of the hash maps and vectors, used when
+// estimating the memory used by the cache.
+#define RECORD_OVERHEAD 64
+
+#define CACHE_FILE_MAGIC "LSRCACHE"
+#define CACHE_FILE_VERSION 1
+
+static std::int64_t currentTime() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Turn a modification time into a stamp. Returns false if the
+ * time is too recent to be trusted (see RACY_INTERVAL_SECONDS).
+ */
+static bool makeStamp(std::filesystem::file_time_type const modifiedTime, std::int64_t &stamp) {
+    auto const now = std::filesystem::file_time_type::clock::now();
+
+    stamp = std::chrono::duration_cast<std::chrono::nanoseconds>(modifiedTime.time_since_epoch()).count();
+
+    return now - modifiedTime >= std::chrono::seconds(RACY_INTERVAL_SECONDS);
+}
+
+CResultCache::CQueryEntry::CQueryEntry(std::wstring const &key)
+    : m_key(key),
+      m_size(0),
+      m_lastUsed(0),
+      m_useCount(0)
+{
+    // nothing to do
+}
+
+bool CResultCache::CQueryEntry::findListing(std::filesystem::path const &directory, CListing &listing) {
+    std::error_code ec;
+    std::filesystem::file_time_type const modifiedTime = std::filesystem::last_write_time(directory, ec);
+
+    listing.isStampValid = !ec && makeStamp(modifiedTime, listing.stamp);
+
+    if(!listing.isStampValid) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto const it = m_directories.find(directory.native());
+
+    if(it == m_directories.end() || it->second.stamp != listing.stamp) {
+        return false;
+    }
+
+    listing.files = it->second.files;
+    listing.subdirectories = it->second.subdirectories;
+    return true;
+}
+
+void CResultCache::CQueryEntry::storeListing(std::filesystem::path const &directory, CListing const &listing) {
+    if(!listing.isStampValid) {
+        return;
+    }
+
+    CDirectoryRecord record;
+    record.stamp = listing.stamp;
+    record.files = listing.files;
+    record.subdirectories = listing.subdirectories;
+
+    std::filesystem::path::string_type const &key = directory.native();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto const it = m_directories.find(key);
+
+    if(it != m_directories.end()) {
+        // The directory changed. Forget the verdicts of files which are
+        // gone, so that deleted files do not pile up in the cache.
+        std::unordered_set<std::filesystem::path::string_type> remainingFiles;
+        for(std::filesystem::path const &name : record.files) {
+            remainingFiles.insert(name.native());
+        }
+
+        for(std::filesystem::path const &name : it->second.files) {
+            if(remainingFiles.count(name.native()) == 0) {
+                std::filesystem::path::string_type const filePath = (directory / name).native();
+
+                if(m_verdicts.erase(filePath) > 0) {
+                    m_size -= recordSize(filePath);
+                }
+            }
+        }
+
+        m_size -= recordSize(key, it->second);
+        m_size += recordSize(key, record);
+        it->second = std::move(record);
+    } else {
+        m_size += recordSize(key, record);
+        m_directories.emplace(key, std::move(record));
+    }
+}
+
+bool CResultCache::CQueryEntry::findVerdict(std::filesystem::path const &filePath, CFileStamp &stamp, bool &isMatch) {
+    std::error_code ec;
+    stamp.isValid = false;
+    stamp.size = std::filesystem::file_size(filePath, ec);
+
+    if(ec) {
+        return false;
+    }
+
+    std::filesystem::file_time_type const modifiedTime = std::filesystem::last_write_time(filePath, ec);
+
+    if(ec) {
+        return false;
+    }
+
+    stamp.isValid = makeStamp(modifiedTime, stamp.modifiedTime);
+
+    if(!stamp.isValid) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto const it = m_verdicts.find(filePath.native());
+
+    if(it == m_verdicts.end() ||
+       it->second.size != stamp.size ||
+       it->second.modifiedTime != stamp.modifiedTime) {
+        return false;
+    }
+
+    isMatch = it->second.isMatch;
+    return true;
+}
+
+void CResultCache::CQueryEntry::storeVerdict(std::filesystem::path const &filePath, CFileStamp const &stamp, bool const isMatch) {
+    if(!stamp.isValid) {
+        return;
+    }
+
+    CVerdictRecord const record = { stamp.size, stamp.modifiedTime, isMatch };
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto const result = m_verdicts.insert_or_assign(filePath.native(), record);
+
+    if(result.second) {
+        m_size += recordSize(filePath.native());
+    }
+}
+
+size_t CResultCache::CQueryEntry::getSize() const {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_size;
+}
+
+size_t CResultCache::CQueryEntry::recordSize(std::filesystem::path::string_type const &key, CDirectoryRecord const &record) {
+    size_t size = RECORD_OVERHEAD + key.size() * sizeof(key[0]) + sizeof(CDirectoryRecord);
+
+    for(std::filesystem::path const &name : record.files) {
+        size += sizeof(std::filesystem::path) + name.native().size() * sizeof(key[0]);
+    }
+
+    for(std::filesystem::path const &name : record.subdirectories) {
+        size += sizeof(std::filesystem::path) + name.native().size() * sizeof(key[0]);
+    }
+
+    return size;
+}
+
+size_t CResultCache::CQueryEntry::recordSize(std::filesystem::path::string_type const &key) {
+    return RECORD_OVERHEAD + key.size() * sizeof(key[0]) + sizeof(CVerdictRecord);
+}
+
+CResultCache::CResultCache()
+    : m_maxSize(DEFAULT_MAX_SIZE),
+      m_maxAge(DEFAULT_MAX_AGE_SECONDS)
+{
+    // nothing to do
+}
+
+CResultCache::~CResultCache() {
+    for(auto &entry : m_entries) {
+        delete entry.second;
+    }
+
+    m_entries.clear();
+}
+
+void CResultCache::setMaxSize(size_t const maxSize) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_maxSize = maxSize;
+    evict(currentTime());
+}
+
+size_t CResultCache::getMaxSize() const {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_maxSize;
+}
+
+void CResultCache::setMaxAge(std::chrono::seconds const maxAge) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_maxAge = maxAge;
+    evict(currentTime());
+}
+
+std::chrono::seconds CResultCache::getMaxAge() const {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_maxAge;
+}
+
+CResultCache::CQueryEntry *CResultCache::acquire(CSearchQuery const &searchQuery) {
+    std::wstring const key = searchQuery.getKey();
+
+    if(key.empty()) {
+        return nullptr;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(key);
+
+    if(it == m_entries.end()) {
+        it = m_entries.emplace(key, new CQueryEntry(key)).first;
+    }
+
+    it->second->m_useCount++;
+    it->second->m_lastUsed = currentTime();
+    return it->second;
+}
+
+void CResultCache::release(CQueryEntry *entry) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    std::int64_t const now = currentTime();
+
+    entry->m_useCount--;
+    entry->m_lastUsed = now;
+
+    evict(now);
+}
+
+void CResultCache::evict(std::int64_t const now) {
+    size_t totalSize = 0;
+
+    // Drop everything that has not been used for too long.
+    for(auto it = m_entries.begin(); it != m_entries.end(); ) {
+        CQueryEntry *entry = it->second;
+
+        if(entry->m_useCount == 0 && now - entry->m_lastUsed > m_maxAge.count()) {
+            delete entry;
+            it = m_entries.erase(it);
+        } else {
+            totalSize += entry->getSize();
+            ++it;
+        }
+    }
+
+    // Then drop the least recently used entries until the rest fits.
+    while(totalSize > m_maxSize) {
+        auto oldest = m_entries.end();
+
+        for(auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if(it->second->m_useCount == 0 &&
+               (oldest == m_entries.end() || it->second->m_lastUsed < oldest->second->m_lastUsed)) {
+                oldest = it;
+            }
+        }
+
+        // Everything left is in use.
+        if(oldest == m_entries.end()) {
+            break;
+        }
+
+        totalSize -= oldest->second->getSize();
+        delete oldest->second;
+        m_entries.erase(oldest);
+    }
+}
+
+size_t CResultCache::getEntryCount() const {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+size_t CResultCache::getSize() const {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    size_t totalSize = 0;
+
+    for(auto const &entry : m_entries) {
+        totalSize += entry.second->getSize();
+    }
+
+    return totalSize;
+}
+
+void CResultCache::clear() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    clearUnused();
+}
+
+void CResultCache::clearUnused() {
+    for(auto it = m_entries.begin(); it != m_entries.end(); ) {
+        if(it->second->m_useCount == 0) {
+            delete it->second;
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// The cache file is a flat binary file in the byte order of the machine
+// that wrote it. It is a cache, not an exchange format: if anything about
+// it looks wrong, it is discarded.
+
+static void writeInteger(std::ostream &out, std::uint64_t const value) {
+    out.write(reinterpret_cast<char const *>(&value), sizeof(value));
+}
+
+static void writeWideString(std::ostream &out, std::wstring const &text) {
+    writeInteger(out, text.size());
+    for(wchar_t const c : text) {
+        std::uint32_t const value = static_cast<std::uint32_t>(c);
+        out.write(reinterpret_cast<char const *>(&value), sizeof(value));
+    }
+}
+
+static void writePath(std::ostream &out, std::filesystem::path const &filePath) {
+    std::string const text = filePath.u8string();
+    writeInteger(out, text.size());
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+static bool readInteger(std::istream &in, std::uint64_t &value) {
+    in.read(reinterpret_cast<char *>(&value), sizeof(value));
+    return in.good();
+}
+
+// Upper bound for string lengths, so that a corrupt file cannot make us
+// allocate huge amounts of memory.
+#define MAX_STRING_LENGTH (1024 * 1024)
+
+static bool readWideString(std::istream &in, std::wstring &text) {
+    std::uint64_t size = 0;
+
+    if(!readInteger(in, size) || size > MAX_STRING_LENGTH) {
+        return false;
+    }
+
+    text.resize(static_cast<size_t>(size));
+    for(wchar_t &c : text) {
+        std::uint32_t value = 0;
+        in.read(reinterpret_cast<char *>(&value), sizeof(value));
+        c = static_cast<wchar_t>(value);
+    }
+
+    return in.good();
+}
+
+static bool readPath(std::istream &in, std::filesystem::path &filePath) {
+    std::uint64_t size = 0;
+
+    if(!readInteger(in, size) || size > MAX_STRING_LENGTH) {
+        return false;
+    }
+
+    std::string text(static_cast<size_t>(size), '\0');
+    in.read(&text[0], static_cast<std::streamsize>(size));
+    filePath = std::filesystem::u8path(text);
+    return in.good();
+}
+
+bool CResultCache::save(std::filesystem::path const &filePath) const {
+    std::ofstream out(filePath, std::ios::binary | std::ios::trunc);
+
+    if(!out.is_open()) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    out.write(CACHE_FILE_MAGIC, sizeof(CACHE_FILE_MAGIC) - 1);
+    writeInteger(out, CACHE_FILE_VERSION);
+    writeInteger(out, m_entries.size());
+
+    for(auto const &item : m_entries) {
+        CQueryEntry const *entry = item.second;
+        std::unique_lock<std::mutex> entryLock(entry->m_mutex);
+
+        writeWideString(out, entry->m_key);
+        writeInteger(out, static_cast<std::uint64_t>(entry->m_lastUsed));
+
+        writeInteger(out, entry->m_directories.size());
+        for(auto const &directory : entry->m_directories) {
+            writePath(out, directory.first);
+            writeInteger(out, static_cast<std::uint64_t>(directory.second.stamp));
+
+            writeInteger(out, directory.second.files.size());
+            for(std::filesystem::path const &name : directory.second.files) {
+                writePath(out, name);
+            }
+
+            writeInteger(out, directory.second.subdirectories.size());
+            for(std::filesystem::path const &name : directory.second.subdirectories) {
+                writePath(out, name);
+            }
+        }
+
+        writeInteger(out, entry->m_verdicts.size());
+        for(auto const &verdict : entry->m_verdicts) {
+            writePath(out, verdict.first);
+            writeInteger(out, verdict.second.size);
+            writeInteger(out, static_cast<std::uint64_t>(verdict.second.modifiedTime));
+            writeInteger(out, verdict.second.isMatch ? 1 : 0);
+        }
+    }
+
+    out.flush();
+    return out.good();
+}
+
+bool CResultCache::load(std::filesystem::path const &filePath) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    clearUnused();
+
+    std::ifstream in(filePath, std::ios::binary);
+
+    if(!in.is_open()) {
+        return false;
+    }
+
+    char magic[sizeof(CACHE_FILE_MAGIC) - 1];
+    std::uint64_t version = 0;
+    std::uint64_t entryCount = 0;
+
+    in.read(magic, sizeof(magic));
+
+    if(!in.good() || std::string(magic, sizeof(magic)) != CACHE_FILE_MAGIC ||
+       !readInteger(in, version) || version != CACHE_FILE_VERSION ||
+       !readInteger(in, entryCount)) {
+        return false;
+    }
+
+    // Read into a separate map first, so that a truncated file leaves
+    // the cache empty rather than half-loaded.
+    std::unordered_map<std::wstring, CQueryEntry *> entries;
+    bool isValid = true;
+
+    for(std::uint64_t i = 0; i < entryCount && isValid; ++i) {
+        std::wstring key;
+        std::uint64_t lastUsed = 0;
+        std::uint64_t directoryCount = 0;
+
+        if(!readWideString(in, key) || !readInteger(in, lastUsed) || !readInteger(in, directoryCount)) {
+            isValid = false;
+            break;
+        }
+
+        CQueryEntry *entry = new CQueryEntry(key);
+        entry->m_lastUsed = static_cast<std::int64_t>(lastUsed);
+
+        auto const inserted = entries.emplace(key, entry);
+        if(!inserted.second) {
+            delete entry;
+            isValid = false;
+            break;
+        }
+
+        for(std::uint64_t d = 0; d < directoryCount && isValid; ++d) {
+            std::filesystem::path directory;
+            std::uint64_t stamp = 0;
+            std::uint64_t fileCount = 0;
+            std::uint64_t subdirectoryCount = 0;
+            CQueryEntry::CDirectoryRecord record;
+
+            isValid = readPath(in, directory) && readInteger(in, stamp) && readInteger(in, fileCount);
+            record.stamp = static_cast<std::int64_t>(stamp);
+
+            for(std::uint64_t f = 0; f < fileCount && isValid; ++f) {
+                std::filesystem::path name;
+                isValid = readPath(in, name);
+                record.files.push_back(std::move(name));
+            }
+
+            isValid = isValid && readInteger(in, subdirectoryCount);
+
+            for(std::uint64_t s = 0; s < subdirectoryCount && isValid; ++s) {
+                std::filesystem::path name;
+                isValid = readPath(in, name);
+                record.subdirectories.push_back(std::move(name));
+            }
+
+            if(isValid) {
+                entry->m_size += CQueryEntry::recordSize(directory.native(), record);
+                entry->m_directories[directory.native()] = std::move(record);
+            }
+        }
+
+        std::uint64_t verdictCount = 0;
+        isValid = isValid && readInteger(in, verdictCount);
+
+        for(std::uint64_t v = 0; v < verdictCount && isValid; ++v) {
+            std::filesystem::path verdictPath;
+            std::uint64_t size = 0;
+            std::uint64_t modifiedTime = 0;
+            std::uint64_t isMatch = 0;
+
+            isValid = readPath(in, verdictPath) && readInteger(in, size) &&
+                      readInteger(in, modifiedTime) && readInteger(in, isMatch);
+
+            if(isValid) {
+                CQueryEntry::CVerdictRecord const record = {
+                    size, static_cast<std::int64_t>(modifiedTime), isMatch != 0
+                };
+                entry->m_size += CQueryEntry::recordSize(verdictPath.native());
+                entry->m_verdicts[verdictPath.native()] = record;
+            }
+        }
+    }
+
+    if(!isValid) {
+        for(auto &item : entries) {
+            delete item.second;
+        }
+        return false;
+    }
+
+    for(auto &item : entries) {
+        // Entries still in use keep their current contents.
+        if(m_entries.count(item.first) != 0) {
+            delete item.second;
+            continue;
+        }
+
+        m_entries.emplace(item.first, item.second);
+    }
+
+    evict(currentTime());
+    return true;
+}
@@ -0,0 +1,221 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CResultExporter.hpp>
+
+#include <StringUtil.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+// Rows are collected until the buffer reaches this many bytes, and then
+// written to the output in one call.
+#define WRITE_BUFFER_SIZE (1024 * 1024)
+#define DEFAULT_QUEUE_CAPACITY 65536
+
+static void appendCsvField(std::string const &field, std::string &buffer) {
+    bool const needsQuotes = field.find_first_of(",\"\r\n") != std::string::npos;
+
+    if(!needsQuotes) {
+        buffer += field;
+        return;
+    }
+
+    buffer += '"';
+    for(char const c : field) {
+        if(c == '"') {
+            buffer += '"';
+        }
+        buffer += c;
+    }
+    buffer += '"';
+}
+
+CResultExporter::CResultExporter(std::filesystem::path const &outputPath, Format const format,
+                                 Mode const mode)
+    : m_ownedOutput(outputPath, std::ios::binary | std::ios::trunc),
+      m_output(m_ownedOutput),
+      m_format(format),
+      m_mode(mode),
+      m_queueCapacity(DEFAULT_QUEUE_CAPACITY),
+      m_rowsWritten(0),
+      m_isFinished(false),
+      m_hasError(false)
+{
+    if(!m_ownedOutput.is_open()) {
+        throw std::runtime_error("Cannot open export file " + outputPath.u8string());
+    }
+
+    start();
+}
+
+CResultExporter::CResultExporter(std::ostream &output, Format const format, Mode const mode)
+    : m_output(output),
+      m_format(format),
+      m_mode(mode),
+      m_queueCapacity(DEFAULT_QUEUE_CAPACITY),
+      m_rowsWritten(0),
+      m_isFinished(false),
+      m_hasError(false)
+{
+    start();
+}
+
+CResultExporter::~CResultExporter() {
+    finish();
+}
+
+void CResultExporter::start() {
+    writeHeader();
+
+    if(m_mode == Mode::Background) {
+        m_writerThread = std::thread(&CResultExporter::writerThreadFunc, this);
+    }
+}
+
+void CResultExporter::writeHeader() {
+    if(m_format == Format::Csv) {
+        std::string header;
+        appendCsvField("path", header);
+        header += '\n';
+        flushBuffer(header);
+    }
+}
+
+void CResultExporter::setQueueCapacity(size_t const queueCapacity) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_queueCapacity = std::max<size_t>(queueCapacity, 1);
+}
+
+void CResultExporter::onFileMatched(std::filesystem::path const &matchedFile) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if(m_isFinished) {
+        return;
+    }
+
+    m_rowsWritten++;
+
+    if(m_mode == Mode::Direct) {
+        formatRow(m_format, matchedFile, m_directBuffer);
+
+        if(m_directBuffer.size() >= WRITE_BUFFER_SIZE) {
+            flushBuffer(m_directBuffer);
+        }
+        return;
+    }
+
+    // Wait for the writer thread if it has fallen too far behind, so
+    // that the queue cannot grow without bounds.
+    m_queueNotFull.wait(lock, [this] {
+        return m_isFinished || m_queue.size() < m_queueCapacity;
+    });
+
+    bool const wasEmpty = m_queue.empty();
+    m_queue.push_back(matchedFile);
+
+    // The writer only ever sleeps on an empty queue.
+    if(wasEmpty) {
+        m_queueNotEmpty.notify_one();
+    }
+}
+
+void CResultExporter::writerThreadFunc() {
+    std::vector<std::filesystem::path> batch;
+    std::string buffer;
+    buffer.reserve(WRITE_BUFFER_SIZE + 4096);
+
+    while(true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            m_queueNotEmpty.wait(lock, [this] {
+                return m_isFinished || !m_queue.empty();
+            });
+
+            if(m_queue.empty() && m_isFinished) {
+                break;
+            }
+
+            // Take the whole queue at once. The swapped-in vector keeps
+            // its capacity from the previous batch, so neither side
+            // reallocates in the steady state.
+            batch.swap(m_queue);
+        }
+
+        m_queueNotFull.notify_all();
+
+        for(std::filesystem::path const &filePath : batch) {
+            formatRow(m_format, filePath, buffer);
+
+            if(buffer.size() >= WRITE_BUFFER_SIZE) {
+                flushBuffer(buffer);
+            }
+        }
+
+        batch.clear();
+    }
+
+    flushBuffer(buffer);
+}
+
+void CResultExporter::flushBuffer(std::string &buffer) {
+    if(buffer.empty()) {
+        return;
+    }
+
+    m_output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    buffer.clear();
+
+    if(!m_output.good()) {
+        m_hasError = true;
+    }
+}
+
+void CResultExporter::finish() {
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        if(m_isFinished) {
+            return;
+        }
+
+        m_isFinished = true;
+    }
+
+    m_queueNotEmpty.notify_all();
+    m_queueNotFull.notify_all();
+
+    if(m_writerThread.joinable()) {
+        m_writerThread.join();
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    flushBuffer(m_directBuffer);
+    m_output.flush();
+
+    if(!m_output.good()) {
+        m_hasError = true;
+    }
+}
+
+size_t CResultExporter::getRowsWritten() const {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_rowsWritten;
+}
+
+bool CResultExporter::hasError() const {
+    return m_hasError.load();
+}
+
+void CResultExporter::formatRow(Format const format, std::filesystem::path const &filePath, std::string &buffer) {
+    std::string const utf8Path = filePath.u8string();
+
+    if(format == Format::Csv) {
+        appendCsvField(utf8Path, buffer);
+    } else {
+        buffer += "{\"path\":";
+        appendJsonString(utf8Path, buffer);
+        buffer += '}';
+    }
+
+    buffer += '\n';
+}
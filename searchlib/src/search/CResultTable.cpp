@@ -0,0 +1,325 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CResultTable.hpp>
+
+#include <search/CBasicStreamSearcher.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <cwctype>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+// Characters per chunk of a string pool. Longer strings get a chunk of
+// their own.
+#define STRING_CHUNK_CHARS (1 << 20)
+
+// Fewest items worth sorting or scanning on a thread of its own
+#define MIN_ITEMS_PER_THREAD 16384
+
+/**
+ * @brief Run task(0) .. task(count - 1), each on a thread of its own,
+ * task(0) on the calling thread.
+ */
+static void runParallel(size_t const count, std::function<void(size_t)> const &task) {
+    std::vector<std::thread> threads;
+    threads.reserve(count > 0 ? count - 1 : 0);
+
+    for(size_t i = 1; i < count; ++i) {
+        threads.emplace_back(task, i);
+    }
+
+    if(count > 0) {
+        task(0);
+    }
+
+    for(std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+/**
+ * @brief Get the number of threads worth using for a number of items.
+ */
+static size_t getThreadCount(size_t const itemCount, size_t const threadCount) {
+    return std::max<size_t>(1, std::min(threadCount, itemCount / MIN_ITEMS_PER_THREAD));
+}
+
+/**
+ * @brief Sort with up to threadCount threads: each sorts a piece of the
+ * items, then the pieces are merged pairwise, the merges of each round
+ * running in parallel.
+ */
+template<typename T, typename Compare>
+static void parallelSort(std::vector<T> &items, Compare const &compare, size_t const threadCount) {
+    size_t const pieces = getThreadCount(items.size(), threadCount);
+
+    if(pieces == 1) {
+        std::sort(items.begin(), items.end(), compare);
+        return;
+    }
+
+    std::vector<size_t> bounds(pieces + 1);
+    for(size_t i = 0; i <= pieces; ++i) {
+        bounds[i] = items.size() * i / pieces;
+    }
+
+    auto const begin = items.begin();
+
+    runParallel(pieces, [&](size_t const i) {
+        std::sort(begin + bounds[i], begin + bounds[i + 1], compare);
+    });
+
+    for(size_t width = 1; width < pieces; width *= 2) {
+        std::vector<size_t> merges;
+        for(size_t i = 0; i + width < pieces; i += 2 * width) {
+            merges.push_back(i);
+        }
+
+        runParallel(merges.size(), [&](size_t const m) {
+            size_t const first = merges[m];
+            size_t const last = std::min(first + 2 * width, pieces);
+            std::inplace_merge(begin + bounds[first], begin + bounds[first + width], begin + bounds[last], compare);
+        });
+    }
+}
+
+static wint_t foldCase(wchar_t const c) {
+    // Most file names are ASCII, which folds without a locale lookup.
+    if(c >= L'A' && c <= L'Z') {
+        return static_cast<wint_t>(c - L'A' + L'a');
+    }
+    if(static_cast<wint_t>(c) < 0x80) {
+        return static_cast<wint_t>(c);
+    }
+    return std::towlower(static_cast<wint_t>(c));
+}
+
+/**
+ * @brief Compare two strings ignoring case, then by their characters to
+ * break ties.
+ */
+static bool isLess(std::wstring_view const a, std::wstring_view const b) {
+    size_t const size = std::min(a.size(), b.size());
+
+    for(size_t i = 0; i < size; ++i) {
+        if(a[i] == b[i]) {
+            continue;
+        }
+
+        wint_t const lowerA = foldCase(a[i]);
+        wint_t const lowerB = foldCase(b[i]);
+
+        if(lowerA != lowerB) {
+            return lowerA < lowerB;
+        }
+    }
+
+    if(a.size() != b.size()) {
+        return a.size() < b.size();
+    }
+
+    return a < b;
+}
+
+CResultTable::CStringPool::~CStringPool() {
+    for(wchar_t *chunk : chunks) {
+        delete[] chunk;
+    }
+}
+
+CResultTable::CResultTable()
+    : m_rowCount(0)
+{
+    // nothing to do
+}
+
+CResultTable::~CResultTable() {
+    // nothing to do
+}
+
+CResultTable::StringId CResultTable::intern(CStringPool &pool, std::wstring const &text) {
+    auto const it = pool.ids.find(text);
+    if(it != pool.ids.end()) {
+        return it->second;
+    }
+
+    size_t const id = pool.count.load(std::memory_order_relaxed);
+    if(id >= BLOCK_SIZE * MAX_BLOCKS) {
+        throw std::length_error("Result table is full");
+    }
+
+    if(pool.chunks.empty() || pool.chunkUsed + text.size() > STRING_CHUNK_CHARS) {
+        pool.chunks.push_back(new wchar_t[std::max<size_t>(STRING_CHUNK_CHARS, text.size())]);
+        pool.chunkUsed = 0;
+    }
+
+    wchar_t *const chars = pool.chunks.back() + pool.chunkUsed;
+    std::memcpy(chars, text.data(), text.size() * sizeof(wchar_t));
+    pool.chunkUsed += text.size();
+
+    std::wstring_view const stored(chars, text.size());
+    pool.strings.set(id, stored);
+    pool.ids.emplace(stored, static_cast<StringId>(id));
+
+    // Publish the string to the readers.
+    pool.count.store(id + 1, std::memory_order_release);
+    return static_cast<StringId>(id);
+}
+
+CResultTable::Row CResultTable::addRow(std::filesystem::path const &path,
+                                       std::uint64_t const size,
+                                       std::int64_t const modifiedTime) {
+    size_t const row = m_rowCount.load(std::memory_order_relaxed);
+    if(row >= BLOCK_SIZE * MAX_BLOCKS) {
+        throw std::length_error("Result table is full");
+    }
+
+    m_nameIds.set(row, intern(m_names, path.filename().wstring()));
+    m_directoryIds.set(row, intern(m_directories, path.parent_path().wstring()));
+    m_sizes.set(row, size);
+    m_modifiedTimes.set(row, modifiedTime);
+
+    // Publish the row, after all of its cells, to the readers.
+    m_rowCount.store(row + 1, std::memory_order_release);
+    return static_cast<Row>(row);
+}
+
+std::filesystem::path CResultTable::getPath(Row const row) const {
+    std::filesystem::path path(std::wstring(getDirectory(getDirectoryId(row))));
+    path /= std::wstring(getName(getNameId(row)));
+    return path;
+}
+
+std::vector<std::uint32_t> CResultTable::rankStrings(CStringPool const &pool,
+                                                     size_t const count,
+                                                     size_t const threadCount) {
+    std::vector<StringId> ids(count);
+    for(size_t id = 0; id < count; ++id) {
+        ids[id] = static_cast<StringId>(id);
+    }
+
+    parallelSort(ids, [&pool](StringId const a, StringId const b) {
+        return isLess(pool.strings[a], pool.strings[b]);
+    }, threadCount);
+
+    std::vector<std::uint32_t> ranks(count);
+    for(size_t rank = 0; rank < count; ++rank) {
+        ranks[ids[rank]] = static_cast<std::uint32_t>(rank);
+    }
+    return ranks;
+}
+
+std::vector<char> CResultTable::findStrings(CStringPool const &pool,
+                                            size_t const count,
+                                            std::wstring const &filterText,
+                                            size_t const threadCount) {
+    CBasicStreamSearcher<wchar_t> const searcher(filterText, true);
+    std::vector<char> isFound(count);
+
+    size_t const pieces = getThreadCount(count, threadCount);
+
+    runParallel(pieces, [&](size_t const i) {
+        for(size_t id = count * i / pieces; id < count * (i + 1) / pieces; ++id) {
+            std::wstring_view const text = pool.strings[id];
+            isFound[id] = searcher.searchBuffer(text.data(), text.size());
+        }
+    });
+
+    return isFound;
+}
+
+std::vector<CResultTable::Row> CResultTable::select(size_t const rowCount,
+                                                    std::wstring const &filterText,
+                                                    Column const sortColumn,
+                                                    bool const isDescending,
+                                                    size_t const threadCount) const {
+    // Every string of the first rowCount rows was published before them.
+    size_t const nameCount = m_names.count.load(std::memory_order_acquire);
+    size_t const directoryCount = m_directories.count.load(std::memory_order_acquire);
+
+    std::vector<Row> rows;
+
+    if(filterText.empty()) {
+        rows.resize(rowCount);
+        for(size_t row = 0; row < rowCount; ++row) {
+            rows[row] = static_cast<Row>(row);
+        }
+    } else {
+        // Search each distinct string once rather than once per row.
+        std::vector<char> const nameFound = findStrings(m_names, nameCount, filterText, threadCount);
+        std::vector<char> const directoryFound = findStrings(m_directories, directoryCount, filterText, threadCount);
+
+        size_t const pieces = getThreadCount(rowCount, threadCount);
+        std::vector<std::vector<Row>> pieceRows(pieces);
+
+        runParallel(pieces, [&](size_t const i) {
+            for(size_t row = rowCount * i / pieces; row < rowCount * (i + 1) / pieces; ++row) {
+                if(nameFound[m_nameIds[row]] || directoryFound[m_directoryIds[row]]) {
+                    pieceRows[i].push_back(static_cast<Row>(row));
+                }
+            }
+        });
+
+        for(std::vector<Row> const &piece : pieceRows) {
+            rows.insert(rows.end(), piece.begin(), piece.end());
+        }
+    }
+
+    if(sortColumn == Column::None) {
+        return rows;
+    }
+
+    // Sort 64-bit keys next to their rows, so that comparisons need not
+    // look anything up. Strings are compared by their ranks, which are
+    // computed once per distinct string.
+    std::vector<std::uint32_t> nameRanks;
+    std::vector<std::uint32_t> directoryRanks;
+
+    if(sortColumn == Column::Name || sortColumn == Column::Directory) {
+        nameRanks = rankStrings(m_names, nameCount, threadCount);
+        directoryRanks = rankStrings(m_directories, directoryCount, threadCount);
+    }
+
+    std::vector<std::pair<std::uint64_t, Row>> keyed(rows.size());
+
+    for(size_t i = 0; i < rows.size(); ++i) {
+        Row const row = rows[i];
+        std::uint64_t key = 0;
+
+        switch(sortColumn) {
+        case Column::None:
+            break;
+        case Column::Name:
+            key = (std::uint64_t(nameRanks[m_nameIds[row]]) << 32) | directoryRanks[m_directoryIds[row]];
+            break;
+        case Column::Directory:
+            key = (std::uint64_t(directoryRanks[m_directoryIds[row]]) << 32) | nameRanks[m_nameIds[row]];
+            break;
+        case Column::Size:
+            key = m_sizes[row];
+            break;
+        case Column::ModifiedTime:
+            // Flip the sign bit, so that unsigned order is signed order.
+            key = static_cast<std::uint64_t>(m_modifiedTimes[row]) ^ (std::uint64_t(1) << 63);
+            break;
+        }
+
+        keyed[i] = { key, row };
+    }
+
+    parallelSort(keyed, [isDescending](std::pair<std::uint64_t, Row> const &a,
+                                       std::pair<std::uint64_t, Row> const &b) {
+        if(a.first != b.first) {
+            return isDescending ? a.first > b.first : a.first < b.first;
+        }
+        return a.second < b.second;
+    }, threadCount);
+
+    for(size_t i = 0; i < keyed.size(); ++i) {
+        rows[i] = keyed[i].second;
+    }
+
+    return rows;
+}
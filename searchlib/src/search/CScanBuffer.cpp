@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CScanBuffer.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+template<typename CharT>
+CBasicScanBuffer<CharT>::CBasicScanBuffer()
+    : m_data(nullptr),
+      m_capacity(0)
+{
+    // nothing to do
+}
+
+template<typename CharT>
+CBasicScanBuffer<CharT>::~CBasicScanBuffer() {
+    delete[] m_data;
+}
+
+template<typename CharT>
+CharT *CBasicScanBuffer<CharT>::reserve(size_t const chars, size_t const keepChars) {
+    if(chars <= m_capacity) {
+        return m_data;
+    }
+
+    // Grow geometrically, so that a buffer which is filled piece by piece
+    // is copied a logarithmic number of times only.
+    size_t const newCapacity = std::max(chars, m_capacity * 2);
+
+    // new[] without an initializer leaves the characters uninitialized.
+    CharT *newData = new CharT[newCapacity];
+
+    if(keepChars > 0) {
+        std::memcpy(newData, m_data, std::min(keepChars, m_capacity) * sizeof(CharT));
+    }
+
+    delete[] m_data;
+    m_data = newData;
+    m_capacity = newCapacity;
+    return m_data;
+}
+
+template<typename CharT>
+void CBasicScanBuffer<CharT>::trim(size_t const maxChars) {
+    if(m_capacity > maxChars) {
+        delete[] m_data;
+        m_data = nullptr;
+        m_capacity = 0;
+    }
+}
+
+template class CBasicScanBuffer<char>;
+template class CBasicScanBuffer<char16_t>;
+template class CBasicScanBuffer<wchar_t>;
@@ -1,161 +1,677 @@
 // SPDX-License-Identifier: GPL-2.0
 #include <search/CSearchEngine.hpp>
 
-#include <iostream>
+#include <FileIdentity.hpp>
+#include <search/CArchive.hpp>
+#include <search/CDirectoryWalker.hpp>
+#include <search/CFilterFuzzyName.hpp>
+
+#include <algorithm>
+#include <climits>
 
 #define BATCH_SIZE 64
 
-CSearchEngine::CSearchEngine(CSearchQuery *searchQuery)
+// Minimum time between two interim snapshots of a ranked search's results
+#define RANKED_SNAPSHOT_INTERVAL_MS 250
+
+// Number of characters a content filter reads from a stream at a time,
+// unless the memory budget allows less.
+#define MAX_STREAM_BUFFER_CHARS 1000000
+
+// Name similarities are ranked as integers, in millionths
+#define SIMILARITY_SCALE 1000000.0
+
+CSearchEngine::CSearchEngine(CSearchQuery *searchQuery, CSearchSettings const &settings)
     : m_searchQuery(searchQuery),
-      m_pendingOperations(0),
+      m_settings(settings),
+      m_searchPlan(searchQuery->getFilters()),
+      m_wantsMatchLocations(false),
+      m_resultCache(nullptr),
+      m_queryCache(nullptr),
+      m_useCachedVerdicts(false),
       m_totalFilesToSearch(0),
       m_totalFilesSearched(0),
-      m_totalMatches(0)
+      m_totalMatches(0),
+      m_searchArchives(searchQuery->isSearchArchives()),
+      m_followSymlinks(searchQuery->isFollowSymlinks()),
+      m_visitedFiles(nullptr),
+      m_visitedDirectories(nullptr),
+      m_queuedBatches(0),
+      m_ranking(searchQuery->getRanking()),
+      m_topResults(nullptr),
+      m_similarityFilter(nullptr),
+      m_isTopChanged(false)
 {
-    // Since the effectiveness of threads is limited by the number of cores
-    // the machine has, we want to set number of threads in the thread pool
-    // based on hardware concurrency.
-    // For example:
-    //  2 cores => 2 threads
-    //  4 cores => 4 threads
-    // etc.
-    auto const numWorkerThreads = std::thread::hardware_concurrency();
+    // Match locations are only collected if somebody wants them.
+    for(ISearchObserver *observer : m_searchQuery->getResultObservers()) {
+        if(observer->wantsMatchLocations()) {
+            m_wantsMatchLocations = true;
+        }
+    }
+
+    if(m_ranking.isEnabled()) {
+        m_topResults = new CTopResults(m_ranking);
+
+        // Matches are counted by locating them.
+        if(m_ranking.key == CRanking::Key::MatchCount) {
+            m_wantsMatchLocations = true;
+        }
+
+        // Names are ranked by how closely they resemble the first fuzzy
+        // name filter of the query.
+        if(m_ranking.key == CRanking::Key::NameSimilarity) {
+            for(IFilter const *filter : m_searchQuery->getFilters()) {
+                m_similarityFilter = dynamic_cast<CFilterFuzzyName const *>(filter);
+                if(m_similarityFilter) {
+                    break;
+                }
+            }
+        }
+    }
+
+    m_searchPlan.setLocationOptions(m_searchQuery->getMaxMatchesPerFile(),
+                                    m_searchQuery->getSnippetContext());
+
+    // Every worker gets an equal share of the memory budget for its file
+    // buffers. A file which does not fit into the share is streamed, and
+    // a streaming buffer is never larger than the share either.
+    size_t const bufferChars = m_settings.getBufferCharsPerWorker();
+    m_searchPlan.setMaxBufferSize(bufferChars);
+
+    for(IFilter *filter : m_searchQuery->getFilters()) {
+        filter->setMaxBufferSize(std::min<size_t>(bufferChars, MAX_STREAM_BUFFER_CHARS));
+    }
+
+    m_maxQueuedBatches = static_cast<int>(std::min<size_t>(m_settings.getMaxQueuedBatches(), INT_MAX));
+
+    // Searches share the process' workers, one per CPU the process may
+    // use unless a search asks for more, so that concurrent searches do
+    // not compete for the same cores with threads of their own. The queue
+    // limits how many of them this search occupies at once. Backpressure
+    // keeps the batches waiting in the queue to about the limit of queued
+    // batches, so the queue needs no more room than that.
+    CExecutor &executor = CExecutor::getShared();
+    executor.reserveWorkers(m_settings.getWorkerThreads());
+    m_taskQueue = new CExecutor::CQueue(executor,
+                                        m_settings.getPriority(),
+                                        m_settings.getWeight(),
+                                        m_settings.getWorkerThreads(),
+                                        m_settings.getMaxQueuedBatches());
+
+    m_searchTasks.setCompletionHandler([this]() {
+        // The search is done with the cache entry; hand it back before
+        // anyone waiting for completion gets to save the cache.
+        if(m_queryCache) {
+            m_resultCache->release(m_queryCache);
+            m_queryCache = nullptr;
+        }
+
+        // Observers have the final ranking before anyone waiting for
+        // completion is woken up.
+        if(m_topResults) {
+            publishRankedResults(true);
+        }
+    });
 
-    m_threadPool = new CThreadPool(numWorkerThreads);
+    // Reads only have to wait for each other if fewer of them may run at
+    // once than there are workers.
+    m_ioSlots = nullptr;
+    if(m_settings.getIoConcurrency() < m_settings.getWorkerThreads()) {
+        m_ioSlots = new CSemaphore(m_settings.getIoConcurrency());
+    }
+
+    m_stats = m_settings.isCollectStats() ? new CSearchStats() : nullptr;
+    m_traceRecorder = nullptr;
+
+    // Name-only searches never read a file, so there is nothing to save
+    // by recognizing one under another name.
+    if(m_searchPlan.needsFileAccess()) {
+        m_visitedFiles = new CVisitedInodes();
+    }
+
+    if(m_followSymlinks) {
+        m_visitedDirectories = new CVisitedInodes();
+    }
 }
 
 CSearchEngine::~CSearchEngine()
 {
+    // Important to note that this delete is potentially blocking: tasks
+    // which have not started are discarded, but those already running
+    // are waited for. The queue has to go first: running tasks still use
+    // the query's filters and observers until they have finished.
+    delete m_taskQueue;
+    delete m_ioSlots;
+    delete m_stats;
+    delete m_topResults;
+    delete m_visitedFiles;
+    delete m_visitedDirectories;
+
     delete m_searchQuery;
+}
 
-    // Important to note that this delete is potentially blocking
-    // because CThreadPool's destructor sends the terminate signal to
-    // all worker threads and then joins on them.
-    delete m_threadPool;
+void CSearchEngine::setResultCache(CResultCache *resultCache) {
+    m_resultCache = resultCache;
+}
+
+void CSearchEngine::setVerdictCache(CVerdictCache *verdictCache) {
+    m_searchPlan.setVerdictCache(verdictCache);
+}
+
+void CSearchEngine::setTraceRecorder(CTraceRecorder *traceRecorder) {
+    m_traceRecorder = traceRecorder;
+    m_taskQueue->setTraceRecorder(traceRecorder);
 }
 
 void CSearchEngine::performSearch() {
-    std::vector<std::filesystem::path> searchPaths = m_searchQuery->getDirectories();
+    // A root within another root would have its files found twice.
+    std::vector<std::filesystem::path> searchPaths =
+        CDirectoryWalker::removeOverlappingRoots(m_searchQuery->getDirectories());
+
+    if(m_resultCache) {
+        m_queryCache = m_resultCache->acquire(*m_searchQuery);
+
+        // Name-only queries are cheaper to evaluate than to look up, so
+        // for those only the directory listings are cached. Cached
+        // verdicts carry no match locations, so they are not used when
+        // locations are wanted either.
+        m_useCachedVerdicts = m_queryCache && m_searchPlan.needsFileAccess() && !m_wantsMatchLocations;
+    }
+
+    // Hold one pending task while spawning the enumerate workers, so
+    // that the search cannot be considered complete before all of them
+    // have been spawned.
+    m_searchTasks.begin();
 
-    for(std::filesystem::path const &path : searchPaths) {
-        spawnEnumerateWorker(path);
+    if(m_searchQuery->hasSearchFiles()) {
+        spawnListWorker();
+    } else {
+        for(std::filesystem::path const &path : searchPaths) {
+            spawnEnumerateWorker(path);
+        }
     }
+
+    m_searchTasks.end();
 }
 
-void CSearchEngine::spawnEnumerateWorker(std::filesystem::path const enumPath) {
-    auto enumerateWorkerFunc = [this](std::filesystem::path const enumPath) {
+void CSearchEngine::spawnEnumerateWorker(std::filesystem::path const &enumPath) {
+    m_taskQueue->post(m_searchTasks, [this, enumPath]() {
+        CSearchStats::CScope const statsScope(m_stats);
+        CTraceRecorder::CScope const traceScope(m_traceRecorder);
+
+        CTraceSpan span("Enumerate");
+        if(span.isRecording()) {
+            span.setDetail(enumPath.u8string());
+        }
+
         std::vector<std::filesystem::path> paths;
-        std::error_code ec;
-
-        // If we used a range-based for loop here, the default behavior of the
-        // recursive directory iterator would be to throw an exception when
-        // a filesystem error occurs. These are very annoying to deal with,
-        // and if uncaught will cause the current task to fail "silently"
-        // because we are running in an std::packaged_task.
-        // Instead of using a range-based for loop, we construct a
-        // recursive_directory_iterator using its non-throwing constructor
-        // and provide an std::error_code.
-        auto dirIterator = std::filesystem::recursive_directory_iterator(
-            enumPath,
-            std::filesystem::directory_options::skip_permission_denied, 
-            ec);
-
-        auto dirEntryEnd = std::filesystem::end(dirIterator);
-
-        for(auto dirEntry = std::filesystem::begin(dirIterator); dirEntry != dirEntryEnd; dirEntry.increment(ec)) {
-            if(ec) {
-                std::cout << "warning: error code " << ec.value() << " while enumerating directory\n";
-                continue;
+
+        // The walker reports errors as warnings and skips unreadable
+        // directories instead of throwing, which would otherwise cause
+        // the current task to fail "silently" because exceptions of
+        // posted tasks are discarded.
+        CDirectoryWalker walker(enumPath);
+        walker.setRespectIgnoreFiles(m_searchQuery->isRespectIgnoreFiles());
+        walker.setDirectoryCache(m_queryCache);
+        walker.setFollowSymlinks(m_followSymlinks);
+        walker.setVisitedDirectories(m_visitedDirectories);
+
+        walker.walk([this, &paths](std::filesystem::path const &filePath) {
+            // Walking a tree can take a while; let more urgent searches
+            // have this worker in between.
+            m_taskQueue->yield();
+
+            addToBatch(filePath, paths);
+
+            if(m_searchArchives) {
+                enumerateArchive(filePath, paths);
             }
+        });
 
-            std::filesystem::path filePath = dirEntry->path();
+        if(paths.size() > 0) {
+            spawnSearchWorker(std::move(paths));
+        }
+    });
+}
 
-            if(!std::filesystem::is_regular_file(filePath)) {
-                continue;
-            }
+void CSearchEngine::spawnListWorker() {
+    m_taskQueue->post(m_searchTasks, [this]() {
+        CSearchStats::CScope const statsScope(m_stats);
+        CTraceRecorder::CScope const traceScope(m_traceRecorder);
 
-            paths.push_back(filePath);
+        CTraceSpan span("List");
 
-            m_totalFilesToSearch++;
+        std::vector<CSearchFile> const &searchFiles = m_searchQuery->getSearchFiles();
+        span.setValue(static_cast<std::int64_t>(searchFiles.size()));
 
-            if(paths.size() > BATCH_SIZE) {
-                spawnSearchWorker(std::move(paths));
+        bool const ranksByMetadata =
+            m_ranking.key == CRanking::Key::ModifiedTime || m_ranking.key == CRanking::Key::Size;
 
-                // After std::move, the paths vector is now in an unspecified
-                // (but valid) state. We call clear() to ensure the vector
-                // is empty before continuing the loop.
-                paths.clear();
+        if(m_topResults && ranksByMetadata) {
+            for(CSearchFile const &searchFile : searchFiles) {
+                if(searchFile.hasMetadata) {
+                    m_knownFiles.emplace(searchFile.path.native(), &searchFile);
+                }
             }
         }
 
+        // The files were found by an earlier search, so they go straight
+        // into batches.
+        std::vector<std::filesystem::path> paths;
+
+        for(CSearchFile const &searchFile : searchFiles) {
+            addToBatch(searchFile.path, paths);
+        }
+
         if(paths.size() > 0) {
             spawnSearchWorker(std::move(paths));
         }
+    });
+}
 
-        m_pendingOperations--;
-    };
+void CSearchEngine::addToBatch(std::filesystem::path filePath, std::vector<std::filesystem::path> &paths) {
+    paths.push_back(std::move(filePath));
+
+    m_totalFilesToSearch++;
+
+    if(paths.size() >= BATCH_SIZE) {
+        spawnSearchWorker(std::move(paths));
+
+        // After std::move, the paths vector is now in an unspecified
+        // (but valid) state. We call clear() to ensure the vector
+        // is empty before continuing the loop.
+        paths.clear();
+    }
+}
+
+void CSearchEngine::enumerateArchive(std::filesystem::path const &archivePath,
+                                     std::vector<std::filesystem::path> &paths) {
+    CArchive::Format const format = CArchive::getFormat(archivePath);
+
+    if(format == CArchive::Format::None) {
+        return;
+    }
+
+    std::vector<std::string> names;
+
+    {
+        // Listing an archive is what reading a directory is to files.
+        CStageTimer listTimer(CSearchStats::Stage::DirectoryRead);
+        CArchive::listMembers(archivePath, names);
+        listTimer.addAmount(names.size());
+    }
+
+    // Members of a zip archive can be read independently, so they are
+    // batched like files and searched in parallel.
+    if(CArchive::isRandomAccess(format)) {
+        for(std::string const &name : names) {
+            addToBatch(CArchive::makeMemberPath(archivePath, name), paths);
+        }
+        return;
+    }
+
+    // Tar members can only be reached by reading the archive front to
+    // back. They are searched in bounded batches, in archive order, but
+    // one batch at a time: each batch queues the next one when it is done
+    // and hands it the cursor it read the archive through, so whichever
+    // thread takes the next batch reads on from where the last one
+    // stopped.
+    if(!names.empty()) {
+        m_totalFilesToSearch += static_cast<int>(names.size());
+
+        auto members = std::make_shared<CArchiveMembers>();
+        members->archivePath = archivePath;
+        members->names = std::move(names);
+
+        searchArchiveMembers(std::move(members));
+    }
+}
+
+void CSearchEngine::searchArchiveMembers(std::shared_ptr<CArchiveMembers> members) {
+    // Backpressure as in spawnSearchWorker: while searching has fallen
+    // behind, the thread searches the next batch itself.
+    while(members->next < members->names.size()) {
+        if(m_queuedBatches.load(std::memory_order_relaxed) < m_maxQueuedBatches) {
+            spawnArchiveWorker(std::move(members));
+            return;
+        }
+
+        searchArchiveBatch(*members);
+    }
+}
+
+void CSearchEngine::spawnArchiveWorker(std::shared_ptr<CArchiveMembers> members) {
+    m_queuedBatches++;
+
+    m_taskQueue->post(m_searchTasks, [this, members = std::move(members)]() mutable {
+        m_queuedBatches--;
+
+        CSearchStats::CScope const statsScope(m_stats);
+        CTraceRecorder::CScope const traceScope(m_traceRecorder);
+
+        searchArchiveBatch(*members);
+        searchArchiveMembers(std::move(members));
+    }, CExecutor::TaskPriority::High);
+}
+
+void CSearchEngine::searchArchiveBatch(CArchiveMembers &members) {
+    size_t const end = std::min(members.next + BATCH_SIZE, members.names.size());
+    std::vector<std::filesystem::path> fileList;
+
+    for(size_t i = members.next; i < end; ++i) {
+        fileList.push_back(CArchive::makeMemberPath(members.archivePath, members.names[i]));
+    }
 
-    // Before enqueuing the worker thread, add one
-    // to the pending operations count.
-    m_pendingOperations++;
+    members.next = end;
 
-    // Enqueue the worker thread
-    m_threadPool->enqueue(enumerateWorkerFunc, enumPath);
+    CArchive::CCursorScope const cursorScope(members.cursor);
+    searchBatch(fileList);
 }
 
 void CSearchEngine::spawnSearchWorker(std::vector<std::filesystem::path> fileList) {
-    auto searchWorkerFunc = [this](std::vector<std::filesystem::path> const fileList) {
-        size_t numMatches = 0;
+    // Backpressure: if searching has fallen behind, the enumerating thread
+    // searches the batch itself instead of queueing it. Enumeration then
+    // proceeds at the pace of searching, and the paths waiting to be
+    // searched never exceed the limit, however large the tree is.
+    if(m_queuedBatches.load(std::memory_order_relaxed) >= m_maxQueuedBatches) {
+        searchBatch(fileList);
+        return;
+    }
+
+    m_queuedBatches++;
+
+    // Batches go ahead of queued enumeration tasks, which would only add
+    // to the backlog.
+    m_taskQueue->post(m_searchTasks, [this, fileList = std::move(fileList)]() {
+        m_queuedBatches--;
+
+        CSearchStats::CScope const statsScope(m_stats);
+        CTraceRecorder::CScope const traceScope(m_traceRecorder);
+
+        searchBatch(fileList);
+    }, CExecutor::TaskPriority::High);
+}
 
-        for(auto &filePath : fileList) {
-            m_totalFilesSearched++;
+void CSearchEngine::searchBatch(std::vector<std::filesystem::path> const &fileList) {
+    CTraceSpan batchSpan("Search batch");
+    batchSpan.setValue(static_cast<std::int64_t>(fileList.size()));
+
+    std::vector<CMatchLocation> locations;
+
+    // The best matches of the batch. Ranking within the batch takes no
+    // lock; the batch's best are merged into the overall best at the end.
+    CTopResults batchTop(m_ranking);
+
+    for(auto &filePath : fileList) {
+        m_taskQueue->yield();
+
+        CTraceSpan fileSpan("File");
+        if(fileSpan.isRecording()) {
+            fileSpan.setDetail(filePath.u8string());
+        }
 
-            bool isMatch = matchesAllFilters(filePath);
+        m_totalFilesSearched++;
 
-            if(isMatch) {
-                m_totalMatches++;
+        locations.clear();
+        bool isMatch = evaluateDistinctFile(filePath, m_wantsMatchLocations ? &locations : nullptr);
 
-                notifyAllObservers(filePath);
+        if(isMatch) {
+            m_totalMatches++;
+
+            if(m_topResults) {
+                rankMatch(filePath, locations, batchTop);
+            } else {
+                notifyAllObservers(filePath, locations);
             }
         }
+    }
 
-        m_pendingOperations--;
-    };
+    if(m_topResults && !batchTop.empty()) {
+        {
+            std::lock_guard<std::mutex> const lock(m_topMutex);
+            m_topResults->merge(batchTop);
+            m_isTopChanged = true;
+        }
+
+        publishRankedResults(false);
+    }
+}
+
+void CSearchEngine::rankMatch(std::filesystem::path const &filePath,
+                              std::vector<CMatchLocation> const &locations,
+                              CTopResults &batchTop) {
+    std::int64_t value = 0;
+    std::error_code ec;
+
+    // Files of a refined search may come with their size and time.
+    CSearchFile const *const knownFile = findKnownFile(filePath);
+
+    // Archive members have the time and size of their archive.
+    std::filesystem::path archivePath;
+    std::string memberName;
+    std::filesystem::path const &statPath =
+        m_searchArchives && CArchive::splitMemberPath(filePath, archivePath, memberName) ? archivePath : filePath;
+
+    switch(m_ranking.key) {
+        case CRanking::Key::ModifiedTime: {
+            if(knownFile) {
+                value = knownFile->modifiedTime;
+                break;
+            }
+
+            CStageTimer const statTimer(CSearchStats::Stage::Stat);
+            auto const modifiedTime = std::filesystem::last_write_time(statPath, ec);
+            value = std::chrono::duration_cast<std::chrono::nanoseconds>(modifiedTime.time_since_epoch()).count();
+            break;
+        }
+
+        case CRanking::Key::Size: {
+            if(knownFile) {
+                value = static_cast<std::int64_t>(knownFile->size);
+                break;
+            }
+
+            CStageTimer const statTimer(CSearchStats::Stage::Stat);
+            value = static_cast<std::int64_t>(std::filesystem::file_size(statPath, ec));
+            break;
+        }
+
+        case CRanking::Key::MatchCount:
+            value = static_cast<std::int64_t>(locations.size());
+            break;
 
-    // Before enqueuing the worker thread, add one
-    // to the pending operations count.
-    m_pendingOperations++;
+        case CRanking::Key::NameSimilarity:
+            if(m_similarityFilter) {
+                value = static_cast<std::int64_t>(m_similarityFilter->getSimilarity(filePath) * SIMILARITY_SCALE);
+            }
+            break;
+
+        case CRanking::Key::Path:
+        case CRanking::Key::None:
+            break;
+    }
+
+    // The file vanished since it matched.
+    if(ec) {
+        return;
+    }
 
-    // Enqueue the worker thread
-    m_threadPool->enqueue(searchWorkerFunc, std::move(fileList));
+    if(batchTop.wouldKeep(value, filePath)) {
+        batchTop.add(CRankedResult{ filePath, value });
+    }
 }
 
-bool CSearchEngine::matchesAllFilters(std::filesystem::path const &filePath) {
-    std::vector<IFilter *> filters = m_searchQuery->getFilters();
+void CSearchEngine::publishRankedResults(bool const isFinal) {
+    std::unique_lock<std::mutex> publishLock(m_publishMutex, std::defer_lock);
+    auto const now = std::chrono::steady_clock::now();
+
+    if(isFinal) {
+        publishLock.lock();
+    } else {
+        // Interim snapshots are skipped while another thread publishes
+        // one, and published at a limited rate: copying and sorting K
+        // results for every batch would cost more than the search.
+        if(!publishLock.try_lock() ||
+           now - m_lastPublishTime < std::chrono::milliseconds(RANKED_SNAPSHOT_INTERVAL_MS)) {
+            return;
+        }
+    }
 
-    for(auto &f : filters) {
-        bool isMatch = false;
+    std::vector<CRankedResult> snapshot;
 
-        isMatch = f->filterFile(filePath);
+    {
+        std::lock_guard<std::mutex> const lock(m_topMutex);
 
-        if(!isMatch) {
-            return false;
+        if(!isFinal && !m_isTopChanged) {
+            return;
         }
+
+        snapshot = m_topResults->getSorted();
+        m_isTopChanged = false;
     }
 
-    return true;
+    m_lastPublishTime = now;
+
+    CStageTimer const notifyTimer(CSearchStats::Stage::Notify);
+
+    for(ISearchObserver *observer : m_searchQuery->getResultObservers()) {
+        observer->onRankedResults(snapshot, isFinal);
+    }
 }
 
-void CSearchEngine::notifyAllObservers(std::filesystem::path const &matchedFile) {
+CSearchFile const *CSearchEngine::findKnownFile(std::filesystem::path const &filePath) const {
+    if(m_knownFiles.empty()) {
+        return nullptr;
+    }
+
+    auto const it = m_knownFiles.find(filePath.native());
+    return it != m_knownFiles.end() ? it->second : nullptr;
+}
+
+std::vector<CRankedResult> CSearchEngine::getRankedResults() const {
+    if(!m_topResults) {
+        return std::vector<CRankedResult>();
+    }
+
+    std::lock_guard<std::mutex> const lock(m_topMutex);
+    return m_topResults->getSorted();
+}
+
+bool CSearchEngine::evaluateDistinctFile(std::filesystem::path const &filePath,
+                                         std::vector<CMatchLocation> *locations) {
+    if(!m_visitedFiles) {
+        return evaluateFile(filePath, locations);
+    }
+
+    CFileIdentity identity;
+    bool hasIdentity;
+
+    {
+        CStageTimer const statTimer(CSearchStats::Stage::Stat);
+        hasIdentity = getFileIdentity(filePath, identity);
+    }
+
+    // Without followed symbolic links, only a file with several hard
+    // links can be reached twice.
+    if(!hasIdentity || (identity.linkCount <= 1 && !m_followSymlinks)) {
+        return evaluateFile(filePath, locations);
+    }
+
+    // Only the outcome of the size check and the content scan is shared
+    // between the paths of the file. Name filters may tell its paths
+    // apart, so the rest of the plan is evaluated for each of them.
+    CSearchPlan::ContentVerdict const contentVerdict = [&](std::function<bool()> const &evaluate) {
+        CVisitedInodes::State const state = m_visitedFiles->visit(identity.device, identity.inode);
+
+        switch(state) {
+            case CVisitedInodes::State::NoMatch:
+                return false;
+
+            case CVisitedInodes::State::Match:
+                // Match locations are not kept, so a match is located
+                // again under each of its paths.
+                return locations ? evaluate() : true;
+
+            case CVisitedInodes::State::Pending:
+                // Another thread is reading the file right now. Reading
+                // it again is cheaper than waiting for the verdict.
+                return evaluate();
+
+            case CVisitedInodes::State::New:
+                break;
+        }
+
+        bool const isMatch = evaluate();
+        m_visitedFiles->setVerdict(identity.device, identity.inode, isMatch);
+        return isMatch;
+    };
+
+    return evaluateFile(filePath, locations, &contentVerdict);
+}
+
+bool CSearchEngine::evaluateFile(std::filesystem::path const &filePath,
+                                 std::vector<CMatchLocation> *locations,
+                                 CSearchPlan::ContentVerdict const *contentVerdict) {
+    if(!m_useCachedVerdicts) {
+        return matchesAllFilters(filePath, locations, contentVerdict);
+    }
+
+    CResultCache::CFileStamp stamp;
+    bool isMatch = false;
+    bool isCached;
+
+    {
+        // Looking up the verdict reads the file's metadata.
+        CStageTimer const statTimer(CSearchStats::Stage::Stat);
+        isCached = m_queryCache->findVerdict(filePath, stamp, isMatch);
+    }
+
+    if(isCached) {
+        return isMatch;
+    }
+
+    isMatch = matchesAllFilters(filePath, locations, contentVerdict);
+    m_queryCache->storeVerdict(filePath, stamp, isMatch);
+    return isMatch;
+}
+
+bool CSearchEngine::matchesAllFilters(std::filesystem::path const &filePath,
+                                      std::vector<CMatchLocation> *locations,
+                                      CSearchPlan::ContentVerdict const *contentVerdict) {
+    if(m_ioSlots && m_searchPlan.needsFileAccess()) {
+        CTraceSpan waitSpan("Wait for I/O slot");
+        m_ioSlots->lock();
+        waitSpan.stop();
+
+        std::lock_guard<CSemaphore> ioSlot(*m_ioSlots, std::adopt_lock);
+        return m_searchPlan.matches(filePath, locations, contentVerdict);
+    }
+
+    return m_searchPlan.matches(filePath, locations, contentVerdict);
+}
+
+void CSearchEngine::notifyAllObservers(std::filesystem::path const &matchedFile,
+                                       std::vector<CMatchLocation> const &locations) {
+    CStageTimer notifyTimer(CSearchStats::Stage::Notify);
+    notifyTimer.addAmount(1);
+
     std::vector<ISearchObserver *> resultObservers = m_searchQuery->getResultObservers();
 
     for(auto &observer : resultObservers) {
         observer->onFileMatched(matchedFile);
+
+        if(!locations.empty() && observer->wantsMatchLocations()) {
+            observer->onMatchLocations(matchedFile, locations);
+        }
     }
 }
 
+void CSearchEngine::waitForCompletion() {
+    m_searchTasks.wait();
+}
+
 int CSearchEngine::getPendingOperations() {
-    return m_pendingOperations.load();
+    return m_searchTasks.getPendingTasks();
 }
 
 int CSearchEngine::getTotalFilesToSearch() {
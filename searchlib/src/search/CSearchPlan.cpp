@@ -0,0 +1,466 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CSearchPlan.hpp>
+
+#include <search/CContentStream.hpp>
+#include <search/CFilterCombine.hpp>
+#include <search/CRegexAnalyzer.hpp>
+#include <search/CScanBuffer.hpp>
+#include <search/CSearchStats.hpp>
+
+#include <FileIdentity.hpp>
+
+#include <algorithm>
+#include <sstream>
+
+// By default, files up to this many characters are loaded once and shared
+// between all content filters of a scan. Larger files are streamed through
+// each filter separately, to keep memory usage bounded.
+#define DEFAULT_MAX_SHARED_SCAN_CHARS (16 * 1024 * 1024)
+#define SHARED_SCAN_CHUNK_CHARS (64 * 1024)
+
+// A thread keeps its shared scan buffer between files unless the buffer
+// grew beyond this many characters.
+#define SHARED_SCAN_RETAINED_CHARS (1024 * 1024)
+
+#define DEFAULT_MAX_MATCHES_PER_FILE 100
+#define DEFAULT_SNIPPET_CONTEXT 80
+
+/**
+ * @brief Read a whole file into memory, unless it exceeds maxChars
+ * characters.
+ *
+ * @param sizeHint the file size in bytes if known, otherwise 0. A file
+ *        has at most as many characters as bytes, so the buffer can be
+ *        sized up front.
+ * @param size receives the number of characters read
+ * @return true if the file was read completely (or up to the first
+ *         character that could not be decoded), false if it was too large
+ */
+static bool loadContents(std::wistream &in, size_t const maxChars, std::uintmax_t const sizeHint,
+                         CScanBuffer &buffer, size_t &size) {
+    size = 0;
+
+    if(sizeHint > 0) {
+        // One more than the size, so that reaching the end of the file
+        // is noticed without growing the buffer.
+        buffer.reserve(static_cast<size_t>(std::min<std::uintmax_t>(sizeHint + 1, maxChars)));
+    }
+
+    while(in.good() && size < maxChars) {
+        size_t const chunkChars = std::min<size_t>(SHARED_SCAN_CHUNK_CHARS, maxChars - size);
+        wchar_t *const data = buffer.reserve(size + chunkChars, size);
+        in.read(data + size, chunkChars);
+        size += static_cast<size_t>(in.gcount());
+    }
+
+    return !in.good();
+}
+
+CSearchPlan::CSearchPlan(std::vector<IFilter *> const &filters)
+    : m_matchLocator(DEFAULT_MAX_MATCHES_PER_FILE, DEFAULT_SNIPPET_CONTEXT),
+      m_verdictCache(nullptr),
+      m_maxSharedScanChars(DEFAULT_MAX_SHARED_SCAN_CHARS),
+      m_minFileSize(0),
+      m_exactFileSize(0),
+      m_hasExactFileSize(false),
+      m_isSatisfiable(true)
+{
+    std::vector<IFilter const *> flattened;
+
+    for(IFilter const *filter : filters) {
+        addFilter(filter, flattened);
+    }
+
+    // Cheap filters first. The sort is stable, so filters of the same
+    // cost class keep the order the user gave them in.
+    std::stable_sort(flattened.begin(), flattened.end(),
+                     [](IFilter const *a, IFilter const *b) {
+                         return a->getCost() < b->getCost();
+                     });
+
+    std::vector<CFilterContents const *> contentFilters;
+    std::vector<IFilter const *> otherContentFilters;
+
+    for(IFilter const *filter : flattened) {
+        if(filter->getCost() != IFilter::Cost::Content) {
+            CStep step;
+            step.type = StepType::Filter;
+            step.filter = filter;
+            m_steps.push_back(step);
+            continue;
+        }
+
+        auto const *contentFilter = dynamic_cast<CFilterContents const *>(filter);
+
+        if(contentFilter) {
+            deriveSizeBounds(contentFilter);
+            contentFilters.push_back(contentFilter);
+        } else {
+            otherContentFilters.push_back(filter);
+        }
+    }
+
+    if(m_hasExactFileSize && m_exactFileSize < m_minFileSize) {
+        m_isSatisfiable = false;
+    }
+
+    if(m_hasExactFileSize || m_minFileSize > 0) {
+        CStep step;
+        step.type = StepType::SizeCheck;
+        m_steps.push_back(step);
+    }
+
+    if(!contentFilters.empty()) {
+        // Within the scan, literal searches are cheaper than regexes and
+        // should get the chance to reject the file first.
+        std::stable_partition(contentFilters.begin(), contentFilters.end(),
+                              [](CFilterContents const *f) { return !f->isRegex(); });
+
+        CStep step;
+        step.type = StepType::ContentScan;
+        step.contentFilters = std::move(contentFilters);
+        m_steps.push_back(std::move(step));
+    }
+
+    for(IFilter const *filter : otherContentFilters) {
+        CStep step;
+        step.type = StepType::Filter;
+        step.filter = filter;
+        m_steps.push_back(step);
+    }
+}
+
+void CSearchPlan::addFilter(IFilter const *filter, std::vector<IFilter const *> &flattened) {
+    auto const *combine = dynamic_cast<CFilterCombine const *>(filter);
+
+    if(!combine) {
+        flattened.push_back(filter);
+        return;
+    }
+
+    std::vector<IFilter *> const &members = combine->getFilters();
+
+    // An empty combination matches everything and can be dropped.
+    // An AND combination, or any combination of a single filter, is
+    // equivalent to its members being listed at the top level.
+    if(members.empty()) {
+        return;
+    }
+
+    if(combine->getMode() == CFilterCombine::Mode::AND || members.size() == 1) {
+        for(IFilter const *member : members) {
+            addFilter(member, flattened);
+        }
+        return;
+    }
+
+    flattened.push_back(filter);
+}
+
+void CSearchPlan::deriveSizeBounds(CFilterContents const *filter) {
+    // Every character read from a file stream consumes at least one byte
+    // of the file, so a lower bound in characters is also a lower bound
+    // in bytes.
+    std::uintmax_t minLength = 0;
+
+    if(filter->isRegex()) {
+        minLength = CRegexAnalyzer(filter->getMatchText()).getMinLength();
+    } else if(filter->getMaxEdits() > 0) {
+        // Each edit may remove one character of the match text.
+        std::wstring const matchText = filter->getMatchText();
+        minLength = matchText.size() - std::min(matchText.size(), filter->getMaxEdits());
+    } else {
+        std::wstring const matchText = filter->getMatchText();
+        minLength = matchText.size();
+
+        // For a case-sensitive whole match of plain ASCII text, the file
+        // has to consist of exactly those bytes.
+        bool const isAscii = std::all_of(matchText.begin(), matchText.end(),
+                                         [](wchar_t c) { return static_cast<std::uint32_t>(c) < 0x80; });
+
+        if(filter->isWholeMatch() && !filter->isCaseInsensitive() && isAscii) {
+            if(m_hasExactFileSize && m_exactFileSize != matchText.size()) {
+                m_isSatisfiable = false;
+            }
+
+            m_hasExactFileSize = true;
+            m_exactFileSize = matchText.size();
+        }
+    }
+
+    m_minFileSize = std::max(m_minFileSize, minLength);
+}
+
+void CSearchPlan::setMaxBufferSize(size_t const maxBufferChars) {
+    m_maxSharedScanChars = maxBufferChars;
+}
+
+void CSearchPlan::setLocationOptions(size_t const maxMatchesPerFile, size_t const snippetContext) {
+    m_matchLocator = CMatchLocator(maxMatchesPerFile, snippetContext);
+}
+
+bool CSearchPlan::matches(std::filesystem::path const &filePath,
+                          std::vector<CMatchLocation> *locations,
+                          ContentVerdict const *contentVerdict) const {
+    if(!m_isSatisfiable) {
+        return false;
+    }
+
+    for(auto step = m_steps.begin(); step != m_steps.end(); ++step) {
+        if(!contentVerdict || step->type == StepType::Filter) {
+            if(!matchesStep(*step, filePath, locations)) {
+                return false;
+            }
+            continue;
+        }
+
+        // The size check and the content scan follow each other; their
+        // outcome is decided as a whole.
+        auto const contentEnd = std::find_if(step, m_steps.end(), [](CStep const &candidate) {
+            return candidate.type == StepType::Filter;
+        });
+
+        bool const isMatch = (*contentVerdict)([&]() {
+            return std::all_of(step, contentEnd, [&](CStep const &contentStep) {
+                return matchesStep(contentStep, filePath, locations);
+            });
+        });
+
+        if(!isMatch) {
+            return false;
+        }
+
+        step = contentEnd - 1;
+    }
+
+    return true;
+}
+
+bool CSearchPlan::matchesStep(CStep const &step,
+                              std::filesystem::path const &filePath,
+                              std::vector<CMatchLocation> *locations) const {
+    switch(step.type) {
+        case StepType::Filter:
+            if(step.filter->getCost() == IFilter::Cost::Name) {
+                CStageTimer const matchTimer(CSearchStats::Stage::Match);
+                return step.filter->filterFile(filePath);
+            }
+
+            // Filters which read the file record their own stages.
+            return step.filter->filterFile(filePath);
+
+        case StepType::SizeCheck:
+            return checkSize(filePath);
+
+        case StepType::ContentScan:
+            return scanContents(filePath, step.contentFilters, locations);
+    }
+
+    return false;
+}
+
+bool CSearchPlan::needsFileAccess() const {
+    for(CStep const &step : m_steps) {
+        if(step.type != StepType::Filter || step.filter->getCost() != IFilter::Cost::Name) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool CSearchPlan::checkSize(std::filesystem::path const &filePath) const {
+    // The size of a compressed file says nothing about the length of
+    // its text.
+    if(CContentStream::getCompression(filePath) != CContentStream::Compression::None) {
+        return true;
+    }
+
+    CStageTimer const statTimer(CSearchStats::Stage::Stat);
+
+    std::error_code ec;
+    std::uintmax_t const fileSize = std::filesystem::file_size(filePath, ec);
+
+    // If the size is not available, let the content filters decide.
+    if(ec) {
+        return true;
+    }
+
+    if(m_hasExactFileSize && fileSize != m_exactFileSize) {
+        return false;
+    }
+
+    return fileSize >= m_minFileSize;
+}
+
+bool CSearchPlan::scanContents(std::filesystem::path const &filePath,
+                               std::vector<CFilterContents const *> const &contentFilters,
+                               std::vector<CMatchLocation> *locations) const {
+    // With a verdict cache, only the filters without a cached verdict for
+    // this version of the file need to look at its contents. The identity
+    // is taken before reading, so a file modified while it is being read
+    // gets its verdicts stored under the old identity, where they are
+    // never found again.
+    CFileIdentity identity;
+    bool isCacheable = false;
+
+    if(m_verdictCache) {
+        CStageTimer const statTimer(CSearchStats::Stage::Stat);
+        isCacheable = getFileIdentity(filePath, identity);
+    }
+
+    std::vector<CFilterContents const *> uncachedFilters;
+    std::vector<CFilterContents const *> const *scanFilters = &contentFilters;
+
+    if(isCacheable) {
+        for(CFilterContents const *filter : contentFilters) {
+            bool isMatch = false;
+
+            if(!m_verdictCache->find(identity, filter->getFingerprint(), isMatch)) {
+                uncachedFilters.push_back(filter);
+            } else if(!isMatch) {
+                return false;
+            }
+        }
+
+        if(uncachedFilters.empty() && !locations) {
+            return true;
+        }
+
+        scanFilters = &uncachedFilters;
+    }
+
+    auto const applyFilter = [&](CFilterContents const *filter, bool const isMatch) {
+        if(isCacheable) {
+            m_verdictCache->store(identity, filter->getFingerprint(), isMatch);
+        }
+        return isMatch;
+    };
+
+    // A single filter streams the file itself and can stop reading early,
+    // unless we need the contents afterwards to locate the matches.
+    if(scanFilters->size() == 1 && !locations) {
+        CFilterContents const *filter = scanFilters->front();
+        return applyFilter(filter, filter->filterFile(filePath));
+    }
+
+    CStageTimer openTimer(CSearchStats::Stage::Open);
+    CContentStream fileStream(filePath);
+    openTimer.stop();
+
+    if(!fileStream.good()) {
+        return false;
+    }
+
+    // Reused for every file the thread scans. Content filters called
+    // below never use this buffer themselves.
+    static thread_local CScanBuffer contentsBuffer;
+    size_t contentsSize = 0;
+
+    CStageTimer readTimer(CSearchStats::Stage::Read);
+    bool const isLoaded = loadContents(fileStream, m_maxSharedScanChars,
+                                       isCacheable && fileStream.getCompression() == CContentStream::Compression::None
+                                           ? identity.size : 0,
+                                       contentsBuffer, contentsSize);
+    readTimer.addAmount(contentsSize);
+    readTimer.stop();
+    wchar_t const *const contents = contentsBuffer.data();
+
+    if(!isLoaded) {
+        // The file is too large to share one buffer. Fall back to
+        // streaming it through each filter.
+        contentsBuffer.trim(SHARED_SCAN_RETAINED_CHARS);
+
+        for(CFilterContents const *filter : *scanFilters) {
+            if(!applyFilter(filter, filter->filterFile(filePath))) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    CStageTimer matchTimer(CSearchStats::Stage::Match);
+
+    for(CFilterContents const *filter : *scanFilters) {
+        if(!applyFilter(filter, filter->filterBuffer(contents, contentsSize))) {
+            matchTimer.stop();
+            contentsBuffer.trim(SHARED_SCAN_RETAINED_CHARS);
+            return false;
+        }
+    }
+
+    if(locations) {
+        std::vector<std::pair<size_t, size_t>> ranges;
+
+        for(CFilterContents const *filter : contentFilters) {
+            filter->findMatches(contents, contentsSize, m_matchLocator.getMaxMatches(), ranges);
+        }
+
+        m_matchLocator.locate(contents, contentsSize, std::move(ranges), *locations);
+    }
+
+    matchTimer.stop();
+    contentsBuffer.trim(SHARED_SCAN_RETAINED_CHARS);
+
+    return true;
+}
+
+std::wstring CSearchPlan::getText() const {
+    std::wstringstream wss;
+
+    // TODO: Add localization support.
+    static std::wstring const TXTCONST_HEADER = L"Search plan:";
+    static std::wstring const TXTCONST_UNSATISFIABLE = L"No file can match; the filters contradict each other.";
+    static std::wstring const TXTCONST_MATCH_ALL = L"Every file matches.";
+    static std::wstring const TXTCONST_SIZE_EXACT = L"File size is exactly";
+    static std::wstring const TXTCONST_SIZE_MIN = L"File size is at least";
+    static std::wstring const TXTCONST_BYTES = L"bytes";
+    static std::wstring const TXTCONST_CONTENT_SCAN = L"Read file once and check:";
+
+    wss << TXTCONST_HEADER << L"\n";
+
+    if(!m_isSatisfiable) {
+        wss << L"  " << TXTCONST_UNSATISFIABLE << L"\n";
+        return wss.str();
+    }
+
+    if(m_steps.empty()) {
+        wss << L"  " << TXTCONST_MATCH_ALL << L"\n";
+        return wss.str();
+    }
+
+    size_t stepNumber = 1;
+
+    for(CStep const &step : m_steps) {
+        wss << L"  " << stepNumber++ << L". ";
+
+        switch(step.type) {
+            case StepType::Filter:
+                wss << step.filter->getText() << L"\n";
+                break;
+
+            case StepType::SizeCheck:
+                if(m_hasExactFileSize) {
+                    wss << TXTCONST_SIZE_EXACT << L" " << m_exactFileSize;
+                } else {
+                    wss << TXTCONST_SIZE_MIN << L" " << m_minFileSize;
+                }
+                wss << L" " << TXTCONST_BYTES << L"\n";
+                break;
+
+            case StepType::ContentScan:
+                if(step.contentFilters.size() == 1) {
+                    wss << step.contentFilters.front()->getText() << L"\n";
+                } else {
+                    wss << TXTCONST_CONTENT_SCAN << L"\n";
+                    for(CFilterContents const *filter : step.contentFilters) {
+                        wss << L"     - " << filter->getText() << L"\n";
+                    }
+                }
+                break;
+        }
+    }
+
+    return wss.str();
+}
@@ -1,7 +1,17 @@
 // SPDX-License-Identifier: GPL-2.0
 #include <search/CSearchQuery.hpp>
 
-CSearchQuery::CSearchQuery() {
+#include <algorithm>
+#include <utility>
+
+CSearchQuery::CSearchQuery()
+    : m_hasSearchFiles(false),
+      m_respectIgnoreFiles(false),
+      m_followSymlinks(false),
+      m_searchArchives(false),
+      m_maxMatchesPerFile(100),
+      m_snippetContext(80)
+{
     // nothing to do
 }
 
@@ -21,6 +31,19 @@ std::vector<std::filesystem::path> CSearchQuery::getDirectories() const {
     return m_searchPaths;
 }
 
+void CSearchQuery::setSearchFiles(std::vector<CSearchFile> searchFiles) {
+    m_searchFiles = std::move(searchFiles);
+    m_hasSearchFiles = true;
+}
+
+std::vector<CSearchFile> const &CSearchQuery::getSearchFiles() const {
+    return m_searchFiles;
+}
+
+bool CSearchQuery::hasSearchFiles() const {
+    return m_hasSearchFiles;
+}
+
 void CSearchQuery::setFilters(std::vector<IFilter *> const &filters) {
     m_filters = filters;
 }
@@ -29,6 +52,119 @@ std::vector<IFilter *> CSearchQuery::getFilters() const {
     return m_filters;
 }
 
+void CSearchQuery::setRespectIgnoreFiles(bool const respectIgnoreFiles) {
+    m_respectIgnoreFiles = respectIgnoreFiles;
+}
+
+bool CSearchQuery::isRespectIgnoreFiles() const {
+    return m_respectIgnoreFiles;
+}
+
+void CSearchQuery::setFollowSymlinks(bool const followSymlinks) {
+    m_followSymlinks = followSymlinks;
+}
+
+bool CSearchQuery::isFollowSymlinks() const {
+    return m_followSymlinks;
+}
+
+void CSearchQuery::setSearchArchives(bool const searchArchives) {
+    m_searchArchives = searchArchives;
+}
+
+bool CSearchQuery::isSearchArchives() const {
+    return m_searchArchives;
+}
+
+void CSearchQuery::setMaxMatchesPerFile(size_t const maxMatchesPerFile) {
+    m_maxMatchesPerFile = maxMatchesPerFile;
+}
+
+size_t CSearchQuery::getMaxMatchesPerFile() const {
+    return m_maxMatchesPerFile;
+}
+
+void CSearchQuery::setSnippetContext(size_t const snippetContext) {
+    m_snippetContext = snippetContext;
+}
+
+size_t CSearchQuery::getSnippetContext() const {
+    return m_snippetContext;
+}
+
+void CSearchQuery::setRanking(CRanking const &ranking) {
+    m_ranking = ranking;
+}
+
+CRanking CSearchQuery::getRanking() const {
+    return m_ranking;
+}
+
+std::wstring CSearchQuery::getKey() const {
+    // The results of a list of files are not worth caching; refining the
+    // same results twice is rare.
+    if(m_hasSearchFiles) {
+        return std::wstring();
+    }
+
+    std::vector<std::wstring> rootKeys;
+    std::vector<std::wstring> filterKeys;
+
+    for(std::filesystem::path const &searchPath : m_searchPaths) {
+        std::error_code ec;
+        std::filesystem::path rootPath = std::filesystem::absolute(searchPath, ec).lexically_normal();
+
+        if(ec) {
+            rootPath = searchPath;
+        }
+
+        // "dir/" and "dir" are the same root.
+        if(!rootPath.has_filename() && rootPath.has_relative_path()) {
+            rootPath = rootPath.parent_path();
+        }
+
+        rootKeys.push_back(rootPath.generic_wstring());
+    }
+
+    for(IFilter const *filter : m_filters) {
+        std::wstring const filterKey = filter->getKey();
+
+        if(filterKey.empty()) {
+            return std::wstring();
+        }
+
+        filterKeys.push_back(filterKey);
+    }
+
+    std::sort(rootKeys.begin(), rootKeys.end());
+    std::sort(filterKeys.begin(), filterKeys.end());
+
+    // Every part is length-prefixed, so no two different queries can
+    // produce the same key.
+    std::wstring key = L"query:ignore=";
+    key += m_respectIgnoreFiles ? L"1" : L"0";
+
+    // Appended only when set, so that keys of existing cache files stay
+    // valid.
+    if(m_followSymlinks) {
+        key += L";follow=1";
+    }
+
+    if(m_searchArchives) {
+        key += L";archives=1";
+    }
+
+    for(std::wstring const &rootKey : rootKeys) {
+        key += L";root=" + std::to_wstring(rootKey.size()) + L":" + rootKey;
+    }
+
+    for(std::wstring const &filterKey : filterKeys) {
+        key += L";filter=" + std::to_wstring(filterKey.size()) + L":" + filterKey;
+    }
+
+    return key;
+}
+
 void CSearchQuery::addResultObserver(ISearchObserver *observer) {
     m_observers.push_back(observer);
 }
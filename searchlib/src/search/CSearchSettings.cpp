@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CSearchSettings.hpp>
+
+#include <algorithm>
+
+// By default, file buffers may use this fraction of the available memory.
+#define DEFAULT_MEMORY_BUDGET_DIVISOR 8
+
+// Used when the available memory is unknown.
+#define FALLBACK_MEMORY_BUDGET (256ULL * 1024 * 1024)
+
+// A worker's buffer never shrinks below this many characters, however
+// small the budget, so that reading stays efficient.
+#define MIN_BUFFER_CHARS_PER_WORKER 4096
+
+// Unless set otherwise, this many batches of files per worker may wait to
+// be searched. A few are enough to keep every worker busy while the
+// enumeration gets ahead again.
+#define DEFAULT_QUEUED_BATCHES_PER_WORKER 4
+
+static CSystemResources const &getProcessResources() {
+    // Detecting the resources reads several files, so do it only once.
+    static CSystemResources const resources = getSystemResources();
+    return resources;
+}
+
+CSearchSettings::CSearchSettings()
+    : CSearchSettings(getProcessResources())
+{
+    // nothing to do
+}
+
+CSearchSettings::CSearchSettings(CSystemResources const &resources)
+    : m_workerThreads(std::max<size_t>(resources.cpuCount, 1)),
+      m_ioConcurrency(m_workerThreads),
+      m_memoryBudget(FALLBACK_MEMORY_BUDGET),
+      m_maxQueuedBatches(0),
+      m_collectStats(true),
+      m_priority(CExecutor::Priority::Normal),
+      m_weight(1)
+{
+    if(resources.memoryBytes > 0) {
+        m_memoryBudget = std::clamp(resources.memoryBytes / DEFAULT_MEMORY_BUDGET_DIVISOR,
+                                    MIN_MEMORY_BUDGET, MAX_DEFAULT_MEMORY_BUDGET);
+    }
+}
+
+void CSearchSettings::setWorkerThreads(size_t const workerThreads) {
+    m_workerThreads = std::max<size_t>(workerThreads, 1);
+}
+
+void CSearchSettings::setIoConcurrency(size_t const ioConcurrency) {
+    m_ioConcurrency = std::max<size_t>(ioConcurrency, 1);
+}
+
+void CSearchSettings::setWeight(unsigned const weight) {
+    m_weight = std::max(weight, 1u);
+}
+
+void CSearchSettings::setMemoryBudget(std::uint64_t const memoryBudget) {
+    m_memoryBudget = memoryBudget;
+}
+
+size_t CSearchSettings::getBufferCharsPerWorker() const {
+    std::uint64_t const chars = m_memoryBudget / m_workerThreads / sizeof(wchar_t);
+    return static_cast<size_t>(std::max<std::uint64_t>(chars, MIN_BUFFER_CHARS_PER_WORKER));
+}
+
+size_t CSearchSettings::getMaxQueuedBatches() const {
+    if(m_maxQueuedBatches == 0) {
+        return m_workerThreads * DEFAULT_QUEUED_BATCHES_PER_WORKER;
+    }
+
+    return m_maxQueuedBatches;
+}
@@ -0,0 +1,228 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CSearchStats.hpp>
+
+#include <iomanip>
+#include <sstream>
+
+// Number of per-thread lookup entries each thread remembers. A thread
+// usually works for one search at a time, so a few are plenty.
+#define THREAD_CACHE_ENTRIES 4
+
+thread_local CSearchStats *CSearchStats::t_current = nullptr;
+
+namespace {
+    struct CThreadCacheEntry {
+        std::uint64_t id = 0;
+        void *counters = nullptr;
+    };
+
+    thread_local CThreadCacheEntry t_threadCache[THREAD_CACHE_ENTRIES];
+    thread_local size_t t_nextCacheEntry = 0;
+
+    std::atomic<std::uint64_t> s_nextId(1);
+}
+
+static size_t getStageIndex(CSearchStats::Stage const stage) {
+    return static_cast<size_t>(stage);
+}
+
+static size_t getBucket(std::uint64_t durationNs) {
+    size_t bucket = 0;
+    while(durationNs > 1 && bucket + 1 < CSearchStats::HISTOGRAM_BUCKETS) {
+        durationNs >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+static void addRelaxed(std::atomic<std::uint64_t> &counter, std::uint64_t const value) {
+    // Only the owning thread writes the counter, so a plain load and store
+    // are enough and avoid the cost of a locked read-modify-write.
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+static std::wstring formatDuration(std::uint64_t const ns) {
+    std::wostringstream wss;
+    wss << std::fixed << std::setprecision(1);
+
+    if(ns >= 1000000000ULL) {
+        wss << (ns / 1e9) << L" s";
+    } else if(ns >= 1000000ULL) {
+        wss << (ns / 1e6) << L" ms";
+    } else if(ns >= 1000ULL) {
+        wss << (ns / 1e3) << L" us";
+    } else {
+        wss << ns << L" ns";
+    }
+
+    return wss.str();
+}
+
+std::uint64_t CSearchStats::CStageSummary::getPercentileNs(double const fraction) const {
+    if(count == 0) {
+        return 0;
+    }
+
+    std::uint64_t const target = static_cast<std::uint64_t>(fraction * static_cast<double>(count - 1)) + 1;
+    std::uint64_t seen = 0;
+
+    for(size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        seen += histogram[i];
+        if(seen >= target) {
+            return std::uint64_t(2) << i;
+        }
+    }
+
+    return std::uint64_t(2) << (HISTOGRAM_BUCKETS - 1);
+}
+
+CSearchStats::CScope::CScope(CSearchStats *stats)
+    : m_previous(t_current)
+{
+    t_current = stats;
+}
+
+CSearchStats::CScope::~CScope() {
+    t_current = m_previous;
+}
+
+CSearchStats::CSearchStats()
+    : m_id(s_nextId++)
+{
+    // nothing to do
+}
+
+CSearchStats::~CSearchStats() {
+    for(CThreadCounters *counters : m_threadCounters) {
+        delete counters;
+    }
+}
+
+CSearchStats::CThreadCounters &CSearchStats::getThreadCounters() {
+    for(CThreadCacheEntry const &entry : t_threadCache) {
+        if(entry.id == m_id) {
+            return *static_cast<CThreadCounters *>(entry.counters);
+        }
+    }
+
+    CThreadCounters *counters = new CThreadCounters();
+    for(size_t stage = 0; stage < STAGE_COUNT; ++stage) {
+        counters->count[stage].store(0, std::memory_order_relaxed);
+        counters->totalNs[stage].store(0, std::memory_order_relaxed);
+        counters->amount[stage].store(0, std::memory_order_relaxed);
+        for(size_t bucket = 0; bucket < HISTOGRAM_BUCKETS; ++bucket) {
+            counters->histogram[stage][bucket].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> const lock(m_mutex);
+        m_threadCounters.push_back(counters);
+    }
+
+    CThreadCacheEntry &entry = t_threadCache[t_nextCacheEntry];
+    t_nextCacheEntry = (t_nextCacheEntry + 1) % THREAD_CACHE_ENTRIES;
+    entry.id = m_id;
+    entry.counters = counters;
+
+    return *counters;
+}
+
+void CSearchStats::record(Stage const stage, std::uint64_t const durationNs, std::uint64_t const amount) {
+    CThreadCounters &counters = getThreadCounters();
+    size_t const index = getStageIndex(stage);
+
+    addRelaxed(counters.count[index], 1);
+    addRelaxed(counters.totalNs[index], durationNs);
+    addRelaxed(counters.histogram[index][getBucket(durationNs)], 1);
+    if(amount > 0) {
+        addRelaxed(counters.amount[index], amount);
+    }
+}
+
+CSearchStats::CStageSummary CSearchStats::getSummary(Stage const stage) const {
+    size_t const index = getStageIndex(stage);
+    CStageSummary summary;
+
+    std::lock_guard<std::mutex> const lock(m_mutex);
+
+    for(CThreadCounters const *counters : m_threadCounters) {
+        summary.count += counters->count[index].load(std::memory_order_relaxed);
+        summary.totalNs += counters->totalNs[index].load(std::memory_order_relaxed);
+        summary.amount += counters->amount[index].load(std::memory_order_relaxed);
+        for(size_t bucket = 0; bucket < HISTOGRAM_BUCKETS; ++bucket) {
+            summary.histogram[bucket] += counters->histogram[index][bucket].load(std::memory_order_relaxed);
+        }
+    }
+
+    return summary;
+}
+
+std::wstring CSearchStats::getStageName(Stage const stage) {
+    switch(stage) {
+        case Stage::DirectoryRead: return L"Directory read";
+        case Stage::Stat: return L"Stat";
+        case Stage::Open: return L"Open";
+        case Stage::Read: return L"Read";
+        case Stage::Match: return L"Match";
+        case Stage::Notify: return L"Notify";
+    }
+    return L"";
+}
+
+char const *CSearchStats::getTraceName(Stage const stage) {
+    switch(stage) {
+        case Stage::DirectoryRead: return "Directory read";
+        case Stage::Stat: return "Stat";
+        case Stage::Open: return "Open";
+        case Stage::Read: return "Read";
+        case Stage::Match: return "Match";
+        case Stage::Notify: return "Notify";
+    }
+    return "";
+}
+
+std::wstring CSearchStats::getAmountUnit(Stage const stage) {
+    switch(stage) {
+        case Stage::DirectoryRead: return L"entries";
+        case Stage::Read: return L"chars";
+        case Stage::Notify: return L"files";
+        default: return L"";
+    }
+}
+
+std::wstring CSearchStats::getText() const {
+    static std::wstring const TXTCONST_HEADER = L"Search statistics:";
+    static std::wstring const TXTCONST_OPERATIONS = L"ops";
+    static std::wstring const TXTCONST_TOTAL = L"total";
+    static std::wstring const TXTCONST_MEAN = L"mean";
+    static std::wstring const TXTCONST_P50 = L"p50 <";
+    static std::wstring const TXTCONST_P99 = L"p99 <";
+
+    std::wostringstream wss;
+    wss << TXTCONST_HEADER << std::endl;
+
+    for(size_t index = 0; index < STAGE_COUNT; ++index) {
+        Stage const stage = static_cast<Stage>(index);
+        CStageSummary const summary = getSummary(stage);
+
+        wss << L"  " << std::left << std::setw(16) << (getStageName(stage) + L":")
+            << std::right << summary.count << L" " << TXTCONST_OPERATIONS;
+
+        if(summary.count > 0) {
+            wss << L", " << TXTCONST_TOTAL << L" " << formatDuration(summary.totalNs)
+                << L", " << TXTCONST_MEAN << L" " << formatDuration(summary.totalNs / summary.count)
+                << L", " << TXTCONST_P50 << L" " << formatDuration(summary.getPercentileNs(0.5))
+                << L", " << TXTCONST_P99 << L" " << formatDuration(summary.getPercentileNs(0.99));
+        }
+
+        std::wstring const unit = getAmountUnit(stage);
+        if(!unit.empty()) {
+            wss << L", " << summary.amount << L" " << unit;
+        }
+
+        wss << std::endl;
+    }
+
+    return wss.str();
+}
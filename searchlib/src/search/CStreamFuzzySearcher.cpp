@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CStreamFuzzySearcher.hpp>
+
+#include <search/CScanBuffer.hpp>
+#include <search/CSearchStats.hpp>
+
+#include <algorithm>
+#include <string>
+
+CStreamFuzzySearcher::CStreamFuzzySearcher(std::wstring const &matchText,
+                                           size_t const maxEdits,
+                                           bool const caseInsensitive,
+                                           bool const wholeMatch,
+                                           size_t const maxBufferSize)
+    : m_matcher(matchText, caseInsensitive, wholeMatch),
+      m_reverseMatcher(std::wstring(matchText.rbegin(), matchText.rend()), caseInsensitive, true),
+      m_matchLength(matchText.size()),
+      m_maxEdits(maxEdits),
+      m_isWholeMatch(wholeMatch),
+      m_maxBufferSize(maxBufferSize)
+{
+    // nothing to do
+}
+
+void CStreamFuzzySearcher::setMaxBufferSize(size_t const maxBufferChars) {
+    m_maxBufferSize = maxBufferChars;
+}
+
+bool CStreamFuzzySearcher::searchText(std::wistream &in) const {
+    return scanStream(in, m_maxEdits) != CFuzzyMatcher::NO_MATCH;
+}
+
+size_t CStreamFuzzySearcher::findBestDistance(std::wistream &in) const {
+    return scanStream(in, 0);
+}
+
+size_t CStreamFuzzySearcher::scanStream(std::wistream &in, size_t const stopDistance) const {
+    if(!in.good()) {
+        return CFuzzyMatcher::NO_MATCH;
+    }
+
+    // The matcher keeps its state between chunks, so unlike exact
+    // searches, chunks need not overlap and can be of any size.
+    size_t const bufferLen = std::max<size_t>(m_maxBufferSize, 1);
+
+    static thread_local CScanBuffer scanBuffer;
+    wchar_t *const buffer = scanBuffer.reserve(bufferLen);
+
+    CFuzzyMatcher::CScan scan;
+    m_matcher.beginScan(scan, m_maxEdits, stopDistance);
+
+    while(!scan.isDecided() && in.good()) {
+        CStageTimer readTimer(CSearchStats::Stage::Read);
+        in.read(buffer, bufferLen);
+        size_t const charsRead = in.gcount();
+        readTimer.addAmount(charsRead);
+        readTimer.stop();
+
+        if(charsRead == 0) {
+            break;
+        }
+
+        CStageTimer const matchTimer(CSearchStats::Stage::Match);
+        m_matcher.continueScan(scan, buffer, charsRead);
+    }
+
+    // A whole match is only decided early if it failed, and then
+    // finishScan reports that as well.
+    return m_matcher.finishScan(scan);
+}
+
+bool CStreamFuzzySearcher::searchBuffer(wchar_t const *text, size_t const size) const {
+    return m_matcher.getDistance(text, size, m_maxEdits) != CFuzzyMatcher::NO_MATCH;
+}
+
+size_t CStreamFuzzySearcher::findBestDistance(wchar_t const *text, size_t const size) const {
+    CFuzzyMatcher::CScan scan;
+    m_matcher.beginScan(scan, m_maxEdits, 0);
+    m_matcher.continueScan(scan, text, size);
+    return m_matcher.finishScan(scan);
+}
+
+void CStreamFuzzySearcher::findMatches(wchar_t const *text,
+                                       size_t const size,
+                                       size_t const maxMatches,
+                                       std::vector<std::pair<size_t, size_t>> &matches) const {
+    if(m_isWholeMatch) {
+        if(maxMatches > 0 && searchBuffer(text, size)) {
+            matches.emplace_back(0, size);
+        }
+        return;
+    }
+
+    if(m_matchLength == 0) {
+        return;
+    }
+
+    CFuzzyMatcher::CScan scan;
+    m_matcher.beginScan(scan, m_maxEdits, CFuzzyMatcher::NO_MATCH);
+
+    // Consecutive ends within the maximum distance belong to the same
+    // occurrence; it is reported where it ends closest to the match text.
+    size_t runDistance = CFuzzyMatcher::NO_MATCH;
+    size_t runEnd = 0;
+    size_t previousEnd = 0;
+    size_t found = 0;
+
+    auto const report = [&]() {
+        size_t const start = findMatchStart(text, runEnd, previousEnd);
+        matches.emplace_back(start, runEnd - start);
+        previousEnd = runEnd;
+        runDistance = CFuzzyMatcher::NO_MATCH;
+        ++found;
+    };
+
+    for(size_t i = 0; i < size && found < maxMatches; ++i) {
+        m_matcher.continueScan(scan, text + i, 1);
+        size_t const distance = scan.getDistance();
+
+        if(distance <= m_maxEdits) {
+            if(distance < runDistance) {
+                runDistance = distance;
+                runEnd = i + 1;
+            }
+        } else if(runDistance != CFuzzyMatcher::NO_MATCH) {
+            report();
+        }
+    }
+
+    if(runDistance != CFuzzyMatcher::NO_MATCH && found < maxMatches) {
+        report();
+    }
+}
+
+size_t CStreamFuzzySearcher::findMatchStart(wchar_t const *text, size_t const end, size_t const floor) const {
+    // A match within the maximum distance is at most that much longer
+    // than the match text.
+    size_t const length = std::min(end - floor, m_matchLength + m_maxEdits);
+    std::wstring const reversed(std::make_reverse_iterator(text + end),
+                                std::make_reverse_iterator(text + end - length));
+
+    // Matching the reversed match text against prefixes of the reversed
+    // text finds the closest match that ends at end.
+    CFuzzyMatcher::CScan scan;
+    m_reverseMatcher.beginScan(scan, m_maxEdits, CFuzzyMatcher::NO_MATCH);
+    m_reverseMatcher.continueScan(scan, reversed.data(), reversed.size());
+
+    // Even a match made up of deletions only covers a character.
+    return end - std::max<size_t>(scan.getBestEnd(), 1);
+}
@@ -1,25 +1,129 @@
 // SPDX-License-Identifier: GPL-2.0
 #include <search/CStreamRegexSearcher.hpp>
 
+#include <search/CRegexAnalyzer.hpp>
+#include <search/CScanBuffer.hpp>
+#include <search/CSearchStats.hpp>
+#include <search/StreamBuffers.hpp>
+
+#include <algorithm>
+#include <locale>
 #include <regex>
 #include <string>
 #include <istream>
 #include <iterator>
+#include <type_traits>
+
+#define READ_CHUNK_CHARS (64 * 1024)
+
+// The thread's buffer is kept between files unless it grew beyond this
+// many characters.
+#define MAX_RETAINED_CHARS (1024 * 1024)
+
+/**
+ * @brief Read the rest of a stream into a buffer.
+ * @return the number of characters read
+ */
+template<typename CharT>
+static size_t readAll(std::basic_istream<CharT> &in, CBasicScanBuffer<CharT> &buffer) {
+    size_t size = 0;
+
+    CStageTimer readTimer(CSearchStats::Stage::Read);
+    while(in.good()) {
+        CharT *const data = buffer.reserve(size + READ_CHUNK_CHARS, size);
+        in.read(data + size, READ_CHUNK_CHARS);
+        size += static_cast<size_t>(in.gcount());
+    }
+    readTimer.addAmount(size);
+    readTimer.stop();
+
+    return size;
+}
 
 CStreamRegexSearcher::CStreamRegexSearcher(std::wstring const& pattern,
                                                   bool caseInsensitive,
                                                   bool wholeMatch)
-    : m_pattern(pattern),
+    : m_byteProgram(nullptr),
+      m_pattern(pattern),
       m_isCaseInsensitive(caseInsensitive),
       m_isWholeMatch(wholeMatch)
 {
+    CRegexAnalyzer const analyzer(pattern);
+    m_isLineBound = analyzer.isLineBound();
+
+    compile(m_program, pattern, analyzer);
+
+    // On ASCII text, a pattern written in ASCII matches the same bytes as
+    // characters, provided that case folding keeps ASCII within ASCII.
+    bool const isAscii = std::all_of(pattern.begin(), pattern.end(), [](wchar_t const c) {
+        return static_cast<std::make_unsigned_t<wchar_t>>(c) < 0x80;
+    });
+
+    if(isAscii) {
+        m_byteProgram = new CProgram<char>;
+
+        try {
+            compile(*m_byteProgram, std::string(pattern.begin(), pattern.end()), analyzer);
+        } catch(std::regex_error const &) {
+            // Escapes of characters beyond a byte, for example.
+            delete m_byteProgram;
+            m_byteProgram = nullptr;
+        }
+    }
+
+    if(m_byteProgram && caseInsensitive) {
+        std::ctype<char> const &ctype = std::use_facet<std::ctype<char>>(m_byteProgram->regex.getloc());
+
+        for(int c = 0; c < 0x80; ++c) {
+            if(static_cast<unsigned char>(ctype.tolower(static_cast<char>(c))) >= 0x80) {
+                delete m_byteProgram;
+                m_byteProgram = nullptr;
+                break;
+            }
+        }
+    }
+}
+
+CStreamRegexSearcher::~CStreamRegexSearcher() {
+    delete m_byteProgram;
+}
+
+template<typename CharT>
+void CStreamRegexSearcher::compile(CProgram<CharT> &program,
+                                   std::basic_string<CharT> const &pattern,
+                                   CRegexAnalyzer const &analyzer) const {
     auto flags = std::regex_constants::ECMAScript;
 
-    if(caseInsensitive) {
+    if(m_isCaseInsensitive) {
         flags |= std::regex_constants::icase;
     }
 
-    m_regex = std::wregex(pattern, flags);
+    program.regex = std::basic_regex<CharT>(pattern, flags);
+
+    // The analyzer's literals are ASCII whenever the pattern is.
+    for(std::wstring const &literal : analyzer.getRequiredLiterals()) {
+        program.requiredLiterals.emplace_back(literal.begin(), literal.end());
+    }
+
+    std::wstring const prefix = analyzer.getRequiredPrefix();
+    program.requiredPrefix.assign(prefix.begin(), prefix.end());
+
+    // Case-insensitive regexes compare characters folded by their
+    // locale's ctype, so the literals are folded alike.
+    if(m_isCaseInsensitive) {
+        std::ctype<CharT> const &ctype = std::use_facet<std::ctype<CharT>>(program.regex.getloc());
+
+        for(std::basic_string<CharT> &literal : program.requiredLiterals) {
+            ctype.tolower(literal.data(), literal.data() + literal.size());
+        }
+        ctype.tolower(program.requiredPrefix.data(), program.requiredPrefix.data() + program.requiredPrefix.size());
+    }
+
+    // The longest literal is the rarest, most likely.
+    std::stable_sort(program.requiredLiterals.begin(), program.requiredLiterals.end(),
+                     [](std::basic_string<CharT> const &a, std::basic_string<CharT> const &b) {
+                         return a.size() > b.size();
+                     });
 }
 
 bool CStreamRegexSearcher::searchText(std::wistream &in) const
@@ -30,13 +134,160 @@ bool CStreamRegexSearcher::searchText(std::wistream &in) const
 
     // Read the entire stream into a buffer
     // and apply the regex search to the entire buffer.
-    std::wstring contents{ std::istreambuf_iterator<wchar_t>(in),
-                           std::istreambuf_iterator<wchar_t>() };
+    // The buffer is reused for every file the thread searches.
+    static thread_local CScanBuffer scanBuffer;
+    size_t const size = readAll(in, scanBuffer);
+
+    CStageTimer matchTimer(CSearchStats::Stage::Match);
+    bool const isMatch = searchBuffer(scanBuffer.data(), size);
+    matchTimer.stop();
+
+    scanBuffer.trim(MAX_RETAINED_CHARS);
+    return isMatch;
+}
+
+CStreamRegexSearcher::ByteResult CStreamRegexSearcher::searchBytes(std::istream &in) const
+{
+    if(!m_byteProgram) {
+        return ByteResult::NeedsDecoding;
+    }
+
+    if(!in.good()) {
+        return ByteResult::NoMatch;
+    }
+
+    static thread_local CBasicScanBuffer<char> scanBuffer;
+    CAsciiBuffer asciiBuffer(in.rdbuf());
+    std::istream asciiStream(&asciiBuffer);
+    size_t const size = readAll(asciiStream, scanBuffer);
+
+    ByteResult result = ByteResult::NeedsDecoding;
+
+    if(!asciiBuffer.isTruncated()) {
+        CStageTimer matchTimer(CSearchStats::Stage::Match);
+        result = search(*m_byteProgram, scanBuffer.data(), size) ? ByteResult::Match : ByteResult::NoMatch;
+        matchTimer.stop();
+    }
+
+    scanBuffer.trim(MAX_RETAINED_CHARS);
+    return result;
+}
+
+bool CStreamRegexSearcher::searchBuffer(wchar_t const *text, size_t const size) const
+{
+    return search(m_program, text, size);
+}
+
+template<typename CharT>
+bool CStreamRegexSearcher::search(CProgram<CharT> const &program, CharT const *text, size_t const size) const
+{
+    if(!program.requiredLiterals.empty()) {
+        std::basic_string<CharT> foldedText;
+        std::basic_string_view<CharT> haystack(text, size);
+
+        if(m_isCaseInsensitive) {
+            foldedText.assign(text, size);
+            std::use_facet<std::ctype<CharT>>(program.regex.getloc()).tolower(foldedText.data(),
+                                                                              foldedText.data() + size);
+            haystack = foldedText;
+        }
+
+        for(std::basic_string<CharT> const &literal : program.requiredLiterals) {
+            if(haystack.find(literal) == std::basic_string_view<CharT>::npos) {
+                return false;
+            }
+        }
+
+        if(!m_isWholeMatch && (m_isLineBound || !program.requiredPrefix.empty())) {
+            return searchNearLiterals(program, text, haystack, size);
+        }
+    }
 
     // Either match or search depending on the provided option
     if(m_isWholeMatch) {
-        return std::regex_match(contents, m_regex);
+        return std::regex_match(text, text + size, program.regex);
     } else {
-        return std::regex_search(contents, m_regex);
+        return std::regex_search(text, text + size, program.regex);
+    }
+}
+
+template<typename CharT>
+bool CStreamRegexSearcher::searchNearLiterals(CProgram<CharT> const &program,
+                                              CharT const *text,
+                                              std::basic_string_view<CharT> const foldedText,
+                                              size_t const size) const
+{
+    using StringView = std::basic_string_view<CharT>;
+
+    bool const isAtPrefix = !program.requiredPrefix.empty();
+    std::basic_string<CharT> const &literal = isAtPrefix ? program.requiredPrefix : program.requiredLiterals.front();
+    CharT const newline = static_cast<CharT>('\n');
+    StringView const lines(text, size);
+    size_t pos = foldedText.find(literal);
+
+    while(pos != StringView::npos) {
+        size_t start = pos;
+        size_t end = size;
+
+        if(m_isLineBound) {
+            size_t const newlineAfter = lines.find(newline, pos);
+            end = newlineAfter == StringView::npos ? size : newlineAfter;
+
+            if(!isAtPrefix) {
+                size_t const newlineBefore = lines.rfind(newline, pos);
+                start = newlineBefore == StringView::npos ? 0 : newlineBefore + 1;
+            }
+        }
+
+        // The regex must see the range as part of the text: ^ and \b look
+        // at the character before it, and $ only matches at the end of
+        // the text.
+        auto flags = std::regex_constants::match_default;
+
+        if(start > 0) {
+            flags |= std::regex_constants::match_prev_avail;
+        }
+        if(end < size) {
+            flags |= std::regex_constants::match_not_eol;
+        }
+        if(isAtPrefix) {
+            flags |= std::regex_constants::match_continuous;
+        }
+
+        if(std::regex_search(text + start, text + end, program.regex, flags)) {
+            return true;
+        }
+
+        // A match at a prefix may start at the next character, a match
+        // on a line not before the next line.
+        if(isAtPrefix) {
+            pos = foldedText.find(literal, pos + 1);
+        } else {
+            pos = end < size ? foldedText.find(literal, end + 1) : StringView::npos;
+        }
+    }
+
+    return false;
+}
+
+void CStreamRegexSearcher::findMatches(wchar_t const *text,
+                                       size_t const size,
+                                       size_t const maxMatches,
+                                       std::vector<std::pair<size_t, size_t>> &matches) const
+{
+    if(m_isWholeMatch) {
+        if(maxMatches > 0 && searchBuffer(text, size)) {
+            matches.emplace_back(0, size);
+        }
+        return;
+    }
+
+    using Iterator = std::regex_iterator<wchar_t const *>;
+
+    size_t found = 0;
+
+    for(Iterator it(text, text + size, m_program.regex), end; it != end && found < maxMatches; ++it) {
+        matches.emplace_back(static_cast<size_t>(it->position()), static_cast<size_t>(it->length()));
+        found++;
     }
 }
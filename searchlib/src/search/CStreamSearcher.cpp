@@ -1,157 +1,105 @@
 // SPDX-License-Identifier: GPL-2.0
 #include <search/CStreamSearcher.hpp>
 
-#include <StringUtil.hpp>
+#include <search/StreamBuffers.hpp>
 
-#include <vector>
+#include <algorithm>
+#include <cwctype>
+#include <string>
+#include <type_traits>
+
+static bool isAscii(std::wstring const &text) {
+    return std::all_of(text.begin(), text.end(), [](wchar_t const c) {
+        return static_cast<std::make_unsigned_t<wchar_t>>(c) < 0x80;
+    });
+}
+
+/**
+ * @brief Whether case folding keeps ASCII letters within ASCII, so that
+ * the byte searcher folds them as the wide one does. Turkish locales, for
+ * one, fold 'I' to a dotless i outside ASCII.
+ */
+static bool foldsAsciiToAscii() {
+    for(wint_t c = 0; c < 0x80; ++c) {
+        if(std::towlower(c) >= 0x80) {
+            return false;
+        }
+    }
+    return true;
+}
 
 CStreamSearcher::CStreamSearcher(std::wstring const &matchText,
                 bool const caseInsensitive,
                 bool const wholeMatch,
                 size_t const maxBufferSize)
-    : m_isCaseInsensitive(caseInsensitive),
-    m_isWholeMatch(wholeMatch),
-    m_maxBufferSize(maxBufferSize)
+    : m_searcher(matchText, caseInsensitive, wholeMatch, maxBufferSize),
+      m_byteSearcher(nullptr)
 {
-    if(caseInsensitive) {
-        // If the match is case-insensitive, initialize the
-        // match text with the lowercase version.
-        // This way, avoid calling lower() every call to searchText
-        // and get better performance.
-
-        m_matchText = wlower(matchText);
-    } else {
-        // Otherwise, keep the name the same.
+    // The folded match text, since a character outside ASCII may fold to
+    // an ASCII letter.
+    std::wstring const &foldedText = m_searcher.getMatchText();
 
-        m_matchText = matchText;
+    if(isAscii(foldedText) && (!caseInsensitive || foldsAsciiToAscii())) {
+        m_byteSearcher = new CBasicStreamSearcher<char>(std::string(foldedText.begin(), foldedText.end()),
+                                                        caseInsensitive, wholeMatch, maxBufferSize);
     }
 }
 
-bool CStreamSearcher::searchText(std::wistream &in) const {
-    if(!in.good()) {
-        return false;
-    }
-    
-    size_t const bufferLen = m_maxBufferSize;
-    std::vector<wchar_t> buffer(bufferLen);
-
-    // If this is a whole match, move the buffer window in
-    // even intervals.
-    // Otherwise, the buffer window will be offset
-    // by the size of the match text. This is needed so that
-    // we don't miss matches that overlap a multiple of the
-    // buffer size.
-    size_t const overlapChars = m_isWholeMatch ? 0 : m_matchText.size();
-    size_t bufferPos = 0;
-
-    do {
-        in.read(buffer.data(), bufferLen);
-        size_t const charsRead = in.gcount();
-
-        if(charsRead == 0) {
-            break;
-        }
+CStreamSearcher::~CStreamSearcher() {
+    delete m_byteSearcher;
+}
 
-        bool bufferResult;
-
-        if(m_isWholeMatch) {
-            bufferResult = bufferedMatch(buffer.data(), charsRead, bufferPos);
-
-            // for a full match:
-            // every chunk must match.
-            // if any chunk does not match,
-            // then fail
-            if(!bufferResult) {
-                return false;
-            }
-        } else {
-            bufferResult = bufferedSearch(buffer.data(), charsRead);
-
-            // for a search:
-            // one chunk must contain the substring
-            // if any chunk contains the substring,
-            // then succeed
-            if(bufferResult) {
-                return true;
-            }
-        }
+void CStreamSearcher::setMaxBufferSize(size_t const maxBufferChars) {
+    m_searcher.setMaxBufferSize(maxBufferChars);
 
-        bufferPos += bufferLen;
-
-        // At this point, if the buffer window should be offset,
-        // then we should rewind
-        if(!in.eof() && overlapChars > 0) {
-            if(in.seekg(-overlapChars, std::ios::cur))
-            {
-                // Ready for next chunk (stream remains good)
-                bufferPos -= overlapChars;
-            } else {
-                // stream refused seek - reset error so the loop
-                // ends cleanly
-                in.clear();
-            }
-        }
-    } while(in.good());
-
-    // if it was a whole match and we got this far,
-    // then the match was successful (no chunk had a mismatch)
-    // and we should return TRUE
-    // Otherwise, if it was a search, then the
-    // search was unsuccessful (no chunk had the substring)
-    // and we should return FALSE
-    return m_isWholeMatch;
+    if(m_byteSearcher) {
+        m_byteSearcher->setMaxBufferSize(maxBufferChars);
+    }
 }
 
-bool CStreamSearcher::bufferedSearch(wchar_t const *text, size_t const size) const {
-    // We will do this differently depending on if the match
-    // should be case-insensitive or not.
-    std::wstring lowerText;
-
-    if(m_isCaseInsensitive) {
-        // If the match is case-insensitive, convert the string
-        // to lowercase.
-        lowerText = wlower(std::wstring(text, size));
-    } else {
-        // Otherwise, search the raw filename.
-        lowerText = std::wstring(text, size);
+bool CStreamSearcher::searchText(std::wistream &in) const {
+    return m_searcher.searchText(in);
+}
+
+CStreamSearcher::ByteResult CStreamSearcher::searchBytes(std::istream &in) const {
+    if(!m_byteSearcher) {
+        return ByteResult::NeedsDecoding;
     }
 
-    // Find the match string in the file name.
-    return lowerText.find(m_matchText) != std::wstring::npos;
-}
+    if(!in.good()) {
+        return ByteResult::NoMatch;
+    }
+
+    // The ASCII bytes before the first other one decode to the same
+    // characters in every encoding, so their verdict is the text's, except
+    // where the rest of the text could change it.
+    CAsciiBuffer asciiBuffer(in.rdbuf());
+    std::istream asciiStream(&asciiBuffer);
+    bool const isMatch = m_byteSearcher->searchText(asciiStream);
 
-bool CStreamSearcher::bufferedMatch(wchar_t const *text, size_t const size, size_t const bufferPos) const {
-    // Example:
-    // * if match string is "ABCDEFGHIJKL"
-    // * buffer pos is 4
-    // * size is 2, then this method should check:
-    // "ABCDEFGHIJKL"
-    //      ^^
-    // and compare against the text buffer,
-    // which is "EF". So in this example,
-    // the function should return true.
-
-    // impossible for this to be a match if
-    // the buffer window runs outside the
-    // match text
-    if(bufferPos + size > m_matchText.size()) {
-        return false;
+    if(!asciiBuffer.isTruncated()) {
+        return isMatch ? ByteResult::Match : ByteResult::NoMatch;
     }
-    
-    // We will do this differently depending on if the match
-    // should be case-insensitive or not.
-    std::wstring lowerText;
-
-    if(m_isCaseInsensitive) {
-        // If the match is case-insensitive, convert the string
-        // to lowercase.
-        lowerText = wlower(std::wstring(text, size));
-    } else {
-        // Otherwise, match the raw text.
-        lowerText = std::wstring(text, size);
+
+    // A search may find the match text after the truncation. A whole
+    // match which failed on the ASCII bytes fails on the text as well,
+    // since no character outside ASCII equals a character of the match
+    // text, but one which succeeded may not have seen all of the text.
+    // Ignoring case, characters outside ASCII may fold to ASCII ones
+    // (KELVIN SIGN to 'k'), so the rest of the text could complete it.
+    if(isWholeMatch()) {
+        return isMatch || isCaseInsensitive() ? ByteResult::NeedsDecoding : ByteResult::NoMatch;
     }
+    return isMatch ? ByteResult::Match : ByteResult::NeedsDecoding;
+}
 
-    std::wstring matchChunk = m_matchText.substr(bufferPos, size);
+bool CStreamSearcher::searchBuffer(wchar_t const *text, size_t const size) const {
+    return m_searcher.searchBuffer(text, size);
+}
 
-    return lowerText == matchChunk;
-}
\ No newline at end of file
+void CStreamSearcher::findMatches(wchar_t const *text,
+                                  size_t const size,
+                                  size_t const maxMatches,
+                                  std::vector<std::pair<size_t, size_t>> &matches) const {
+    m_searcher.findMatches(text, size, maxMatches, matches);
+}
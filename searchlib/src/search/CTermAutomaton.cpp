@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CTermAutomaton.hpp>
+
+#include <StringUtil.hpp>
+
+#include <algorithm>
+#include <cwctype>
+#include <deque>
+
+CTermAutomaton::CTermAutomaton(std::vector<std::wstring> const &terms, bool const caseInsensitive)
+    : m_isCaseInsensitive(caseInsensitive)
+{
+    // Build the trie. State 0 is the root.
+    std::vector<std::vector<std::uint32_t>> ownOutputs(1);
+    m_edges.emplace_back();
+
+    for(std::uint32_t index = 0; index < terms.size(); ++index) {
+        std::wstring const term = m_isCaseInsensitive ? wlower(terms[index]) : terms[index];
+
+        if(term.empty()) {
+            continue;
+        }
+
+        State state = START;
+
+        for(wchar_t const c : term) {
+            State target = findEdge(state, c);
+
+            if(target == START) {
+                target = static_cast<State>(m_edges.size());
+                m_edges.emplace_back();
+                ownOutputs.emplace_back();
+
+                std::vector<CEdge> &edges = m_edges[state];
+                auto const pos = std::lower_bound(edges.begin(), edges.end(), c,
+                                                  [](CEdge const &edge, wchar_t const ch) { return edge.c < ch; });
+                edges.insert(pos, CEdge{ c, target });
+            }
+
+            state = target;
+        }
+
+        ownOutputs[state].push_back(index);
+    }
+
+    size_t const stateCount = m_edges.size();
+    m_failure.assign(stateCount, START);
+    m_directTable.assign(stateCount * DIRECT_CHARS, START);
+    std::vector<std::vector<std::uint32_t>> outputs(stateCount);
+
+    // Breadth first, so that the failure state of every state, which is
+    // shallower, is complete before the state itself.
+    std::deque<State> queue;
+    queue.push_back(START);
+
+    while(!queue.empty()) {
+        State const state = queue.front();
+        queue.pop_front();
+
+        outputs[state] = ownOutputs[state];
+        if(state != START) {
+            std::vector<std::uint32_t> const &inherited = outputs[m_failure[state]];
+            outputs[state].insert(outputs[state].end(), inherited.begin(), inherited.end());
+        }
+
+        for(CEdge const &edge : m_edges[state]) {
+            // The longest proper suffix of the target's path which is
+            // also a path in the trie.
+            State failure = START;
+
+            if(state != START) {
+                State fallback = m_failure[state];
+                while(fallback != START && findEdge(fallback, edge.c) == START) {
+                    fallback = m_failure[fallback];
+                }
+                failure = findEdge(fallback, edge.c);
+            }
+
+            m_failure[edge.target] = failure;
+            queue.push_back(edge.target);
+        }
+
+        for(std::uint32_t c = 0; c < DIRECT_CHARS; ++c) {
+            State const target = findEdge(state, static_cast<wchar_t>(c));
+
+            if(target != START) {
+                m_directTable[state * DIRECT_CHARS + c] = target;
+            } else if(state != START) {
+                m_directTable[state * DIRECT_CHARS + c] = m_directTable[m_failure[state] * DIRECT_CHARS + c];
+            }
+        }
+
+        // Uppercase letters go where their lowercase versions go.
+        if(m_isCaseInsensitive) {
+            for(std::uint32_t c = 'A'; c <= 'Z'; ++c) {
+                m_directTable[state * DIRECT_CHARS + c] = m_directTable[state * DIRECT_CHARS + c + ('a' - 'A')];
+            }
+        }
+    }
+
+    m_outputBegin.reserve(stateCount + 1);
+    for(std::vector<std::uint32_t> const &stateOutputs : outputs) {
+        m_outputBegin.push_back(static_cast<std::uint32_t>(m_outputs.size()));
+        m_outputs.insert(m_outputs.end(), stateOutputs.begin(), stateOutputs.end());
+    }
+    m_outputBegin.push_back(static_cast<std::uint32_t>(m_outputs.size()));
+}
+
+CTermAutomaton::State CTermAutomaton::findEdge(State const state, wchar_t const c) const {
+    std::vector<CEdge> const &edges = m_edges[state];
+    auto const pos = std::lower_bound(edges.begin(), edges.end(), c,
+                                      [](CEdge const &edge, wchar_t const ch) { return edge.c < ch; });
+    return pos != edges.end() && pos->c == c ? pos->target : START;
+}
+
+CTermAutomaton::State CTermAutomaton::nextSlow(State state, wchar_t const c) const {
+    wchar_t const folded = m_isCaseInsensitive ? static_cast<wchar_t>(std::towlower(c)) : c;
+
+    for(;;) {
+        State const target = findEdge(state, folded);
+
+        if(target != START || state == START) {
+            return target;
+        }
+        state = m_failure[state];
+    }
+}
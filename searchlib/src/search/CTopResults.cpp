@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CTopResults.hpp>
+
+#include <algorithm>
+
+CTopResults::CTopResults(CRanking const &ranking)
+    : m_ranking(ranking)
+{
+    // nothing to do
+}
+
+bool CTopResults::ranksBefore(std::int64_t const valueA, std::filesystem::path const &pathA,
+                              std::int64_t const valueB, std::filesystem::path const &pathB) const {
+    if(m_ranking.key != CRanking::Key::Path && valueA != valueB) {
+        return m_ranking.isDescending ? valueA > valueB : valueA < valueB;
+    }
+
+    // Ranking by path, or a tie. Ties always go to the smaller path, so
+    // that the order is total.
+    int const comparison = pathA.compare(pathB);
+
+    if(m_ranking.key == CRanking::Key::Path && m_ranking.isDescending) {
+        return comparison > 0;
+    }
+
+    return comparison < 0;
+}
+
+bool CTopResults::ranksBefore(CRankedResult const &a, CRankedResult const &b) const {
+    return ranksBefore(a.value, a.path, b.value, b.path);
+}
+
+bool CTopResults::wouldKeep(std::int64_t const value, std::filesystem::path const &path) const {
+    if(m_heap.size() < m_ranking.count) {
+        return true;
+    }
+
+    return m_ranking.count > 0 && ranksBefore(value, path, m_heap.front().value, m_heap.front().path);
+}
+
+void CTopResults::add(CRankedResult result) {
+    if(!wouldKeep(result.value, result.path)) {
+        return;
+    }
+
+    // With this comparison, the heap's front is the result which ranks
+    // last.
+    auto const compare = [this](CRankedResult const &a, CRankedResult const &b) {
+        return ranksBefore(a, b);
+    };
+
+    if(m_heap.size() == m_ranking.count) {
+        std::pop_heap(m_heap.begin(), m_heap.end(), compare);
+        m_heap.back() = std::move(result);
+    } else {
+        m_heap.push_back(std::move(result));
+    }
+
+    std::push_heap(m_heap.begin(), m_heap.end(), compare);
+}
+
+void CTopResults::merge(CTopResults &other) {
+    for(CRankedResult &result : other.m_heap) {
+        add(std::move(result));
+    }
+
+    other.m_heap.clear();
+}
+
+std::vector<CRankedResult> CTopResults::getSorted() const {
+    std::vector<CRankedResult> sorted = m_heap;
+
+    std::sort(sorted.begin(), sorted.end(), [this](CRankedResult const &a, CRankedResult const &b) {
+        return ranksBefore(a, b);
+    });
+
+    return sorted;
+}
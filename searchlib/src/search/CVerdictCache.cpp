@@ -0,0 +1,267 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CVerdictCache.hpp>
+
+#include <fstream>
+#include <mutex>
+
+#define SHARD_COUNT 64
+#define INITIAL_SLOTS_PER_SHARD 1024
+
+// Grow a shard's table once it is this full, in percent.
+#define MAX_LOAD_PERCENT 70
+
+#define CACHE_FILE_MAGIC "LSVCACHE"
+#define CACHE_FILE_VERSION 1
+
+static std::uint64_t mix(std::uint64_t value) {
+    // Finalizer of SplitMix64.
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebULL;
+    value ^= value >> 31;
+    return value;
+}
+
+CVerdictCache::CVerdictCache(size_t const maxEntries)
+    : m_maxEntriesPerShard(std::max<size_t>(maxEntries / SHARD_COUNT, 1)),
+      m_shards(SHARD_COUNT)
+{
+    // nothing to do
+}
+
+std::uint64_t CVerdictCache::fingerprint(std::wstring const &filterKey) {
+    // 64-bit FNV-1a over the characters of the key.
+    std::uint64_t value = 0xcbf29ce484222325ULL;
+
+    for(wchar_t const c : filterKey) {
+        value ^= static_cast<std::uint64_t>(static_cast<std::uint32_t>(c));
+        value *= 0x100000001b3ULL;
+    }
+
+    // The lowest bit holds the verdict in a record, and 0 marks an empty
+    // slot, so clear the former and make sure the result is not the latter.
+    return (value & ~1ULL) | 2ULL;
+}
+
+std::uint64_t CVerdictCache::hash(CFileIdentity const &identity, std::uint64_t const filterFingerprint) {
+    std::uint64_t value = mix(identity.inode ^ filterFingerprint);
+    value = mix(value ^ identity.device);
+    value = mix(value ^ identity.size ^ static_cast<std::uint64_t>(identity.modifiedTimeNs));
+    return value;
+}
+
+bool CVerdictCache::matches(CRecord const &record, CFileIdentity const &identity, std::uint64_t const filterFingerprint) {
+    return (record.fingerprintAndVerdict & ~1ULL) == filterFingerprint &&
+           record.inode == identity.inode &&
+           record.device == identity.device &&
+           record.size == identity.size &&
+           record.modifiedTimeNs == identity.modifiedTimeNs;
+}
+
+CVerdictCache::CShard &CVerdictCache::shardFor(std::uint64_t const hashValue) const {
+    // The high bits pick the shard, the low bits the slot within it.
+    return m_shards[(hashValue >> 58) % SHARD_COUNT];
+}
+
+bool CVerdictCache::find(CFileIdentity const &identity, std::uint64_t const filterFingerprint, bool &isMatch) const {
+    std::uint64_t const hashValue = hash(identity, filterFingerprint);
+    CShard const &shard = shardFor(hashValue);
+
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+    if(shard.slots.empty()) {
+        return false;
+    }
+
+    size_t const mask = shard.slots.size() - 1;
+
+    for(size_t i = hashValue & mask; ; i = (i + 1) & mask) {
+        CRecord const &record = shard.slots[i];
+
+        if(record.fingerprintAndVerdict == 0) {
+            return false;
+        }
+
+        if(matches(record, identity, filterFingerprint)) {
+            isMatch = (record.fingerprintAndVerdict & 1) != 0;
+            return true;
+        }
+    }
+}
+
+void CVerdictCache::store(CFileIdentity const &identity, std::uint64_t const filterFingerprint, bool const isMatch) {
+    if(isRecentlyModified(identity)) {
+        return;
+    }
+
+    CRecord const record = {
+        identity.device,
+        identity.inode,
+        identity.size,
+        identity.modifiedTimeNs,
+        filterFingerprint | (isMatch ? 1ULL : 0ULL)
+    };
+
+    std::uint64_t const hashValue = hash(identity, filterFingerprint);
+    CShard &shard = shardFor(hashValue);
+
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    insert(shard, record, hashValue);
+}
+
+void CVerdictCache::insert(CShard &shard, CRecord const &record, std::uint64_t const hashValue) {
+    if(shard.count >= m_maxEntriesPerShard) {
+        // Full. Rather than tracking usage per record, start the shard
+        // over; the verdicts still in use are re-learned on the next run.
+        std::fill(shard.slots.begin(), shard.slots.end(), CRecord());
+        shard.count = 0;
+    }
+
+    if(shard.slots.empty() || (shard.count + 1) * 100 > shard.slots.size() * MAX_LOAD_PERCENT) {
+        std::vector<CRecord> oldSlots(std::max<size_t>(shard.slots.size() * 2, INITIAL_SLOTS_PER_SHARD));
+        oldSlots.swap(shard.slots);
+        shard.count = 0;
+
+        for(CRecord const &oldRecord : oldSlots) {
+            if(oldRecord.fingerprintAndVerdict != 0) {
+                CFileIdentity const identity = { oldRecord.device, oldRecord.inode, oldRecord.size, oldRecord.modifiedTimeNs, 0 };
+                insert(shard, oldRecord, hash(identity, oldRecord.fingerprintAndVerdict & ~1ULL));
+            }
+        }
+    }
+
+    size_t const mask = shard.slots.size() - 1;
+    std::uint64_t const filterFingerprint = record.fingerprintAndVerdict & ~1ULL;
+    CFileIdentity const identity = { record.device, record.inode, record.size, record.modifiedTimeNs, 0 };
+
+    for(size_t i = hashValue & mask; ; i = (i + 1) & mask) {
+        CRecord &slot = shard.slots[i];
+
+        if(slot.fingerprintAndVerdict == 0) {
+            slot = record;
+            shard.count++;
+            return;
+        }
+
+        if(matches(slot, identity, filterFingerprint)) {
+            slot.fingerprintAndVerdict = record.fingerprintAndVerdict;
+            return;
+        }
+    }
+}
+
+size_t CVerdictCache::getEntryCount() const {
+    size_t count = 0;
+
+    for(CShard const &shard : m_shards) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        count += shard.count;
+    }
+
+    return count;
+}
+
+void CVerdictCache::clear() {
+    for(CShard &shard : m_shards) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.slots.clear();
+        shard.slots.shrink_to_fit();
+        shard.count = 0;
+    }
+}
+
+// The cache file holds the raw records in the byte order of the machine
+// that wrote it. A file from a different machine would only produce
+// misses, since its device numbers do not exist here.
+
+bool CVerdictCache::save(std::filesystem::path const &filePath) const {
+    std::ofstream out(filePath, std::ios::binary | std::ios::trunc);
+
+    if(!out.is_open()) {
+        return false;
+    }
+
+    std::uint64_t const version = CACHE_FILE_VERSION;
+    std::uint64_t const count = getEntryCount();
+
+    out.write(CACHE_FILE_MAGIC, sizeof(CACHE_FILE_MAGIC) - 1);
+    out.write(reinterpret_cast<char const *>(&version), sizeof(version));
+    out.write(reinterpret_cast<char const *>(&count), sizeof(count));
+
+    std::uint64_t written = 0;
+
+    for(CShard const &shard : m_shards) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+        for(CRecord const &record : shard.slots) {
+            if(record.fingerprintAndVerdict != 0 && written < count) {
+                out.write(reinterpret_cast<char const *>(&record), sizeof(record));
+                written++;
+            }
+        }
+    }
+
+    // Entries added concurrently after counting are left out; if some
+    // were removed instead, the file would be short, so pad it with
+    // empty records which load() skips.
+    CRecord const empty = CRecord();
+    for(; written < count; ++written) {
+        out.write(reinterpret_cast<char const *>(&empty), sizeof(empty));
+    }
+
+    out.flush();
+    return out.good();
+}
+
+bool CVerdictCache::load(std::filesystem::path const &filePath) {
+    std::ifstream in(filePath, std::ios::binary);
+
+    if(!in.is_open()) {
+        return false;
+    }
+
+    char magic[sizeof(CACHE_FILE_MAGIC) - 1];
+    std::uint64_t version = 0;
+    std::uint64_t count = 0;
+
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char *>(&version), sizeof(version));
+    in.read(reinterpret_cast<char *>(&count), sizeof(count));
+
+    if(!in.good() || std::string(magic, sizeof(magic)) != CACHE_FILE_MAGIC || version != CACHE_FILE_VERSION) {
+        return false;
+    }
+
+    // Check the size up front, so that a truncated file is rejected
+    // before anything is added.
+    std::error_code ec;
+    std::uintmax_t const fileSize = std::filesystem::file_size(filePath, ec);
+    std::uintmax_t const headerSize = sizeof(CACHE_FILE_MAGIC) - 1 + 2 * sizeof(std::uint64_t);
+
+    if(ec || count > (fileSize - headerSize) / sizeof(CRecord)) {
+        return false;
+    }
+
+    for(std::uint64_t i = 0; i < count; ++i) {
+        CRecord record;
+        in.read(reinterpret_cast<char *>(&record), sizeof(record));
+
+        if(!in.good()) {
+            return false;
+        }
+
+        if(record.fingerprintAndVerdict == 0) {
+            continue;
+        }
+
+        CFileIdentity const identity = { record.device, record.inode, record.size, record.modifiedTimeNs, 0 };
+        std::uint64_t const hashValue = hash(identity, record.fingerprintAndVerdict & ~1ULL);
+        CShard &shard = shardFor(hashValue);
+
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        insert(shard, record, hashValue);
+    }
+
+    return true;
+}
@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CVisitedInodes.hpp>
+
+size_t CVisitedInodes::CKeyHash::operator()(CKey const &key) const {
+    // Inode numbers are often sequential, so mix the bits before they
+    // pick shards and buckets.
+    std::uint64_t hash = key.inode * 0x9E3779B97F4A7C15ULL ^ key.device;
+    hash ^= hash >> 29;
+    hash *= 0xBF58476D1CE4E5B9ULL;
+    hash ^= hash >> 32;
+    return static_cast<size_t>(hash);
+}
+
+CVisitedInodes::CVisitedInodes() {
+    // nothing to do
+}
+
+CVisitedInodes::CShard &CVisitedInodes::getShard(CKey const &key) {
+    return m_shards[(CKeyHash()(key) >> 16) % SHARD_COUNT];
+}
+
+CVisitedInodes::State CVisitedInodes::visit(std::uint64_t const device, std::uint64_t const inode) {
+    CKey const key{ device, inode };
+    CShard &shard = getShard(key);
+
+    std::lock_guard<std::mutex> const lock(shard.mutex);
+    auto const inserted = shard.states.emplace(key, State::Pending);
+
+    return inserted.second ? State::New : inserted.first->second;
+}
+
+void CVisitedInodes::setVerdict(std::uint64_t const device, std::uint64_t const inode, bool const isMatch) {
+    CKey const key{ device, inode };
+    CShard &shard = getShard(key);
+
+    std::lock_guard<std::mutex> const lock(shard.mutex);
+    shard.states[key] = isMatch ? State::Match : State::NoMatch;
+}
+
+size_t CVisitedInodes::size() const {
+    size_t count = 0;
+
+    for(CShard const &shard : m_shards) {
+        std::lock_guard<std::mutex> const lock(shard.mutex);
+        count += shard.states.size();
+    }
+
+    return count;
+}
+
+void CVisitedInodes::clear() {
+    for(CShard &shard : m_shards) {
+        std::lock_guard<std::mutex> const lock(shard.mutex);
+        shard.states.clear();
+    }
+}
@@ -0,0 +1,536 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/StreamBuffers.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef LIGHTNING_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef LIGHTNING_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef LIGHTNING_HAVE_LZMA
+#include <lzma.h>
+#endif
+
+// Bytes read from a source at a time
+#define SOURCE_CHUNK_BYTES (64 * 1024)
+
+// Decompressed bytes produced at a time
+#define DECOMPRESSED_CHUNK_BYTES (64 * 1024)
+
+// Characters kept in front of newly decoded ones, so that readers can
+// seek back into text they have already read
+#define HISTORY_CHARS (16 * 1024)
+
+static unsigned char const GZIP_MAGIC[] = { 0x1F, 0x8B };
+static unsigned char const ZSTD_MAGIC[] = { 0x28, 0xB5, 0x2F, 0xFD };
+static unsigned char const XZ_MAGIC[] = { 0xFD, '7', 'z', 'X', 'Z', 0x00 };
+
+using Format = CDecompressingBuffer::Format;
+
+/**
+ * @brief Streaming decoder of one compression format.
+ */
+class IDecoder {
+public:
+    virtual ~IDecoder() = default;
+
+    /**
+     * @brief Decompress as much of the input as fits into the output.
+     * Advances the pointers and decreases the sizes by what was consumed
+     * and produced.
+     *
+     * @param isInputEnd whether the input is all there is
+     * @return false once the data ends or is corrupt
+     */
+    virtual bool decode(unsigned char const *&in, size_t &inSize,
+                        unsigned char *&out, size_t &outSize,
+                        bool const isInputEnd) = 0;
+};
+
+#ifdef LIGHTNING_HAVE_ZLIB
+class CInflateDecoder : public IDecoder {
+public:
+    /**
+     * @param isRaw whether the data is raw deflate data, as in zip
+     *        members, instead of gzip members
+     */
+    explicit CInflateDecoder(bool const isRaw)
+        : m_isRaw(isRaw)
+    {
+        std::memset(&m_stream, 0, sizeof(m_stream));
+
+        // Negative window bits select raw data; 32 added to them detects
+        // gzip and zlib headers.
+        m_isValid = inflateInit2(&m_stream, isRaw ? -15 : 15 + 32) == Z_OK;
+    }
+
+    ~CInflateDecoder() override {
+        if(m_isValid) {
+            inflateEnd(&m_stream);
+        }
+    }
+
+    bool decode(unsigned char const *&in, size_t &inSize,
+                unsigned char *&out, size_t &outSize,
+                bool const isInputEnd) override {
+        if(!m_isValid) {
+            return false;
+        }
+
+        // Chunks are far below the 4 GiB zlib can take at once.
+        m_stream.next_in = const_cast<Bytef *>(in);
+        m_stream.avail_in = static_cast<uInt>(inSize);
+        m_stream.next_out = out;
+        m_stream.avail_out = static_cast<uInt>(outSize);
+
+        int const result = inflate(&m_stream, Z_NO_FLUSH);
+
+        in = m_stream.next_in;
+        inSize = m_stream.avail_in;
+        out = m_stream.next_out;
+        outSize = m_stream.avail_out;
+
+        if(result == Z_STREAM_END) {
+            // Rotated logs are sometimes concatenated gzip members.
+            return !m_isRaw && (inSize > 0 || !isInputEnd) && inflateReset(&m_stream) == Z_OK;
+        }
+
+        if(result == Z_BUF_ERROR) {
+            return !isInputEnd || inSize > 0;
+        }
+
+        return result == Z_OK;
+    }
+
+private:
+    z_stream m_stream;
+    bool m_isRaw;
+    bool m_isValid;
+};
+#endif
+
+#ifdef LIGHTNING_HAVE_ZSTD
+class CZstdDecoder : public IDecoder {
+public:
+    CZstdDecoder()
+        : m_stream(ZSTD_createDStream())
+    {
+        if(m_stream) {
+            ZSTD_initDStream(m_stream);
+        }
+    }
+
+    ~CZstdDecoder() override {
+        ZSTD_freeDStream(m_stream);
+    }
+
+    bool decode(unsigned char const *&in, size_t &inSize,
+                unsigned char *&out, size_t &outSize,
+                bool const isInputEnd) override {
+        if(!m_stream) {
+            return false;
+        }
+
+        ZSTD_inBuffer input = { in, inSize, 0 };
+        ZSTD_outBuffer output = { out, outSize, 0 };
+
+        // Concatenated frames are decoded one after another.
+        size_t const result = ZSTD_decompressStream(m_stream, &output, &input);
+
+        in += input.pos;
+        inSize -= input.pos;
+        out += output.pos;
+        outSize -= output.pos;
+
+        if(ZSTD_isError(result)) {
+            return false;
+        }
+
+        return !isInputEnd || inSize > 0 || output.pos > 0;
+    }
+
+private:
+    ZSTD_DStream *m_stream;
+};
+#endif
+
+#ifdef LIGHTNING_HAVE_LZMA
+class CXzDecoder : public IDecoder {
+public:
+    CXzDecoder()
+        : m_stream(LZMA_STREAM_INIT)
+    {
+        m_isValid = lzma_stream_decoder(&m_stream, UINT64_MAX, LZMA_CONCATENATED) == LZMA_OK;
+    }
+
+    ~CXzDecoder() override {
+        lzma_end(&m_stream);
+    }
+
+    bool decode(unsigned char const *&in, size_t &inSize,
+                unsigned char *&out, size_t &outSize,
+                bool const isInputEnd) override {
+        if(!m_isValid) {
+            return false;
+        }
+
+        m_stream.next_in = in;
+        m_stream.avail_in = inSize;
+        m_stream.next_out = out;
+        m_stream.avail_out = outSize;
+
+        lzma_ret const result = lzma_code(&m_stream, isInputEnd ? LZMA_FINISH : LZMA_RUN);
+
+        in = m_stream.next_in;
+        inSize = m_stream.avail_in;
+        out = m_stream.next_out;
+        outSize = m_stream.avail_out;
+
+        return result == LZMA_OK;
+    }
+
+private:
+    lzma_stream m_stream;
+    bool m_isValid;
+};
+#endif
+
+static IDecoder *createDecoder(Format const format) {
+    switch(format) {
+#ifdef LIGHTNING_HAVE_ZLIB
+        case Format::Gzip:
+            return new CInflateDecoder(false);
+        case Format::Deflate:
+            return new CInflateDecoder(true);
+#endif
+#ifdef LIGHTNING_HAVE_ZSTD
+        case Format::Zstd:
+            return new CZstdDecoder();
+#endif
+#ifdef LIGHTNING_HAVE_LZMA
+        case Format::Xz:
+            return new CXzDecoder();
+#endif
+        default:
+            return nullptr;
+    }
+}
+
+/**
+ * @brief Whether data starts with the magic number of a format. Formats
+ * without a magic number always match.
+ */
+static bool hasMagic(Format const format, char const *data, size_t const size) {
+    unsigned char const *magic = nullptr;
+    size_t magicSize = 0;
+
+    switch(format) {
+        case Format::Gzip:
+            magic = GZIP_MAGIC;
+            magicSize = sizeof(GZIP_MAGIC);
+            break;
+        case Format::Zstd:
+            magic = ZSTD_MAGIC;
+            magicSize = sizeof(ZSTD_MAGIC);
+            break;
+        case Format::Xz:
+            magic = XZ_MAGIC;
+            magicSize = sizeof(XZ_MAGIC);
+            break;
+        case Format::Deflate:
+        case Format::None:
+            return true;
+    }
+
+    return size >= magicSize && std::memcmp(data, magic, magicSize) == 0;
+}
+
+CDecompressingBuffer::CDecompressingBuffer(std::streambuf *source, Format const format)
+    : m_source(source),
+      m_decoder(nullptr),
+      m_format(format),
+      m_input(SOURCE_CHUNK_BYTES),
+      m_inputPos(0),
+      m_inputSize(0),
+      m_isInputEnd(false),
+      m_isDataEnd(false)
+{
+    fillInput();
+
+    if(m_format != Format::None && hasMagic(m_format, m_input.data(), m_inputSize)) {
+        m_decoder = createDecoder(m_format);
+    }
+
+    if(m_decoder) {
+        m_output.resize(DECOMPRESSED_CHUNK_BYTES);
+    } else {
+        m_format = Format::None;
+    }
+
+    setg(m_input.data(), m_input.data(), m_input.data());
+}
+
+CDecompressingBuffer::~CDecompressingBuffer() {
+    delete m_decoder;
+}
+
+bool CDecompressingBuffer::isSupported(Format const format) {
+    switch(format) {
+        case Format::Gzip:
+        case Format::Deflate:
+#ifdef LIGHTNING_HAVE_ZLIB
+            return true;
+#else
+            return false;
+#endif
+        case Format::Zstd:
+#ifdef LIGHTNING_HAVE_ZSTD
+            return true;
+#else
+            return false;
+#endif
+        case Format::Xz:
+#ifdef LIGHTNING_HAVE_LZMA
+            return true;
+#else
+            return false;
+#endif
+        case Format::None:
+            break;
+    }
+
+    return false;
+}
+
+bool CDecompressingBuffer::fillInput() {
+    if(m_isInputEnd) {
+        return false;
+    }
+
+    m_inputSize = static_cast<size_t>(std::max<std::streamsize>(m_source->sgetn(m_input.data(), SOURCE_CHUNK_BYTES), 0));
+    m_inputPos = 0;
+    m_isInputEnd = m_inputSize < SOURCE_CHUNK_BYTES;
+
+    return m_inputSize > 0;
+}
+
+CDecompressingBuffer::int_type CDecompressingBuffer::underflow() {
+    if(gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+
+    if(!m_decoder) {
+        // Pass through: the first chunk was read for the magic number
+        // check, later ones are read here.
+        if(m_inputPos < m_inputSize || fillInput()) {
+            setg(m_input.data(), m_input.data() + m_inputPos, m_input.data() + m_inputSize);
+            m_inputPos = m_inputSize;
+            return traits_type::to_int_type(*gptr());
+        }
+
+        return traits_type::eof();
+    }
+
+    while(!m_isDataEnd) {
+        if(m_inputPos == m_inputSize) {
+            fillInput();
+        }
+
+        auto const *in = reinterpret_cast<unsigned char const *>(m_input.data()) + m_inputPos;
+        size_t inSize = m_inputSize - m_inputPos;
+        auto *out = reinterpret_cast<unsigned char *>(m_output.data());
+        size_t outSize = m_output.size();
+
+        if(!m_decoder->decode(in, inSize, out, outSize, m_isInputEnd)) {
+            m_isDataEnd = true;
+        }
+
+        m_inputPos = m_inputSize - inSize;
+        size_t const produced = m_output.size() - outSize;
+
+        if(produced > 0) {
+            setg(m_output.data(), m_output.data(), m_output.data() + produced);
+            return traits_type::to_int_type(*gptr());
+        }
+    }
+
+    return traits_type::eof();
+}
+
+CWindowBuffer::CWindowBuffer(std::streambuf *source, std::uint64_t const length, std::uint64_t *consumed)
+    : m_source(source),
+      m_remaining(length),
+      m_consumed(consumed),
+      m_buffer(static_cast<size_t>(std::min<std::uint64_t>(length, SOURCE_CHUNK_BYTES)))
+{
+    setg(m_buffer.data(), m_buffer.data(), m_buffer.data());
+}
+
+CWindowBuffer::int_type CWindowBuffer::underflow() {
+    if(gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+
+    if(m_remaining == 0) {
+        return traits_type::eof();
+    }
+
+    std::streamsize const wanted = static_cast<std::streamsize>(std::min<std::uint64_t>(m_remaining, m_buffer.size()));
+    std::streamsize const got = std::max<std::streamsize>(m_source->sgetn(m_buffer.data(), wanted), 0);
+
+    if(m_consumed) {
+        *m_consumed += static_cast<std::uint64_t>(got);
+    }
+
+    // A truncated source ends the window early.
+    m_remaining = got < wanted ? 0 : m_remaining - static_cast<std::uint64_t>(got);
+
+    if(got == 0) {
+        return traits_type::eof();
+    }
+
+    setg(m_buffer.data(), m_buffer.data(), m_buffer.data() + got);
+    return traits_type::to_int_type(*gptr());
+}
+
+CAsciiBuffer::CAsciiBuffer(std::streambuf *source)
+    : m_source(source),
+      m_buffer(SOURCE_CHUNK_BYTES),
+      m_isTruncated(false)
+{
+    setg(m_buffer.data(), m_buffer.data(), m_buffer.data());
+}
+
+CAsciiBuffer::int_type CAsciiBuffer::underflow() {
+    if(gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+
+    if(m_isTruncated) {
+        return traits_type::eof();
+    }
+
+    std::streamsize const got = m_source->sgetn(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+
+    if(got <= 0) {
+        return traits_type::eof();
+    }
+
+    // Check eight bytes at a time for a set high bit, and then find the
+    // first such byte.
+    char const *const begin = m_buffer.data();
+    char const *const end = begin + got;
+    char const *pos = begin;
+
+    for(; end - pos >= 8; pos += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, pos, sizeof(word));
+
+        if(word & 0x8080808080808080ULL) {
+            break;
+        }
+    }
+
+    while(pos < end && static_cast<unsigned char>(*pos) < 0x80) {
+        ++pos;
+    }
+
+    m_isTruncated = pos < end;
+
+    if(pos == begin) {
+        return traits_type::eof();
+    }
+
+    setg(m_buffer.data(), m_buffer.data(), m_buffer.data() + (pos - begin));
+    return traits_type::to_int_type(*gptr());
+}
+
+CWideningBuffer::CWideningBuffer(std::streambuf *source)
+    : m_source(source),
+      m_codecvt(&std::use_facet<std::codecvt<wchar_t, char, std::mbstate_t>>(getloc())),
+      m_state(),
+      m_bytes(SOURCE_CHUNK_BYTES),
+      m_byteCount(0),
+      m_isSourceEnd(false),
+      m_chars(HISTORY_CHARS + SOURCE_CHUNK_BYTES),
+      m_basePosition(0)
+{
+    setg(m_chars.data(), m_chars.data(), m_chars.data());
+}
+
+CWideningBuffer::int_type CWideningBuffer::underflow() {
+    if(gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+
+    // Keep the most recent characters in front of the new ones.
+    size_t const heldChars = egptr() - eback();
+    size_t const keepChars = std::min<size_t>(heldChars, HISTORY_CHARS);
+    wchar_t *const chars = m_chars.data();
+    m_basePosition += heldChars - keepChars;
+    std::memmove(chars, egptr() - keepChars, keepChars * sizeof(wchar_t));
+    setg(chars, chars + keepChars, chars + keepChars);
+
+    while(true) {
+        if(m_byteCount > 0) {
+            char const *nextByte = nullptr;
+            wchar_t *nextChar = nullptr;
+
+            // Every byte makes at most one character, so the characters
+            // of all buffered bytes fit.
+            std::codecvt_base::result const result = m_codecvt->in(
+                m_state,
+                m_bytes.data(), m_bytes.data() + m_byteCount, nextByte,
+                chars + keepChars, chars + m_chars.size(), nextChar);
+
+            m_byteCount -= nextByte - m_bytes.data();
+            std::memmove(m_bytes.data(), nextByte, m_byteCount);
+
+            // Like std::wfilebuf, end the text at the first byte sequence
+            // that cannot be decoded.
+            if(result == std::codecvt_base::error) {
+                m_isSourceEnd = true;
+                m_byteCount = 0;
+            }
+
+            if(nextChar > chars + keepChars) {
+                setg(chars, chars + keepChars, nextChar);
+                return traits_type::to_int_type(*gptr());
+            }
+        }
+
+        if(m_isSourceEnd) {
+            return traits_type::eof();
+        }
+
+        // Append to the bytes left over from an incomplete character.
+        std::streamsize const got = m_source->sgetn(m_bytes.data() + m_byteCount,
+                                                    static_cast<std::streamsize>(m_bytes.size() - m_byteCount));
+
+        if(got <= 0) {
+            m_isSourceEnd = true;
+        } else {
+            m_byteCount += static_cast<size_t>(got);
+        }
+    }
+}
+
+CWideningBuffer::pos_type CWideningBuffer::seekoff(off_type const off, std::ios_base::seekdir const dir,
+                                                   std::ios_base::openmode const which) {
+    if(dir != std::ios_base::cur || !(which & std::ios_base::in)) {
+        return pos_type(off_type(-1));
+    }
+
+    // Only the characters still held can be returned to.
+    if(off < eback() - gptr() || off > egptr() - gptr()) {
+        return pos_type(off_type(-1));
+    }
+
+    gbump(static_cast<int>(off));
+    return pos_type(static_cast<off_type>(m_basePosition + (gptr() - eback())));
+}
@@ -0,0 +1,415 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CArchive.hpp>
+
+#include <search/CContentStream.hpp>
+#include <search/CFilterContents.hpp>
+#include <search/CSearchEngine.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef LIGHTNING_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+class CArchiveMatchCollector : public ISearchObserver {
+public:
+    void onFileMatched(std::filesystem::path const &path) override {
+        std::lock_guard<std::mutex> const lock(m_mutex);
+        m_paths.push_back(path.lexically_relative(m_root).generic_string());
+    }
+
+    std::vector<std::string> getSorted() {
+        std::lock_guard<std::mutex> const lock(m_mutex);
+        std::vector<std::string> paths = m_paths;
+        std::sort(paths.begin(), paths.end());
+        return paths;
+    }
+
+    std::filesystem::path m_root;
+
+private:
+    std::mutex m_mutex;
+    std::vector<std::string> m_paths;
+};
+
+static std::filesystem::path makeArchiveTestDirectory() {
+    std::filesystem::path const dir = std::filesystem::temp_directory_path() / "lightning_search_archive_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    return dir;
+}
+
+/**
+ * @brief Count the spans of a name in a trace written as JSON.
+ */
+static size_t countSpans(std::string const &json, std::string const &name) {
+    std::string const pattern = "\"name\":\"" + name + "\"";
+    size_t count = 0;
+    for(size_t pos = json.find(pattern); pos != std::string::npos; pos = json.find(pattern, pos + 1)) {
+        count++;
+    }
+    return count;
+}
+
+static std::string readMember(std::filesystem::path const &archivePath, std::string const &name) {
+    CContentStream in(CArchive::makeMemberPath(archivePath, name));
+    std::wstring const text((std::istreambuf_iterator<wchar_t>(in)), std::istreambuf_iterator<wchar_t>());
+    return std::string(text.begin(), text.end());
+}
+
+/**
+ * @brief Append a ustar header block and the padded data of one entry.
+ */
+static void appendTarEntry(std::string &tar, std::string const &name, std::string const &data, char const type = '0') {
+    char header[512] = {};
+    std::memcpy(header, name.data(), std::min<size_t>(name.size(), 100));
+    std::snprintf(header + 100, 8, "%07o", 0644);
+    std::snprintf(header + 108, 8, "%07o", 0);
+    std::snprintf(header + 116, 8, "%07o", 0);
+    std::snprintf(header + 124, 12, "%011o", static_cast<unsigned>(data.size()));
+    std::snprintf(header + 136, 12, "%011o", 0);
+    header[156] = type;
+    std::memcpy(header + 257, "ustar", 6);
+    std::memcpy(header + 263, "00", 2);
+
+    unsigned checksum = 8 * ' ';
+    for(size_t i = 0; i < sizeof(header); ++i) {
+        checksum += (i >= 148 && i < 156) ? 0 : static_cast<unsigned char>(header[i]);
+    }
+    std::snprintf(header + 148, 8, "%06o", checksum);
+    header[155] = ' ';
+
+    tar.append(header, sizeof(header));
+    tar += data;
+    tar.append((512 - data.size() % 512) % 512, '\0');
+}
+
+static std::string makeTar(std::vector<std::pair<std::string, std::string>> const &members) {
+    std::string tar;
+
+    appendTarEntry(tar, "dir/", "", '5');
+
+    for(auto const &member : members) {
+        // Names too long for the header come in a GNU long name entry.
+        if(member.first.size() > 100) {
+            appendTarEntry(tar, "././@LongLink", member.first + '\0', 'L');
+        }
+        appendTarEntry(tar, member.first, member.second);
+    }
+
+    tar.append(1024, '\0');
+    return tar;
+}
+
+static void appendU16(std::string &out, std::uint16_t const value) {
+    out += static_cast<char>(value & 0xFF);
+    out += static_cast<char>(value >> 8);
+}
+
+static void appendU32(std::string &out, std::uint32_t const value) {
+    appendU16(out, static_cast<std::uint16_t>(value & 0xFFFF));
+    appendU16(out, static_cast<std::uint16_t>(value >> 16));
+}
+
+/**
+ * @brief Build a zip archive. Members are deflated if zlib is available,
+ * except for the first one, which is always stored.
+ */
+static std::string makeZip(std::vector<std::pair<std::string, std::string>> const &members) {
+    std::string zip;
+    std::string directory;
+
+    for(size_t i = 0; i < members.size(); ++i) {
+        std::string const &name = members[i].first;
+        std::string const &data = members[i].second;
+        std::string stored = data;
+        std::uint16_t method = 0;
+        std::uint32_t crc = 0;
+
+#ifdef LIGHTNING_HAVE_ZLIB
+        crc = static_cast<std::uint32_t>(crc32(0, reinterpret_cast<Bytef const *>(data.data()), static_cast<uInt>(data.size())));
+
+        if(i > 0) {
+            z_stream stream = {};
+            deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+            stored.resize(deflateBound(&stream, static_cast<uLong>(data.size())));
+            stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+            stream.avail_in = static_cast<uInt>(data.size());
+            stream.next_out = reinterpret_cast<Bytef *>(&stored[0]);
+            stream.avail_out = static_cast<uInt>(stored.size());
+            deflate(&stream, Z_FINISH);
+            stored.resize(stream.total_out);
+            deflateEnd(&stream);
+            method = 8;
+        }
+#endif
+
+        std::uint32_t const offset = static_cast<std::uint32_t>(zip.size());
+
+        appendU32(zip, 0x04034b50);
+        appendU16(zip, 20);
+        appendU16(zip, 0);
+        appendU16(zip, method);
+        appendU32(zip, 0);
+        appendU32(zip, crc);
+        appendU32(zip, static_cast<std::uint32_t>(stored.size()));
+        appendU32(zip, static_cast<std::uint32_t>(data.size()));
+        appendU16(zip, static_cast<std::uint16_t>(name.size()));
+        appendU16(zip, 0);
+        zip += name;
+        zip += stored;
+
+        appendU32(directory, 0x02014b50);
+        appendU16(directory, 20);
+        appendU16(directory, 20);
+        appendU16(directory, 0);
+        appendU16(directory, method);
+        appendU32(directory, 0);
+        appendU32(directory, crc);
+        appendU32(directory, static_cast<std::uint32_t>(stored.size()));
+        appendU32(directory, static_cast<std::uint32_t>(data.size()));
+        appendU16(directory, static_cast<std::uint16_t>(name.size()));
+        appendU16(directory, 0);
+        appendU16(directory, 0);
+        appendU16(directory, 0);
+        appendU16(directory, 0);
+        appendU32(directory, 0);
+        appendU32(directory, offset);
+        directory += name;
+    }
+
+    std::uint32_t const directoryOffset = static_cast<std::uint32_t>(zip.size());
+    zip += directory;
+
+    appendU32(zip, 0x06054b50);
+    appendU16(zip, 0);
+    appendU16(zip, 0);
+    appendU16(zip, static_cast<std::uint16_t>(members.size()));
+    appendU16(zip, static_cast<std::uint16_t>(members.size()));
+    appendU32(zip, static_cast<std::uint32_t>(directory.size()));
+    appendU32(zip, directoryOffset);
+    appendU16(zip, 0);
+
+    return zip;
+}
+
+static void writeBinary(std::filesystem::path const &path, std::string const &data) {
+    std::ofstream(path, std::ios::binary) << data;
+}
+
+TEST(Archive, SplitsMemberPaths) {
+    std::filesystem::path const memberPath = CArchive::makeMemberPath("/data/backup.tar.gz", "etc/app.conf");
+    EXPECT_EQ(memberPath.filename(), "app.conf");
+
+    std::filesystem::path archivePath;
+    std::string memberName;
+    ASSERT_TRUE(CArchive::splitMemberPath(memberPath, archivePath, memberName));
+    EXPECT_EQ(archivePath, "/data/backup.tar.gz");
+    EXPECT_EQ(memberName, "etc/app.conf");
+
+    // A directory ending in "!" is not an archive.
+    EXPECT_FALSE(CArchive::splitMemberPath("/data/wow!/file.txt", archivePath, memberName));
+    EXPECT_FALSE(CArchive::splitMemberPath("/data/backup.tar", archivePath, memberName));
+
+    EXPECT_EQ(CArchive::getFormat("a.ZIP"), CArchive::Format::Zip);
+    EXPECT_EQ(CArchive::getFormat("a.tar"), CArchive::Format::Tar);
+    EXPECT_EQ(CArchive::getFormat("a.txt"), CArchive::Format::None);
+}
+
+TEST(Archive, ReadsTarMembersInAnyOrder) {
+    std::filesystem::path const dir = makeArchiveTestDirectory();
+    std::string const longName = "dir/" + std::string(120, 'n') + ".txt";
+    std::string const bigData(100000, 'b');
+
+    writeBinary(dir / "a.tar", makeTar({
+        { "dir/first.txt", "first" },
+        { longName, "long" },
+        { "dir/big.txt", bigData },
+        { "dir/last.txt", "last" },
+    }));
+
+    std::vector<std::string> names;
+    ASSERT_TRUE(CArchive::listMembers(dir / "a.tar", names));
+    EXPECT_EQ(names, (std::vector<std::string>{ "dir/first.txt", longName, "dir/big.txt", "dir/last.txt" }));
+
+    // In order, partly read, then backwards
+    EXPECT_EQ(readMember(dir / "a.tar", "dir/first.txt"), "first");
+    EXPECT_EQ(readMember(dir / "a.tar", longName), "long");
+    EXPECT_EQ(readMember(dir / "a.tar", "dir/last.txt"), "last");
+    EXPECT_EQ(readMember(dir / "a.tar", "dir/big.txt"), bigData);
+    EXPECT_EQ(readMember(dir / "a.tar", "dir/first.txt"), "first");
+
+    // Two members open at once
+    {
+        CContentStream first(CArchive::makeMemberPath(dir / "a.tar", "dir/first.txt"));
+        EXPECT_EQ(readMember(dir / "a.tar", "dir/last.txt"), "last");
+        EXPECT_TRUE(first.good());
+    }
+
+    CContentStream missing(CArchive::makeMemberPath(dir / "a.tar", "dir/missing.txt"));
+    EXPECT_FALSE(missing.good());
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(Archive, ReadsZipMembers) {
+    std::filesystem::path const dir = makeArchiveTestDirectory();
+    std::string const bigData(200000, 'z');
+
+    writeBinary(dir / "b.zip", makeZip({
+        { "stored.txt", "stored text" },
+        { "dir/deflated.txt", "deflated text" },
+        { "dir/big.txt", bigData },
+    }));
+
+    std::vector<std::string> names;
+    ASSERT_TRUE(CArchive::listMembers(dir / "b.zip", names));
+    EXPECT_EQ(names, (std::vector<std::string>{ "stored.txt", "dir/deflated.txt", "dir/big.txt" }));
+
+    EXPECT_EQ(readMember(dir / "b.zip", "dir/big.txt"), bigData);
+    EXPECT_EQ(readMember(dir / "b.zip", "stored.txt"), "stored text");
+    EXPECT_EQ(readMember(dir / "b.zip", "dir/deflated.txt"), "deflated text");
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(Archive, EngineReportsMatchingMembers) {
+    std::filesystem::path const dir = makeArchiveTestDirectory();
+    std::ofstream(dir / "plain.txt") << "needle";
+    writeBinary(dir / "a.tar", makeTar({ { "x.txt", "needle" }, { "y.txt", "haystack" } }));
+    writeBinary(dir / "b.zip", makeZip({ { "dir/z.txt", "a needle" }, { "w.txt", "hay" } }));
+
+#ifdef LIGHTNING_HAVE_ZLIB
+    gzFile file = gzopen((dir / "c.tar.gz").c_str(), "wb");
+    std::string const tar = makeTar({ { "v.txt", "needle" } });
+    gzwrite(file, tar.data(), static_cast<unsigned>(tar.size()));
+    gzclose(file);
+#endif
+
+    for(bool const searchArchives : { false, true }) {
+        CArchiveMatchCollector collector;
+        collector.m_root = dir;
+
+        CSearchQuery *query = new CSearchQuery;
+        query->setDirectories({ dir });
+        query->setFilters({ new CFilterContents(L"needle", false, false, false) });
+        query->setSearchArchives(searchArchives);
+        query->addResultObserver(&collector);
+
+        CSearchEngine engine(query);
+        engine.performSearch();
+        engine.waitForCompletion();
+
+        // The archives themselves are searched either way. The tar and zip
+        // archives hold a matching member as it is, and the .tar.gz is
+        // decompressed as a whole.
+        std::vector<std::string> expected = { "a.tar", "b.zip", "c.tar.gz", "plain.txt" };
+
+        if(searchArchives) {
+            expected.push_back("a.tar!/x.txt");
+            expected.push_back("b.zip!/dir/z.txt");
+#ifdef LIGHTNING_HAVE_ZLIB
+            expected.push_back("c.tar.gz!/v.txt");
+#endif
+        }
+
+        std::sort(expected.begin(), expected.end());
+        EXPECT_EQ(collector.getSorted(), expected);
+        EXPECT_EQ(engine.getTotalFilesSearched(), engine.getTotalFilesToSearch());
+    }
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(Archive, ReadsTarOnceWhenMembersNeedDecoding) {
+    std::filesystem::path const dir = makeArchiveTestDirectory();
+
+    // Every member has a non-ASCII character, so none can be searched as
+    // bytes alone.
+    std::vector<std::pair<std::string, std::string>> members;
+    for(int i = 0; i < 50; ++i) {
+        members.emplace_back("m" + std::to_string(i) + ".txt", i % 2 ? "caf\xc3\xa9" : "needle caf\xc3\xa9");
+    }
+    writeBinary(dir / "a.tar", makeTar(members));
+
+    CArchiveMatchCollector collector;
+    collector.m_root = dir;
+    CTraceRecorder recorder;
+
+    {
+        CSearchQuery *query = new CSearchQuery;
+        query->setDirectories({ dir });
+        query->setFilters({ new CFilterContents(L"needle", false, false, false) });
+        query->setSearchArchives(true);
+        query->addResultObserver(&collector);
+
+        CSearchEngine engine(query);
+        engine.setTraceRecorder(&recorder);
+        engine.performSearch();
+        engine.waitForCompletion();
+    }
+
+    EXPECT_EQ(collector.getSorted().size(), 26u);
+
+    // The members are read in archive order, by a single reader.
+    std::string json;
+    recorder.writeJson(json);
+
+    EXPECT_EQ(countSpans(json, "Open archive"), 1u);
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(Archive, BatchesTarMembers) {
+    std::filesystem::path const dir = makeArchiveTestDirectory();
+
+    std::vector<std::pair<std::string, std::string>> members;
+    for(int i = 0; i < 300; ++i) {
+        members.emplace_back("m" + std::to_string(i) + ".txt", "needle " + std::to_string(i));
+    }
+    writeBinary(dir / "a.tar", makeTar(members));
+
+    CArchiveMatchCollector collector;
+    collector.m_root = dir;
+    CTraceRecorder recorder;
+
+    {
+        CSearchQuery *query = new CSearchQuery;
+        query->setDirectories({ dir });
+        query->setFilters({ new CFilterContents(L"needle", false, false, false) });
+        query->setSearchArchives(true);
+        query->addResultObserver(&collector);
+
+        CSearchEngine engine(query);
+        engine.setTraceRecorder(&recorder);
+        engine.performSearch();
+        engine.waitForCompletion();
+
+        EXPECT_EQ(engine.getTotalFilesSearched(), 301);
+    }
+
+    // The archive itself and every member
+    EXPECT_EQ(collector.getSorted().size(), 301u);
+
+    std::string json;
+    recorder.writeJson(json);
+
+    EXPECT_GE(countSpans(json, "Search batch"), 5u);
+
+    // Whichever threads search the batches, the archive is read once.
+    EXPECT_EQ(countSpans(json, "Open archive"), 1u);
+
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,181 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CContentStream.hpp>
+
+#include <search/CFilterContents.hpp>
+#include <search/CSearchEngine.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#ifdef LIGHTNING_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef LIGHTNING_HAVE_LZMA
+#include <lzma.h>
+#endif
+
+using Compression = CContentStream::Compression;
+
+class CCompressedMatchCounter : public ISearchObserver {
+public:
+    void onFileMatched(std::filesystem::path const &) override { m_matches++; }
+
+    std::atomic_int m_matches{0};
+};
+
+static std::filesystem::path makeCompressionTestDirectory() {
+    std::filesystem::path const dir = std::filesystem::temp_directory_path() / "lightning_search_compressed_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    return dir;
+}
+
+static std::wstring readAll(std::filesystem::path const &path) {
+    CContentStream in(path);
+    return std::wstring(std::istreambuf_iterator<wchar_t>(in), std::istreambuf_iterator<wchar_t>());
+}
+
+#ifdef LIGHTNING_HAVE_ZLIB
+static void writeGzip(std::filesystem::path const &path, std::string const &text, char const *mode = "wb") {
+    gzFile file = gzopen(path.c_str(), mode);
+    ASSERT_NE(file, nullptr);
+    gzwrite(file, text.data(), static_cast<unsigned>(text.size()));
+    gzclose(file);
+}
+#endif
+
+TEST(ContentStream, DetectsCompressionByExtension) {
+    EXPECT_EQ(CContentStream::getCompression("notes.txt"), Compression::None);
+    EXPECT_EQ(CContentStream::getCompression("archive.tar"), Compression::None);
+
+    for(char const *name : { "syslog.1.gz", "syslog.2.zst", "syslog.3.xz" }) {
+        Compression const compression = CContentStream::getCompression(name);
+
+        if(compression != Compression::None) {
+            EXPECT_TRUE(CContentStream::isSupported(compression));
+        }
+    }
+}
+
+TEST(ContentStream, ReadsPlainAndMisnamedFilesAsTheyAre) {
+    std::filesystem::path const dir = makeCompressionTestDirectory();
+    std::ofstream(dir / "plain.txt") << "plain text";
+    std::ofstream(dir / "fake.gz") << "not compressed";
+
+    EXPECT_EQ(readAll(dir / "plain.txt"), L"plain text");
+    EXPECT_EQ(readAll(dir / "fake.gz"), L"not compressed");
+
+    CContentStream missing(dir / "missing.gz");
+    EXPECT_FALSE(missing.good());
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(ContentStream, ByteStreamLeavesBytesUndecoded) {
+    std::filesystem::path const dir = makeCompressionTestDirectory();
+    std::ofstream(dir / "utf8.txt") << "caf\xC3\xA9 au lait";
+
+    CContentByteStream in(dir / "utf8.txt");
+    EXPECT_EQ(std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()),
+              "caf\xC3\xA9 au lait");
+
+#ifdef LIGHTNING_HAVE_ZLIB
+    writeGzip(dir / "log.gz", "compressed bytes");
+    CContentByteStream compressed(dir / "log.gz");
+    EXPECT_EQ(std::string(std::istreambuf_iterator<char>(compressed), std::istreambuf_iterator<char>()),
+              "compressed bytes");
+#endif
+
+    CContentByteStream missing(dir / "missing.txt");
+    EXPECT_FALSE(missing.good());
+
+    std::filesystem::remove_all(dir);
+}
+
+#ifdef LIGHTNING_HAVE_ZLIB
+TEST(ContentStream, DecompressesGzipMembers) {
+    std::filesystem::path const dir = makeCompressionTestDirectory();
+    writeGzip(dir / "log.gz", "first member, ");
+    writeGzip(dir / "log.gz", "second member", "ab");
+
+    CContentStream in(dir / "log.gz");
+    EXPECT_EQ(in.getCompression(), Compression::Gzip);
+    EXPECT_EQ(readAll(dir / "log.gz"), L"first member, second member");
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(ContentStream, FindsMatchesAcrossChunkBoundaries) {
+    std::filesystem::path const dir = makeCompressionTestDirectory();
+
+    // Small search windows make the searcher carry its overlap over many
+    // times, across the stream's internal chunks as well.
+    CFilterContents filter(L"needle");
+    filter.setMaxBufferSize(1000);
+
+    for(size_t const position : { size_t(0), size_t(997), size_t(65533), size_t(200000) }) {
+        std::string text(300000, 'x');
+        text.replace(position, 6, "needle");
+        writeGzip(dir / "big.gz", text);
+
+        EXPECT_TRUE(filter.filterFile(dir / "big.gz")) << "needle at " << position;
+    }
+
+    writeGzip(dir / "big.gz", std::string(300000, 'x'));
+    EXPECT_FALSE(filter.filterFile(dir / "big.gz"));
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(ContentStream, EngineSearchesCompressedFiles) {
+    std::filesystem::path const dir = makeCompressionTestDirectory();
+
+    // The whole-match filter would reject the file by its compressed
+    // size alone, if size checks applied to it.
+    writeGzip(dir / "exact.gz", "needle");
+    writeGzip(dir / "other.gz", "haystack");
+
+    CCompressedMatchCounter counter;
+    CSearchQuery *query = new CSearchQuery;
+    query->setDirectories({ dir });
+    query->setFilters({ new CFilterContents(L"needle", false, true, false) });
+    query->addResultObserver(&counter);
+
+    CSearchEngine engine(query);
+    engine.performSearch();
+    engine.waitForCompletion();
+
+    EXPECT_EQ(counter.m_matches.load(), 1);
+
+    std::filesystem::remove_all(dir);
+}
+#endif
+
+#ifdef LIGHTNING_HAVE_LZMA
+TEST(ContentStream, DecompressesXz) {
+    std::filesystem::path const dir = makeCompressionTestDirectory();
+    std::string const text = "xz compressed text";
+
+    std::string compressed(text.size() + 1024, '\0');
+    size_t compressedSize = 0;
+    ASSERT_EQ(lzma_easy_buffer_encode(6, LZMA_CHECK_CRC64, nullptr,
+                                      reinterpret_cast<uint8_t const *>(text.data()), text.size(),
+                                      reinterpret_cast<uint8_t *>(&compressed[0]), &compressedSize,
+                                      compressed.size()),
+              LZMA_OK);
+    compressed.resize(compressedSize);
+    std::ofstream(dir / "log.xz", std::ios::binary) << compressed;
+
+    CContentStream in(dir / "log.xz");
+    EXPECT_EQ(in.getCompression(), Compression::Xz);
+    EXPECT_EQ(readAll(dir / "log.xz"), L"xz compressed text");
+
+    std::filesystem::remove_all(dir);
+}
+#endif
@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CDirectoryWalker.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Test fixture which creates a scratch directory tree and removes
+ * it again after the test.
+ */
+class DirectoryWalkerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::string const testName = ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        m_root = std::filesystem::temp_directory_path() / ("lightning_walker_" + testName);
+        std::filesystem::remove_all(m_root);
+        std::filesystem::create_directories(m_root);
+    }
+
+    void TearDown() override {
+        std::error_code ec;
+        std::filesystem::remove_all(m_root, ec);
+    }
+
+    void writeFile(std::string const &relativePath, std::string const &contents = "") {
+        std::filesystem::path const filePath = m_root / relativePath;
+        std::filesystem::create_directories(filePath.parent_path());
+        std::ofstream file(filePath, std::ios::binary);
+        file << contents;
+    }
+
+    std::vector<std::string> walk(bool respectIgnoreFiles) {
+        std::vector<std::string> files;
+        CDirectoryWalker walker(m_root);
+        walker.setRespectIgnoreFiles(respectIgnoreFiles);
+        walker.walk([this, &files](std::filesystem::path const &filePath) {
+            files.push_back(filePath.lexically_relative(m_root).generic_string());
+        });
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+    std::filesystem::path m_root;
+};
+
+TEST_F(DirectoryWalkerTest, ReportsAllRegularFilesByDefault)
+{
+    writeFile("a.txt");
+    writeFile("sub/b.txt");
+    writeFile("sub/deeper/c.txt");
+    writeFile(".gitignore", "sub/\n");
+
+    std::vector<std::string> const expected = { ".gitignore", "a.txt", "sub/b.txt", "sub/deeper/c.txt" };
+    EXPECT_EQ(walk(false), expected);
+}
+
+TEST_F(DirectoryWalkerTest, PrunesIgnoredDirectories)
+{
+    writeFile(".gitignore", "build/\n*.o\n");
+    writeFile("main.cpp");
+    writeFile("main.o");
+    writeFile("build/out.txt");
+    writeFile("src/build/gen.txt");
+
+    std::vector<std::string> const expected = { ".gitignore", "main.cpp" };
+    EXPECT_EQ(walk(true), expected);
+}
+
+TEST_F(DirectoryWalkerTest, NestedIgnoreFilesTakePrecedence)
+{
+    writeFile(".gitignore", "*.log\n");
+    writeFile("app/.ignore", "!keep.log\n");
+    writeFile("drop.log");
+    writeFile("app/keep.log");
+    writeFile("app/other.log");
+
+    std::vector<std::string> const expected = { ".gitignore", "app/.ignore", "app/keep.log" };
+    EXPECT_EQ(walk(true), expected);
+}
+
+TEST_F(DirectoryWalkerTest, NestedRulesDoNotLeakToSiblings)
+{
+    writeFile("a/.gitignore", "*.txt\n");
+    writeFile("a/x.txt");
+    writeFile("b/y.txt");
+
+    std::vector<std::string> const expected = { "a/.gitignore", "b/y.txt" };
+    EXPECT_EQ(walk(true), expected);
+}
+
+TEST_F(DirectoryWalkerTest, ReadsRepositoryExcludeFile)
+{
+    writeFile(".git/info/exclude", "secret.txt\n");
+    writeFile("secret.txt");
+    writeFile("public.txt");
+
+    // The .git directory itself is never searched when ignore files are respected.
+    std::vector<std::string> const expected = { "public.txt" };
+    EXPECT_EQ(walk(true), expected);
+}
+
+TEST_F(DirectoryWalkerTest, MissingRootReportsNothing)
+{
+    std::filesystem::remove_all(m_root);
+    EXPECT_TRUE(walk(true).empty());
+}
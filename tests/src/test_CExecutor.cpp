@@ -0,0 +1,405 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <CExecutor.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Task which keeps the executor's only worker busy until released.
+ */
+class CGate {
+public:
+    CGate() : m_isEntered(false), m_isOpen(false) {}
+
+    void operator()() {
+        m_isEntered = true;
+        while(!m_isOpen) {
+            std::this_thread::yield();
+        }
+    }
+
+    void waitUntilEntered() {
+        while(!m_isEntered) {
+            std::this_thread::yield();
+        }
+    }
+
+    void open() { m_isOpen = true; }
+
+private:
+    std::atomic_bool m_isEntered;
+    std::atomic_bool m_isOpen;
+};
+
+/**
+ * @brief Keep the CPU busy for a while, as a search task would.
+ */
+static void spin(std::chrono::microseconds const duration) {
+    std::chrono::steady_clock::time_point const end = std::chrono::steady_clock::now() + duration;
+    while(std::chrono::steady_clock::now() < end) {
+    }
+}
+
+TEST(Executor, CompletesTaskGroupsOfSeveralQueues) {
+    CExecutor executor(3);
+    CExecutor::CQueue first(executor);
+    CExecutor::CQueue second(executor, CExecutor::Priority::Background, 2);
+
+    CTaskGroup group;
+    std::atomic_int counter(0);
+
+    for(int i = 0; i < 1000; ++i) {
+        CExecutor::CQueue &queue = i % 2 ? first : second;
+        queue.post(group, [&counter] { counter++; });
+    }
+
+    group.wait();
+    EXPECT_EQ(counter.load(), 1000);
+    EXPECT_EQ(group.getPendingTasks(), 0);
+}
+
+TEST(Executor, RunsTasksInlineWhenQueueIsFullOnWorker) {
+    // A single worker with a tiny queue: every task the worker posts
+    // beyond the capacity has to run on the worker itself.
+    CExecutor executor(1);
+    CExecutor::CQueue queue(executor, CExecutor::Priority::Normal, 1, SIZE_MAX, 2);
+
+    CTaskGroup group;
+    std::atomic_int counter(0);
+
+    queue.post(group, [&queue, &group, &counter] {
+        // Tasks may add tasks to their own group.
+        for(int i = 0; i < 100; ++i) {
+            queue.post(group, [&counter] { counter++; });
+        }
+    });
+
+    group.wait();
+    EXPECT_EQ(counter.load(), 100);
+}
+
+TEST(Executor, SurvivesThrowingTasks) {
+    CExecutor executor(1);
+    CExecutor::CQueue queue(executor);
+
+    CTaskGroup group;
+    std::atomic_int counter(0);
+
+    queue.post(group, [] { throw std::runtime_error("task failed"); });
+    queue.post(group, [&counter] { counter++; });
+
+    group.wait();
+    EXPECT_EQ(counter.load(), 1);
+}
+
+TEST(Executor, CompletionHandlerMayUseItsGroup) {
+    CExecutor executor(2);
+    CExecutor::CQueue queue(executor);
+
+    CTaskGroup group;
+    std::atomic_int completions(0);
+    std::atomic_int pendingInHandler(-1);
+    std::atomic_bool isFollowUpPosted(false);
+
+    // The handler runs without the group's lock: it may query the group,
+    // wait for it and add tasks to it, which complete the group again.
+    group.setCompletionHandler([&] {
+        completions++;
+        pendingInHandler = group.getPendingTasks();
+        group.wait();
+
+        if(!isFollowUpPosted.exchange(true)) {
+            queue.post(group, [] {});
+        }
+    });
+
+    queue.post(group, [] {});
+    group.wait();
+
+    // Waiting returns only after the handler has returned, for the
+    // follow-up task as well.
+    EXPECT_EQ(completions.load(), 2);
+    EXPECT_EQ(pendingInHandler.load(), 1);
+    EXPECT_EQ(group.getPendingTasks(), 0);
+}
+
+TEST(Executor, SharesWorkersByWeight) {
+    CExecutor executor(1);
+    CExecutor::CQueue gateQueue(executor);
+    CExecutor::CQueue heavy(executor, CExecutor::Priority::Normal, 3);
+    CExecutor::CQueue light(executor, CExecutor::Priority::Normal, 1);
+
+    CGate gate;
+    CTaskGroup group;
+    gateQueue.post(group, [&gate] { gate(); });
+    gate.waitUntilEntered();
+
+    std::mutex mutex;
+    std::vector<int> order;
+
+    for(int i = 0; i < 40; ++i) {
+        for(int queue : { 0, 1 }) {
+            (queue == 0 ? heavy : light).post(group, [&mutex, &order, queue] {
+                spin(std::chrono::microseconds(2000));
+                std::lock_guard<std::mutex> const lock(mutex);
+                order.push_back(queue);
+            });
+        }
+    }
+
+    gate.open();
+    group.wait();
+
+    // While both queues have tasks, the heavy one gets about three times
+    // the worker time.
+    ASSERT_EQ(order.size(), 80u);
+    long const heavyTasks = std::count(order.begin(), order.begin() + 40, 0);
+    EXPECT_GE(heavyTasks, 24);
+    EXPECT_LE(heavyTasks, 36);
+}
+
+TEST(Executor, RunsQueuesOfHigherPriorityFirst) {
+    CExecutor executor(1);
+    CExecutor::CQueue background(executor, CExecutor::Priority::Background, 100);
+    CExecutor::CQueue normal(executor);
+    CExecutor::CQueue interactive(executor, CExecutor::Priority::Interactive);
+
+    CGate gate;
+    CTaskGroup group;
+    background.post(group, [&gate] { gate(); });
+    gate.waitUntilEntered();
+
+    std::mutex mutex;
+    std::vector<int> order;
+
+    auto const record = [&mutex, &order](int const value) {
+        return [&mutex, &order, value] {
+            std::lock_guard<std::mutex> const lock(mutex);
+            order.push_back(value);
+        };
+    };
+
+    for(int i = 0; i < 3; ++i) {
+        background.post(group, record(0));
+    }
+    normal.post(group, record(1));
+    interactive.post(group, record(2));
+
+    // Within a queue, high priority tasks still go first.
+    interactive.post(group, record(3), CExecutor::TaskPriority::High);
+
+    gate.open();
+    group.wait();
+
+    EXPECT_EQ(order, (std::vector<int>{ 3, 2, 1, 0, 0, 0 }));
+}
+
+TEST(Executor, YieldRunsWaitingTasksOfHigherPriority) {
+    CExecutor executor(1);
+    CExecutor::CQueue background(executor, CExecutor::Priority::Background);
+    CExecutor::CQueue normal(executor);
+    CExecutor::CQueue interactive(executor, CExecutor::Priority::Interactive);
+
+    std::atomic_bool isStarted(false);
+    std::atomic_bool isPosted(false);
+    std::mutex mutex;
+    std::vector<int> order;
+    CTaskGroup group;
+
+    background.post(group, [&] {
+        isStarted = true;
+        while(!isPosted) {
+            std::this_thread::yield();
+        }
+
+        EXPECT_TRUE(background.shouldYield());
+        background.yield();
+        EXPECT_FALSE(background.shouldYield());
+
+        std::lock_guard<std::mutex> const lock(mutex);
+        order.push_back(0);
+    });
+
+    while(!isStarted) {
+        std::this_thread::yield();
+    }
+
+    // The normal task waits until the interactive one has run, which
+    // yields to nothing.
+    normal.post(group, [&] {
+        EXPECT_FALSE(interactive.shouldYield());
+        interactive.yield();
+
+        std::lock_guard<std::mutex> const lock(mutex);
+        order.push_back(1);
+    });
+    interactive.post(group, [&] {
+        std::lock_guard<std::mutex> const lock(mutex);
+        order.push_back(2);
+    });
+    isPosted = true;
+
+    group.wait();
+
+    EXPECT_EQ(order, (std::vector<int>{ 2, 1, 0 }));
+}
+
+TEST(Executor, LimitsRunningTasksPerQueue) {
+    CExecutor executor(4);
+    CExecutor::CQueue queue(executor, CExecutor::Priority::Normal, 1, 2);
+
+    std::atomic_int running(0);
+    std::atomic_int maxRunning(0);
+    CTaskGroup group;
+
+    for(int i = 0; i < 40; ++i) {
+        queue.post(group, [&running, &maxRunning] {
+            int const now = ++running;
+            int seen = maxRunning.load();
+            while(now > seen && !maxRunning.compare_exchange_weak(seen, now)) {
+            }
+
+            spin(std::chrono::microseconds(200));
+            running--;
+        });
+    }
+
+    group.wait();
+    EXPECT_LE(maxRunning.load(), 2);
+}
+
+TEST(Executor, DiscardsWaitingTasksOnQueueDestruction) {
+    CExecutor executor(1);
+    CExecutor::CQueue gateQueue(executor);
+
+    CGate gate;
+    CTaskGroup gateGroup;
+    gateQueue.post(gateGroup, [&gate] { gate(); });
+    gate.waitUntilEntered();
+
+    std::atomic_int counter(0);
+    CTaskGroup group;
+
+    {
+        CExecutor::CQueue queue(executor);
+        for(int i = 0; i < 10; ++i) {
+            queue.post(group, [&counter] { counter++; });
+        }
+        EXPECT_EQ(group.getPendingTasks(), 10);
+    }
+
+    // The group learned about the discarded tasks.
+    EXPECT_EQ(group.getPendingTasks(), 0);
+
+    gate.open();
+    gateGroup.wait();
+    EXPECT_EQ(counter.load(), 0);
+}
+
+TEST(Executor, WaitsForFreeSlotWhenAllQueuesExist) {
+    CExecutor executor(1);
+
+    std::vector<std::unique_ptr<CExecutor::CQueue>> queues;
+    for(size_t i = 0; i < CExecutor::MAX_QUEUES; ++i) {
+        queues.emplace_back(new CExecutor::CQueue(executor));
+    }
+
+    std::atomic_bool isCreated(false);
+    std::thread creator([&executor, &isCreated] {
+        CExecutor::CQueue queue(executor);
+        isCreated = true;
+
+        CTaskGroup group;
+        queue.post(group, [] {});
+        group.wait();
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(isCreated.load());
+
+    queues.pop_back();
+    creator.join();
+    EXPECT_TRUE(isCreated.load());
+}
+
+TEST(Executor, SharedExecutorGrowsOnRequest) {
+    CExecutor &executor = CExecutor::getShared();
+    EXPECT_EQ(&executor, &CExecutor::getShared());
+    EXPECT_GE(executor.getWorkerCount(), 1u);
+
+    executor.reserveWorkers(2);
+    EXPECT_GE(executor.getWorkerCount(), 2u);
+}
+
+TEST(Executor, TracesIdleWorkersAndWaitsForRoom) {
+    CExecutor executor(1);
+    CTraceRecorder traceRecorder;
+
+    {
+        CExecutor::CQueue queue(executor, CExecutor::Priority::Normal, 1, SIZE_MAX, 2);
+        queue.setTraceRecorder(&traceRecorder);
+
+        CGate gate;
+        CTaskGroup group;
+        queue.post(group, [&gate] { gate(); });
+        gate.waitUntilEntered();
+
+        // The gate task runs, the next two fill the queue and the last
+        // one waits for room until the gate opens.
+        queue.post(group, [] {});
+        queue.post(group, [] {});
+        std::thread opener([&gate] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            gate.open();
+        });
+        queue.post(group, [] {});
+        opener.join();
+        group.wait();
+
+        // Let the worker fall asleep, then wake it up.
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        queue.post(group, [] {});
+        group.wait();
+    }
+
+    std::string json;
+    traceRecorder.writeJson(json);
+    EXPECT_NE(json.find("\"Wait for queue\""), std::string::npos);
+    EXPECT_NE(json.find("\"Idle\""), std::string::npos);
+}
+
+TEST(Executor, ConcurrentPostsFromSeveralThreads) {
+    CExecutor executor(4);
+    CExecutor::CQueue first(executor);
+    CExecutor::CQueue second(executor, CExecutor::Priority::Interactive, 1, 2, 16);
+
+    CTaskGroup group;
+    std::atomic_int counter(0);
+    std::vector<std::thread> posters;
+
+    for(int p = 0; p < 4; ++p) {
+        posters.emplace_back([&, p] {
+            for(int i = 0; i < 5000; ++i) {
+                (i % 2 ? first : second).post(group, [&counter] { counter++; },
+                                              p % 2 ? CExecutor::TaskPriority::High : CExecutor::TaskPriority::Normal);
+            }
+        });
+    }
+
+    for(std::thread &poster : posters) {
+        poster.join();
+    }
+
+    group.wait();
+    EXPECT_EQ(counter.load(), 20000);
+}
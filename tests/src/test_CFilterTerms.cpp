@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CFilterTerms.hpp>
+
+#include <search/CTermAutomaton.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+static bool matches(std::wstring const &query, std::wstring const &text, bool const caseInsensitive = false) {
+    return CFilterTerms(query, caseInsensitive).filterBuffer(text.data(), text.size());
+}
+
+TEST(FilterTerms, AutomatonFindsOverlappingTerms) {
+    CTermAutomaton const automaton({ L"he", L"she", L"his", L"hers", L"€uro" }, false);
+    std::wstring const text = L"ushers pay in €uro";
+
+    // (term, end offset) of every occurrence
+    std::vector<std::pair<std::uint32_t, size_t>> found;
+    CTermAutomaton::State state = CTermAutomaton::START;
+
+    for(size_t i = 0; i < text.size(); ++i) {
+        state = automaton.next(state, text[i]);
+        for(std::uint32_t const *term = automaton.outputsBegin(state); term != automaton.outputsEnd(state); ++term) {
+            found.emplace_back(*term, i + 1);
+        }
+    }
+
+    std::sort(found.begin(), found.end());
+    std::vector<std::pair<std::uint32_t, size_t>> const expected = { { 0, 4 }, { 1, 4 }, { 3, 6 }, { 4, 18 } };
+    EXPECT_EQ(found, expected);
+}
+
+TEST(FilterTerms, EvaluatesAndNotNear) {
+    std::wstring const log = L"connect: timeout after 30s\nwill retry in 5s\n";
+
+    EXPECT_TRUE(matches(L"timeout retry", log));
+    EXPECT_TRUE(matches(L"timeout AND retry", log));
+    EXPECT_FALSE(matches(L"timeout AND refused", log));
+    EXPECT_TRUE(matches(L"timeout NOT refused", log));
+    EXPECT_FALSE(matches(L"timeout NOT retry", log));
+    EXPECT_TRUE(matches(L"NOT refused", log));
+
+    // 16 characters lie between the end of timeout and the start of retry.
+    EXPECT_TRUE(matches(L"timeout NEAR/16 retry", log));
+    EXPECT_FALSE(matches(L"timeout NEAR/15 retry", log));
+    EXPECT_TRUE(matches(L"retry NEAR/16 timeout", log));
+    EXPECT_TRUE(matches(L"connect NEAR/2 timeout NEAR/16 retry", log));
+    EXPECT_FALSE(matches(L"connect NEAR/1 timeout NEAR/16 retry", log));
+
+    EXPECT_TRUE(matches(L"\"will retry\" TIMEOUT", log, true));
+    EXPECT_FALSE(matches(L"\"will retry\" TIMEOUT", log, false));
+}
+
+TEST(FilterTerms, NearUsesClosestOccurrences) {
+    std::wstring const text = L"a .......... b ... a b";
+    EXPECT_TRUE(matches(L"a NEAR/1 b", text));
+    EXPECT_TRUE(matches(L"b NEAR/1 a", text));
+    EXPECT_FALSE(matches(L"a NEAR/0 b", text));
+}
+
+TEST(FilterTerms, RejectsMalformedQueries) {
+    for(wchar_t const *query : { L"", L"  ", L"AND a", L"a AND", L"a AND AND b", L"NOT", L"a NOT",
+                                 L"NEAR/3 a", L"a NEAR/3", L"a NEAR/x b", L"\"open", L"\"\"" }) {
+        EXPECT_THROW(CFilterTerms filter(query), std::invalid_argument) << std::filesystem::path(query).string();
+    }
+
+    EXPECT_NO_THROW(CFilterTerms filter(L"a AND NOT b"));
+    EXPECT_NO_THROW(CFilterTerms filter(L"\"AND\" \"NEAR/3\""));
+}
+
+TEST(FilterTerms, StreamsFilesAcrossChunks) {
+    std::filesystem::path const dir = std::filesystem::temp_directory_path() / "lightning_search_terms_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    std::ofstream(dir / "log.txt") << "request failed: timeout\nscheduling retry\n";
+
+    CFilterTerms filter(L"timeout NEAR/20 retry NOT fatal");
+
+    // Chunks of 4 characters split both terms.
+    filter.setMaxBufferSize(4);
+    EXPECT_TRUE(filter.filterFile(dir / "log.txt"));
+
+    std::ofstream(dir / "log.txt", std::ios::app) << "fatal error\n";
+    EXPECT_FALSE(filter.filterFile(dir / "log.txt"));
+
+    EXPECT_FALSE(filter.filterFile(dir / "missing.txt"));
+    EXPECT_EQ(filter.getCost(), IFilter::Cost::Content);
+    EXPECT_NE(filter.getKey(), CFilterTerms(L"timeout NEAR/20 retry NOT fatal", true).getKey());
+
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,169 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CFuzzyMatcher.hpp>
+
+#include <search/CFilterFuzzyName.hpp>
+#include <search/CSearchEngine.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Edit distance by the textbook dynamic program, to check the
+ * bit-parallel one against.
+ */
+static size_t referenceDistance(std::wstring const &pattern, std::wstring const &text, bool const wholeMatch) {
+    std::vector<size_t> column(pattern.size() + 1);
+    for(size_t i = 0; i <= pattern.size(); ++i) {
+        column[i] = i;
+    }
+
+    size_t best = column.back();
+
+    for(size_t j = 1; j <= text.size(); ++j) {
+        size_t diagonal = column[0];
+        column[0] = wholeMatch ? j : 0;
+
+        for(size_t i = 1; i <= pattern.size(); ++i) {
+            size_t const above = column[i];
+            column[i] = std::min({ column[i - 1] + 1, above + 1,
+                                   diagonal + (pattern[i - 1] == text[j - 1] ? 0 : 1) });
+            diagonal = above;
+        }
+
+        best = std::min(best, column.back());
+    }
+
+    return wholeMatch ? column.back() : best;
+}
+
+static std::wstring makeRandomText(std::mt19937 &random, size_t const length) {
+    // A small alphabet, with one character outside the direct range, so
+    // that random texts have plenty of near matches.
+    static wchar_t const ALPHABET[] = { L'a', L'b', L'c', L'd', L'é' };
+    std::uniform_int_distribution<size_t> pick(0, 4);
+
+    std::wstring text;
+    for(size_t i = 0; i < length; ++i) {
+        text += ALPHABET[pick(random)];
+    }
+    return text;
+}
+
+TEST(FuzzyMatcher, AgreesWithDynamicProgramming) {
+    std::mt19937 random(42);
+
+    // Short patterns take the single word path, long ones the blocked one.
+    for(size_t const patternLength : { 1, 5, 17, 63, 64, 65, 130 }) {
+        for(int round = 0; round < 40; ++round) {
+            std::wstring const pattern = makeRandomText(random, patternLength);
+            std::wstring const text = makeRandomText(random, std::uniform_int_distribution<size_t>(0, 200)(random));
+
+            for(bool const wholeMatch : { false, true }) {
+                CFuzzyMatcher const matcher(pattern, false, wholeMatch);
+                size_t const expected = referenceDistance(pattern, text, wholeMatch);
+
+                EXPECT_EQ(matcher.getDistance(text, CFuzzyMatcher::NO_MATCH - 1), expected);
+
+                // A limit below the distance rejects the text.
+                if(expected > 0) {
+                    EXPECT_EQ(matcher.getDistance(text, expected - 1), CFuzzyMatcher::NO_MATCH);
+                }
+                EXPECT_EQ(matcher.getDistance(text, expected), expected);
+            }
+        }
+    }
+}
+
+TEST(FuzzyMatcher, MatchesNames) {
+    CFuzzyMatcher const partial(L"report", false, false);
+    EXPECT_EQ(partial.getDistance(L"quarterly_report.pdf", 2), 0u);
+    EXPECT_EQ(partial.getDistance(L"quarterly_repot.pdf", 2), 1u);
+    EXPECT_EQ(partial.getDistance(L"quarterly_rpeort.pdf", 2), 2u);
+    EXPECT_EQ(partial.getDistance(L"summary.pdf", 2), CFuzzyMatcher::NO_MATCH);
+    EXPECT_EQ(partial.getDistance(L"Report.pdf", 0), CFuzzyMatcher::NO_MATCH);
+
+    CFuzzyMatcher const insensitive(L"report", true, false);
+    EXPECT_EQ(insensitive.getDistance(L"REPORT.pdf", 0), 0u);
+    EXPECT_EQ(insensitive.getDistance(L"rePOrt", 0), 0u);
+
+    CFuzzyMatcher const whole(L"report.pdf", false, true);
+    EXPECT_EQ(whole.getDistance(L"report.pdf", 2), 0u);
+    EXPECT_EQ(whole.getDistance(L"repot.pdf", 2), 1u);
+    EXPECT_EQ(whole.getDistance(L"quarterly_report.pdf", 2), CFuzzyMatcher::NO_MATCH);
+
+    EXPECT_DOUBLE_EQ(partial.getSimilarity(0, 20), 1.0);
+    EXPECT_DOUBLE_EQ(partial.getSimilarity(3, 20), 0.5);
+    EXPECT_DOUBLE_EQ(whole.getSimilarity(1, 9), 0.9);
+}
+
+TEST(FuzzyMatcher, FilterKeysDependOnAllOptions) {
+    CFilterFuzzyName const filter(L"report", 2, true, false);
+    EXPECT_TRUE(filter.filterFile("/some/dir/Quarterly_Repot.pdf"));
+    EXPECT_FALSE(filter.filterFile("/some/report/summary.pdf"));
+    EXPECT_DOUBLE_EQ(filter.getSimilarity("/some/dir/repot.txt"), 1.0 - 1.0 / 6.0);
+    EXPECT_DOUBLE_EQ(filter.getSimilarity("/some/dir/summary.txt"), 0.0);
+    EXPECT_EQ(filter.getCost(), IFilter::Cost::Name);
+
+    EXPECT_NE(filter.getKey(), CFilterFuzzyName(L"report", 1, true, false).getKey());
+    EXPECT_NE(filter.getKey(), CFilterFuzzyName(L"report", 2, false, false).getKey());
+    EXPECT_NE(filter.getKey(), CFilterFuzzyName(L"report", 2, true, true).getKey());
+    EXPECT_EQ(filter.getKey(), CFilterFuzzyName(L"report", 2, true, false).getKey());
+}
+
+class FuzzyRankingRecorder : public ISearchObserver {
+public:
+    void onFileMatched(std::filesystem::path const &) override {}
+
+    void onRankedResults(std::vector<CRankedResult> const &results, bool const isFinal) override {
+        std::lock_guard<std::mutex> const lock(m_mutex);
+        if(isFinal) {
+            m_final = results;
+        }
+    }
+
+    std::mutex m_mutex;
+    std::vector<CRankedResult> m_final;
+};
+
+TEST(FuzzyMatcher, EngineRanksBySimilarity) {
+    std::filesystem::path const dir = std::filesystem::temp_directory_path() / "lightning_search_fuzzy_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    for(char const *name : { "budget.txt", "budgte.txt", "bdget.txt", "bugdet_old.txt", "notes.txt" }) {
+        std::ofstream(dir / name) << "text\n";
+    }
+
+    FuzzyRankingRecorder recorder;
+    CRanking ranking;
+    ranking.key = CRanking::Key::NameSimilarity;
+    ranking.count = 10;
+    ranking.isDescending = CRanking::isDescendingByDefault(ranking.key);
+
+    CSearchQuery *query = new CSearchQuery;
+    query->setDirectories({ dir });
+    query->setFilters({ new CFilterFuzzyName(L"budget", 2, false, false) });
+    query->setRanking(ranking);
+    query->addResultObserver(&recorder);
+
+    CSearchEngine engine(query);
+    engine.performSearch();
+    engine.waitForCompletion();
+
+    // Exact first, then one edit, then two; ties by path.
+    std::vector<std::string> names;
+    for(CRankedResult const &result : recorder.m_final) {
+        names.push_back(result.path.filename().string());
+    }
+    std::vector<std::string> const expected = { "budget.txt", "bdget.txt", "budgte.txt", "bugdet_old.txt" };
+    EXPECT_EQ(names, expected);
+
+    std::filesystem::remove_all(dir);
+}
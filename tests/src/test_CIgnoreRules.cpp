@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CIgnoreRules.hpp>
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+/**
+ * @brief Helper function that compiles a rule set and tests a single path.
+ * The file name is derived from the last component of the relative path.
+ */
+static CIgnoreRules::Verdict runMatch(std::string const &rules,
+                                      std::string const &relativePath,
+                                      bool isDirectory = false)
+{
+    CIgnoreRules ignoreRules;
+    ignoreRules.addRules(rules);
+
+    size_t const slash = relativePath.rfind('/');
+    std::string const name = slash == std::string::npos ? relativePath : relativePath.substr(slash + 1);
+
+    return ignoreRules.match(relativePath, name, isDirectory);
+}
+
+/* --------------------------------------------------------------------------
+ *                     Glob matching
+ * --------------------------------------------------------------------------*/
+TEST(IgnoreRules, Glob_StarDoesNotCrossSeparator)
+{
+    EXPECT_TRUE(globMatch("src/*.cpp", "src/main.cpp"));
+    EXPECT_FALSE(globMatch("src/*.cpp", "src/ui/main.cpp"));
+}
+
+TEST(IgnoreRules, Glob_DoubleStar)
+{
+    EXPECT_TRUE(globMatch("**/build", "build"));
+    EXPECT_TRUE(globMatch("**/build", "a/b/build"));
+    EXPECT_TRUE(globMatch("a/**/b", "a/b"));
+    EXPECT_TRUE(globMatch("a/**/b", "a/x/y/b"));
+    EXPECT_TRUE(globMatch("logs/**", "logs/2025/app.log"));
+    EXPECT_FALSE(globMatch("logs/**", "logs"));
+}
+
+TEST(IgnoreRules, Glob_QuestionMarkAndClasses)
+{
+    EXPECT_TRUE(globMatch("file?.txt", "file1.txt"));
+    EXPECT_FALSE(globMatch("file?.txt", "file10.txt"));
+    EXPECT_TRUE(globMatch("[a-c]x", "bx"));
+    EXPECT_FALSE(globMatch("[!a-c]x", "bx"));
+    EXPECT_TRUE(globMatch("[!a-c]x", "dx"));
+}
+
+TEST(IgnoreRules, Glob_UnterminatedClassIsLiteral)
+{
+    EXPECT_TRUE(globMatch("a[b", "a[b"));
+    EXPECT_FALSE(globMatch("a[b", "ab"));
+}
+
+/* --------------------------------------------------------------------------
+ *                     Rule parsing and evaluation
+ * --------------------------------------------------------------------------*/
+TEST(IgnoreRules, LiteralNameMatchesAtAnyDepth)
+{
+    EXPECT_EQ(runMatch("node_modules", "node_modules", true), CIgnoreRules::Verdict::Ignore);
+    EXPECT_EQ(runMatch("node_modules", "web/node_modules", true), CIgnoreRules::Verdict::Ignore);
+    EXPECT_EQ(runMatch("node_modules", "web/modules", true), CIgnoreRules::Verdict::None);
+}
+
+TEST(IgnoreRules, SuffixAndPrefixRules)
+{
+    EXPECT_EQ(runMatch("*.o", "obj/main.o"), CIgnoreRules::Verdict::Ignore);
+    EXPECT_EQ(runMatch("*.o", "main.cpp"), CIgnoreRules::Verdict::None);
+    EXPECT_EQ(runMatch("tmp*", "tmp_1234"), CIgnoreRules::Verdict::Ignore);
+}
+
+TEST(IgnoreRules, CommentsAndBlankLinesAreSkipped)
+{
+    EXPECT_EQ(runMatch("# comment\n\n   \n", "comment"), CIgnoreRules::Verdict::None);
+    EXPECT_EQ(runMatch("\\#hash", "#hash"), CIgnoreRules::Verdict::Ignore);
+}
+
+TEST(IgnoreRules, DirectoryOnlyRule)
+{
+    EXPECT_EQ(runMatch("build/", "build", true), CIgnoreRules::Verdict::Ignore);
+    EXPECT_EQ(runMatch("build/", "build", false), CIgnoreRules::Verdict::None);
+}
+
+TEST(IgnoreRules, AnchoredRuleOnlyMatchesRelativeToBase)
+{
+    EXPECT_EQ(runMatch("/out", "out", true), CIgnoreRules::Verdict::Ignore);
+    EXPECT_EQ(runMatch("/out", "src/out", true), CIgnoreRules::Verdict::None);
+    EXPECT_EQ(runMatch("doc/*.html", "doc/index.html"), CIgnoreRules::Verdict::Ignore);
+    EXPECT_EQ(runMatch("doc/*.html", "src/doc/index.html"), CIgnoreRules::Verdict::None);
+}
+
+TEST(IgnoreRules, LastMatchingRuleWins)
+{
+    EXPECT_EQ(runMatch("*.log\n!keep.log", "keep.log"), CIgnoreRules::Verdict::Include);
+    EXPECT_EQ(runMatch("*.log\n!keep.log", "drop.log"), CIgnoreRules::Verdict::Ignore);
+    EXPECT_EQ(runMatch("!keep.log\n*.log", "keep.log"), CIgnoreRules::Verdict::Ignore);
+}
+
+TEST(IgnoreRules, PatternRuleOverridesEarlierLiteral)
+{
+    EXPECT_EQ(runMatch("!data.bin\n*.bin", "data.bin"), CIgnoreRules::Verdict::Ignore);
+    EXPECT_EQ(runMatch("*.bin\n!data.bin", "data.bin"), CIgnoreRules::Verdict::Include);
+}
+
+TEST(IgnoreRules, CarriageReturnsAndTrailingSpaces)
+{
+    EXPECT_EQ(runMatch("*.tmp \r\n", "a.tmp"), CIgnoreRules::Verdict::Ignore);
+    EXPECT_EQ(runMatch("space\\ ", "space "), CIgnoreRules::Verdict::Ignore);
+}
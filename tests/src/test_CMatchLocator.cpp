@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CMatchLocator.hpp>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+TEST(MatchLocator, LineNumbersAndColumns)
+{
+    std::wstring const text = L"first line\nsecond needle\nthird\nneedle fourth";
+    CMatchLocator locator(10, 80);
+    std::vector<CMatchLocation> locations;
+
+    locator.locate(text.data(), text.size(), { { 31, 6 }, { 18, 6 } }, locations);
+
+    ASSERT_EQ(locations.size(), 2u);
+    EXPECT_EQ(locations[0].offset, 18u);
+    EXPECT_EQ(locations[0].lineNumber, 2u);
+    EXPECT_EQ(locations[0].column, 8u);
+    EXPECT_EQ(locations[0].snippet, L"second needle");
+    EXPECT_EQ(locations[0].snippetMatchOffset, 7u);
+
+    EXPECT_EQ(locations[1].lineNumber, 4u);
+    EXPECT_EQ(locations[1].column, 1u);
+    EXPECT_EQ(locations[1].snippet, L"needle fourth");
+}
+
+TEST(MatchLocator, SnippetIsBoundedByContext)
+{
+    std::wstring const text = L"0123456789needle0123456789";
+    CMatchLocator locator(10, 3);
+    std::vector<CMatchLocation> locations;
+
+    locator.locate(text.data(), text.size(), { { 10, 6 } }, locations);
+
+    ASSERT_EQ(locations.size(), 1u);
+    EXPECT_EQ(locations[0].snippet, L"789needle012");
+    EXPECT_EQ(locations[0].snippetMatchOffset, 3u);
+    EXPECT_EQ(locations[0].column, 11u);
+}
+
+TEST(MatchLocator, StripsCarriageReturn)
+{
+    std::wstring const text = L"hit\r\nnext";
+    CMatchLocator locator(10, 80);
+    std::vector<CMatchLocation> locations;
+
+    locator.locate(text.data(), text.size(), { { 0, 3 } }, locations);
+
+    ASSERT_EQ(locations.size(), 1u);
+    EXPECT_EQ(locations[0].snippet, L"hit");
+}
+
+TEST(MatchLocator, CapsAndDeduplicatesMatches)
+{
+    std::wstring const text = L"a a a a a";
+    CMatchLocator locator(2, 80);
+    std::vector<CMatchLocation> locations;
+
+    locator.locate(text.data(), text.size(), { { 4, 1 }, { 0, 1 }, { 0, 1 }, { 2, 1 } }, locations);
+
+    ASSERT_EQ(locations.size(), 2u);
+    EXPECT_EQ(locations[0].offset, 0u);
+    EXPECT_EQ(locations[1].offset, 2u);
+}
@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CRegexAnalyzer.hpp>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Helper function returning the minimum match length of a pattern.
+ */
+static size_t minLength(std::wstring const &pattern)
+{
+    return CRegexAnalyzer(pattern).getMinLength();
+}
+
+TEST(RegexAnalyzer, LiteralsAndClasses)
+{
+    EXPECT_EQ(minLength(L"abc"), 3u);
+    EXPECT_EQ(minLength(L"a.c"), 3u);
+    EXPECT_EQ(minLength(L"[a-z]\\d\\s"), 3u);
+    EXPECT_EQ(minLength(L"\\x41\\u0042"), 2u);
+}
+
+TEST(RegexAnalyzer, Quantifiers)
+{
+    EXPECT_EQ(minLength(L"ab*"), 1u);
+    EXPECT_EQ(minLength(L"ab+"), 2u);
+    EXPECT_EQ(minLength(L"ab?"), 1u);
+    EXPECT_EQ(minLength(L"a{3}"), 3u);
+    EXPECT_EQ(minLength(L"a{2,}b{1,5}?"), 3u);
+}
+
+TEST(RegexAnalyzer, GroupsAndAlternation)
+{
+    EXPECT_EQ(minLength(L"foo|ba"), 2u);
+    EXPECT_EQ(minLength(L"(ab|c)d"), 2u);
+    EXPECT_EQ(minLength(L"(?:abc){2}"), 6u);
+    EXPECT_EQ(minLength(L"x(?=abc)"), 1u);
+}
+
+TEST(RegexAnalyzer, ZeroWidthConstructs)
+{
+    EXPECT_EQ(minLength(L"^\\bword\\b$"), 4u);
+    EXPECT_EQ(minLength(L"(a)\\1"), 1u);
+}
+
+TEST(RegexAnalyzer, ClassWithClosingBracketAndEscapes)
+{
+    EXPECT_EQ(minLength(L"[\\]x]y"), 2u);
+    EXPECT_EQ(minLength(L"\\(\\)"), 2u);
+}
+
+TEST(RegexAnalyzer, InvalidPatternIsConservative)
+{
+    CRegexAnalyzer analyzer(L"(abc");
+    EXPECT_FALSE(analyzer.isValid());
+    EXPECT_EQ(analyzer.getMinLength(), 0u);
+    EXPECT_EQ(minLength(L"*a"), 0u);
+}
+
+static std::vector<std::wstring> requiredLiterals(std::wstring const &pattern)
+{
+    return CRegexAnalyzer(pattern).getRequiredLiterals();
+}
+
+TEST(RegexAnalyzer, RequiredLiterals)
+{
+    using Literals = std::vector<std::wstring>;
+
+    EXPECT_EQ(requiredLiterals(L"ERROR\\s+code=\\d+"), (Literals{ L"ERROR", L"code=" }));
+    EXPECT_EQ(requiredLiterals(L"^\\bfoo(?:bar)baz\\b"), (Literals{ L"foobarbaz" }));
+    EXPECT_EQ(requiredLiterals(L"ab+c"), (Literals{ L"ab", L"bc" }));
+    EXPECT_EQ(requiredLiterals(L"xa{3}y"), (Literals{ L"xaaay" }));
+    EXPECT_EQ(requiredLiterals(L"a(bc)+d"), (Literals{ L"a", L"bc", L"d" }));
+    EXPECT_EQ(requiredLiterals(L"key\\.value?"), (Literals{ L"key.valu" }));
+
+    // Optional and alternative parts are not required.
+    EXPECT_EQ(requiredLiterals(L"(foo)?bar"), (Literals{ L"bar" }));
+    EXPECT_EQ(requiredLiterals(L"foo|bar"), Literals{});
+    EXPECT_EQ(requiredLiterals(L"x(foo|bar)y"), (Literals{ L"x", L"y" }));
+    EXPECT_EQ(requiredLiterals(L"(abc"), Literals{});
+}
+
+TEST(RegexAnalyzer, LineBound)
+{
+    EXPECT_TRUE(CRegexAnalyzer(L"^ERROR code=\\d+.*$").isLineBound());
+    EXPECT_TRUE(CRegexAnalyzer(L"[a-z_ ]+\\w*").isLineBound());
+
+    // \s, negated classes and escapes in classes may match a line feed.
+    EXPECT_FALSE(CRegexAnalyzer(L"ERROR\\s?code").isLineBound());
+    EXPECT_FALSE(CRegexAnalyzer(L"a[^b]").isLineBound());
+    EXPECT_FALSE(CRegexAnalyzer(L"a[ \\t]").isLineBound());
+    EXPECT_FALSE(CRegexAnalyzer(L"a[\x01-z]").isLineBound());
+    EXPECT_FALSE(CRegexAnalyzer(L"a\\nb").isLineBound());
+
+    // So may lookaheads and backreferences look beyond the line.
+    EXPECT_FALSE(CRegexAnalyzer(L"a(?=b)").isLineBound());
+    EXPECT_FALSE(CRegexAnalyzer(L"(a)\\1").isLineBound());
+    EXPECT_FALSE(CRegexAnalyzer(L"(abc").isLineBound());
+}
+
+TEST(RegexAnalyzer, RequiredPrefix)
+{
+    EXPECT_EQ(CRegexAnalyzer(L"ERROR\\s+code=\\d+").getRequiredPrefix(), L"ERROR");
+    EXPECT_EQ(CRegexAnalyzer(L"^\\b(?:foo)bar?").getRequiredPrefix(), L"fooba");
+    EXPECT_EQ(CRegexAnalyzer(L"(ab)+c").getRequiredPrefix(), L"ab");
+    EXPECT_EQ(CRegexAnalyzer(L"a*b").getRequiredPrefix(), L"");
+    EXPECT_EQ(CRegexAnalyzer(L"\\d+ms").getRequiredPrefix(), L"");
+    EXPECT_EQ(CRegexAnalyzer(L"foo|bar").getRequiredPrefix(), L"");
+}
@@ -0,0 +1,273 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CResultCache.hpp>
+
+#include <search/CDirectoryWalker.hpp>
+#include <search/CFilterContents.hpp>
+#include <search/CFilterName.hpp>
+#include <search/CSearchEngine.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Filter without a key, which makes its query uncacheable.
+ */
+class CKeylessFilter : public IFilter {
+public:
+    bool filterFile(std::filesystem::path const &) const override { return true; }
+    std::wstring getText() const override { return L"Keyless"; }
+};
+
+class CFileNameCollector : public ISearchObserver {
+public:
+    void onFileMatched(std::filesystem::path const &matchedFile) override {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_matches.push_back(matchedFile.filename().string());
+    }
+
+    std::vector<std::string> sorted() {
+        std::sort(m_matches.begin(), m_matches.end());
+        return m_matches;
+    }
+
+    std::mutex m_mutex;
+    std::vector<std::string> m_matches;
+};
+
+/**
+ * @brief Move the modification time of a file or directory into the
+ * past, so that the cache trusts it.
+ */
+static void makeOld(std::filesystem::path const &path, int const minutesAgo = 60) {
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now() -
+                                           std::chrono::minutes(minutesAgo));
+}
+
+static CSearchQuery makeQuery(std::vector<std::filesystem::path> const &roots,
+                              std::vector<IFilter *> const &filters) {
+    CSearchQuery query;
+    query.setDirectories(roots);
+    query.setFilters(filters);
+    return query;
+}
+
+class ResultCacheTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::string const testName = ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        m_root = std::filesystem::temp_directory_path() / ("lightning_cache_" + testName);
+        std::filesystem::remove_all(m_root);
+        std::filesystem::create_directories(m_root / "sub");
+    }
+
+    void TearDown() override {
+        std::error_code ec;
+        std::filesystem::remove_all(m_root, ec);
+    }
+
+    void writeFile(std::filesystem::path const &filePath, std::string const &contents) {
+        std::ofstream(filePath, std::ios::binary) << contents;
+        makeOld(filePath);
+    }
+
+    std::vector<std::string> walk(IDirectoryCache *cache) {
+        std::vector<std::string> files;
+        CDirectoryWalker walker(m_root);
+        walker.setDirectoryCache(cache);
+        walker.walk([this, &files](std::filesystem::path const &filePath) {
+            files.push_back(filePath.lexically_relative(m_root).generic_string());
+        });
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+    std::vector<std::string> search(CResultCache &cache, std::wstring const &contents) {
+        CFileNameCollector observer;
+
+        CSearchQuery *searchQuery = new CSearchQuery;
+        searchQuery->setDirectories({ m_root });
+        searchQuery->setFilters({ new CFilterContents(contents) });
+        searchQuery->addResultObserver(&observer);
+
+        CSearchEngine searchEngine(searchQuery);
+        searchEngine.setResultCache(&cache);
+        searchEngine.performSearch();
+        searchEngine.waitForCompletion();
+
+        return observer.sorted();
+    }
+
+    std::filesystem::path m_root;
+};
+
+TEST(SearchQueryKey, IgnoresOrderOfRootsAndFilters)
+{
+    CSearchQuery a = makeQuery({ "/a", "/b/" }, { new CFilterName(L"x"), new CFilterContents(L"y") });
+    CSearchQuery b = makeQuery({ "/b", "/a" }, { new CFilterContents(L"y"), new CFilterName(L"x") });
+
+    EXPECT_FALSE(a.getKey().empty());
+    EXPECT_EQ(a.getKey(), b.getKey());
+}
+
+TEST(SearchQueryKey, DistinguishesFilterOptions)
+{
+    CSearchQuery plain = makeQuery({ "/a" }, { new CFilterName(L"x") });
+    CSearchQuery caseInsensitive = makeQuery({ "/a" }, { new CFilterName(L"x", true) });
+    CSearchQuery contents = makeQuery({ "/a" }, { new CFilterContents(L"x") });
+    CSearchQuery ignoring = makeQuery({ "/a" }, { new CFilterName(L"x") });
+    ignoring.setRespectIgnoreFiles(true);
+
+    EXPECT_NE(plain.getKey(), caseInsensitive.getKey());
+    EXPECT_NE(plain.getKey(), contents.getKey());
+    EXPECT_NE(plain.getKey(), ignoring.getKey());
+}
+
+TEST(SearchQueryKey, EmptyForFiltersWithoutKey)
+{
+    CSearchQuery query = makeQuery({ "/a" }, { new CFilterName(L"x"), new CKeylessFilter });
+    CResultCache cache;
+
+    EXPECT_TRUE(query.getKey().empty());
+    EXPECT_EQ(cache.acquire(query), nullptr);
+}
+
+TEST_F(ResultCacheTest, ReplaysUnchangedDirectories)
+{
+    writeFile(m_root / "a.txt", "a");
+    writeFile(m_root / "sub" / "b.txt", "b");
+    makeOld(m_root / "sub");
+    makeOld(m_root);
+
+    CResultCache::CQueryEntry entry(L"test");
+    std::vector<std::string> const expected = { "a.txt", "sub/b.txt" };
+
+    EXPECT_EQ(walk(&entry), expected);
+
+    // A file created behind the cache's back, without changing the
+    // directory's stamp, proves that the listing is replayed.
+    auto const subdirectoryTime = std::filesystem::last_write_time(m_root / "sub");
+    writeFile(m_root / "sub" / "hidden.txt", "c");
+    std::filesystem::last_write_time(m_root / "sub", subdirectoryTime);
+    EXPECT_EQ(walk(&entry), expected);
+
+    // Once the directory's stamp changes, it is read again.
+    makeOld(m_root / "sub", 30);
+    std::vector<std::string> const updated = { "a.txt", "sub/b.txt", "sub/hidden.txt" };
+    EXPECT_EQ(walk(&entry), updated);
+}
+
+TEST_F(ResultCacheTest, DoesNotCacheRecentlyModifiedDirectories)
+{
+    writeFile(m_root / "a.txt", "a");
+
+    CResultCache::CQueryEntry entry(L"test");
+    IDirectoryCache::CListing listing;
+
+    walk(&entry);
+
+    // The root was just modified by creating a.txt.
+    EXPECT_FALSE(entry.findListing(m_root, listing));
+    EXPECT_FALSE(listing.isStampValid);
+}
+
+TEST_F(ResultCacheTest, VerdictsAreValidatedByFileStamp)
+{
+    std::filesystem::path const filePath = m_root / "a.txt";
+    writeFile(filePath, "abc");
+
+    CResultCache::CQueryEntry entry(L"test");
+    CResultCache::CFileStamp stamp;
+    bool isMatch = false;
+
+    EXPECT_FALSE(entry.findVerdict(filePath, stamp, isMatch));
+    ASSERT_TRUE(stamp.isValid);
+    entry.storeVerdict(filePath, stamp, true);
+
+    EXPECT_TRUE(entry.findVerdict(filePath, stamp, isMatch));
+    EXPECT_TRUE(isMatch);
+
+    // Same modification time, different size.
+    auto const modifiedTime = std::filesystem::last_write_time(filePath);
+    std::ofstream(filePath, std::ios::binary) << "abcd";
+    std::filesystem::last_write_time(filePath, modifiedTime);
+
+    EXPECT_FALSE(entry.findVerdict(filePath, stamp, isMatch));
+}
+
+TEST_F(ResultCacheTest, SearchReusesAndRefreshesResults)
+{
+    writeFile(m_root / "a.txt", "needle");
+    writeFile(m_root / "b.txt", "hay");
+    writeFile(m_root / "sub" / "c.txt", "needle");
+    makeOld(m_root / "sub");
+    makeOld(m_root);
+
+    CResultCache cache;
+    std::vector<std::string> const expected = { "a.txt", "c.txt" };
+
+    EXPECT_EQ(search(cache, L"needle"), expected);
+    EXPECT_EQ(cache.getEntryCount(), 1u);
+    EXPECT_GT(cache.getSize(), 0u);
+
+    EXPECT_EQ(search(cache, L"needle"), expected);
+
+    // Changing a file's contents does not change its directory's stamp,
+    // but the file's own stamp invalidates its verdict.
+    writeFile(m_root / "b.txt", "needle!");
+    makeOld(m_root);
+    std::vector<std::string> const updated = { "a.txt", "b.txt", "c.txt" };
+    EXPECT_EQ(search(cache, L"needle"), updated);
+}
+
+TEST_F(ResultCacheTest, EvictsBySizeAndAge)
+{
+    writeFile(m_root / "a.txt", "a");
+    makeOld(m_root);
+
+    CResultCache cache;
+    search(cache, L"a");
+    search(cache, L"b");
+    EXPECT_EQ(cache.getEntryCount(), 2u);
+
+    cache.setMaxSize(cache.getSize() - 1);
+    EXPECT_EQ(cache.getEntryCount(), 1u);
+
+    cache.setMaxAge(std::chrono::seconds(-1));
+    EXPECT_EQ(cache.getEntryCount(), 0u);
+}
+
+TEST_F(ResultCacheTest, SavesAndLoads)
+{
+    writeFile(m_root / "a.txt", "needle");
+    makeOld(m_root);
+
+    std::filesystem::path const cacheFile = m_root.parent_path() / "lightning_cache_file.bin";
+
+    {
+        CResultCache cache;
+        search(cache, L"needle");
+        ASSERT_TRUE(cache.save(cacheFile));
+    }
+
+    CResultCache loaded;
+    ASSERT_TRUE(loaded.load(cacheFile));
+    EXPECT_EQ(loaded.getEntryCount(), 1u);
+    EXPECT_GT(loaded.getSize(), 0u);
+
+    std::vector<std::string> const expected = { "a.txt" };
+    EXPECT_EQ(search(loaded, L"needle"), expected);
+
+    // A truncated file is rejected as a whole.
+    std::filesystem::resize_file(cacheFile, std::filesystem::file_size(cacheFile) / 2);
+    EXPECT_FALSE(loaded.load(cacheFile));
+    EXPECT_EQ(loaded.getEntryCount(), 0u);
+
+    std::filesystem::remove(cacheFile);
+}
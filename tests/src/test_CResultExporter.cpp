@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CResultExporter.hpp>
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+static std::vector<std::string> splitLines(std::string const &text) {
+    std::vector<std::string> lines;
+    std::istringstream stream(text);
+    std::string line;
+
+    while(std::getline(stream, line)) {
+        lines.push_back(line);
+    }
+
+    return lines;
+}
+
+TEST(ResultExporter, FormatsCsvRows)
+{
+    std::string buffer;
+
+    CResultExporter::formatRow(CResultExporter::Format::Csv, "/tmp/plain.txt", buffer);
+    CResultExporter::formatRow(CResultExporter::Format::Csv, "/tmp/a,b \"c\".txt", buffer);
+
+    EXPECT_EQ(buffer, "/tmp/plain.txt\n\"/tmp/a,b \"\"c\"\".txt\"\n");
+}
+
+TEST(ResultExporter, FormatsNdJsonRows)
+{
+    std::string buffer;
+
+    CResultExporter::formatRow(CResultExporter::Format::NdJson, "/tmp/a\"b\\c\td.txt", buffer);
+
+    EXPECT_EQ(buffer, "{\"path\":\"/tmp/a\\\"b\\\\c\\td.txt\"}\n");
+}
+
+TEST(ResultExporter, DirectModeWritesHeaderAndRows)
+{
+    std::ostringstream output;
+
+    {
+        CResultExporter exporter(output, CResultExporter::Format::Csv, CResultExporter::Mode::Direct);
+        exporter.onFileMatched("one.txt");
+        exporter.onFileMatched("two.txt");
+        exporter.finish();
+
+        EXPECT_EQ(exporter.getRowsWritten(), 2u);
+        EXPECT_FALSE(exporter.hasError());
+
+        // Rows arriving after finish() are dropped.
+        exporter.onFileMatched("three.txt");
+    }
+
+    EXPECT_EQ(output.str(), "path\none.txt\ntwo.txt\n");
+}
+
+TEST(ResultExporter, BackgroundModeCollectsRowsFromManyThreads)
+{
+    constexpr int numThreads = 8;
+    constexpr int rowsPerThread = 5000;
+
+    std::ostringstream output;
+    CResultExporter exporter(output, CResultExporter::Format::NdJson);
+
+    // A small queue forces the search threads to wait for the writer.
+    exporter.setQueueCapacity(16);
+
+    std::vector<std::thread> threads;
+    for(int t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&exporter, t] {
+            for(int i = 0; i < rowsPerThread; ++i) {
+                exporter.onFileMatched("file_" + std::to_string(t) + "_" + std::to_string(i));
+            }
+        });
+    }
+
+    for(std::thread &thread : threads) {
+        thread.join();
+    }
+
+    exporter.finish();
+
+    std::vector<std::string> const lines = splitLines(output.str());
+    std::set<std::string> const uniqueLines(lines.begin(), lines.end());
+
+    EXPECT_EQ(lines.size(), static_cast<size_t>(numThreads * rowsPerThread));
+    EXPECT_EQ(uniqueLines.size(), lines.size());
+    EXPECT_EQ(uniqueLines.count("{\"path\":\"file_3_42\"}"), 1u);
+}
+
+TEST(ResultExporter, WritesToFile)
+{
+    std::filesystem::path const outputPath = std::filesystem::temp_directory_path() / "lightning_export_test.csv";
+
+    {
+        CResultExporter exporter(outputPath, CResultExporter::Format::Csv);
+        exporter.onFileMatched("match.txt");
+    }
+
+    std::ifstream file(outputPath, std::ios::binary);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    file.close();
+
+    EXPECT_EQ(contents.str(), "path\nmatch.txt\n");
+
+    std::filesystem::remove(outputPath);
+}
+
+TEST(ResultExporter, ThrowsIfFileCannotBeOpened)
+{
+    std::filesystem::path const outputPath = std::filesystem::temp_directory_path() / "lightning_no_such_dir" / "out.csv";
+
+    EXPECT_THROW(CResultExporter(outputPath, CResultExporter::Format::Csv), std::runtime_error);
+}
@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CResultTable.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+static std::vector<std::wstring> getNames(CResultTable const &table, std::vector<CResultTable::Row> const &rows) {
+    std::vector<std::wstring> names;
+    for(CResultTable::Row const row : rows) {
+        names.emplace_back(table.getName(table.getNameId(row)));
+    }
+    return names;
+}
+
+TEST(CResultTable, InternsNamesAndDirectories) {
+    CResultTable table;
+    table.addRow("/a/b/readme.txt", 10, 100);
+    table.addRow("/a/b/main.cpp", 20, 200);
+    table.addRow("/a/c/readme.txt", 30, 300);
+
+    ASSERT_EQ(table.getRowCount(), 3u);
+    EXPECT_EQ(table.getDirectoryId(0), table.getDirectoryId(1));
+    EXPECT_NE(table.getDirectoryId(0), table.getDirectoryId(2));
+    EXPECT_EQ(table.getNameId(0), table.getNameId(2));
+
+    EXPECT_EQ(table.getName(table.getNameId(1)), L"main.cpp");
+    EXPECT_EQ(table.getDirectory(table.getDirectoryId(2)), L"/a/c");
+    EXPECT_EQ(table.getPath(1), std::filesystem::path("/a/b/main.cpp"));
+    EXPECT_EQ(table.getSize(2), 30u);
+    EXPECT_EQ(table.getModifiedTime(1), 200);
+}
+
+TEST(CResultTable, SortsByEachColumn) {
+    CResultTable table;
+    table.addRow("/x/Beta", 3, -5);
+    table.addRow("/y/alpha", 1, 7);
+    table.addRow("/a/gamma", 2, 0);
+    table.addRow("/b/alpha", 2, -9);
+
+    using Column = CResultTable::Column;
+
+    // Names ignore case first, and ties are ordered by directory.
+    EXPECT_EQ(table.select(4, L"", Column::Name, false, 1),
+              (std::vector<CResultTable::Row>{ 3, 1, 0, 2 }));
+    EXPECT_EQ(table.select(4, L"", Column::Name, true, 1),
+              (std::vector<CResultTable::Row>{ 2, 0, 1, 3 }));
+    EXPECT_EQ(table.select(4, L"", Column::Directory, false, 1),
+              (std::vector<CResultTable::Row>{ 2, 3, 0, 1 }));
+
+    // Ties keep the order the rows were added in, in both directions.
+    EXPECT_EQ(table.select(4, L"", Column::Size, false, 1),
+              (std::vector<CResultTable::Row>{ 1, 2, 3, 0 }));
+    EXPECT_EQ(table.select(4, L"", Column::Size, true, 1),
+              (std::vector<CResultTable::Row>{ 0, 2, 3, 1 }));
+    EXPECT_EQ(table.select(4, L"", Column::ModifiedTime, false, 1),
+              (std::vector<CResultTable::Row>{ 3, 0, 2, 1 }));
+
+    // Without a sort column, even descending views keep that order.
+    EXPECT_EQ(table.select(4, L"", Column::None, true, 1),
+              (std::vector<CResultTable::Row>{ 0, 1, 2, 3 }));
+
+    // Only the given number of rows is viewed.
+    EXPECT_EQ(table.select(2, L"", Column::Size, false, 1),
+              (std::vector<CResultTable::Row>{ 1, 0 }));
+}
+
+TEST(CResultTable, FiltersNamesAndDirectoriesIgnoringCase) {
+    CResultTable table;
+    table.addRow("/src/Main.cpp", 1, 0);
+    table.addRow("/docs/guide.md", 1, 0);
+    table.addRow("/src/util.cpp", 1, 0);
+    table.addRow("/MAIN/notes.txt", 1, 0);
+
+    std::vector<CResultTable::Row> const rows = table.select(4, L"main", CResultTable::Column::Name, false, 1);
+    EXPECT_EQ(getNames(table, rows), (std::vector<std::wstring>{ L"Main.cpp", L"notes.txt" }));
+
+    EXPECT_TRUE(table.select(4, L"nothing", CResultTable::Column::Name, false, 1).empty());
+}
+
+TEST(CResultTable, ParallelSelectAgreesWithSerial) {
+    std::mt19937 random(17);
+    std::uniform_int_distribution<int> pick(0, 199);
+
+    CResultTable table;
+    for(int i = 0; i < 100000; ++i) {
+        std::wstring const directory = L"/d" + std::to_wstring(pick(random) % 37);
+        std::wstring const name = (pick(random) % 2 ? L"File" : L"file") + std::to_wstring(pick(random));
+        table.addRow(directory + L"/" + name, static_cast<std::uint64_t>(pick(random)), pick(random) - 100);
+    }
+
+    using Column = CResultTable::Column;
+
+    for(Column const column : { Column::None, Column::Name, Column::Directory, Column::Size, Column::ModifiedTime }) {
+        for(bool const isDescending : { false, true }) {
+            for(std::wstring const filter : { L"", L"e1", L"D3" }) {
+                EXPECT_EQ(table.select(table.getRowCount(), filter, column, isDescending, 8),
+                          table.select(table.getRowCount(), filter, column, isDescending, 1));
+            }
+        }
+    }
+}
+
+TEST(CResultTable, ReadsWhileRowsAreAdded) {
+    CResultTable table;
+    std::atomic_bool isDone(false);
+
+    std::thread writer([&table, &isDone] {
+        for(int i = 0; i < 200000; ++i) {
+            table.addRow(L"/dir" + std::to_wstring(i % 100) + L"/name" + std::to_wstring(i), i, i);
+        }
+        isDone = true;
+    });
+
+    // Every published row is complete, whenever it is read.
+    while(!isDone) {
+        size_t const rowCount = table.getRowCount();
+        std::vector<CResultTable::Row> const rows =
+            table.select(rowCount, L"name1", CResultTable::Column::Size, true, 2);
+
+        for(CResultTable::Row const row : rows) {
+            ASSERT_EQ(table.getName(table.getNameId(row)), L"name" + std::to_wstring(row));
+            ASSERT_EQ(table.getSize(row), row);
+        }
+        ASSERT_TRUE(std::is_sorted(rows.rbegin(), rows.rend()));
+    }
+
+    writer.join();
+    EXPECT_EQ(table.getRowCount(), 200000u);
+}
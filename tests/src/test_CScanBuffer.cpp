@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CScanBuffer.hpp>
+
+#include <search/CStreamRegexSearcher.hpp>
+#include <search/CStreamSearcher.hpp>
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+TEST(ScanBuffer, StartsEmpty) {
+    CScanBuffer buffer;
+    EXPECT_EQ(buffer.data(), nullptr);
+    EXPECT_EQ(buffer.getCapacity(), 0u);
+}
+
+TEST(ScanBuffer, ReusesMemoryWhenLargeEnough) {
+    CScanBuffer buffer;
+    wchar_t *const first = buffer.reserve(1000);
+    EXPECT_GE(buffer.getCapacity(), 1000u);
+
+    EXPECT_EQ(buffer.reserve(10), first);
+    EXPECT_EQ(buffer.reserve(1000), first);
+}
+
+TEST(ScanBuffer, KeepsPrefixWhenGrowing) {
+    CScanBuffer buffer;
+    wchar_t *data = buffer.reserve(4);
+    data[0] = L'a';
+    data[1] = L'b';
+    data[2] = L'c';
+
+    data = buffer.reserve(5, 2);
+    EXPECT_EQ(data[0], L'a');
+    EXPECT_EQ(data[1], L'b');
+
+    // Growth is geometric.
+    EXPECT_GE(buffer.getCapacity(), 8u);
+}
+
+TEST(ScanBuffer, TrimsOnlyLargeBuffers) {
+    CScanBuffer buffer;
+    buffer.reserve(100);
+
+    buffer.trim(100);
+    EXPECT_EQ(buffer.getCapacity(), 100u);
+
+    buffer.trim(99);
+    EXPECT_EQ(buffer.getCapacity(), 0u);
+    EXPECT_EQ(buffer.data(), nullptr);
+}
+
+TEST(ScanBuffer, StaleContentsDoNotLeakIntoLaterSearches) {
+    // Both searchers reuse a per-thread buffer; a long stream followed by
+    // a short one must not see the tail of the long one.
+    CStreamSearcher literal(L"needle", false, false, 64);
+    CStreamRegexSearcher regex(L"nee+dle");
+
+    std::wstringstream longStream(std::wstring(200, L'x') + L"needle");
+    std::wstringstream shortStream(L"nee");
+
+    EXPECT_TRUE(literal.searchText(longStream));
+    EXPECT_FALSE(literal.searchText(shortStream));
+
+    std::wstringstream longRegexStream(std::wstring(200000, L'x') + L"needle");
+    std::wstringstream shortRegexStream(L"nee");
+
+    EXPECT_TRUE(regex.searchText(longRegexStream));
+    EXPECT_FALSE(regex.searchText(shortRegexStream));
+}
@@ -0,0 +1,208 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CSearchEngine.hpp>
+
+#include <search/CFilterName.hpp>
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Observer which records every matched file.
+ */
+class CCollectingObserver : public ISearchObserver {
+public:
+    void onFileMatched(std::filesystem::path const &matchedFile) override {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_matches.push_back(matchedFile);
+    }
+
+    std::mutex m_mutex;
+    std::vector<std::filesystem::path> m_matches;
+};
+
+/**
+ * @brief Test fixture which creates a directory tree to search.
+ */
+class SearchEngineTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::string const testName = ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        m_root = std::filesystem::temp_directory_path() / ("lightning_engine_" + testName);
+        std::filesystem::remove_all(m_root);
+
+        // Enough files to need several search batches.
+        for(int dir = 0; dir < 5; ++dir) {
+            std::filesystem::path const dirPath = m_root / ("dir" + std::to_string(dir));
+            std::filesystem::create_directories(dirPath);
+
+            for(int file = 0; file < 100; ++file) {
+                std::string const extension = (file % 4 == 0) ? ".log" : ".txt";
+                std::ofstream(dirPath / ("file" + std::to_string(file) + extension)) << "x";
+            }
+        }
+    }
+
+    void TearDown() override {
+        std::error_code ec;
+        std::filesystem::remove_all(m_root, ec);
+    }
+
+    std::filesystem::path m_root;
+};
+
+TEST_F(SearchEngineTest, WaitForCompletionReturnsAfterAllMatches)
+{
+    CCollectingObserver observer;
+
+    CSearchQuery *searchQuery = new CSearchQuery;
+    searchQuery->setDirectories({ m_root });
+    searchQuery->setFilters({ new CFilterName(L".log") });
+    searchQuery->addResultObserver(&observer);
+
+    CSearchEngine searchEngine(searchQuery);
+    searchEngine.performSearch();
+    searchEngine.waitForCompletion();
+
+    EXPECT_EQ(searchEngine.getPendingOperations(), 0);
+    EXPECT_EQ(searchEngine.getTotalFilesSearched(), 500);
+    EXPECT_EQ(searchEngine.getTotalMatches(), 125);
+    EXPECT_EQ(observer.m_matches.size(), 125u);
+}
+
+TEST_F(SearchEngineTest, WaitForCompletionWithoutSearchReturnsImmediately)
+{
+    CSearchEngine searchEngine(new CSearchQuery);
+
+    searchEngine.waitForCompletion();
+
+    EXPECT_EQ(searchEngine.getTotalMatches(), 0);
+}
+
+TEST_F(SearchEngineTest, SearchesListedFilesWithoutEnumerating)
+{
+    CCollectingObserver observer;
+
+    // Refine: only the files of dir1 are searched, though the query's
+    // directory (if it had one) would hold all of them.
+    std::vector<CSearchFile> searchFiles;
+    for(int file = 0; file < 100; ++file) {
+        std::string const extension = (file % 4 == 0) ? ".log" : ".txt";
+        searchFiles.push_back(CSearchFile{ m_root / "dir1" / ("file" + std::to_string(file) + extension) });
+    }
+
+    CSearchQuery *searchQuery = new CSearchQuery;
+    searchQuery->setDirectories({ m_root });
+    searchQuery->setSearchFiles(searchFiles);
+    searchQuery->setFilters({ new CFilterName(L".log") });
+    searchQuery->addResultObserver(&observer);
+
+    EXPECT_TRUE(searchQuery->getKey().empty());
+
+    CSearchEngine searchEngine(searchQuery);
+    searchEngine.performSearch();
+    searchEngine.waitForCompletion();
+
+    EXPECT_EQ(searchEngine.getTotalFilesToSearch(), 100);
+    EXPECT_EQ(searchEngine.getTotalFilesSearched(), 100);
+    EXPECT_EQ(searchEngine.getTotalMatches(), 25);
+
+    for(std::filesystem::path const &match : observer.m_matches) {
+        EXPECT_EQ(match.parent_path(), m_root / "dir1");
+    }
+}
+
+TEST_F(SearchEngineTest, EmptyFileListSearchesNothing)
+{
+    CSearchQuery *searchQuery = new CSearchQuery;
+    searchQuery->setDirectories({ m_root });
+    searchQuery->setSearchFiles({});
+
+    CSearchEngine searchEngine(searchQuery);
+    searchEngine.performSearch();
+    searchEngine.waitForCompletion();
+
+    EXPECT_EQ(searchEngine.getTotalFilesSearched(), 0);
+}
+
+TEST_F(SearchEngineTest, RanksListedFilesByKnownMetadata)
+{
+    // The files are all one byte long; the ranking must use the sizes
+    // the list claims rather than looking at the files.
+    std::vector<CSearchFile> searchFiles;
+    for(int file = 0; file < 10; ++file) {
+        CSearchFile searchFile;
+        searchFile.path = m_root / "dir0" / ("file" + std::to_string(file) + (file % 4 == 0 ? ".log" : ".txt"));
+        searchFile.hasMetadata = true;
+        searchFile.size = static_cast<std::uint64_t>((file * 7) % 10);
+        searchFiles.push_back(searchFile);
+    }
+
+    CRanking ranking;
+    ranking.key = CRanking::Key::Size;
+    ranking.count = 3;
+    ranking.isDescending = true;
+
+    CSearchQuery *searchQuery = new CSearchQuery;
+    searchQuery->setSearchFiles(searchFiles);
+    searchQuery->setRanking(ranking);
+
+    CSearchEngine searchEngine(searchQuery);
+    searchEngine.performSearch();
+    searchEngine.waitForCompletion();
+
+    std::vector<CRankedResult> const results = searchEngine.getRankedResults();
+    ASSERT_EQ(results.size(), 3u);
+    EXPECT_EQ(results[0].value, 9);
+    EXPECT_EQ(results[0].path.filename(), "file7.txt");
+    EXPECT_EQ(results[1].value, 8);
+    EXPECT_EQ(results[2].value, 7);
+}
+
+TEST_F(SearchEngineTest, ConcurrentSearchesShareTheExecutor)
+{
+    CExecutor::Priority const priorities[] = {
+        CExecutor::Priority::Background, CExecutor::Priority::Normal, CExecutor::Priority::Interactive
+    };
+
+    CCollectingObserver observers[3];
+    std::vector<CSearchEngine *> searchEngines;
+
+    for(int i = 0; i < 3; ++i) {
+        CSearchQuery *searchQuery = new CSearchQuery;
+        searchQuery->setDirectories({ m_root });
+        searchQuery->setFilters({ new CFilterName(i == 1 ? L".txt" : L".log") });
+        searchQuery->addResultObserver(&observers[i]);
+
+        CSearchSettings settings;
+        settings.setPriority(priorities[i]);
+        settings.setWeight(static_cast<unsigned>(i + 1));
+        searchEngines.push_back(new CSearchEngine(searchQuery, settings));
+    }
+
+    size_t const workers = CExecutor::getShared().getWorkerCount();
+
+    for(CSearchEngine *searchEngine : searchEngines) {
+        searchEngine->performSearch();
+    }
+
+    for(CSearchEngine *searchEngine : searchEngines) {
+        searchEngine->waitForCompletion();
+        EXPECT_EQ(searchEngine->getTotalFilesSearched(), 500);
+    }
+
+    EXPECT_EQ(observers[0].m_matches.size(), 125u);
+    EXPECT_EQ(observers[1].m_matches.size(), 375u);
+    EXPECT_EQ(observers[2].m_matches.size(), 125u);
+
+    // No search started threads of its own.
+    EXPECT_EQ(CExecutor::getShared().getWorkerCount(), workers);
+
+    for(CSearchEngine *searchEngine : searchEngines) {
+        delete searchEngine;
+    }
+}
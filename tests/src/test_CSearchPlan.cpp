@@ -0,0 +1,206 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CSearchPlan.hpp>
+
+#include <search/CFilterCombine.hpp>
+#include <search/CFilterContents.hpp>
+#include <search/CFilterName.hpp>
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Test fixture which owns the filters handed to the plan and
+ * provides a scratch directory for files to match against.
+ */
+class SearchPlanTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::string const testName = ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        m_root = std::filesystem::temp_directory_path() / ("lightning_plan_" + testName);
+        std::filesystem::remove_all(m_root);
+        std::filesystem::create_directories(m_root);
+    }
+
+    void TearDown() override {
+        for(IFilter *filter : m_filters) {
+            delete filter;
+        }
+
+        std::error_code ec;
+        std::filesystem::remove_all(m_root, ec);
+    }
+
+    IFilter *add(IFilter *filter) {
+        m_filters.push_back(filter);
+        return filter;
+    }
+
+    std::filesystem::path writeFile(std::string const &name, std::string const &contents) {
+        std::filesystem::path const filePath = m_root / name;
+        std::ofstream file(filePath, std::ios::binary);
+        file << contents;
+        return filePath;
+    }
+
+    std::vector<IFilter *> m_filters;
+    std::filesystem::path m_root;
+};
+
+TEST_F(SearchPlanTest, EmptyPlanMatchesEverything)
+{
+    CSearchPlan plan(m_filters);
+
+    EXPECT_TRUE(plan.getSteps().empty());
+    EXPECT_TRUE(plan.matches(writeFile("a.txt", "x")));
+}
+
+TEST_F(SearchPlanTest, NameFiltersRunBeforeContentFilters)
+{
+    IFilter *contents = add(new CFilterContents(L"needle"));
+    IFilter *name = add(new CFilterName(L".txt"));
+
+    CSearchPlan plan(m_filters);
+    auto const &steps = plan.getSteps();
+
+    ASSERT_EQ(steps.size(), 3u);
+    EXPECT_EQ(steps[0].type, CSearchPlan::StepType::Filter);
+    EXPECT_EQ(steps[0].filter, name);
+    EXPECT_EQ(steps[1].type, CSearchPlan::StepType::SizeCheck);
+    EXPECT_EQ(steps[2].type, CSearchPlan::StepType::ContentScan);
+    ASSERT_EQ(steps[2].contentFilters.size(), 1u);
+    EXPECT_EQ(steps[2].contentFilters[0], contents);
+}
+
+TEST_F(SearchPlanTest, FlattensNestedAndCombinations)
+{
+    auto *outer = new CFilterCombine(CFilterCombine::Mode::AND);
+    auto *inner = new CFilterCombine(CFilterCombine::Mode::AND);
+    inner->addFilter(new CFilterContents(L"alpha"));
+    inner->addFilter(new CFilterName(L"log"));
+    outer->addFilter(inner);
+    outer->addFilter(new CFilterContents(L"beta", false, false, true));
+    add(outer);
+
+    CSearchPlan plan(m_filters);
+    auto const &steps = plan.getSteps();
+
+    ASSERT_EQ(steps.size(), 3u);
+    EXPECT_EQ(steps[0].type, CSearchPlan::StepType::Filter);
+    EXPECT_EQ(steps[2].type, CSearchPlan::StepType::ContentScan);
+
+    // Both content filters share a single scan, literal before regex.
+    ASSERT_EQ(steps[2].contentFilters.size(), 2u);
+    EXPECT_FALSE(steps[2].contentFilters[0]->isRegex());
+    EXPECT_TRUE(steps[2].contentFilters[1]->isRegex());
+}
+
+TEST_F(SearchPlanTest, OrCombinationsStayIntact)
+{
+    auto *either = new CFilterCombine(CFilterCombine::Mode::OR);
+    either->addFilter(new CFilterName(L"a"));
+    either->addFilter(new CFilterName(L"b"));
+    add(either);
+
+    CSearchPlan plan(m_filters);
+
+    ASSERT_EQ(plan.getSteps().size(), 1u);
+    EXPECT_EQ(plan.getSteps()[0].filter, either);
+    EXPECT_EQ(either->getCost(), IFilter::Cost::Name);
+}
+
+TEST_F(SearchPlanTest, DerivesSizeBounds)
+{
+    add(new CFilterContents(L"hello", false, true));
+    add(new CFilterContents(L"ab+c", false, false, true));
+
+    CSearchPlan plan(m_filters);
+
+    EXPECT_TRUE(plan.hasExactFileSize());
+    EXPECT_EQ(plan.getExactFileSize(), 5u);
+    EXPECT_EQ(plan.getMinFileSize(), 5u);
+    EXPECT_TRUE(plan.isSatisfiable());
+}
+
+TEST_F(SearchPlanTest, CaseInsensitiveWholeMatchOnlyGivesMinimum)
+{
+    add(new CFilterContents(L"hello", true, true));
+
+    CSearchPlan plan(m_filters);
+
+    EXPECT_FALSE(plan.hasExactFileSize());
+    EXPECT_EQ(plan.getMinFileSize(), 5u);
+}
+
+TEST_F(SearchPlanTest, ContradictingSizesAreUnsatisfiable)
+{
+    add(new CFilterContents(L"abc", false, true));
+    add(new CFilterContents(L"abcd", false, true));
+
+    CSearchPlan plan(m_filters);
+
+    EXPECT_FALSE(plan.isSatisfiable());
+    EXPECT_FALSE(plan.matches(writeFile("abc.txt", "abc")));
+}
+
+TEST_F(SearchPlanTest, SizeCheckRejectsWithoutReading)
+{
+    add(new CFilterContents(L"abc", false, true));
+
+    CSearchPlan plan(m_filters);
+
+    EXPECT_TRUE(plan.matches(writeFile("exact.txt", "abc")));
+    EXPECT_FALSE(plan.matches(writeFile("longer.txt", "abcd")));
+    EXPECT_FALSE(plan.matches(writeFile("shorter.txt", "ab")));
+}
+
+TEST_F(SearchPlanTest, SharedScanAppliesAllFilters)
+{
+    add(new CFilterContents(L"timeout"));
+    add(new CFilterContents(L"RETRY", true));
+    add(new CFilterContents(L"err(or)?\\s+\\d+", false, false, true));
+
+    CSearchPlan plan(m_filters);
+
+    EXPECT_TRUE(plan.matches(writeFile("hit.log", "timeout; retry; error 42")));
+    EXPECT_FALSE(plan.matches(writeFile("miss1.log", "timeout; error 42")));
+    EXPECT_FALSE(plan.matches(writeFile("miss2.log", "timeout; retry; error")));
+    EXPECT_FALSE(plan.matches(m_root / "does_not_exist.log"));
+}
+
+TEST_F(SearchPlanTest, TextDescribesSteps)
+{
+    add(new CFilterContents(L"abc", false, true));
+    add(new CFilterName(L"x"));
+
+    std::wstring const text = CSearchPlan(m_filters).getText();
+
+    EXPECT_NE(text.find(L"1. Name contains"), std::wstring::npos);
+    EXPECT_NE(text.find(L"2. File size is exactly 3 bytes"), std::wstring::npos);
+    EXPECT_NE(text.find(L"3. File content matches"), std::wstring::npos);
+}
+
+TEST_F(SearchPlanTest, ReportsMatchLocations)
+{
+    add(new CFilterContents(L"needle"));
+    add(new CFilterContents(L"n[a-z]+e", false, false, true));
+
+    CSearchPlan plan(m_filters);
+    plan.setLocationOptions(10, 80);
+
+    std::vector<CMatchLocation> locations;
+    EXPECT_TRUE(plan.matches(writeFile("hay.txt", "hay\nhay needle hay\nnone"), &locations));
+
+    // Both filters report the same range, which is only listed once.
+    ASSERT_EQ(locations.size(), 2u);
+    EXPECT_EQ(locations[0].lineNumber, 2u);
+    EXPECT_EQ(locations[0].column, 5u);
+    EXPECT_EQ(locations[0].length, 6u);
+    EXPECT_EQ(locations[0].snippet, L"hay needle hay");
+    EXPECT_EQ(locations[1].lineNumber, 3u);
+    EXPECT_EQ(locations[1].snippet, L"none");
+}
@@ -0,0 +1,189 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CSearchSettings.hpp>
+
+#include <SystemResources.hpp>
+#include <search/CFilterContents.hpp>
+#include <search/CSearchEngine.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#define MIB (1024ULL * 1024)
+
+class CMatchCounter : public ISearchObserver {
+public:
+    void onFileMatched(std::filesystem::path const &) override { m_count++; }
+
+    std::atomic_int m_count{0};
+};
+
+class SearchSettingsTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        m_dir = std::filesystem::temp_directory_path() / "lightning_search_settings_test";
+        std::filesystem::remove_all(m_dir);
+        std::filesystem::create_directories(m_dir);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(m_dir);
+    }
+
+    void writeFile(std::filesystem::path const &path, std::string const &contents) {
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream out(path, std::ios::binary);
+        out << contents;
+    }
+
+    std::filesystem::path m_dir;
+};
+
+TEST(CgroupParsing, ParsesCpuMax) {
+    size_t cpuCount = 0;
+
+    EXPECT_FALSE(parseCgroupCpuMax("max 100000", cpuCount));
+    EXPECT_FALSE(parseCgroupCpuMax("", cpuCount));
+    EXPECT_FALSE(parseCgroupCpuMax("abc 100000", cpuCount));
+
+    ASSERT_TRUE(parseCgroupCpuMax("200000 100000", cpuCount));
+    EXPECT_EQ(cpuCount, 2u);
+
+    // Partial CPUs round up, and a tiny quota still allows one thread.
+    ASSERT_TRUE(parseCgroupCpuMax("150000 100000", cpuCount));
+    EXPECT_EQ(cpuCount, 2u);
+    ASSERT_TRUE(parseCgroupCpuMax("1000 100000", cpuCount));
+    EXPECT_EQ(cpuCount, 1u);
+}
+
+TEST(CgroupParsing, ParsesMemoryMax) {
+    std::uint64_t memoryBytes = 0;
+
+    EXPECT_FALSE(parseCgroupMemoryMax("max", memoryBytes));
+    EXPECT_FALSE(parseCgroupMemoryMax("", memoryBytes));
+
+    ASSERT_TRUE(parseCgroupMemoryMax("536870912\n", memoryBytes));
+    EXPECT_EQ(memoryBytes, 512 * MIB);
+}
+
+TEST_F(SearchSettingsTest, AppliesLowestLimitOfAncestors) {
+    writeFile(m_dir / "cpu.max", "max 100000\n");
+    writeFile(m_dir / "kubepods" / "cpu.max", "400000 100000\n");
+    writeFile(m_dir / "kubepods" / "memory.max", "1073741824\n");
+    writeFile(m_dir / "kubepods" / "pod1" / "cpu.max", "max 100000\n");
+    writeFile(m_dir / "kubepods" / "pod1" / "memory.max", "536870912\n");
+    std::filesystem::create_directories(m_dir / "kubepods" / "pod1" / "container");
+
+    CSystemResources resources;
+    resources.cpuCount = 64;
+    resources.memoryBytes = 256 * 1024 * MIB;
+
+    applyCgroupLimits(m_dir, "/kubepods/pod1/container", resources);
+
+    EXPECT_EQ(resources.cpuCount, 4u);
+    EXPECT_EQ(resources.memoryBytes, 512 * MIB);
+
+    // Without limits, nothing changes.
+    CSystemResources unlimited;
+    unlimited.cpuCount = 8;
+    applyCgroupLimits(m_dir / "missing", "/", unlimited);
+
+    EXPECT_EQ(unlimited.cpuCount, 8u);
+    EXPECT_EQ(unlimited.memoryBytes, 0u);
+}
+
+TEST(SearchSettings, DerivesDefaultsFromResources) {
+    CSystemResources resources;
+    resources.cpuCount = 2;
+    resources.memoryBytes = 4096 * MIB;
+
+    CSearchSettings const settings(resources);
+
+    EXPECT_EQ(settings.getWorkerThreads(), 2u);
+    EXPECT_EQ(settings.getIoConcurrency(), 2u);
+    EXPECT_EQ(settings.getMemoryBudget(), 512 * MIB);
+    EXPECT_EQ(settings.getBufferCharsPerWorker(), 256 * MIB / sizeof(wchar_t));
+
+    // Small machines still get a usable budget, and large ones are capped.
+    resources.memoryBytes = 64 * MIB;
+    EXPECT_EQ(CSearchSettings(resources).getMemoryBudget(), CSearchSettings::MIN_MEMORY_BUDGET);
+
+    resources.memoryBytes = 1024 * 1024 * MIB;
+    EXPECT_EQ(CSearchSettings(resources).getMemoryBudget(), CSearchSettings::MAX_DEFAULT_MEMORY_BUDGET);
+
+    // The process defaults are sane wherever the tests run.
+    CSearchSettings const processDefaults;
+    EXPECT_GE(processDefaults.getWorkerThreads(), 1u);
+    EXPECT_GE(processDefaults.getMemoryBudget(), CSearchSettings::MIN_MEMORY_BUDGET);
+}
+
+TEST(SearchSettings, ClampsValues) {
+    CSearchSettings settings;
+    settings.setWorkerThreads(0);
+    settings.setIoConcurrency(0);
+    settings.setMemoryBudget(0);
+
+    EXPECT_EQ(settings.getWorkerThreads(), 1u);
+    EXPECT_EQ(settings.getIoConcurrency(), 1u);
+    EXPECT_GT(settings.getBufferCharsPerWorker(), 0u);
+}
+
+TEST_F(SearchSettingsTest, SearchesWithinSmallBudget) {
+    // A match which straddles any small buffer boundary.
+    std::string contents(100000, 'x');
+    contents.replace(50000, 6, "needle");
+    writeFile(m_dir / "big.txt", contents);
+    writeFile(m_dir / "small.txt", "no match here");
+
+    CSearchSettings settings;
+    settings.setWorkerThreads(2);
+    settings.setIoConcurrency(1);
+    settings.setMemoryBudget(0);
+
+    CMatchCounter counter;
+    CSearchQuery *query = new CSearchQuery;
+    query->setDirectories({ m_dir });
+    query->setFilters({ new CFilterContents(L"needle") });
+    query->addResultObserver(&counter);
+
+    CSearchEngine engine(query, settings);
+    EXPECT_EQ(engine.getSettings().getWorkerThreads(), 2u);
+
+    engine.performSearch();
+    engine.waitForCompletion();
+
+    EXPECT_EQ(engine.getTotalFilesSearched(), 2);
+    EXPECT_EQ(counter.m_count.load(), 1);
+}
+
+TEST_F(SearchSettingsTest, SearchesEverythingWithFewQueuedBatches) {
+    // Far more batches than may be queued, so that enumeration has to
+    // search most of them itself.
+    for(int i = 0; i < 2000; ++i) {
+        writeFile(m_dir / std::to_string(i % 7) / ("file" + std::to_string(i) + ".txt"),
+                  i % 3 == 0 ? "needle" : "hay");
+    }
+
+    CSearchSettings settings;
+    EXPECT_EQ(settings.getMaxQueuedBatches(), settings.getWorkerThreads() * 4);
+
+    settings.setWorkerThreads(2);
+    settings.setMaxQueuedBatches(1);
+    EXPECT_EQ(settings.getMaxQueuedBatches(), 1u);
+
+    CMatchCounter counter;
+    CSearchQuery *query = new CSearchQuery;
+    query->setDirectories({ m_dir });
+    query->setFilters({ new CFilterContents(L"needle") });
+    query->addResultObserver(&counter);
+
+    CSearchEngine engine(query, settings);
+    engine.performSearch();
+    engine.waitForCompletion();
+
+    EXPECT_EQ(engine.getTotalFilesSearched(), 2000);
+    EXPECT_EQ(counter.m_count.load(), 667);
+}
@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CSearchStats.hpp>
+
+#include <search/CFilterContents.hpp>
+#include <search/CSearchEngine.hpp>
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Stage = CSearchStats::Stage;
+
+class StatsMatchSink : public ISearchObserver {
+public:
+    void onFileMatched(std::filesystem::path const &) override {}
+};
+
+TEST(SearchStats, SumsRecordsOfAllThreads) {
+    CSearchStats stats;
+    std::vector<std::thread> threads;
+
+    for(int t = 0; t < 4; ++t) {
+        threads.emplace_back([&stats]() {
+            for(int i = 0; i < 1000; ++i) {
+                stats.record(Stage::Read, 100, 10);
+            }
+        });
+    }
+
+    for(std::thread &thread : threads) {
+        thread.join();
+    }
+
+    CSearchStats::CStageSummary const summary = stats.getSummary(Stage::Read);
+    EXPECT_EQ(summary.count, 4000u);
+    EXPECT_EQ(summary.totalNs, 400000u);
+    EXPECT_EQ(summary.amount, 40000u);
+
+    EXPECT_EQ(stats.getSummary(Stage::Match).count, 0u);
+}
+
+TEST(SearchStats, EstimatesPercentilesFromHistogram) {
+    CSearchStats stats;
+
+    // 99 fast operations and one slow one.
+    for(int i = 0; i < 99; ++i) {
+        stats.record(Stage::Open, 1000, 0);
+    }
+    stats.record(Stage::Open, 1000000, 0);
+
+    CSearchStats::CStageSummary const summary = stats.getSummary(Stage::Open);
+
+    // 1000 ns falls into the bucket [512, 1024).
+    EXPECT_EQ(summary.getPercentileNs(0.5), 1024u);
+    EXPECT_EQ(summary.getPercentileNs(0.99), 1024u);
+    EXPECT_GE(summary.getPercentileNs(1.0), 1000000u);
+
+    EXPECT_EQ(CSearchStats::CStageSummary().getPercentileNs(0.5), 0u);
+}
+
+TEST(SearchStats, TimersRecordOnlyInsideScope) {
+    CSearchStats stats;
+
+    {
+        CStageTimer const timer(Stage::Stat);
+    }
+    EXPECT_EQ(stats.getSummary(Stage::Stat).count, 0u);
+
+    {
+        CSearchStats::CScope const scope(&stats);
+
+        CStageTimer timer(Stage::Read);
+        timer.addAmount(42);
+        timer.stop();
+
+        // Stopping twice records once.
+        timer.stop();
+    }
+
+    EXPECT_EQ(CSearchStats::getCurrent(), nullptr);
+    EXPECT_EQ(stats.getSummary(Stage::Read).count, 1u);
+    EXPECT_EQ(stats.getSummary(Stage::Read).amount, 42u);
+}
+
+TEST(SearchStats, KeepsInstancesApart) {
+    // A thread records into several instances in turn; each sees only
+    // its own records, also when an instance reuses a freed address.
+    for(int round = 0; round < 3; ++round) {
+        CSearchStats first;
+        CSearchStats second;
+
+        first.record(Stage::Notify, 10, 1);
+        second.record(Stage::Notify, 10, 1);
+        second.record(Stage::Notify, 10, 1);
+
+        EXPECT_EQ(first.getSummary(Stage::Notify).count, 1u);
+        EXPECT_EQ(second.getSummary(Stage::Notify).count, 2u);
+    }
+}
+
+TEST(SearchStats, EngineRecordsPipelineStages) {
+    std::filesystem::path const dir = std::filesystem::temp_directory_path() / "lightning_search_stats_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir / "sub");
+
+    for(int i = 0; i < 10; ++i) {
+        std::ofstream(dir / "sub" / ("file" + std::to_string(i) + ".txt")) << (i % 2 ? "needle" : "haystack");
+    }
+
+    StatsMatchSink sink;
+    CSearchQuery *query = new CSearchQuery;
+    query->setDirectories({ dir });
+    query->setFilters({ new CFilterContents(L"needle", false, false, false) });
+    query->addResultObserver(&sink);
+
+    CSearchEngine engine(query);
+    engine.performSearch();
+    engine.waitForCompletion();
+
+    ASSERT_NE(engine.getStats(), nullptr);
+    CSearchStats const &stats = *engine.getStats();
+
+    EXPECT_EQ(stats.getSummary(Stage::DirectoryRead).count, 2u);
+    EXPECT_EQ(stats.getSummary(Stage::DirectoryRead).amount, 11u);
+    EXPECT_EQ(stats.getSummary(Stage::Open).count, 10u);
+    EXPECT_EQ(stats.getSummary(Stage::Read).amount, 5u * 6u + 5u * 8u);
+    EXPECT_GE(stats.getSummary(Stage::Match).count, 10u);
+    EXPECT_EQ(stats.getSummary(Stage::Notify).amount, 5u);
+
+    std::wstring const text = stats.getText();
+    EXPECT_NE(text.find(L"Directory read"), std::wstring::npos);
+    EXPECT_NE(text.find(L"Notify"), std::wstring::npos);
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(SearchStats, CanBeDisabled) {
+    CSearchSettings settings;
+    settings.setCollectStats(false);
+
+    CSearchEngine engine(new CSearchQuery, settings);
+    EXPECT_EQ(engine.getStats(), nullptr);
+}
@@ -0,0 +1,133 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CStreamFuzzySearcher.hpp>
+
+#include <search/CFilterContents.hpp>
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+
+TEST(StreamFuzzySearcher, ScansInPiecesLikeAtOnce) {
+    std::mt19937 random(7);
+    std::uniform_int_distribution<int> pickChar(0, 3);
+
+    for(size_t const patternLength : { 4, 40, 100 }) {
+        for(int round = 0; round < 30; ++round) {
+            std::wstring pattern;
+            std::wstring text;
+            for(size_t i = 0; i < patternLength; ++i) {
+                pattern += static_cast<wchar_t>(L'a' + pickChar(random));
+            }
+            for(int i = 0; i < 300; ++i) {
+                text += static_cast<wchar_t>(L'a' + pickChar(random));
+            }
+
+            for(bool const wholeMatch : { false, true }) {
+                CFuzzyMatcher const matcher(pattern, false, wholeMatch);
+                size_t const maxDistance = patternLength / 2;
+
+                CFuzzyMatcher::CScan scan;
+                matcher.beginScan(scan, maxDistance, 0);
+
+                size_t offset = 0;
+                while(offset < text.size()) {
+                    size_t const piece = std::min<size_t>(text.size() - offset, 1 + random() % 17);
+                    matcher.continueScan(scan, text.data() + offset, piece);
+                    offset += piece;
+                }
+
+                EXPECT_EQ(matcher.finishScan(scan), matcher.getDistance(text, maxDistance));
+            }
+        }
+    }
+}
+
+TEST(StreamFuzzySearcher, FindsTyposAcrossChunks) {
+    CStreamFuzzySearcher searcher(L"transaction", 2, true, false);
+
+    // Chunks of 3 characters split every occurrence.
+    searcher.setMaxBufferSize(3);
+
+    std::wstringstream ocr(L"Log: TRANSACTlON 42 was r0lled back\n");
+    EXPECT_TRUE(searcher.searchText(ocr));
+
+    std::wstringstream typo(L"the transcation failed");
+    EXPECT_EQ(searcher.findBestDistance(typo), 2u);
+
+    std::wstringstream exact(L"transactio transaction");
+    EXPECT_EQ(searcher.findBestDistance(exact), 0u);
+
+    std::wstringstream unrelated(L"nothing to see here");
+    EXPECT_FALSE(searcher.searchText(unrelated));
+    std::wstringstream unrelatedAgain(L"nothing to see here");
+    EXPECT_EQ(searcher.findBestDistance(unrelatedAgain), CFuzzyMatcher::NO_MATCH);
+}
+
+TEST(StreamFuzzySearcher, WholeMatch) {
+    CStreamFuzzySearcher searcher(L"hello world", 1, false, true);
+    searcher.setMaxBufferSize(4);
+
+    std::wstringstream oneEdit(L"hello wrld");
+    EXPECT_TRUE(searcher.searchText(oneEdit));
+
+    std::wstringstream longer(L"hello world, and more");
+    EXPECT_FALSE(searcher.searchText(longer));
+
+    std::wstring const text = L"hallo world";
+    std::vector<std::pair<size_t, size_t>> matches;
+    searcher.findMatches(text.data(), text.size(), 10, matches);
+    ASSERT_EQ(matches.size(), 1u);
+    EXPECT_EQ(matches[0].first, 0u);
+    EXPECT_EQ(matches[0].second, 11u);
+}
+
+TEST(StreamFuzzySearcher, LocatesMatches) {
+    CStreamFuzzySearcher const searcher(L"needle", 1, false, false);
+
+    std::wstring const text = L"a nedle, a needle and a neeedle but not a noodle";
+    std::vector<std::pair<size_t, size_t>> matches;
+    searcher.findMatches(text.data(), text.size(), 10, matches);
+
+    std::vector<std::wstring> found;
+    for(auto const &match : matches) {
+        found.push_back(text.substr(match.first, match.second));
+    }
+
+    std::vector<std::wstring> const expected = { L"nedle", L"needle", L"neeedle" };
+    EXPECT_EQ(found, expected);
+
+    matches.clear();
+    searcher.findMatches(text.data(), text.size(), 2, matches);
+    EXPECT_EQ(matches.size(), 2u);
+}
+
+TEST(StreamFuzzySearcher, FilterReportsBestDistance) {
+    std::filesystem::path const dir = std::filesystem::temp_directory_path() / "lightning_search_approx_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    std::ofstream(dir / "scan.txt") << "Invoice numbcr 1234\n";
+
+    CFilterContents const approximate(L"invoice number", true, false, false, 2);
+    EXPECT_TRUE(approximate.filterFile(dir / "scan.txt"));
+    EXPECT_EQ(approximate.findBestDistance(dir / "scan.txt"), 1u);
+
+    CFilterContents const exact(L"invoice number", true, false, false);
+    EXPECT_FALSE(exact.filterFile(dir / "scan.txt"));
+    EXPECT_EQ(exact.findBestDistance(dir / "scan.txt"), CFuzzyMatcher::NO_MATCH);
+
+    // Approximate filters are told apart by their number of edits, while
+    // exact ones keep their keys.
+    EXPECT_NE(approximate.getKey(), exact.getKey());
+    EXPECT_NE(approximate.getKey(), CFilterContents(L"invoice number", true, false, false, 1).getKey());
+    EXPECT_EQ(exact.getKey(), CFilterContents(L"invoice number", true, false, false, 0).getKey());
+
+    // Regexes are never approximate.
+    EXPECT_EQ(CFilterContents(L"a+", false, false, true, 2).getMaxEdits(), 0u);
+
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CStreamRegexSearcher.hpp>
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+TEST(StreamRegexSearcher, RejectsTextsWithoutRequiredLiterals)
+{
+    CStreamRegexSearcher const searcher(L"ERROR\\s+code=\\d+");
+    std::vector<std::wstring> const expected = { L"ERROR", L"code=" };
+    EXPECT_EQ(searcher.getRequiredLiterals(), expected);
+    EXPECT_EQ(searcher.getRequiredPrefix(), L"ERROR");
+
+    std::wstring const matching = L"INFO ok\nERROR  code=42\n";
+    std::wstring const literalsOnly = L"ERROR code= none\n";
+    std::wstring const missing = L"ERROR without the other one\n";
+
+    EXPECT_TRUE(searcher.searchBuffer(matching.data(), matching.size()));
+    EXPECT_FALSE(searcher.searchBuffer(literalsOnly.data(), literalsOnly.size()));
+    EXPECT_FALSE(searcher.searchBuffer(missing.data(), missing.size()));
+
+    CStreamRegexSearcher const insensitive(L"Error\\s+Code=\\d+", true);
+    EXPECT_EQ(insensitive.getRequiredLiterals(), (std::vector<std::wstring>{ L"error", L"code=" }));
+    EXPECT_TRUE(insensitive.searchBuffer(matching.data(), matching.size()));
+}
+
+TEST(StreamRegexSearcher, LineSearchesSeeTheWholeText)
+{
+    // Anchors and word boundaries at the edges of the line searched must
+    // behave as they do for the whole text.
+    std::wstring const text = L"xfoo\nfoo bar\nbarfoo";
+
+    auto search = [&](wchar_t const *pattern) {
+        return CStreamRegexSearcher(pattern).searchBuffer(text.data(), text.size());
+    };
+
+    EXPECT_FALSE(search(L"^foo"));
+    EXPECT_TRUE(search(L"^xfoo"));
+    EXPECT_TRUE(search(L"\\bfoo bar"));
+    EXPECT_FALSE(search(L"bar$"));
+    EXPECT_TRUE(search(L"barfoo$"));
+    EXPECT_FALSE(search(L"\\bfoo\\b.*bar\\bfoo"));
+    EXPECT_TRUE(search(L"oo\\b"));
+}
+
+TEST(StreamRegexSearcher, PrefilterAgreesWithRegex)
+{
+    std::mt19937 random(5);
+
+    static wchar_t const *const PIECES[] = {
+        L"ab", L"b", L"c", L"A", L"\\d", L"[a-c]", L"[^a]", L"\\s", L".", L"^", L"$", L"\\b",
+        L"(ab|c)", L"(?:bc)", L"(?=a)", L"a+", L"b?", L"c*", L"(ab)+", L"a{2}",
+    };
+    static wchar_t const TEXT_CHARS[] = { L'a', L'b', L'c', L'A', L'1', L' ', L'\n' };
+
+    for(int round = 0; round < 2000; ++round) {
+        std::wstring pattern;
+        for(size_t i = 1 + random() % 5; i > 0; --i) {
+            pattern += PIECES[random() % (sizeof(PIECES) / sizeof(PIECES[0]))];
+        }
+
+        std::wstring text;
+        for(size_t i = random() % 30; i > 0; --i) {
+            text += TEXT_CHARS[random() % (sizeof(TEXT_CHARS) / sizeof(TEXT_CHARS[0]))];
+        }
+
+        bool const caseInsensitive = random() % 2;
+        bool const wholeMatch = random() % 4 == 0;
+
+        auto flags = std::regex_constants::ECMAScript;
+        if(caseInsensitive) {
+            flags |= std::regex_constants::icase;
+        }
+        std::wregex const regex(pattern, flags);
+        bool const expected = wholeMatch ? std::regex_match(text, regex) : std::regex_search(text, regex);
+
+        CStreamRegexSearcher const searcher(pattern, caseInsensitive, wholeMatch);
+        EXPECT_EQ(searcher.searchBuffer(text.data(), text.size()), expected)
+            << "pattern " << std::string(pattern.begin(), pattern.end()) << ", round " << round;
+
+        // The texts are ASCII, so searching their bytes decides as well.
+        ASSERT_TRUE(searcher.canSearchBytes());
+        std::istringstream bytes(std::string(text.begin(), text.end()));
+        EXPECT_EQ(searcher.searchBytes(bytes),
+                  expected ? IStreamSearcher::ByteResult::Match : IStreamSearcher::ByteResult::NoMatch)
+            << "pattern " << std::string(pattern.begin(), pattern.end()) << ", round " << round;
+    }
+}
+
+TEST(StreamRegexSearcher, SearchesAsciiBytesOnly)
+{
+    CStreamRegexSearcher const searcher(L"caf.\\b");
+    EXPECT_TRUE(searcher.canSearchBytes());
+
+    // A match in the ASCII part of a text need not be one in all of it.
+    std::istringstream utf8("cafe caf\xC3\xA9");
+    EXPECT_EQ(searcher.searchBytes(utf8), IStreamSearcher::ByteResult::NeedsDecoding);
+
+    std::istringstream ascii("a cafe");
+    EXPECT_EQ(searcher.searchBytes(ascii), IStreamSearcher::ByteResult::Match);
+
+    EXPECT_FALSE(CStreamRegexSearcher(L"caf\u00e9").canSearchBytes());
+}
@@ -1,9 +1,14 @@
 // SPDX-License-Identifier: GPL-2.0
 #include <search/CStreamSearcher.hpp>
 
+#include <search/StreamBuffers.hpp>
+
 #include <gtest/gtest.h>
 
+#include <random>
+#include <stdexcept>
 #include <sstream>
+#include <string>
 #include <locale>
 #include <codecvt>
 
@@ -135,4 +140,177 @@ TEST(StreamSearcher, HandlesLargeStream_Match_AcrossChunkBoundary)
                           /*caseInsensitive=*/true,
                           /*wholeMatch=*/true,
                           /*maxBufferSize=*/25'000));
-}
\ No newline at end of file
+}
+
+/* --------------------------------------------------------------------------
+ *                     Whole-match length tests
+ * --------------------------------------------------------------------------*/
+TEST(StreamSearcher, WholeMatch_Negative_StreamIsPrefixOfMatchText)
+{
+    // The stream must contain the whole match text, not just its beginning.
+    EXPECT_FALSE(runSearch(L"alpha", L"alpha beta",
+                           /*caseInsensitive=*/false,
+                           /*wholeMatch=*/true));
+}
+
+TEST(StreamSearcher, WholeMatch_Negative_StreamIsPrefixAcrossChunks)
+{
+    std::wstring const longText(50'000, L'a');
+    std::wstring const matchText(60'000, L'a');
+
+    EXPECT_FALSE(runSearch(longText, matchText,
+                           /*caseInsensitive=*/false,
+                           /*wholeMatch=*/true,
+                           /*maxBufferSize=*/25'000));
+}
+
+/* --------------------------------------------------------------------------
+ *                     In-memory buffer tests
+ * --------------------------------------------------------------------------*/
+TEST(StreamSearcher, SearchBuffer_MatchesStreamResults)
+{
+    std::wstring const text = L"Hello World";
+
+    CStreamSearcher partial(L"world", /*caseInsensitive=*/true, /*wholeMatch=*/false);
+    CStreamSearcher whole(L"Hello World", /*caseInsensitive=*/false, /*wholeMatch=*/true);
+    CStreamSearcher prefix(L"Hello", /*caseInsensitive=*/false, /*wholeMatch=*/true);
+
+    EXPECT_TRUE(partial.searchBuffer(text.data(), text.size()));
+    EXPECT_TRUE(whole.searchBuffer(text.data(), text.size()));
+    EXPECT_FALSE(prefix.searchBuffer(text.data(), text.size()));
+}
+
+/* --------------------------------------------------------------------------
+ *                     Character types
+ * --------------------------------------------------------------------------*/
+template<typename CharT>
+static std::basic_string<CharT> convertText(std::wstring const &text) {
+    return std::basic_string<CharT>(text.begin(), text.end());
+}
+
+TEST(StreamSearcher, CharacterTypesAgree)
+{
+    std::mt19937 random(11);
+    std::uniform_int_distribution<int> pickChar(0, 3);
+
+    // Mixed case over a small alphabet, so that the needles occur often,
+    // also across the small windows.
+    auto makeText = [&](size_t const length) {
+        std::wstring text;
+        for(size_t i = 0; i < length; ++i) {
+            text += static_cast<wchar_t>((random() % 2 ? L'a' : L'A') + pickChar(random));
+        }
+        return text;
+    };
+
+    for(int round = 0; round < 200; ++round) {
+        std::wstring const needle = makeText(1 + random() % 4);
+        std::wstring const haystack = random() % 4 ? makeText(random() % 40) : needle;
+        bool const caseInsensitive = random() % 2;
+        bool const wholeMatch = random() % 2;
+        size_t const bufferSize = 1 + random() % 8;
+
+        std::wstringstream wideStream(haystack);
+        bool const expected = CBasicStreamSearcher<wchar_t>(needle, caseInsensitive, wholeMatch, bufferSize)
+                                  .searchText(wideStream);
+
+        std::istringstream narrowStream(convertText<char>(haystack));
+        EXPECT_EQ(CBasicStreamSearcher<char>(convertText<char>(needle), caseInsensitive, wholeMatch, bufferSize)
+                      .searchText(narrowStream), expected);
+
+        std::basic_string<char16_t> const utf16 = convertText<char16_t>(haystack);
+        CBasicStreamSearcher<char16_t> const utf16Searcher(convertText<char16_t>(needle), caseInsensitive, wholeMatch);
+        EXPECT_EQ(utf16Searcher.searchBuffer(utf16.data(), utf16.size()), expected);
+    }
+}
+
+TEST(StreamSearcher, NarrowSearchFoldsAsciiOnly)
+{
+    // The bytes of "É" in UTF-8 are left alone, and so is the match text.
+    CBasicStreamSearcher<char> const searcher("\xC3\xA9t\xC3\xA9", true, false);
+    std::string const text = "\xC3\x89T\xC3\xA9 / \xC3\xA9T\xC3\xA9";
+
+    std::vector<std::pair<size_t, size_t>> matches;
+    searcher.findMatches(text.data(), text.size(), 10, matches);
+    ASSERT_EQ(matches.size(), 1u);
+    EXPECT_EQ(matches[0].first, 8u);
+}
+
+TEST(StreamSearcher, CarriesOverlapWithoutSeeking)
+{
+    // A stream over CAsciiBuffer cannot seek, so the overlap between
+    // windows must be carried over in the buffer.
+    std::string const text = std::string(100, 'x') + "needle" + std::string(100, 'x');
+    CBasicStreamSearcher<char> const searcher("needle", false, false, 7);
+
+    for(size_t start = 0; start < 7; ++start) {
+        std::stringbuf source(text.substr(start));
+        CAsciiBuffer asciiBuffer(&source);
+        std::istream in(&asciiBuffer);
+        EXPECT_TRUE(searcher.searchText(in)) << "starting at " << start;
+    }
+}
+
+/* --------------------------------------------------------------------------
+ *                     Byte searches
+ * --------------------------------------------------------------------------*/
+static IStreamSearcher::ByteResult runByteSearch(std::string const &haystack,
+                                                 std::wstring const &needle,
+                                                 bool caseInsensitive,
+                                                 bool wholeMatch)
+{
+    std::istringstream ss(haystack);
+    CStreamSearcher searcher(needle, caseInsensitive, wholeMatch, 4);
+    return searcher.searchBytes(ss);
+}
+
+TEST(StreamSearcher, SearchesAsciiBytes)
+{
+    using ByteResult = IStreamSearcher::ByteResult;
+
+    EXPECT_EQ(runByteSearch("a NEEDLE in a haystack", L"needle", true, false), ByteResult::Match);
+    EXPECT_EQ(runByteSearch("a NEEDLE in a haystack", L"needle", false, false), ByteResult::NoMatch);
+    EXPECT_EQ(runByteSearch("Hello World", L"hello world", true, true), ByteResult::Match);
+    EXPECT_EQ(runByteSearch("Hello World!", L"hello world", true, true), ByteResult::NoMatch);
+
+    // Bytes outside ASCII end the byte search, unless it is decided
+    // before them.
+    EXPECT_EQ(runByteSearch("needle caf\xC3\xA9", L"needle", false, false), ByteResult::Match);
+    EXPECT_EQ(runByteSearch("caf\xC3\xA9 needle", L"needle", false, false), ByteResult::NeedsDecoding);
+    EXPECT_EQ(runByteSearch("Hello\xC3\xA9", L"Hello", false, true), ByteResult::NeedsDecoding);
+    EXPECT_EQ(runByteSearch("Help\xC3\xA9", L"Hello", false, true), ByteResult::NoMatch);
+}
+
+TEST(StreamSearcher, DecodesWholeMatchesWhichCaseFoldingCouldComplete)
+{
+    using ByteResult = IStreamSearcher::ByteResult;
+
+    // KELVIN SIGN (U+212A) folds to 'k', so the text might equal the match
+    // text once decoded. Case sensitive, it cannot.
+    EXPECT_EQ(runByteSearch("\xE2\x84\xAA", L"k", true, true), ByteResult::NeedsDecoding);
+    EXPECT_EQ(runByteSearch("o\xE2\x84\xAA", L"ok", true, true), ByteResult::NeedsDecoding);
+    EXPECT_EQ(runByteSearch("\xE2\x84\xAA", L"k", false, true), ByteResult::NoMatch);
+
+    std::locale const previous;
+    try {
+        std::locale::global(std::locale("C.UTF-8"));
+    } catch(std::runtime_error const &) {
+        GTEST_SKIP() << "C.UTF-8 locale not available";
+    }
+
+    // The decoded text agrees with the shared scan over the same text.
+    std::wstring const kelvin = L"\u212A";
+    EXPECT_TRUE(CStreamSearcher(L"k", true, true).searchBuffer(kelvin.data(), kelvin.size()));
+    EXPECT_TRUE(runSearch(kelvin, L"k", true, true));
+
+    std::locale::global(previous);
+}
+
+TEST(StreamSearcher, SearchesBytesOfAsciiMatchTextsOnly)
+{
+    EXPECT_TRUE(CStreamSearcher(L"needle").canSearchBytes());
+    EXPECT_FALSE(CStreamSearcher(L"caf\u00e9").canSearchBytes());
+
+    std::istringstream ss("caf\xC3\xA9");
+    EXPECT_EQ(CStreamSearcher(L"caf\u00e9").searchBytes(ss), IStreamSearcher::ByteResult::NeedsDecoding);
+}
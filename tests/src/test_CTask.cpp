@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <CBoundedQueue.hpp>
+#include <CTask.hpp>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST(Task, RunsSmallAndLargeCallables) {
+    int calls = 0;
+
+    CTask small([&calls]() { calls++; });
+
+    std::array<char, 4 * CTask::INLINE_SIZE> payload{};
+    payload[0] = 1;
+    CTask large([&calls, payload]() { calls += payload[0]; });
+
+    ASSERT_TRUE(small);
+    ASSERT_TRUE(large);
+    small();
+    large();
+    EXPECT_EQ(calls, 2);
+}
+
+TEST(Task, MovesOwnershipOfCallable) {
+    auto counter = std::make_shared<int>(0);
+
+    CTask first([counter]() { (*counter)++; });
+    EXPECT_EQ(counter.use_count(), 2);
+
+    CTask second(std::move(first));
+    EXPECT_FALSE(first);
+    second();
+    EXPECT_EQ(*counter, 1);
+
+    CTask third;
+    third = std::move(second);
+    third();
+    EXPECT_EQ(*counter, 2);
+
+    third.reset();
+    EXPECT_FALSE(third);
+    EXPECT_EQ(counter.use_count(), 1);
+}
+
+TEST(Task, AcceptsMoveOnlyCallables) {
+    auto value = std::make_unique<int>(7);
+    int result = 0;
+
+    CTask task([value = std::move(value), &result]() { result = *value; });
+    task();
+    EXPECT_EQ(result, 7);
+}
+
+TEST(BoundedQueue, IsFifoAndBounded) {
+    CBoundedQueue<int> queue(3);
+    EXPECT_EQ(queue.getCapacity(), 4u);
+    EXPECT_TRUE(queue.isEmpty());
+
+    for(int i = 0; i < 4; ++i) {
+        int item = i;
+        ASSERT_TRUE(queue.tryPush(item));
+    }
+
+    int overflow = 99;
+    EXPECT_FALSE(queue.tryPush(overflow));
+    EXPECT_EQ(overflow, 99);
+
+    for(int i = 0; i < 4; ++i) {
+        int item = -1;
+        ASSERT_TRUE(queue.tryPop(item));
+        EXPECT_EQ(item, i);
+    }
+
+    int item = -1;
+    EXPECT_FALSE(queue.tryPop(item));
+    EXPECT_TRUE(queue.isEmpty());
+}
+
+TEST(BoundedQueue, DeliversEveryItemOnceUnderContention) {
+    CBoundedQueue<int> queue(64);
+    int const itemsPerProducer = 20000;
+    int const producerCount = 3;
+    std::atomic<long long> sum(0);
+    std::atomic_int popped(0);
+
+    std::vector<std::thread> threads;
+
+    for(int p = 0; p < producerCount; ++p) {
+        threads.emplace_back([&queue, p]() {
+            for(int i = 1; i <= itemsPerProducer; ++i) {
+                int item = p * itemsPerProducer + i;
+                while(!queue.tryPush(item)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    for(int c = 0; c < 2; ++c) {
+        threads.emplace_back([&]() {
+            while(popped.load() < producerCount * itemsPerProducer) {
+                int item = 0;
+                if(queue.tryPop(item)) {
+                    sum += item;
+                    popped++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    for(std::thread &thread : threads) {
+        thread.join();
+    }
+
+    long long const n = producerCount * itemsPerProducer;
+    EXPECT_EQ(sum.load(), n * (n + 1) / 2);
+}
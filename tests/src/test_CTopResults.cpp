@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CTopResults.hpp>
+
+#include <search/CFilterContents.hpp>
+#include <search/CSearchEngine.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+static CRanking makeRanking(CRanking::Key const key, size_t const count) {
+    CRanking ranking;
+    ranking.key = key;
+    ranking.count = count;
+    ranking.isDescending = CRanking::isDescendingByDefault(key);
+    return ranking;
+}
+
+static std::vector<std::int64_t> getValues(std::vector<CRankedResult> const &results) {
+    std::vector<std::int64_t> values;
+    for(CRankedResult const &result : results) {
+        values.push_back(result.value);
+    }
+    return values;
+}
+
+class RankingRecorder : public ISearchObserver {
+public:
+    void onFileMatched(std::filesystem::path const &) override { m_matchCalls++; }
+
+    void onRankedResults(std::vector<CRankedResult> const &results, bool const isFinal) override {
+        std::lock_guard<std::mutex> const lock(m_mutex);
+        m_snapshots++;
+        if(isFinal) {
+            m_finalCalls++;
+            m_final = results;
+        }
+    }
+
+    std::atomic_int m_matchCalls{0};
+    std::mutex m_mutex;
+    int m_snapshots = 0;
+    int m_finalCalls = 0;
+    std::vector<CRankedResult> m_final;
+};
+
+TEST(TopResults, KeepsBestValues) {
+    CTopResults top(makeRanking(CRanking::Key::Size, 3));
+
+    for(std::int64_t value : { 5, 1, 9, 3, 7, 2, 8 }) {
+        top.add(CRankedResult{ "f" + std::to_string(value), value });
+    }
+
+    EXPECT_EQ(top.size(), 3u);
+    EXPECT_EQ(getValues(top.getSorted()), (std::vector<std::int64_t>{ 9, 8, 7 }));
+
+    EXPECT_TRUE(top.wouldKeep(10, "x"));
+    EXPECT_FALSE(top.wouldKeep(6, "x"));
+}
+
+TEST(TopResults, BreaksTiesByPathAndMerges) {
+    CRanking ranking = makeRanking(CRanking::Key::MatchCount, 2);
+    ranking.isDescending = false;
+
+    CTopResults first(ranking);
+    CTopResults second(ranking);
+
+    first.add(CRankedResult{ "c", 1 });
+    first.add(CRankedResult{ "d", 4 });
+    second.add(CRankedResult{ "a", 1 });
+    second.add(CRankedResult{ "b", 2 });
+
+    first.merge(second);
+    EXPECT_TRUE(second.empty());
+
+    std::vector<CRankedResult> const sorted = first.getSorted();
+    ASSERT_EQ(sorted.size(), 2u);
+    EXPECT_EQ(sorted[0].path, "a");
+    EXPECT_EQ(sorted[1].path, "c");
+}
+
+TEST(TopResults, RanksByPath) {
+    CTopResults top(makeRanking(CRanking::Key::Path, 2));
+
+    for(char const *path : { "m", "b", "z", "a" }) {
+        top.add(CRankedResult{ path, 0 });
+    }
+
+    std::vector<CRankedResult> const sorted = top.getSorted();
+    ASSERT_EQ(sorted.size(), 2u);
+    EXPECT_EQ(sorted[0].path, "a");
+    EXPECT_EQ(sorted[1].path, "b");
+}
+
+TEST(TopResults, EngineReportsOnlyTheBestMatches) {
+    std::filesystem::path const dir = std::filesystem::temp_directory_path() / "lightning_search_top_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    // File i has i + 1 matches and is (i + 1) * 7 + 1 bytes large.
+    for(int i = 0; i < 300; ++i) {
+        std::string contents;
+        for(int j = 0; j <= i; ++j) {
+            contents += "needle ";
+        }
+        std::ofstream(dir / ("file" + std::to_string(i) + ".txt")) << contents << "\n";
+    }
+
+    for(CRanking::Key const key : { CRanking::Key::Size, CRanking::Key::MatchCount }) {
+        RankingRecorder recorder;
+        CSearchQuery *query = new CSearchQuery;
+        query->setDirectories({ dir });
+        query->setFilters({ new CFilterContents(L"needle", false, false, false) });
+        query->setMaxMatchesPerFile(1000);
+        query->setRanking(makeRanking(key, 5));
+        query->addResultObserver(&recorder);
+
+        CSearchEngine engine(query);
+        engine.performSearch();
+        engine.waitForCompletion();
+
+        EXPECT_EQ(engine.getTotalMatches(), 300);
+        EXPECT_EQ(recorder.m_matchCalls.load(), 0);
+        EXPECT_EQ(recorder.m_finalCalls, 1);
+        EXPECT_GE(recorder.m_snapshots, 1);
+
+        ASSERT_EQ(recorder.m_final.size(), 5u);
+        for(size_t i = 0; i < 5; ++i) {
+            EXPECT_EQ(recorder.m_final[i].path.filename(), "file" + std::to_string(299 - i) + ".txt");
+        }
+
+        EXPECT_EQ(engine.getRankedResults().size(), 5u);
+    }
+
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,126 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <CTraceRecorder.hpp>
+
+#include <search/CFilterContents.hpp>
+#include <search/CSearchEngine.hpp>
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+static size_t countOccurrences(std::string const &text, std::string const &pattern) {
+    size_t count = 0;
+    for(size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1)) {
+        count++;
+    }
+    return count;
+}
+
+TEST(TraceRecorder, RecordsSpansOnlyInsideScope) {
+    CTraceRecorder recorder;
+
+    {
+        CTraceSpan span("Outside");
+        EXPECT_FALSE(span.isRecording());
+    }
+    EXPECT_EQ(recorder.getEventCount(), 0u);
+
+    {
+        CTraceRecorder::CScope const scope(&recorder);
+
+        CTraceSpan span("Inside");
+        EXPECT_TRUE(span.isRecording());
+        span.setDetail("some \"quoted\" path");
+        span.setValue(7);
+    }
+
+    EXPECT_EQ(CTraceRecorder::getCurrent(), nullptr);
+    ASSERT_EQ(recorder.getEventCount(), 1u);
+
+    std::string json;
+    recorder.writeJson(json);
+
+    EXPECT_NE(json.find("\"traceEvents\":["), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"Inside\""), std::string::npos);
+    EXPECT_NE(json.find("\"detail\":\"some \\\"quoted\\\" path\""), std::string::npos);
+    EXPECT_NE(json.find("\"value\":7"), std::string::npos);
+    EXPECT_EQ(json.find("Outside"), std::string::npos);
+}
+
+TEST(TraceRecorder, RingKeepsMostRecentEvents) {
+    CTraceRecorder recorder(4);
+    CTraceRecorder::Clock::time_point const now = CTraceRecorder::Clock::now();
+
+    for(int i = 0; i < 10; ++i) {
+        recorder.record("Event", now, now, std::string(), i);
+    }
+
+    EXPECT_EQ(recorder.getEventCount(), 4u);
+
+    std::string json;
+    recorder.writeJson(json);
+
+    EXPECT_EQ(json.find("\"value\":5"), std::string::npos);
+    for(int i = 6; i < 10; ++i) {
+        EXPECT_NE(json.find("\"value\":" + std::to_string(i)), std::string::npos);
+    }
+
+    // Oldest first.
+    EXPECT_LT(json.find("\"value\":6"), json.find("\"value\":9"));
+}
+
+TEST(TraceRecorder, GivesEachThreadItsOwnTrack) {
+    CTraceRecorder recorder;
+    CTraceRecorder::Clock::time_point const now = CTraceRecorder::Clock::now();
+
+    recorder.record("Main", now, now);
+    std::thread([&recorder, now]() { recorder.record("Other", now, now); }).join();
+
+    std::string json;
+    recorder.writeJson(json);
+
+    EXPECT_EQ(countOccurrences(json, "\"thread_name\""), 2u);
+    EXPECT_NE(json.find("\"tid\":1"), std::string::npos);
+    EXPECT_NE(json.find("\"tid\":2"), std::string::npos);
+}
+
+TEST(TraceRecorder, TracesSearch) {
+    std::filesystem::path const dir = std::filesystem::temp_directory_path() / "lightning_search_trace_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    for(int i = 0; i < 5; ++i) {
+        std::ofstream(dir / ("file" + std::to_string(i) + ".txt")) << "needle in a haystack";
+    }
+
+    CTraceRecorder recorder;
+
+    {
+        CSearchQuery *query = new CSearchQuery;
+        query->setDirectories({ dir });
+        query->setFilters({ new CFilterContents(L"needle", false, false, false) });
+
+        CSearchEngine engine(query);
+        engine.setTraceRecorder(&recorder);
+        engine.performSearch();
+        engine.waitForCompletion();
+    }
+
+    std::string json;
+    recorder.writeJson(json);
+
+    EXPECT_EQ(countOccurrences(json, "\"name\":\"Enumerate\""), 1u);
+    EXPECT_EQ(countOccurrences(json, "\"name\":\"Search batch\""), 1u);
+    EXPECT_EQ(countOccurrences(json, "\"name\":\"File\""), 5u);
+    EXPECT_EQ(countOccurrences(json, "\"name\":\"Open\""), 5u);
+    EXPECT_NE(json.find("file3.txt"), std::string::npos);
+
+    std::filesystem::path const tracePath = dir / "trace.json";
+    ASSERT_TRUE(recorder.writeJson(tracePath));
+    EXPECT_GT(std::filesystem::file_size(tracePath), 0u);
+
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,270 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CVerdictCache.hpp>
+
+#include <FileIdentity.hpp>
+#include <search/CFilterContents.hpp>
+#include <search/CSearchPlan.hpp>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// An identity of a file last modified long ago, which the cache accepts.
+static CFileIdentity makeIdentity(std::uint64_t const inode, std::uint64_t const size = 100) {
+    CFileIdentity identity;
+    identity.device = 42;
+    identity.inode = inode;
+    identity.size = size;
+    identity.modifiedTimeNs = 1500000000LL * 1000000000LL;
+    identity.linkCount = 1;
+    return identity;
+}
+
+class VerdictCacheTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        m_dir = std::filesystem::temp_directory_path() / "lightning_verdict_cache_test";
+        std::filesystem::remove_all(m_dir);
+        std::filesystem::create_directories(m_dir);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(m_dir);
+    }
+
+    std::filesystem::path writeFile(std::string const &name, std::string const &contents) {
+        std::filesystem::path const path = m_dir / name;
+        std::ofstream out(path, std::ios::binary);
+        out << contents;
+        out.close();
+
+        // Old enough for the cache to trust it.
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now() -
+                                               std::chrono::hours(1));
+        return path;
+    }
+
+    std::filesystem::path m_dir;
+};
+
+TEST(VerdictCacheFingerprint, IsNonZeroEvenAndDistinct) {
+    std::uint64_t const a = CVerdictCache::fingerprint(L"");
+    std::uint64_t const b = CVerdictCache::fingerprint(L"content:abc");
+    std::uint64_t const c = CVerdictCache::fingerprint(L"content:abd");
+
+    EXPECT_NE(a, 0u);
+    EXPECT_EQ(b & 1, 0u);
+    EXPECT_NE(b, c);
+    EXPECT_EQ(b, CVerdictCache::fingerprint(L"content:abc"));
+}
+
+TEST(VerdictCache, StoresAndFindsVerdicts) {
+    CVerdictCache cache;
+    std::uint64_t const fp = CVerdictCache::fingerprint(L"filter");
+
+    cache.store(makeIdentity(1), fp, true);
+    cache.store(makeIdentity(2), fp, false);
+
+    bool isMatch = false;
+    ASSERT_TRUE(cache.find(makeIdentity(1), fp, isMatch));
+    EXPECT_TRUE(isMatch);
+    ASSERT_TRUE(cache.find(makeIdentity(2), fp, isMatch));
+    EXPECT_FALSE(isMatch);
+    EXPECT_EQ(cache.getEntryCount(), 2u);
+
+    // Overwriting keeps one entry.
+    cache.store(makeIdentity(1), fp, false);
+    ASSERT_TRUE(cache.find(makeIdentity(1), fp, isMatch));
+    EXPECT_FALSE(isMatch);
+    EXPECT_EQ(cache.getEntryCount(), 2u);
+}
+
+TEST(VerdictCache, MissesOnAnyChangedKeyPart) {
+    CVerdictCache cache;
+    std::uint64_t const fp = CVerdictCache::fingerprint(L"filter");
+    cache.store(makeIdentity(1), fp, true);
+
+    CFileIdentity modified = makeIdentity(1);
+    modified.modifiedTimeNs += 1;
+
+    CFileIdentity otherDevice = makeIdentity(1);
+    otherDevice.device = 43;
+
+    bool isMatch = false;
+    EXPECT_FALSE(cache.find(makeIdentity(1, 101), fp, isMatch));
+    EXPECT_FALSE(cache.find(modified, fp, isMatch));
+    EXPECT_FALSE(cache.find(otherDevice, fp, isMatch));
+    EXPECT_FALSE(cache.find(makeIdentity(1), CVerdictCache::fingerprint(L"other"), isMatch));
+}
+
+TEST(VerdictCache, DoesNotStoreRecentlyModifiedFiles) {
+    CVerdictCache cache;
+    std::uint64_t const fp = CVerdictCache::fingerprint(L"filter");
+
+    CFileIdentity identity = makeIdentity(1);
+    identity.modifiedTimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    cache.store(identity, fp, true);
+
+    bool isMatch = false;
+    EXPECT_FALSE(cache.find(identity, fp, isMatch));
+    EXPECT_EQ(cache.getEntryCount(), 0u);
+}
+
+TEST(VerdictCache, StaysWithinItsBound) {
+    CVerdictCache cache(1024);
+    std::uint64_t const fp = CVerdictCache::fingerprint(L"filter");
+
+    for(std::uint64_t inode = 0; inode < 100000; ++inode) {
+        cache.store(makeIdentity(inode), fp, true);
+    }
+
+    EXPECT_LE(cache.getEntryCount(), 1024u);
+
+    // The most recent verdict survives.
+    bool isMatch = false;
+    EXPECT_TRUE(cache.find(makeIdentity(99999), fp, isMatch));
+}
+
+TEST(VerdictCache, SupportsConcurrentUse) {
+    CVerdictCache cache;
+    std::uint64_t const fp = CVerdictCache::fingerprint(L"filter");
+    std::vector<std::thread> threads;
+
+    for(std::uint64_t t = 0; t < 4; ++t) {
+        threads.emplace_back([&cache, fp, t]() {
+            for(std::uint64_t i = 0; i < 10000; ++i) {
+                std::uint64_t const inode = t * 10000 + i;
+                cache.store(makeIdentity(inode), fp, (inode % 2) == 0);
+
+                bool isMatch = false;
+                if(!cache.find(makeIdentity(inode), fp, isMatch) || isMatch != ((inode % 2) == 0)) {
+                    ADD_FAILURE() << "verdict of inode " << inode << " lost";
+                    return;
+                }
+            }
+        });
+    }
+
+    for(std::thread &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(cache.getEntryCount(), 40000u);
+}
+
+TEST_F(VerdictCacheTest, SavesAndLoads) {
+    CVerdictCache cache;
+    std::uint64_t const fp = CVerdictCache::fingerprint(L"filter");
+
+    for(std::uint64_t inode = 0; inode < 5000; ++inode) {
+        cache.store(makeIdentity(inode), fp, (inode % 3) == 0);
+    }
+
+    std::filesystem::path const cachePath = m_dir / "verdicts.cache";
+    ASSERT_TRUE(cache.save(cachePath));
+
+    CVerdictCache loaded;
+    ASSERT_TRUE(loaded.load(cachePath));
+    EXPECT_EQ(loaded.getEntryCount(), 5000u);
+
+    for(std::uint64_t inode = 0; inode < 5000; ++inode) {
+        bool isMatch = false;
+        ASSERT_TRUE(loaded.find(makeIdentity(inode), fp, isMatch));
+        EXPECT_EQ(isMatch, (inode % 3) == 0);
+    }
+}
+
+TEST_F(VerdictCacheTest, RejectsInvalidFiles) {
+    CVerdictCache cache;
+    EXPECT_FALSE(cache.load(m_dir / "missing.cache"));
+    EXPECT_FALSE(cache.load(writeFile("garbage.cache", "not a cache file at all")));
+
+    // A truncated file is rejected without adding anything.
+    CVerdictCache full;
+    full.store(makeIdentity(1), CVerdictCache::fingerprint(L"filter"), true);
+    ASSERT_TRUE(full.save(m_dir / "full.cache"));
+    std::filesystem::resize_file(m_dir / "full.cache", std::filesystem::file_size(m_dir / "full.cache") - 1);
+
+    EXPECT_FALSE(cache.load(m_dir / "full.cache"));
+    EXPECT_EQ(cache.getEntryCount(), 0u);
+}
+
+TEST_F(VerdictCacheTest, FileIdentityFollowsHardLinksAndModifications) {
+    std::filesystem::path const path = writeFile("a.txt", "hello");
+    std::filesystem::path const link = m_dir / "b.txt";
+
+    std::error_code ec;
+    std::filesystem::create_hard_link(path, link, ec);
+
+    CFileIdentity identity;
+    ASSERT_TRUE(getFileIdentity(path, identity));
+    EXPECT_EQ(identity.size, 5u);
+    EXPECT_FALSE(isRecentlyModified(identity));
+
+    if(!ec) {
+        CFileIdentity linkIdentity;
+        ASSERT_TRUE(getFileIdentity(link, linkIdentity));
+        EXPECT_EQ(linkIdentity.device, identity.device);
+        EXPECT_EQ(linkIdentity.inode, identity.inode);
+        EXPECT_EQ(linkIdentity.linkCount, 2u);
+    }
+
+    std::ofstream(path, std::ios::app) << " world";
+
+    CFileIdentity modified;
+    ASSERT_TRUE(getFileIdentity(path, modified));
+    EXPECT_EQ(modified.size, 11u);
+    EXPECT_TRUE(isRecentlyModified(modified));
+
+    EXPECT_FALSE(getFileIdentity(m_dir / "missing.txt", identity));
+}
+
+TEST_F(VerdictCacheTest, PlanStoresAndUsesVerdicts) {
+    std::filesystem::path const hit = writeFile("hit.txt", "needle in a haystack");
+    std::filesystem::path const miss = writeFile("miss.txt", "only hay in here");
+
+    CFilterContents needle(L"needle");
+    CFilterContents hay(L"hay");
+    CSearchPlan plan({ &needle, &hay });
+
+    CVerdictCache cache;
+    plan.setVerdictCache(&cache);
+
+    EXPECT_TRUE(plan.matches(hit));
+    EXPECT_FALSE(plan.matches(miss));
+
+    // Both verdicts of the matching file, and the rejecting one of the
+    // other file.
+    EXPECT_EQ(cache.getEntryCount(), 3u);
+
+    CFileIdentity hitIdentity;
+    CFileIdentity missIdentity;
+    ASSERT_TRUE(getFileIdentity(hit, hitIdentity));
+    ASSERT_TRUE(getFileIdentity(miss, missIdentity));
+
+    // Swap the verdicts around. The plan now trusts the cache over the
+    // contents, which proves it does not read the files.
+    cache.store(hitIdentity, needle.getFingerprint(), false);
+    cache.store(missIdentity, needle.getFingerprint(), true);
+    cache.store(missIdentity, hay.getFingerprint(), true);
+
+    EXPECT_FALSE(plan.matches(hit));
+    EXPECT_TRUE(plan.matches(miss));
+
+    // Verdicts are shared with other plans using the same filter.
+    CFilterContents sameNeedle(L"needle");
+    CSearchPlan otherPlan({ &sameNeedle });
+    otherPlan.setVerdictCache(&cache);
+    EXPECT_TRUE(otherPlan.matches(miss));
+
+    // Locations still require the contents to be read.
+    std::vector<CMatchLocation> locations;
+    EXPECT_TRUE(plan.matches(miss, &locations));
+}
@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <search/CVisitedInodes.hpp>
+
+#include <search/CDirectoryWalker.hpp>
+#include <search/CFilterContents.hpp>
+#include <search/CFilterName.hpp>
+#include <search/CSearchEngine.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using Stage = CSearchStats::Stage;
+
+class CVisitedPathCollector : public ISearchObserver {
+public:
+    void onFileMatched(std::filesystem::path const &path) override {
+        std::lock_guard<std::mutex> const lock(m_mutex);
+        m_paths.push_back(path.filename().string());
+    }
+
+    std::vector<std::string> getSorted() {
+        std::lock_guard<std::mutex> const lock(m_mutex);
+        std::vector<std::string> paths = m_paths;
+        std::sort(paths.begin(), paths.end());
+        return paths;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::vector<std::string> m_paths;
+};
+
+static std::filesystem::path makeTestDirectory(char const *name) {
+    std::filesystem::path const dir = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    return dir;
+}
+
+TEST(VisitedInodes, RecordsFirstVisitAndVerdict) {
+    CVisitedInodes visited;
+
+    EXPECT_EQ(visited.visit(1, 100), CVisitedInodes::State::New);
+    EXPECT_EQ(visited.visit(1, 100), CVisitedInodes::State::Pending);
+    EXPECT_EQ(visited.visit(2, 100), CVisitedInodes::State::New);
+
+    visited.setVerdict(1, 100, true);
+    visited.setVerdict(2, 100, false);
+    EXPECT_EQ(visited.visit(1, 100), CVisitedInodes::State::Match);
+    EXPECT_EQ(visited.visit(2, 100), CVisitedInodes::State::NoMatch);
+    EXPECT_EQ(visited.size(), 2u);
+
+    visited.clear();
+    EXPECT_EQ(visited.size(), 0u);
+    EXPECT_EQ(visited.visit(1, 100), CVisitedInodes::State::New);
+}
+
+TEST(VisitedInodes, RemovesOverlappingRoots) {
+    std::filesystem::path const dir = makeTestDirectory("lightning_search_roots_test");
+    std::filesystem::create_directories(dir / "a" / "b");
+    std::filesystem::create_directories(dir / "ab");
+
+    std::vector<std::filesystem::path> const roots = CDirectoryWalker::removeOverlappingRoots({
+        dir / "a" / "b",
+        dir / "ab",
+        dir / "a",
+        dir / "ab" / "",
+        dir / "a" / ".." / "ab",
+    });
+
+    // "ab" is not within "a", even though its name starts with it.
+    ASSERT_EQ(roots.size(), 2u);
+    EXPECT_EQ(roots[0], dir / "ab");
+    EXPECT_EQ(roots[1], dir / "a");
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(VisitedInodes, EngineReadsHardLinkedFileOnce) {
+    std::filesystem::path const dir = makeTestDirectory("lightning_search_hardlink_test");
+    std::ofstream(dir / "original.txt") << "needle";
+    std::ofstream(dir / "other.txt") << "haystack";
+    std::filesystem::create_hard_link(dir / "original.txt", dir / "link.txt");
+
+    CSearchSettings settings;
+    settings.setWorkerThreads(1);
+
+    CVisitedPathCollector collector;
+    CSearchQuery *query = new CSearchQuery;
+    query->setDirectories({ dir, dir / "." });
+    query->setFilters({ new CFilterContents(L"needle", false, false, false) });
+    query->addResultObserver(&collector);
+
+    CSearchEngine engine(query, settings);
+    engine.performSearch();
+    engine.waitForCompletion();
+
+    // Both names are reported, but the shared contents are read once and
+    // the duplicate root is not walked.
+    EXPECT_EQ(collector.getSorted(), (std::vector<std::string>{ "link.txt", "original.txt" }));
+    ASSERT_NE(engine.getStats(), nullptr);
+    EXPECT_EQ(engine.getStats()->getSummary(Stage::Open).count, 2u);
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(VisitedInodes, EngineAppliesNameFiltersToEachHardLink) {
+    std::filesystem::path const dir = makeTestDirectory("lightning_search_hardlink_name_test");
+    std::ofstream(dir / "a.txt") << "hello world";
+    std::filesystem::create_hard_link(dir / "a.txt", dir / "b.log");
+
+    for(std::wstring const &pattern : { L"\\.txt$", L"\\.log$" }) {
+        CSearchSettings settings;
+        settings.setWorkerThreads(1);
+
+        CVisitedPathCollector collector;
+        CSearchQuery *query = new CSearchQuery;
+        query->setDirectories({ dir });
+        query->setFilters({ new CFilterName(pattern, false, false, true),
+                            new CFilterContents(L"hello", false, false, false) });
+        query->addResultObserver(&collector);
+
+        CSearchEngine engine(query, settings);
+        engine.performSearch();
+        engine.waitForCompletion();
+
+        // Whichever name is seen first, the contents are shared but each
+        // name is matched on its own.
+        std::vector<std::string> const expected{ pattern == L"\\.txt$" ? "a.txt" : "b.log" };
+        EXPECT_EQ(collector.getSorted(), expected);
+        ASSERT_NE(engine.getStats(), nullptr);
+        EXPECT_LE(engine.getStats()->getSummary(Stage::Open).count, 1u);
+    }
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(VisitedInodes, EngineFollowsSymlinksWithoutLooping) {
+    std::filesystem::path const dir = makeTestDirectory("lightning_search_follow_test");
+    std::filesystem::create_directories(dir / "root" / "sub");
+    std::filesystem::create_directories(dir / "elsewhere");
+    std::ofstream(dir / "root" / "sub" / "file.txt") << "needle";
+    std::ofstream(dir / "elsewhere" / "linked.txt") << "needle";
+
+    // A cycle back to the root, and a link to a directory outside of it
+    std::filesystem::create_directory_symlink(dir / "root", dir / "root" / "sub" / "loop");
+    std::filesystem::create_directory_symlink(dir / "elsewhere", dir / "root" / "out");
+
+    for(bool const followSymlinks : { false, true }) {
+        CVisitedPathCollector collector;
+        CSearchQuery *query = new CSearchQuery;
+        query->setDirectories({ dir / "root" });
+        query->setFilters({ new CFilterContents(L"needle", false, false, false) });
+        query->setFollowSymlinks(followSymlinks);
+        query->addResultObserver(&collector);
+
+        CSearchEngine engine(query);
+        engine.performSearch();
+        engine.waitForCompletion();
+
+        if(followSymlinks) {
+            EXPECT_EQ(collector.getSorted(), (std::vector<std::string>{ "file.txt", "linked.txt" }));
+        } else {
+            EXPECT_EQ(collector.getSorted(), (std::vector<std::string>{ "file.txt" }));
+        }
+    }
+
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <locale>
+#include <stdexcept>
+#include <string>
+
+#if defined(LIGHTNING_CLI_PATH) && !defined(_WIN32)
+
+#include <sys/wait.h>
+
+/**
+ * @brief Run the command-line program under a UTF-8 locale.
+ *
+ * @return the exit code, or -1 if the program did not exit normally
+ */
+static int runCli(std::string const &arguments, std::string &output) {
+    std::string const command = "LC_ALL=C.UTF-8 '" LIGHTNING_CLI_PATH "' " + arguments + " 2>&1";
+
+    FILE *pipe = popen(command.c_str(), "r");
+    if(!pipe) {
+        return -1;
+    }
+
+    output.clear();
+    char buffer[4096];
+    size_t size;
+    while((size = std::fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, size);
+    }
+
+    int const status = pclose(pipe);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+TEST(Cli, SearchesUtf8TextInTheEnvironmentsLocale) {
+    try {
+        std::locale("C.UTF-8");
+    } catch(std::runtime_error const &) {
+        GTEST_SKIP() << "C.UTF-8 locale not available";
+    }
+
+    std::filesystem::path const dir = std::filesystem::temp_directory_path() / "lightning_search_cli_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    std::ofstream(dir / "hello.txt", std::ios::binary) << "h\xC3\xA9llo world";
+
+    std::string output;
+
+    EXPECT_EQ(runCli("-c world '" + dir.string() + "'", output), 0);
+    EXPECT_NE(output.find("hello.txt"), std::string::npos);
+
+    EXPECT_EQ(runCli("-e 'w.rld' '" + dir.string() + "'", output), 0);
+    EXPECT_NE(output.find("hello.txt"), std::string::npos);
+
+    // Search text outside ASCII
+    EXPECT_EQ(runCli("-c 'h\xC3\xA9llo' '" + dir.string() + "'", output), 0);
+    EXPECT_NE(output.find("hello.txt"), std::string::npos);
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(Cli, AcceptsValuesAttachedToShortOptions) {
+    std::filesystem::path const dir = std::filesystem::temp_directory_path() / "lightning_search_cli_short_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    std::ofstream(dir / "hello.txt", std::ios::binary) << "hello world";
+    std::ofstream(dir / "other.log", std::ios::binary) << "hello world";
+
+    std::string output;
+
+    EXPECT_EQ(runCli("-j1 -n'hello' -cworld '" + dir.string() + "'", output), 0);
+    EXPECT_NE(output.find("hello.txt"), std::string::npos);
+    EXPECT_EQ(output.find("other.log"), std::string::npos);
+
+    // Options without a value are not bundled.
+    EXPECT_EQ(runCli("-iw -c world '" + dir.string() + "'", output), 2);
+    EXPECT_NE(output.find("unknown option -iw"), std::string::npos);
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(Cli, ReportsMissingDirectories) {
+    std::string output;
+
+    EXPECT_EQ(runCli("-c world /nonexistent/lightning_search", output), 2);
+    EXPECT_NE(output.find("not a directory"), std::string::npos);
+    EXPECT_NE(output.find("no directory to search"), std::string::npos);
+}
+
+#endif
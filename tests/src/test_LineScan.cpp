@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <LineScan.hpp>
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+TEST(LineScan, CountsNewlinesInAllCharacterWidths)
+{
+    std::string const narrow = "a\nb\n\nc";
+    std::u16string const utf16 = u"a\nb\n\nc";
+    std::wstring const wide = L"a\nb\n\nc";
+
+    EXPECT_EQ(countNewlines(narrow.data(), narrow.size()), 3u);
+    EXPECT_EQ(countNewlines(utf16.data(), utf16.size()), 3u);
+    EXPECT_EQ(countNewlines(wide.data(), wide.size()), 3u);
+}
+
+TEST(LineScan, CountsAcrossVectorBlocksAndTail)
+{
+    // 1000 characters with a newline every 7th character, so that both
+    // the vectorized blocks and the scalar tail contain newlines.
+    std::wstring text(1000, L'x');
+    size_t expected = 0;
+    for(size_t i = 0; i < text.size(); i += 7) {
+        text[i] = L'\n';
+        expected++;
+    }
+
+    EXPECT_EQ(countNewlines(text.data(), text.size()), expected);
+    EXPECT_EQ(countNewlines(text.data() + 1, text.size() - 1), expected - 1);
+}
+
+TEST(LineScan, EmptyBuffer)
+{
+    EXPECT_EQ(countNewlines(static_cast<wchar_t const *>(nullptr), 0), 0u);
+}